@@ -504,7 +504,7 @@ class CLDR():
 		return {"mini_lut_bin": mini_lut_array_bin, "covered_glyphs":glyphs, "hid_to_glyph_lut":hid_to_glyph_lut, "glyphs_from_transforms":glyphs_from_transforms, "transforms":transforms}
 
 
-	def generate_mini_ble_lut(self, platform_name, layout_name, debug_print, layout_description, export_file_name):
+	def generate_mini_ble_lut(self, platform_name, layout_name, debug_print, layout_description, export_file_name, layout_flags=0):
 		layout = self.layouts[platform_name][layout_name]
 		sorted_keys = sorted(layout)
 		lut_bin_dict = {}
@@ -571,6 +571,7 @@ class CLDR():
 			print("Deadkeys: " + "/".join(chr(i) for i in dead_keys))
 					
 		# Language description (max 19 chars unicode, then we append 0)
+		# The last character is replaced by the layout flags (bit 0: no key packing in a single report)
 		language_desc_item = array('B')
 		i = 0
 		for c in layout_description:
@@ -579,8 +580,9 @@ class CLDR():
 		if i > 19:
 			print("Language description too long!")
 			sys.exit(0)
-		for remain_i in range(i, 20):
+		for remain_i in range(i, 19):
 			language_desc_item.frombytes(pack('H', 0))
+		language_desc_item.frombytes(pack('H', layout_flags))
 			
 		# Intervals (max 20 intervals, max 20 keys non described)
 		intervals_item = array('B')		
@@ -696,7 +698,7 @@ print("Parsing CLDR files...")
 cldr = CLDR()
 cldr.parse_cldr_xml()
 
-# Generation descriptiona array: platform / layout / description
+# Generation descriptiona array: platform / layout / description / optional layout flags
 keyboard_generation_array = [ \
 								[ "windows", "Belgian French", "Belgium French"],\
 								[ "windows", "Portuguese (Brazil ABNT)", "Brazil"],\
@@ -758,7 +760,8 @@ if False:
 
 counter = 0
 for array_item in keyboard_generation_array:
-	cldr.generate_mini_ble_lut(array_item[0], array_item[1], False, array_item[2], str(counter) + "_" + array_item[0] + "_" + array_item[1].replace(" ","").lower() + ".img")
+	layout_flags = array_item[3] if len(array_item) > 3 else 0
+	cldr.generate_mini_ble_lut(array_item[0], array_item[1], False, array_item[2], str(counter) + "_" + array_item[0] + "_" + array_item[1].replace(" ","").lower() + ".img", layout_flags)
 	print("Generated " + str(counter) + "_" + array_item[0] + "_" + array_item[1].lower() + ".img")
 	counter += 1
 
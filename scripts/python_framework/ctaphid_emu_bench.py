@@ -0,0 +1,200 @@
+from __future__ import print_function
+import tempfile
+import hashlib
+import socket
+import struct
+import time
+import sys
+import os
+
+# Software CTAP2 client for the emulator ctaphid socket (emulator --ctaphid-socket <name>)
+# Benchmarks silent getAssertion round trips: assertions per second and signing latency
+# Usage: ctaphid_emu_bench.py <socket name> [nb assertions] [credential id hex]
+# Without a credential id, one is made first: approve it on the emulator screen
+# Assertions need a logged in user, eg emulator started from a snapshot
+
+CTAPHID_REPORT_SIZE		= 64
+CTAPHID_BROADCAST_CID	= 0xFFFFFFFF
+CTAPHID_INIT			= 0x86
+CTAPHID_CBOR			= 0x90
+CTAPHID_KEEPALIVE		= 0xBB
+CTAPHID_ERROR			= 0xBF
+CTAP_MAKE_CREDENTIAL	= 0x01
+CTAP_GET_ASSERTION		= 0x02
+BENCH_RP_ID				= "bench.mooltipass.com"
+
+# Minimal CBOR, only the types CTAP2 uses
+def cbor_head(major, value):
+	if value < 24:
+		return struct.pack(">B", (major << 5) | value)
+	elif value < 0x100:
+		return struct.pack(">BB", (major << 5) | 24, value)
+	elif value < 0x10000:
+		return struct.pack(">BH", (major << 5) | 25, value)
+	else:
+		return struct.pack(">BI", (major << 5) | 26, value)
+
+def cbor_encode(obj):
+	if isinstance(obj, bool):
+		return b"\xf5" if obj else b"\xf4"
+	elif isinstance(obj, int):
+		return cbor_head(0, obj) if obj >= 0 else cbor_head(1, -1 - obj)
+	elif isinstance(obj, bytes):
+		return cbor_head(2, len(obj)) + obj
+	elif isinstance(obj, str):
+		return cbor_head(3, len(obj.encode())) + obj.encode()
+	elif isinstance(obj, list):
+		return cbor_head(4, len(obj)) + b"".join(cbor_encode(item) for item in obj)
+	elif isinstance(obj, dict):
+		return cbor_head(5, len(obj)) + b"".join(cbor_encode(key) + cbor_encode(obj[key]) for key in obj)
+	raise ValueError("Unsupported CBOR type")
+
+def cbor_decode(data, offset=0):
+	major = data[offset] >> 5
+	info = data[offset] & 0x1F
+	offset += 1
+	if info < 24:
+		value = info
+	elif info == 24:
+		value = data[offset]
+		offset += 1
+	elif info == 25:
+		value = struct.unpack_from(">H", data, offset)[0]
+		offset += 2
+	elif info == 26:
+		value = struct.unpack_from(">I", data, offset)[0]
+		offset += 4
+	else:
+		value = struct.unpack_from(">Q", data, offset)[0]
+		offset += 8
+	if major == 0:
+		return value, offset
+	elif major == 1:
+		return -1 - value, offset
+	elif major == 2:
+		return bytes(data[offset:offset+value]), offset + value
+	elif major == 3:
+		return bytes(data[offset:offset+value]).decode(), offset + value
+	elif major == 4:
+		items = []
+		for i in range(value):
+			item, offset = cbor_decode(data, offset)
+			items.append(item)
+		return items, offset
+	elif major == 5:
+		items = {}
+		for i in range(value):
+			key, offset = cbor_decode(data, offset)
+			items[key], offset = cbor_decode(data, offset)
+		return items, offset
+	elif major == 7:
+		return {20: False, 21: True, 22: None}.get(info), offset
+	raise ValueError("Unsupported CBOR type")
+
+class ctaphid_emu_client:
+	def __init__(self, socket_name):
+		# Qt local sockets without a path live in the temp dir
+		if "/" not in socket_name:
+			socket_name = os.path.join(tempfile.gettempdir(), socket_name)
+		self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+		self.sock.connect(socket_name)
+		self.cid = CTAPHID_BROADCAST_CID
+		self.nb_keepalives = 0
+
+	def send_message(self, cmd, payload):
+		# Init report then continuation reports, all zero padded to 64 bytes
+		reports = [struct.pack(">IBH", self.cid, cmd, len(payload)) + payload[:57]]
+		payload = payload[57:]
+		while len(payload) > 0:
+			reports.append(struct.pack(">IB", self.cid, len(reports) - 1) + payload[:59])
+			payload = payload[59:]
+		self.sock.sendall(b"".join(report.ljust(CTAPHID_REPORT_SIZE, b"\x00") for report in reports))
+
+	def receive_report(self):
+		report = b""
+		while len(report) < CTAPHID_REPORT_SIZE:
+			chunk = self.sock.recv(CTAPHID_REPORT_SIZE - len(report))
+			if len(chunk) == 0:
+				raise IOError("Emulator closed the ctaphid socket")
+			report += chunk
+		return report
+
+	def receive_message(self):
+		while True:
+			report = self.receive_report()
+			cid, cmd, length = struct.unpack_from(">IBH", report)
+			if cmd == CTAPHID_KEEPALIVE:
+				self.nb_keepalives += 1
+				continue
+			payload = report[7:7+length]
+			while len(payload) < length:
+				payload += self.receive_report()[5:5+length-len(payload)]
+			if cmd == CTAPHID_ERROR:
+				raise IOError("CTAPHID error 0x%02x" % payload[0])
+			return cmd, payload
+
+	def init_channel(self):
+		nonce = os.urandom(8)
+		self.send_message(CTAPHID_INIT, nonce)
+		cmd, payload = self.receive_message()
+		if cmd != CTAPHID_INIT or payload[:8] != nonce:
+			raise IOError("CTAPHID init failed")
+		self.cid = struct.unpack_from(">I", payload, 8)[0]
+
+	def cbor_command(self, ctap_cmd, params):
+		self.send_message(CTAPHID_CBOR, struct.pack(">B", ctap_cmd) + cbor_encode(params))
+		cmd, payload = self.receive_message()
+		if payload[0] != 0:
+			raise IOError("CTAP2 error 0x%02x" % payload[0])
+		return cbor_decode(payload, 1)[0]
+
+	def make_credential(self):
+		params = {1: hashlib.sha256(b"bench make credential").digest(),
+				  2: {"id": BENCH_RP_ID, "name": BENCH_RP_ID},
+				  3: {"id": b"bench", "name": "bench", "displayName": "bench"},
+				  4: [{"alg": -7, "type": "public-key"}]}
+		auth_data = self.cbor_command(CTAP_MAKE_CREDENTIAL, params)[2]
+		# rpid hash, flags, counter, aaguid, then the credential id length & credential id
+		cred_id_len = struct.unpack_from(">H", auth_data, 32+1+4+16)[0]
+		return auth_data[32+1+4+16+2:32+1+4+16+2+cred_id_len]
+
+	def get_silent_assertion(self, cred_id):
+		params = {1: BENCH_RP_ID,
+				  2: hashlib.sha256(b"bench get assertion").digest(),
+				  3: [{"id": cred_id, "type": "public-key"}],
+				  5: {"up": False}}
+		return self.cbor_command(CTAP_GET_ASSERTION, params)
+
+def percentile(samples, percent):
+	samples = sorted(samples)
+	return samples[(len(samples) - 1) * percent // 100]
+
+def main():
+	if len(sys.argv) < 2:
+		print("Usage: ctaphid_emu_bench.py <socket name> [nb assertions] [credential id hex]")
+		sys.exit(1)
+
+	nb_assertions = int(sys.argv[2]) if len(sys.argv) > 2 else 100
+	client = ctaphid_emu_client(sys.argv[1])
+	client.init_channel()
+
+	if len(sys.argv) > 3:
+		cred_id = bytes.fromhex(sys.argv[3])
+	else:
+		print("Making a credential for " + BENCH_RP_ID + ", approve it on the emulator...")
+		cred_id = client.make_credential()
+		print("Credential id: " + cred_id.hex())
+
+	latencies_us = []
+	start = time.perf_counter()
+	for i in range(nb_assertions):
+		request_start = time.perf_counter()
+		client.get_silent_assertion(cred_id)
+		latencies_us.append(int((time.perf_counter() - request_start) * 1000000))
+	total_s = time.perf_counter() - start
+
+	print("assertions;p50_us;p99_us;max_us;assertions_per_s;keepalives")
+	print("%u;%u;%u;%u;%.1f;%u" % (nb_assertions, percentile(latencies_us, 50), percentile(latencies_us, 99), max(latencies_us), nb_assertions / total_s, client.nb_keepalives))
+
+if __name__ == "__main__":
+	main()
@@ -65,6 +65,8 @@ HID_CMD_ID_GET_BATTERY_STATUS   = 0x800D
 HID_CMD_ID_FLASH_AUX_AND_MAIN   = 0x800E
 HID_CMD_ID_GET_PLAT_TIME        = 0x800F
 CMD_DBG_FLASH_PLAT_UNIQUE_DATA	= 0x8010
+CMD_DBG_GET_DBFLASH_CACHE_STATS	= 0x8011
+CMD_DBG_GET_PROFILER_STATS		= 0x8012
 
 # OLD Command IDs
 CMD_EXPORT_FLASH_START  = 0x8A
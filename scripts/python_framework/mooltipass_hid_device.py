@@ -300,6 +300,26 @@ class mooltipass_hid_device:
 		print("Total 30mins battery powered: " + str(total_nb_30mins_bat_on))
 		print("Total 30mins USB powered: " + str(total_nb_30mins_usb_on))
 
+	# Print database flash page cache counters
+	def printDbflashCacheStats(self, reset_stats):
+		packet = self.device.sendHidMessageWaitForAck(self.getPacketForCommand(CMD_DBG_GET_DBFLASH_CACHE_STATS, [1 if reset_stats else 0]))
+		nb_hits = struct.unpack('I', packet["data"][0:4])[0]
+		nb_misses = struct.unpack('I', packet["data"][4:8])[0]
+		print("Page cache hits: " + str(nb_hits))
+		print("Page cache misses: " + str(nb_misses))
+		if nb_hits + nb_misses != 0:
+			print("Hit rate: " + str(round(100 * nb_hits / (nb_hits + nb_misses), 1)) + "%")
+
+	# Print hot path profiler table, cycles are 48MHz MCU systick ticks
+	def printProfilerStats(self, reset_stats):
+		section_names = ["dbflash read", "custom fs read", "oled flush", "aes ctr", "aux mcu routine", "gui screen render", "gui carousel render"]
+		packet = self.device.sendHidMessageWaitForAck(self.getPacketForCommand(CMD_DBG_GET_PROFILER_STATS, [1 if reset_stats else 0]))
+		print("{:<20} {:>10} {:>14} {:>12} {:>10} {:>10}".format("section", "calls", "total cycles", "max cycles", "avg us", "max us"))
+		for i in range(0, len(section_names)):
+			nb_calls, max_cycles, total_cycles = struct.unpack('IIQ', packet["data"][i*16:i*16+16])
+			avg_us = total_cycles / nb_calls / 48 if nb_calls != 0 else 0
+			print("{:<20} {:>10} {:>14} {:>12} {:>10.1f} {:>10.1f}".format(section_names[i], nb_calls, total_cycles, max_cycles, avg_us, max_cycles / 48))
+
 	# Send bundle to display
 	def uploadDebugBundle(self, filename):	
 		# Check for file
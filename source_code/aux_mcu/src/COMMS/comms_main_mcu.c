@@ -42,6 +42,10 @@ volatile BOOL comms_main_mcu_other_msg_answered_using_first_bytes = FALSE;
 BOOL comms_main_mcu_invalid_message_received_from_main = FALSE;
 /* Flag set when adc watchdog fired */
 BOOL comms_main_mcu_adc_watchdog_fired = FALSE;
+/* Flag set when the main MCU accepts framed messages */
+BOOL comms_main_mcu_framing_enabled = FALSE;
+/* CRC16 CCITT lookup table, one nibble at a time */
+const uint16_t comms_main_mcu_crc16_nibble_table[16] = {0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7, 0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF};
 
 /*! \fn     comms_main_init_rx(void)
 *   \brief  Init communications with aux MCU
@@ -51,6 +55,71 @@ void comms_main_init_rx(void)
     dma_main_mcu_init_rx_transfer();
 }
 
+/*! \fn     comms_main_mcu_crc16_update(uint16_t crc, uint8_t* data, uint16_t length)
+*   \brief  Update a CRC16 CCITT with a buffer
+*   \param  crc     Current CRC
+*   \param  data    Pointer to the data
+*   \param  length  Number of bytes
+*   \return The updated CRC
+*/
+uint16_t comms_main_mcu_crc16_update(uint16_t crc, uint8_t* data, uint16_t length)
+{
+    for (uint16_t i = 0; i < length; i++)
+    {
+        crc = (crc << 4) ^ comms_main_mcu_crc16_nibble_table[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (crc << 4) ^ comms_main_mcu_crc16_nibble_table[(crc >> 12) ^ (data[i] & 0x0F)];
+    }
+    return crc;
+}
+
+/*! \fn     comms_main_mcu_compute_frame_crc(aux_mcu_message_t* message)
+*   \brief  Compute the CRC16 of a framed message: header without the framed flag, then payload_length1 payload bytes
+*   \param  message Pointer to the message
+*   \return The CRC
+*   \note   payload_length1 should have been checked beforehand
+*/
+uint16_t comms_main_mcu_compute_frame_crc(aux_mcu_message_t* message)
+{
+    uint16_t header[AUX_MCU_MSG_HEADER_LENGTH/sizeof(uint16_t)] = {message->message_type & ~AUX_MCU_MSG_TYPE_FRAMED_FLAG, message->payload_length1};
+    uint16_t crc = comms_main_mcu_crc16_update(0xFFFF, (uint8_t*)header, sizeof(header));
+    return comms_main_mcu_crc16_update(crc, message->payload, message->payload_length1);
+}
+
+/*! \fn     comms_main_mcu_unframe_message(aux_mcu_message_t* message)
+*   \brief  Check a received message CRC and bring it back to its legacy layout if it is framed
+*   \param  message Pointer to the received message
+*   \return FALSE if the framed message is invalid
+*   \note   Legacy messages mean the main MCU rebooted: stop sending framed messages until it asks again
+*/
+BOOL comms_main_mcu_unframe_message(aux_mcu_message_t* message)
+{
+    uint16_t payload_length = message->payload_length1;
+    uint16_t received_crc;
+    
+    /* Legacy message */
+    if (AUX_MCU_MSG_IS_FRAMED(message->message_type) == FALSE)
+    {
+        comms_main_mcu_framing_enabled = FALSE;
+        return TRUE;
+    }
+    
+    /* Remove flag, DMA interrupt already checked the length */
+    message->message_type &= ~AUX_MCU_MSG_TYPE_FRAMED_FLAG;
+    uint8_t* crc_pt = (uint8_t*)message + AUX_MCU_MSG_HEADER_LENGTH + payload_length;
+    received_crc = (uint16_t)crc_pt[0] | ((uint16_t)crc_pt[1] << 8);
+    
+    /* Bytes after the payload: CRC and what previous messages left there */
+    memset((void*)crc_pt, 0, sizeof(*message) - AUX_MCU_MSG_HEADER_LENGTH - payload_length);
+    
+    /* Check CRC */
+    if (comms_main_mcu_compute_frame_crc(message) != received_crc)
+    {
+        comms_main_mcu_invalid_message_received_from_main = TRUE;
+        return FALSE;
+    }
+    return TRUE;
+}
+
 /*! \fn     comms_main_mcu_flag_adc_watchdog_fired(void)
 *   \brief  Flag that the ADC watchdog fired
 */
@@ -147,6 +216,25 @@ void comms_main_mcu_send_message(volatile aux_mcu_message_t* message, uint16_t m
     /* Wait for no comms release */
     while (platform_io_is_no_comms_asserted() == RETURN_OK);
     
+    /* Message may be sent again */
+    if (AUX_MCU_MSG_IS_FRAMED(message->message_type) != FALSE)
+    {
+        message->message_type &= ~AUX_MCU_MSG_TYPE_FRAMED_FLAG;
+    }
+    
+    /* Framed message: only header, payload & CRC */
+    if ((comms_main_mcu_framing_enabled != FALSE) && (message->payload_length1 <= AUX_MCU_MSG_PAYLOAD_LENGTH))
+    {
+        uint16_t payload_length = message->payload_length1;
+        uint8_t* crc_pt = (uint8_t*)message + AUX_MCU_MSG_HEADER_LENGTH + payload_length;
+        uint16_t crc = comms_main_mcu_compute_frame_crc((aux_mcu_message_t*)message);
+        crc_pt[0] = (uint8_t)crc;
+        crc_pt[1] = (uint8_t)(crc >> 8);
+        message->message_type |= AUX_MCU_MSG_TYPE_FRAMED_FLAG;
+        dma_main_mcu_init_framed_tx_transfer((void*)&AUXMCU_SERCOM->USART.DATA.reg, (void*)message, payload_length);
+        return;
+    }
+    
     /* The function below does wait for a previous transfer to finish and does check for no comms */
     dma_main_mcu_init_tx_transfer((void*)&AUXMCU_SERCOM->USART.DATA.reg, (void*)message, sizeof(aux_mcu_message_t));    
 }
@@ -203,6 +291,10 @@ void comms_main_mcu_deal_with_non_usb_non_ble_message(aux_mcu_message_t* message
         comms_main_mcu_message_for_main_replies.aux_details_message.aux_uid_registers[3] = *(uint32_t*)0x0080A048;
         comms_main_mcu_message_for_main_replies.aux_details_message.aux_stack_low_watermark = main_check_stack_usage();
         
+        /* Framing is only negotiated when the main MCU explicitly asks for it, plain platform details requests keep the current framing */
+        BOOL framing_negotiation = (message->aux_details_message.framing_magic == AUX_MCU_MSG_FRAMING_MAGIC)? TRUE : FALSE;
+        comms_main_mcu_message_for_main_replies.aux_details_message.framing_magic = (framing_negotiation != FALSE)? AUX_MCU_MSG_FRAMING_MAGIC : 0;
+        
         /* Check if BLE is enabled */
         if (logic_is_ble_enabled() != FALSE)
         {
@@ -232,8 +324,21 @@ void comms_main_mcu_deal_with_non_usb_non_ble_message(aux_mcu_message_t* message
             }
         }
         
-        /* Send message */
-        comms_main_mcu_send_message((void*)&comms_main_mcu_message_for_main_replies, (uint16_t)sizeof(comms_main_mcu_message_for_main_replies));
+        if (framing_negotiation != FALSE)
+        {
+            /* Main MCU supports framing: its next messages come with a gap after their header, to be received on their own */
+            dma_main_mcu_set_rx_header_split(TRUE);
+            
+            /* Send legacy message: the main MCU only receives framed messages once it got this answer */
+            comms_main_mcu_framing_enabled = FALSE;
+            comms_main_mcu_send_message((void*)&comms_main_mcu_message_for_main_replies, (uint16_t)sizeof(comms_main_mcu_message_for_main_replies));
+            comms_main_mcu_framing_enabled = TRUE;
+        }
+        else
+        {
+            /* Send message */
+            comms_main_mcu_send_message((void*)&comms_main_mcu_message_for_main_replies, (uint16_t)sizeof(comms_main_mcu_message_for_main_replies));
+        }
     }
     else if (message->message_type == AUX_MCU_MSG_TYPE_NIMH_CHARGE)
     {
@@ -264,63 +369,16 @@ void comms_main_mcu_deal_with_non_usb_non_ble_message(aux_mcu_message_t* message
     }    
     else if (message->message_type == AUX_MCU_MSG_TYPE_KEYBOARD_TYPE)
     {
-        BOOL typing_success_bool = TRUE;
-        
-        /* This command may take a while... let's use our other buffer to prevent corruptions */
-        memcpy((void*)&comms_main_mcu_message_for_main_replies, message, sizeof(comms_main_mcu_message_for_main_replies));
-        
-        /* Iterate over symbols */
-        uint16_t counter = 0;
-        while(comms_main_mcu_message_for_main_replies.keyboard_type_message.keyboard_symbols[counter] != 0)
+        /* Typing is done by logic_keyboard_routine(), which answers once the string is typed */
+        if (logic_keyboard_start_typing(&message->keyboard_type_message, message->payload_length1) != RETURN_OK)
         {
-            uint16_t symbol = comms_main_mcu_message_for_main_replies.keyboard_type_message.keyboard_symbols[counter];
-            
-            if (symbol == 0xFFFF)
-            {
-                /* Original unicode point can't be typed */
-            }            
-            else if ((symbol & 0x7F00) == 0)
-            {
-                BOOL is_dead_key = FALSE;
-                
-                /* Check for dead key */
-                if ((symbol & 0x8000) != 0)
-                {
-                    is_dead_key = TRUE;
-                }                    
-                
-                /* One key to be typed */
-                if (logic_keyboard_type_symbol((hid_interface_te)comms_main_mcu_message_for_main_replies.keyboard_type_message.interface_identifier, (uint8_t)symbol, is_dead_key, comms_main_mcu_message_for_main_replies.keyboard_type_message.delay_between_types) != RETURN_OK)
-                {
-                    typing_success_bool = FALSE;
-                    break;
-                }
-            }
-            else
-            {
-                /* Two keys to be typed */
-                if (logic_keyboard_type_symbol((hid_interface_te)comms_main_mcu_message_for_main_replies.keyboard_type_message.interface_identifier, (uint8_t)(symbol >> 8), FALSE, comms_main_mcu_message_for_main_replies.keyboard_type_message.delay_between_types) != RETURN_OK)
-                {
-                    typing_success_bool = FALSE;
-                    break;
-                }
-                if (logic_keyboard_type_symbol((hid_interface_te)comms_main_mcu_message_for_main_replies.keyboard_type_message.interface_identifier, (uint8_t)symbol, FALSE, comms_main_mcu_message_for_main_replies.keyboard_type_message.delay_between_types) != RETURN_OK)
-                {
-                    typing_success_bool = FALSE;
-                    break;
-                }
-            }
-            
-            /* Move on to the next symbol */
-            counter++;
+            /* Still typing the previous string */
+            memset((void*)&comms_main_mcu_message_for_main_replies, 0x00, sizeof(comms_main_mcu_message_for_main_replies));
+            comms_main_mcu_message_for_main_replies.message_type = AUX_MCU_MSG_TYPE_KEYBOARD_TYPE;
+            comms_main_mcu_message_for_main_replies.payload_as_uint16[0] = (uint16_t)FALSE;
+            comms_main_mcu_message_for_main_replies.payload_length1 = sizeof(uint16_t);
+            comms_main_mcu_send_message((void*)&comms_main_mcu_message_for_main_replies, (uint16_t)sizeof(comms_main_mcu_message_for_main_replies));
         }
-            
-        /* Send success status */
-        memset((void*)&comms_main_mcu_message_for_main_replies, 0x00, sizeof(comms_main_mcu_message_for_main_replies));
-        comms_main_mcu_message_for_main_replies.message_type = AUX_MCU_MSG_TYPE_KEYBOARD_TYPE;
-        comms_main_mcu_message_for_main_replies.payload_as_uint16[0] = (uint16_t)typing_success_bool;
-        comms_main_mcu_message_for_main_replies.payload_length1 = sizeof(uint16_t);
-        comms_main_mcu_send_message((void*)&comms_main_mcu_message_for_main_replies, (uint16_t)sizeof(comms_main_mcu_message_for_main_replies));
     }
     else if (message->message_type == AUX_MCU_MSG_TYPE_BLE_CMD)
     {
@@ -739,7 +797,7 @@ ret_type_te comms_main_mcu_routine(BOOL filter_and_force_use_of_temp_receive_buf
         /* Set bool and do necessary action: no point in setting the bool after the function call as the dma receiver will overwrite the packet anyways */
         dma_main_mcu_usb_msg_received = FALSE;
         
-        if (comms_main_mcu_usb_msg_answered_using_first_bytes == FALSE)
+        if ((comms_main_mcu_usb_msg_answered_using_first_bytes == FALSE) && (comms_main_mcu_unframe_message((aux_mcu_message_t*)&dma_main_mcu_usb_rcv_message) != FALSE))
         {
             comms_raw_hid_send_hid_message(USB_INTERFACE, (aux_mcu_message_t*)&dma_main_mcu_usb_rcv_message);
         }
@@ -749,7 +807,7 @@ ret_type_te comms_main_mcu_routine(BOOL filter_and_force_use_of_temp_receive_buf
         /* Set bool and do necessary action: no point in setting the bool after the function call as the dma receiver will overwrite the packet anyways */
         dma_main_mcu_ble_msg_received = FALSE;
         
-        if (comms_main_mcu_ble_msg_answered_using_first_bytes == FALSE)
+        if ((comms_main_mcu_ble_msg_answered_using_first_bytes == FALSE) && (comms_main_mcu_unframe_message((aux_mcu_message_t*)&dma_main_mcu_ble_rcv_message) != FALSE))
         {
             comms_raw_hid_send_hid_message(BLE_INTERFACE, (aux_mcu_message_t*)&dma_main_mcu_ble_rcv_message);
         }
@@ -759,7 +817,7 @@ ret_type_te comms_main_mcu_routine(BOOL filter_and_force_use_of_temp_receive_buf
         /* Set bool and do necessary action: no point in setting the bool after the function call as the dma receiver will overwrite the packet anyways */
         dma_main_mcu_other_msg_received = FALSE;
         
-        if (comms_main_mcu_other_msg_answered_using_first_bytes == FALSE)
+        if ((comms_main_mcu_other_msg_answered_using_first_bytes == FALSE) && (comms_main_mcu_unframe_message((aux_mcu_message_t*)&dma_main_mcu_other_message) != FALSE))
         {
             if ((filter_and_force_use_of_temp_receive_buffer != FALSE) && (dma_main_mcu_other_message.message_type == expected_message_type))
             {
@@ -820,6 +878,9 @@ ret_type_te comms_main_mcu_routine(BOOL filter_and_force_use_of_temp_receive_buf
     /* First part of message */
     if (should_deal_with_packet != FALSE)
     {        
+        /* Only legacy messages are dealt with this way */
+        comms_main_mcu_unframe_message((aux_mcu_message_t*)&comms_main_mcu_temp_message);
+        
         if (comms_main_mcu_temp_message.message_type == AUX_MCU_MSG_TYPE_USB)
         {
             comms_raw_hid_send_hid_message(USB_INTERFACE, (aux_mcu_message_t*)&comms_main_mcu_temp_message);
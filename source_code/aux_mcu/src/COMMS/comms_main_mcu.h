@@ -36,6 +36,14 @@ extern volatile BOOL comms_main_mcu_other_msg_answered_using_first_bytes;
 #define AUX_MCU_MSG_TYPE_RNG_TRANSFER   0x000A
 #define AUX_MCU_MSG_TYPE_BLE_CMD        0x000B
 
+/* Framed messages: header, payload_length1 payload bytes then a CRC16, message type flagged */
+#define AUX_MCU_MSG_TYPE_FRAMED_FLAG    0x8000
+#define AUX_MCU_MSG_HEADER_LENGTH       4
+#define AUX_MCU_MSG_CRC_LENGTH          2
+#define AUX_MCU_MSG_FRAMING_MAGIC       0x4652
+#define AUX_MCU_MSG_HEADER_GAP_US       20      // Main MCU DMA interrupt arms the payload reception, measured at 3.5us
+#define AUX_MCU_MSG_IS_FRAMED(type)     ((((type) & AUX_MCU_MSG_TYPE_FRAMED_FLAG) != 0) && ((type) != 0xFFFF))
+
 // Main MCU commands
 #define MAIN_MCU_COMMAND_SLEEP              0x0001
 #define MAIN_MCU_COMMAND_ATTACH_USB         0x0002
@@ -87,6 +95,10 @@ extern volatile BOOL comms_main_mcu_other_msg_answered_using_first_bytes;
 #define AUX_MCU_EVENT_BLE_CON_SPAM          0x0018
 #define AUX_MCU_EVENT_BONDING_CLEARED       0x0019
 
+// Keyboard typing flags, optional uint16_t after the keyboard symbols 0 terminator
+#define KEYBOARD_TYPING_FLAG_MERGE_MODIFIER 0x01
+#define KEYBOARD_TYPING_FLAG_PACK_KEYS      0x02
+
 // BLE commands
 #define BLE_MESSAGE_CMD_ENABLE              0x0001
 #define BLE_MESSAGE_CMD_RESERVED            0x0002
@@ -135,6 +147,7 @@ typedef struct
     uint32_t atbtlc_chip_id;
     uint8_t atbtlc_address[6];
     uint32_t aux_stack_low_watermark;
+    uint16_t framing_magic;
 } aux_plat_details_message_t;
 
 typedef struct
@@ -333,6 +346,9 @@ ret_type_te comms_main_mcu_fetch_bonding_info_for_irk(uint8_t* irk_key, nodemgmt
 void comms_main_mcu_get_empty_packet_ready_to_be_sent(aux_mcu_message_t** message_pt_pt, uint16_t message_type);
 void comms_main_mcu_send_simple_event_alt_buffer(uint16_t event_id, aux_mcu_message_t* buffer);
 void comms_main_mcu_send_message(volatile aux_mcu_message_t* message, uint16_t message_length);
+uint16_t comms_main_mcu_crc16_update(uint16_t crc, uint8_t* data, uint16_t length);
+uint16_t comms_main_mcu_compute_frame_crc(aux_mcu_message_t* message);
+BOOL comms_main_mcu_unframe_message(aux_mcu_message_t* message);
 BOOL comms_aux_mcu_get_received_packet(aux_mcu_message_t** message, BOOL arm_new_rx);
 void comms_main_mcu_deal_with_non_usb_non_ble_message(aux_mcu_message_t* message);
 uint16_t comms_main_mcu_get_bonding_info_irks(uint8_t** irk_keys_buffer);
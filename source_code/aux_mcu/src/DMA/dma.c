@@ -37,6 +37,32 @@ volatile BOOL dma_main_mcu_ble_msg_received = FALSE;
 volatile BOOL dma_main_mcu_other_msg_received = FALSE;
 /* Pointer to message being sent to main MCU */
 void* dma_pt_to_message_being_sent_to_main_mcu;
+#ifndef BOOTLOADER
+/* Main MCU packet reception stage: header first, then the rest of the message */
+volatile dma_main_mcu_rx_stage_te dma_main_mcu_rx_stage = DMA_MAIN_MCU_RX_STAGE_HEADER;
+/* Set to receive headers on their own: only once the main MCU negotiated framing, as it then leaves a gap after each header */
+volatile BOOL dma_main_mcu_rx_header_split = FALSE;
+
+/*! \fn     dma_main_mcu_arm_rx_descriptor(void* datap, uint16_t size)
+*   \brief  Arm the main MCU comms RX channel
+*   \param  datap       Pointer to where to store the data
+*   \param  size        Number of bytes for transfer
+*   \note   Called from the DMA interrupt or with IRQs disabled
+*/
+static void dma_main_mcu_arm_rx_descriptor(void* datap, uint16_t size)
+{
+    /* Setup transfer size */
+    dma_descriptors[DMA_DESCID_RX_COMMS].BTCNT.bit.BTCNT = size;
+    /* Source address: DATA register from SPI */
+    dma_descriptors[DMA_DESCID_RX_COMMS].DSTADDR.reg = (uint32_t)datap + size;
+    /* Destination address: given value */
+    dma_descriptors[DMA_DESCID_RX_COMMS].SRCADDR.reg = (uint32_t)((void*)&AUXMCU_SERCOM->USART.DATA.reg);
+    
+    /* Resume DMA channel operation */
+    DMAC->CHID.reg= DMAC_CHID_ID(DMA_DESCID_RX_COMMS);
+    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_ENABLE;
+}
+#endif
 
 /*! \fn     DMAC_Handler(void)
 *   \brief  Function called by interrupt when RX is done
@@ -47,55 +73,103 @@ void DMAC_Handler(void)
     DMAC->CHID.reg = DMAC_CHID_ID(DMA_DESCID_RX_COMMS);
     if ((DMAC->CHINTFLAG.reg & DMAC_CHINTFLAG_TCMPL) != 0)
     {
-        /* Set transfer done boolean, clear interrupt */
-        dma_aux_mcu_packet_received = TRUE;
+        #ifndef BOOTLOADER
+        /* Message type & length, read before the next message header overwrites them */
+        uint16_t rx_message_type = dma_main_mcu_temp_rcv_message.message_type;
+        uint16_t rx_payload_length = dma_main_mcu_temp_rcv_message.payload_length1;
+        uint16_t rx_message_length = sizeof(dma_main_mcu_temp_rcv_message);
+        BOOL rx_message_framed = AUX_MCU_MSG_IS_FRAMED(rx_message_type);
         DMAC->CHINTFLAG.reg = DMAC_CHINTFLAG_TCMPL;
         
-        /* Arm next transfer: leave this here! */
-        dma_main_mcu_init_rx_transfer();        
-        
-        #ifndef BOOTLOADER        
-        /* Depending on message received, copy to the right rcv buffer and set flag */
-        if (dma_main_mcu_temp_rcv_message.message_type == AUX_MCU_MSG_TYPE_USB)
+        /* Header received: arm the remainder of the message right away */
+        if (dma_main_mcu_rx_stage == DMA_MAIN_MCU_RX_STAGE_HEADER)
         {
-            memcpy((void*)&dma_main_mcu_usb_rcv_message, (void*)&dma_main_mcu_temp_rcv_message, sizeof(dma_main_mcu_temp_rcv_message));
-            /* Check if received message has already been dealt with, do not set received flag if so */
-            if (comms_main_mcu_usb_msg_answered_using_first_bytes != FALSE)
-            {
-                comms_main_mcu_usb_msg_answered_using_first_bytes = FALSE;
-            } 
-            else
+            if (rx_message_framed == FALSE)
             {
-                dma_main_mcu_usb_msg_received = TRUE;
+                dma_main_mcu_rx_stage = DMA_MAIN_MCU_RX_STAGE_LEGACY_BODY;
+                dma_main_mcu_arm_rx_descriptor((uint8_t*)&dma_main_mcu_temp_rcv_message + AUX_MCU_MSG_HEADER_LENGTH, sizeof(dma_main_mcu_temp_rcv_message) - AUX_MCU_MSG_HEADER_LENGTH);
             }
-        }
-        else if (dma_main_mcu_temp_rcv_message.message_type == AUX_MCU_MSG_TYPE_BLE)
-        {
-            memcpy((void*)&dma_main_mcu_ble_rcv_message, (void*)&dma_main_mcu_temp_rcv_message, sizeof(dma_main_mcu_temp_rcv_message));
-            /* Check if received message has already been dealt with, do not set received flag if so */
-            if (comms_main_mcu_ble_msg_answered_using_first_bytes != FALSE)
+            else if (rx_payload_length <= AUX_MCU_MSG_PAYLOAD_LENGTH)
             {
-                comms_main_mcu_ble_msg_answered_using_first_bytes = FALSE;
+                dma_main_mcu_rx_stage = DMA_MAIN_MCU_RX_STAGE_FRAMED_BODY;
+                dma_main_mcu_arm_rx_descriptor((uint8_t*)&dma_main_mcu_temp_rcv_message + AUX_MCU_MSG_HEADER_LENGTH, rx_payload_length + AUX_MCU_MSG_CRC_LENGTH);
             }
             else
             {
-                dma_main_mcu_ble_msg_received = TRUE;
+                /* Invalid length: discard, wait for the next header */
+                dma_main_mcu_init_rx_transfer();
             }
         }
         else
         {
-            memcpy((void*)&dma_main_mcu_other_message, (void*)&dma_main_mcu_temp_rcv_message, sizeof(dma_main_mcu_temp_rcv_message));
-            /* Check if received message has already been dealt with, do not set received flag if so */
-            if (comms_main_mcu_other_msg_answered_using_first_bytes != FALSE)
+            /* Framed message: only copy what was received, comms zero the rest once the CRC is checked */
+            if (rx_message_framed != FALSE)
+            {
+                rx_message_length = AUX_MCU_MSG_HEADER_LENGTH + rx_payload_length + AUX_MCU_MSG_CRC_LENGTH;
+            }
+            rx_message_type &= ~AUX_MCU_MSG_TYPE_FRAMED_FLAG;
+            
+            /* Legacy message: the main MCU went back to legacy messages (reboot, update, reset packets...), which it may not send with a gap */
+            if (rx_message_framed == FALSE)
             {
-                comms_main_mcu_other_msg_answered_using_first_bytes = FALSE;
+                dma_main_mcu_rx_header_split = FALSE;
+            }
+        
+            /* Set transfer done boolean */
+            dma_aux_mcu_packet_received = TRUE;
+        
+            /* Arm next transfer: leave this here! */
+            dma_main_mcu_init_rx_transfer();
+        
+            /* Depending on message received, copy to the right rcv buffer and set flag */
+            if (rx_message_type == AUX_MCU_MSG_TYPE_USB)
+            {
+                memcpy((void*)&dma_main_mcu_usb_rcv_message, (void*)&dma_main_mcu_temp_rcv_message, rx_message_length);
+                /* Check if received message has already been dealt with, do not set received flag if so */
+                if (comms_main_mcu_usb_msg_answered_using_first_bytes != FALSE)
+                {
+                    comms_main_mcu_usb_msg_answered_using_first_bytes = FALSE;
+                } 
+                else
+                {
+                    dma_main_mcu_usb_msg_received = TRUE;
+                }
+            }
+            else if (rx_message_type == AUX_MCU_MSG_TYPE_BLE)
+            {
+                memcpy((void*)&dma_main_mcu_ble_rcv_message, (void*)&dma_main_mcu_temp_rcv_message, rx_message_length);
+                /* Check if received message has already been dealt with, do not set received flag if so */
+                if (comms_main_mcu_ble_msg_answered_using_first_bytes != FALSE)
+                {
+                    comms_main_mcu_ble_msg_answered_using_first_bytes = FALSE;
+                }
+                else
+                {
+                    dma_main_mcu_ble_msg_received = TRUE;
+                }
             }
             else
             {
-                dma_main_mcu_other_msg_received = TRUE;
-            }    
+                memcpy((void*)&dma_main_mcu_other_message, (void*)&dma_main_mcu_temp_rcv_message, rx_message_length);
+                /* Check if received message has already been dealt with, do not set received flag if so */
+                if (comms_main_mcu_other_msg_answered_using_first_bytes != FALSE)
+                {
+                    comms_main_mcu_other_msg_answered_using_first_bytes = FALSE;
+                }
+                else
+                {
+                    dma_main_mcu_other_msg_received = TRUE;
+                }    
+            }
         }
         #else
+            /* Set transfer done boolean, clear interrupt */
+            dma_aux_mcu_packet_received = TRUE;
+            DMAC->CHINTFLAG.reg = DMAC_CHINTFLAG_TCMPL;
+            
+            /* Arm next transfer: leave this here! */
+            dma_main_mcu_init_rx_transfer();
+            
             /* Bootloader: we're only receiving other messages :D */
             dma_main_mcu_other_msg_received = TRUE;
         #endif
@@ -200,7 +274,15 @@ void dma_init(void)
 */
 uint16_t dma_main_mcu_get_remaining_bytes_for_rx_transfer(void)
 {
-    /* Check for active channel */
+    #ifndef BOOTLOADER
+    /* Nothing can be dealt with before the header, framed messages are only dealt with once their CRC is received */
+    if (dma_main_mcu_rx_stage != DMA_MAIN_MCU_RX_STAGE_LEGACY_BODY)
+    {
+        return sizeof(dma_main_mcu_temp_rcv_message);
+    }
+    #endif
+    
+    /* Check for active channel: the legacy message body ends with the message */
     DMAC_ACTIVE_Type active_reg_copy = DMAC->ACTIVE;
     if (active_reg_copy.bit.ID == DMA_DESCID_RX_COMMS && active_reg_copy.bit.ABUSY != 0)
     {
@@ -265,6 +347,25 @@ void dma_main_mcu_init_tx_transfer(void* spi_data_p, void* datap, uint16_t size)
     __enable_irq();
 }
 
+#ifndef BOOTLOADER
+/*! \fn     dma_main_mcu_init_framed_tx_transfer(void* spi_data_p, void* datap, uint16_t payload_size)
+*   \brief  Send a framed message to the main MCU: header, then payload & CRC once the main MCU armed their reception
+*   \param  spi_data_p      Pointer to the SPI data register
+*   \param  datap           Pointer to the message, header flagged and CRC appended to its payload
+*   \param  payload_size    Payload length, without the CRC
+*/
+void dma_main_mcu_init_framed_tx_transfer(void* spi_data_p, void* datap, uint16_t payload_size)
+{
+    dma_main_mcu_init_tx_transfer(spi_data_p, datap, AUX_MCU_MSG_HEADER_LENGTH);
+    dma_wait_for_main_mcu_packet_sent();
+    DELAYUS(AUX_MCU_MSG_HEADER_GAP_US);
+    dma_main_mcu_init_tx_transfer(spi_data_p, (uint8_t*)datap + AUX_MCU_MSG_HEADER_LENGTH, payload_size + AUX_MCU_MSG_CRC_LENGTH);
+    
+    /* Message being sent is the complete one */
+    dma_pt_to_message_being_sent_to_main_mcu = datap;
+}
+#endif
+
 /*! \fn     dma_get_pointer_to_message_being_sent_to_main_mcu(void)
 *   \brief  Get pointer to the message currently being sent to main MCU
 */
@@ -304,12 +405,55 @@ void dma_main_mcu_disable_transfer(void)
     __enable_irq();
 }
 
+#ifndef BOOTLOADER
+/*! \fn     dma_main_mcu_set_rx_header_split(BOOL header_split)
+*   \brief  Select if main MCU messages are received as a header then the rest of the message, or in one go
+*   \param  header_split    TRUE to receive the header on its own (framed messages)
+*   \note   Reception is re-armed: only call while the main MCU waits for our answer
+*/
+void dma_main_mcu_set_rx_header_split(BOOL header_split)
+{
+    /* Disable IRQs */
+    __disable_irq();
+    __DMB();
+    
+    /* Stop DMA channel operation */
+    DMAC->CHID.reg= DMAC_CHID_ID(DMA_DESCID_RX_COMMS);
+    DMAC->CHCTRLA.reg = 0;
+    
+    /* Wait for bit clear */
+    while(DMAC->CHCTRLA.reg != 0);
+    
+    /* Re-arm with the new setting */
+    dma_main_mcu_rx_header_split = header_split;
+    dma_main_mcu_init_rx_transfer();
+    
+    /* Re-enable IRQs */
+    __DMB();
+    __enable_irq();
+}
+#endif
+
 /*! \fn     dma_main_mcu_init_rx_transfer(void)
 *   \brief  Initialize a DMA transfer from the main MCU
 *   \note   We are not disabling IRQs as this is called from an IRQ
 */
 void dma_main_mcu_init_rx_transfer(void)
 {
+    #ifndef BOOTLOADER
+    if (dma_main_mcu_rx_header_split != FALSE)
+    {
+        /* Header only: the DMA interrupt arms the rest of the message once it is received */
+        dma_main_mcu_rx_stage = DMA_MAIN_MCU_RX_STAGE_HEADER;
+        dma_main_mcu_arm_rx_descriptor((void*)&dma_main_mcu_temp_rcv_message, AUX_MCU_MSG_HEADER_LENGTH);
+    }
+    else
+    {
+        /* Full message: legacy senders do not leave time to re-arm after the header */
+        dma_main_mcu_rx_stage = DMA_MAIN_MCU_RX_STAGE_LEGACY_BODY;
+        dma_main_mcu_arm_rx_descriptor((void*)&dma_main_mcu_temp_rcv_message, sizeof(dma_main_mcu_temp_rcv_message));
+    }
+    #else
     /* Setup transfer size */
     dma_descriptors[DMA_DESCID_RX_COMMS].BTCNT.bit.BTCNT = (uint16_t)sizeof(dma_main_mcu_temp_rcv_message);
     /* Source address: DATA register from SPI */
@@ -320,4 +464,5 @@ void dma_main_mcu_init_rx_transfer(void)
     /* Resume DMA channel operation */
     DMAC->CHID.reg= DMAC_CHID_ID(DMA_DESCID_RX_COMMS);
     DMAC->CHCTRLA.reg = DMAC_CHCTRLA_ENABLE;
+    #endif
 }
@@ -13,6 +13,9 @@
 #include "comms_main_mcu.h"
 #include "defines.h"
 
+/* Enums */
+typedef enum {DMA_MAIN_MCU_RX_STAGE_HEADER = 0, DMA_MAIN_MCU_RX_STAGE_LEGACY_BODY, DMA_MAIN_MCU_RX_STAGE_FRAMED_BODY} dma_main_mcu_rx_stage_te;
+
 /* Global vars */
 extern volatile aux_mcu_message_t dma_main_mcu_temp_rcv_message;
 extern volatile aux_mcu_message_t dma_main_mcu_usb_rcv_message;
@@ -24,9 +27,11 @@ extern volatile BOOL dma_main_mcu_ble_msg_received;
 
 /* Prototypes */
 void dma_main_mcu_init_tx_transfer(void* spi_data_p, void* datap, uint16_t size);
+void dma_main_mcu_init_framed_tx_transfer(void* spi_data_p, void* datap, uint16_t payload_size);
 uint16_t dma_main_mcu_get_remaining_bytes_for_rx_transfer(void);
 void* dma_get_pointer_to_message_being_sent_to_main_mcu(void);
 BOOL dma_main_mcu_check_and_clear_dma_transfer_flag(void);
+void dma_main_mcu_set_rx_header_split(BOOL header_split);
 void dma_wait_for_main_mcu_packet_sent(void);
 void dma_main_mcu_init_rx_transfer(void);
 void dma_main_mcu_disable_transfer(void);
@@ -1814,14 +1814,15 @@ void logic_bluetooth_raw_send(uint8_t* data, uint16_t data_len)
     }
 }
 
-/*! \fn     logic_bluetooth_send_modifier_and_key(uint8_t modifier, uint8_t key, uint8_t second_key)
-*   \brief  Send modifier and key through keyboard link
+/*! \fn     logic_bluetooth_start_sending_keyboard_report(uint8_t modifier, uint8_t* keys, uint16_t nb_keys)
+*   \brief  Start sending a keyboard report containing several keys, without waiting for the notification to be sent
 *   \param  modifier    HID modifier
-*   \param  key         HID key
-*   \param  second_key  Another HID key
-*   \return If we were able to correctly type
+*   \param  keys        HID keys
+*   \param  nb_keys     Number of keys, slots that don't fit in the report are ignored
+*   \return If we could start sending the report
+*   \note   Use logic_bluetooth_is_typed_report_sent() to know when the report was sent
 */
-ret_type_te logic_bluetooth_send_modifier_and_key(uint8_t modifier, uint8_t key, uint8_t second_key)
+ret_type_te logic_bluetooth_start_sending_keyboard_report(uint8_t modifier, uint8_t* keys, uint16_t nb_keys)
 {
     if (logic_bluetooth_can_communicate_with_host != FALSE)
     {
@@ -1829,9 +1830,12 @@ ret_type_te logic_bluetooth_send_modifier_and_key(uint8_t modifier, uint8_t key,
         {
             logic_bluetooth_check_and_wait_for_notif_sent();
             logic_bluetooth_notif_being_sent = KEYBOARD_NOTIF_SENDING;
+            memset(logic_bluetooth_keyboard_in_report, 0, sizeof(logic_bluetooth_keyboard_in_report));
             logic_bluetooth_keyboard_in_report[0] = modifier;
-            logic_bluetooth_keyboard_in_report[2] = key;
-            logic_bluetooth_keyboard_in_report[3] = second_key;
+            for (uint16_t i = 0; (i < nb_keys) && (i + 2 < sizeof(logic_bluetooth_keyboard_in_report)); i++)
+            {
+                logic_bluetooth_keyboard_in_report[i + 2] = keys[i];
+            }
             logic_bluetooth_typed_report_sent = FALSE;
             logic_bluetooth_update_report(logic_bluetooth_ble_connection_handle, BLE_KEYBOARD_HID_SERVICE_INSTANCE, BLE_KEYBOARD_HID_IN_REPORT_NB, logic_bluetooth_keyboard_in_report, sizeof(logic_bluetooth_keyboard_in_report), TRUE);
         } 
@@ -1839,14 +1843,58 @@ ret_type_te logic_bluetooth_send_modifier_and_key(uint8_t modifier, uint8_t key,
         {
             logic_bluetooth_check_and_wait_for_notif_sent();
             logic_bluetooth_notif_being_sent = KEYBOARD_NOTIF_SENDING;
+            memset(logic_bluetooth_boot_keyb_in_report, 0, sizeof(logic_bluetooth_boot_keyb_in_report));
             logic_bluetooth_boot_keyb_in_report[0] = modifier;
-            logic_bluetooth_boot_keyb_in_report[2] = key;
-            logic_bluetooth_boot_keyb_in_report[3] = second_key;
+            for (uint16_t i = 0; (i < nb_keys) && (i + 2 < sizeof(logic_bluetooth_boot_keyb_in_report)); i++)
+            {
+                logic_bluetooth_boot_keyb_in_report[i + 2] = keys[i];
+            }
             logic_bluetooth_typed_report_sent = FALSE;
             logic_bluetooth_update_report(logic_bluetooth_ble_connection_handle, BLE_KEYBOARD_HID_SERVICE_INSTANCE, BLE_KEYBOARD_HID_IN_REPORT_NB, logic_bluetooth_boot_keyb_in_report, sizeof(logic_bluetooth_boot_keyb_in_report), FALSE);
         }
-        
-        /* OK I'm still not sure about this one... but I think it should be OK. Stack trace is main > comms_main_mcu_routine > comms_main_mcu_deal_with_non_usb_non_ble_message > logic_keyboard_type_symbol > logic_keyboard_type_key_with_modifier to here */
+        return RETURN_OK;
+    }
+    else
+    {
+        return RETURN_NOK;
+    }
+}
+
+/*! \fn     logic_bluetooth_start_sending_modifier_and_key(uint8_t modifier, uint8_t key, uint8_t second_key)
+*   \brief  Start sending modifier and key through keyboard link, without waiting for the notification to be sent
+*   \param  modifier    HID modifier
+*   \param  key         HID key
+*   \param  second_key  Another HID key
+*   \return If we could start sending the report
+*   \note   Use logic_bluetooth_is_typed_report_sent() to know when the report was sent
+*/
+ret_type_te logic_bluetooth_start_sending_modifier_and_key(uint8_t modifier, uint8_t key, uint8_t second_key)
+{
+    uint8_t keys[2] = {key, second_key};
+    return logic_bluetooth_start_sending_keyboard_report(modifier, keys, ARRAY_SIZE(keys));
+}
+
+/*! \fn     logic_bluetooth_is_typed_report_sent(void)
+*   \brief  Know if the last keyboard report was sent
+*   \return If it was sent
+*/
+BOOL logic_bluetooth_is_typed_report_sent(void)
+{
+    return logic_bluetooth_typed_report_sent;
+}
+
+/*! \fn     logic_bluetooth_send_modifier_and_key(uint8_t modifier, uint8_t key, uint8_t second_key)
+*   \brief  Send modifier and key through keyboard link
+*   \param  modifier    HID modifier
+*   \param  key         HID key
+*   \param  second_key  Another HID key
+*   \return If we were able to correctly type
+*/
+ret_type_te logic_bluetooth_send_modifier_and_key(uint8_t modifier, uint8_t key, uint8_t second_key)
+{
+    if (logic_bluetooth_start_sending_modifier_and_key(modifier, key, second_key) == RETURN_OK)
+    {        
+        /* OK I'm still not sure about this one... but I think it should be OK. Stack trace is main > comms_main_mcu_routine > comms_main_mcu_deal_with_non_usb_non_ble_message > logic_keyboard_type_key_with_modifier to here */
         timer_start_timer(TIMER_BT_TYPING_TIMEOUT, 1000);
         while ((timer_has_timer_expired(TIMER_BT_TYPING_TIMEOUT, FALSE) == TIMER_RUNNING) && (logic_bluetooth_typed_report_sent == FALSE))
         {
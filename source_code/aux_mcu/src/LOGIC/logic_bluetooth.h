@@ -275,6 +275,8 @@ void logic_bluetooth_hid_profile_init(uint8_t servinst, uint8_t device, uint8_t*
 void logic_bluetooth_update_report(uint16_t conn_handle, uint8_t serv_inst, uint8_t reportid, uint8_t* report, uint16_t len, BOOL use_report_charac);
 void logic_bluetooth_boot_key_report_update(at_ble_handle_t conn_handle, uint8_t serv_inst, uint8_t* bootreport, uint16_t len);
 void logic_bluetooth_successfull_pairing_call(ble_connected_dev_info_t* dev_info, at_ble_connected_t* connected_info);
+ret_type_te logic_bluetooth_start_sending_keyboard_report(uint8_t modifier, uint8_t* keys, uint16_t nb_keys);
+ret_type_te logic_bluetooth_start_sending_modifier_and_key(uint8_t modifier, uint8_t key, uint8_t second_key);
 ret_type_te logic_bluetooth_send_modifier_and_key(uint8_t modifier, uint8_t key, uint8_t second_key);
 uint8_t logic_bluetooth_get_report_characteristic(uint16_t handle, uint8_t serv, uint8_t reportid);
 uint8_t logic_bluetooth_get_notif_instance(uint8_t serv_num, uint16_t char_handle);
@@ -299,6 +301,7 @@ BOOL logic_bluetooth_get_open_to_pairing(void);
 void logic_bluetooth_start_advertising(void);
 void logic_bluetooth_set_disable_flag(void);
 BOOL logic_bluetooth_can_talk_to_host(void);
+BOOL logic_bluetooth_is_typed_report_sent(void);
 void logic_bluetooth_stop_bluetooth(void);
 void logic_bluetooth_routine(void);
 void logic_bluetooth_ms_tick(void);
@@ -13,6 +13,22 @@
 #include "udc.h"
 /* Buffer containing the keys to be sent through USB */
 uint8_t logic_keyboard_usb_hid_keys_buffer[8];
+/* Message describing what we're currently typing */
+keyboard_type_message_t logic_keyboard_typing_message;
+/* Typing flags sent after the symbols 0 terminator, see KEYBOARD_TYPING_FLAG_xxx */
+uint16_t logic_keyboard_typing_flags = 0;
+/* Index of the next symbol to be queued */
+uint16_t logic_keyboard_next_symbol_index = 0;
+/* Queue of reports for the symbol being typed */
+keyboard_report_t logic_keyboard_reports_queue[KEYBOARD_REPORT_QUEUE_LENGTH];
+uint16_t logic_keyboard_reports_queue_read_index = 0;
+uint16_t logic_keyboard_nb_reports_queued = 0;
+/* Keys pressed once all queued reports are sent */
+keyboard_report_t logic_keyboard_last_queued_report;
+/* Typing state */
+keyboard_typing_state_te logic_keyboard_typing_state = KEYBOARD_TYPING_IDLE;
+/* Set when the last report sent through USB was received by the host */
+volatile BOOL logic_keyboard_usb_report_sent = FALSE;
 
 
 /*! \fn     logic_keyboard_type_lock_shortcut(hid_interface_te interface_id, uint8_t l_symbol)
@@ -28,6 +44,12 @@ void logic_keyboard_type_lock_shortcut(hid_interface_te interface_id, uint8_t l_
         return;
     }
     
+    /* Reports buffers are used by the string being typed */
+    if (logic_keyboard_typing_state != KEYBOARD_TYPING_IDLE)
+    {
+        return;
+    }
+    
     if (interface_id == USB_INTERFACE)
     {
         logic_keyboard_usb_hid_keys_buffer[2] = KEY_WIN_L;
@@ -65,6 +87,12 @@ ret_type_te logic_keyboard_type_key_with_modifier(hid_interface_te interface, ui
         return RETURN_NOK;
     }
     
+    /* Reports buffers are used by the string being typed */
+    if (logic_keyboard_typing_state != KEYBOARD_TYPING_IDLE)
+    {
+        return RETURN_NOK;
+    }
+    
     // Send modifier
     if (modifier != 0)
     {
@@ -117,18 +145,142 @@ ret_type_te logic_keyboard_type_key_with_modifier(hid_interface_te interface, ui
     return RETURN_OK; 
 }
 
-/*! \fn     logic_keyboard_type_symbol(hid_interface_te interface, uint8_t symbol, BOOL is_dead_key, uint16_t delay_between_types)
-*   \brief  Type an encoded symbol through a given interface
-*   \param  interface           HID interface on which to type the symbol
+/*! \fn     logic_keyboard_usb_report_sent_callback(void)
+*   \brief  Called by the USB interrupt when a keyboard report was sent
+*/
+void logic_keyboard_usb_report_sent_callback(void)
+{
+    logic_keyboard_usb_report_sent = TRUE;
+}
+
+/*! \fn     logic_keyboard_is_typing(void)
+*   \brief  Know if we are currently typing a string
+*   \return If we are
+*/
+BOOL logic_keyboard_is_typing(void)
+{
+    if (logic_keyboard_typing_state == KEYBOARD_TYPING_IDLE)
+    {
+        return FALSE;
+    }
+    else
+    {
+        return TRUE;
+    }
+}
+
+/*! \fn     logic_keyboard_queue_report(keyboard_report_t* report_pt)
+*   \brief  Queue a keyboard report
+*   \param  report_pt   Pointer to the report
+*/
+static void logic_keyboard_queue_report(keyboard_report_t* report_pt)
+{
+    uint16_t write_index = (logic_keyboard_reports_queue_read_index + logic_keyboard_nb_reports_queued) % KEYBOARD_REPORT_QUEUE_LENGTH;
+    
+    memcpy(&logic_keyboard_reports_queue[write_index], report_pt, sizeof(keyboard_report_t));
+    memcpy(&logic_keyboard_last_queued_report, report_pt, sizeof(keyboard_report_t));
+    logic_keyboard_nb_reports_queued++;
+}
+
+/*! \fn     logic_keyboard_queue_modifier_and_key(uint8_t modifier, uint8_t key)
+*   \brief  Queue a keyboard report containing at most one key
+*   \param  modifier    Modifier (alt, shift...)
+*   \param  key         Key, 0 for none
+*/
+static void logic_keyboard_queue_modifier_and_key(uint8_t modifier, uint8_t key)
+{
+    keyboard_report_t report;
+    
+    memset(&report, 0, sizeof(report));
+    report.modifier = modifier;
+    if (key != 0)
+    {
+        report.keys[report.nb_keys++] = key;
+    }
+    logic_keyboard_queue_report(&report);
+}
+
+/*! \fn     logic_keyboard_queue_release_all(void)
+*   \brief  Queue an all keys released report if something is still pressed
+*/
+static void logic_keyboard_queue_release_all(void)
+{
+    if ((logic_keyboard_last_queued_report.modifier != 0) || (logic_keyboard_last_queued_report.nb_keys != 0))
+    {
+        logic_keyboard_queue_modifier_and_key(0, 0);
+    }
+}
+
+/*! \fn     logic_keyboard_queue_key_with_modifier(uint8_t key, uint8_t modifier)
+*   \brief  Queue the reports for a single keystroke
+*   \param  key         Key to send
+*   \param  modifier    Modifier (alt, shift...)
+*   \note   When packing keys, keys are only released when a key repeats, the modifier changes or the report is full
+*   \note   Keys aren't packed with long delays between reports, as held keys would be autorepeated by the host
+*/
+static void logic_keyboard_queue_key_with_modifier(uint8_t key, uint8_t modifier)
+{
+    keyboard_report_t* last_report_pt = &logic_keyboard_last_queued_report;
+    BOOL pack_keys = FALSE;
+    
+    if (((logic_keyboard_typing_flags & KEYBOARD_TYPING_FLAG_PACK_KEYS) != 0) && (logic_keyboard_typing_message.delay_between_types <= KEYBOARD_PACK_KEYS_MAX_DELAY_MS))
+    {
+        pack_keys = TRUE;
+    }
+    
+    /* Packing: press this key together with the ones already pressed */
+    if ((pack_keys != FALSE) && (last_report_pt->nb_keys != 0) && (last_report_pt->nb_keys < KEYBOARD_REPORT_NB_KEYS) && (last_report_pt->modifier == modifier) && (memchr(last_report_pt->keys, key, last_report_pt->nb_keys) == NULL))
+    {
+        if (logic_keyboard_nb_reports_queued == 0)
+        {
+            /* Last report already sent: send a new one with the extra key */
+            keyboard_report_t new_report;
+            memcpy(&new_report, last_report_pt, sizeof(new_report));
+            new_report.keys[new_report.nb_keys++] = key;
+            logic_keyboard_queue_report(&new_report);
+        }
+        else
+        {
+            /* Last report not sent yet: add the key to it */
+            keyboard_report_t* queued_report_pt = &logic_keyboard_reports_queue[(logic_keyboard_reports_queue_read_index + logic_keyboard_nb_reports_queued - 1) % KEYBOARD_REPORT_QUEUE_LENGTH];
+            queued_report_pt->keys[queued_report_pt->nb_keys++] = key;
+            memcpy(last_report_pt, queued_report_pt, sizeof(keyboard_report_t));
+        }
+        return;
+    }
+    
+    /* Release what's still pressed */
+    logic_keyboard_queue_release_all();
+    
+    /* Modifier first, unless the host is fine with it being pressed together with the key */
+    if ((modifier != 0) && ((logic_keyboard_typing_flags & KEYBOARD_TYPING_FLAG_MERGE_MODIFIER) == 0))
+    {
+        logic_keyboard_queue_modifier_and_key(modifier, 0);
+    }
+    
+    /* Modifier + key, then release all unless we're packing keys */
+    logic_keyboard_queue_modifier_and_key(modifier, key);
+    if (pack_keys == FALSE)
+    {
+        logic_keyboard_queue_modifier_and_key(0, 0);
+    }
+}
+
+/*! \fn     logic_keyboard_queue_symbol(uint8_t symbol, BOOL is_dead_key)
+*   \brief  Queue the reports for an encoded symbol
 *   \param  symbol              The symbol
 *   \param  is_dead_key         Is the symbol a dead key?
-*   \param  delay_between_types Delay between key presses
-*   \return If we were able to type the symbol
+*   \note   A dead key is never packed with other keys, even when packing keys
 */
-ret_type_te logic_keyboard_type_symbol(hid_interface_te interface, uint8_t symbol, BOOL is_dead_key, uint16_t delay_between_types)
+static void logic_keyboard_queue_symbol(uint8_t symbol, BOOL is_dead_key)
 {
     uint8_t masked_key = symbol & (SHIFT_MASK|ALTGR_MASK);
-    ret_type_te return_val;
+    
+    /* Dead key is pressed on its own */
+    if (is_dead_key != FALSE)
+    {
+        logic_keyboard_queue_release_all();
+    }
         
     if ((symbol & 0x3F) == KEY_EUROPE_2)
     {
@@ -149,32 +301,213 @@ ret_type_te logic_keyboard_type_symbol(hid_interface_te interface, uint8_t symbo
         }
             
         // Send the correct KEY_EUROPE_2 with the correct modifier
-        return_val = logic_keyboard_type_key_with_modifier(interface, KEY_EUROPE_2_REAL, mod_tbs, delay_between_types);
+        logic_keyboard_queue_key_with_modifier(KEY_EUROPE_2_REAL, mod_tbs);
     }
     else if (masked_key == (SHIFT_MASK|ALTGR_MASK))
     {
-        return_val = logic_keyboard_type_key_with_modifier(interface, symbol & ~(SHIFT_MASK|ALTGR_MASK), KEY_SHIFT|KEY_RIGHT_ALT, delay_between_types);
+        logic_keyboard_queue_key_with_modifier(symbol & ~(SHIFT_MASK|ALTGR_MASK), KEY_SHIFT|KEY_RIGHT_ALT);
     }
     else if (masked_key == SHIFT_MASK)
     {
         // If we need shift
-        return_val = logic_keyboard_type_key_with_modifier(interface, symbol & ~SHIFT_MASK, KEY_SHIFT, delay_between_types);
+        logic_keyboard_queue_key_with_modifier(symbol & ~SHIFT_MASK, KEY_SHIFT);
     }
     else if (masked_key == ALTGR_MASK)
     {
         // We need altgr for the numbered keys, only possible because we don't use the numerical keypad
-        return_val = logic_keyboard_type_key_with_modifier(interface, symbol & ~ALTGR_MASK, KEY_RIGHT_ALT, delay_between_types);
+        logic_keyboard_queue_key_with_modifier(symbol & ~ALTGR_MASK, KEY_RIGHT_ALT);
     }
     else
     {
-        return_val = logic_keyboard_type_key_with_modifier(interface, symbol, 0, delay_between_types);
+        logic_keyboard_queue_key_with_modifier(symbol, 0);
     }
     
-    /* Add space if typed character is a dead key */
-    if ((is_dead_key != FALSE) && (return_val == RETURN_OK))
+    /* Add space if typed character is a dead key, hosts only compose it once released */
+    if (is_dead_key != FALSE)
     {
-        return_val = logic_keyboard_type_key_with_modifier(interface, KEY_SPACE, 0, delay_between_types);        
+        logic_keyboard_queue_release_all();
+        logic_keyboard_queue_key_with_modifier(KEY_SPACE, 0);
+    }
+}
+
+/*! \fn     logic_keyboard_queue_next_symbol(void)
+*   \brief  Queue the reports for the next symbol to be typed
+*   \return FALSE if there is no symbol left to be typed
+*   \note   Up to KEYBOARD_MAX_REPORTS_PER_SYMBOL reports may be queued
+*/
+static BOOL logic_keyboard_queue_next_symbol(void)
+{
+    while (logic_keyboard_next_symbol_index < MEMBER_ARRAY_SIZE(keyboard_type_message_t, keyboard_symbols))
+    {
+        uint16_t symbol = logic_keyboard_typing_message.keyboard_symbols[logic_keyboard_next_symbol_index++];
+        
+        if (symbol == 0)
+        {
+            /* End of string */
+            logic_keyboard_next_symbol_index = MEMBER_ARRAY_SIZE(keyboard_type_message_t, keyboard_symbols);
+        }
+        else if (symbol == 0xFFFF)
+        {
+            /* Original unicode point can't be typed */
+        }
+        else if ((symbol & 0x7F00) == 0)
+        {
+            /* One key to be typed, check for dead key */
+            logic_keyboard_queue_symbol((uint8_t)symbol, ((symbol & 0x8000) != 0)? TRUE:FALSE);
+            return TRUE;
+        }
+        else
+        {
+            /* Two keys to be typed, the first one being a dead key pressed on its own */
+            logic_keyboard_queue_release_all();
+            logic_keyboard_queue_symbol((uint8_t)(symbol >> 8), FALSE);
+            logic_keyboard_queue_release_all();
+            logic_keyboard_queue_symbol((uint8_t)symbol, FALSE);
+            return TRUE;
+        }
     }
     
-    return return_val;
-}
\ No newline at end of file
+    /* Nothing left to type: release the keys left pressed */
+    logic_keyboard_queue_release_all();
+    return FALSE;
+}
+
+/*! \fn     logic_keyboard_stop_typing(BOOL typing_success_bool)
+*   \brief  Stop typing and let the main MCU know how it went
+*   \param  typing_success_bool If all symbols were typed
+*/
+static void logic_keyboard_stop_typing(BOOL typing_success_bool)
+{
+    aux_mcu_message_t* temp_tx_message_pt;
+    
+    /* Reset state */
+    logic_keyboard_typing_state = KEYBOARD_TYPING_IDLE;
+    logic_keyboard_nb_reports_queued = 0;
+
+    /* Make sure no key stays pressed if we stopped midway */
+    if ((typing_success_bool == FALSE) && (logic_keyboard_typing_message.interface_identifier == USB_INTERFACE) && (usb_get_config() != 0))
+    {
+        memset(logic_keyboard_usb_hid_keys_buffer, 0, sizeof(logic_keyboard_usb_hid_keys_buffer));
+        usb_send(USB_KEYBOARD_ENDPOINT, (uint8_t*)logic_keyboard_usb_hid_keys_buffer, sizeof(logic_keyboard_usb_hid_keys_buffer));
+    }
+
+    /* Send success status */
+    comms_main_mcu_get_empty_packet_ready_to_be_sent(&temp_tx_message_pt, AUX_MCU_MSG_TYPE_KEYBOARD_TYPE);
+    temp_tx_message_pt->payload_as_uint16[0] = (uint16_t)typing_success_bool;
+    temp_tx_message_pt->payload_length1 = sizeof(uint16_t);
+    comms_main_mcu_send_message((void*)temp_tx_message_pt, (uint16_t)sizeof(aux_mcu_message_t));
+}
+
+/*! \fn     logic_keyboard_start_typing(keyboard_type_message_t* typing_message, uint16_t payload_length)
+*   \brief  Start typing a string, logic_keyboard_routine() will then send the keyboard reports one by one
+*   \param  typing_message  Message describing what to type
+*   \param  payload_length  Message payload length
+*   \return RETURN_NOK if we are already typing
+*   \note   The main MCU is answered by logic_keyboard_routine() once the string is typed
+*   \note   Typing flags are only present when the payload extends past the symbols 0 terminator
+*/
+ret_type_te logic_keyboard_start_typing(keyboard_type_message_t* typing_message, uint16_t payload_length)
+{
+    if (logic_keyboard_typing_state != KEYBOARD_TYPING_IDLE)
+    {
+        return RETURN_NOK;
+    }
+    
+    /* Store message, it may be overwritten by the next received ones */
+    memcpy(&logic_keyboard_typing_message, typing_message, sizeof(logic_keyboard_typing_message));
+    
+    /* Look for the typing flags after the symbols 0 terminator */
+    uint16_t nb_symbols_sent = 0;
+    if (payload_length > (sizeof(typing_message->interface_identifier) + sizeof(typing_message->delay_between_types)))
+    {
+        nb_symbols_sent = (payload_length - sizeof(typing_message->interface_identifier) - sizeof(typing_message->delay_between_types)) / sizeof(uint16_t);
+    }
+    if (nb_symbols_sent > ARRAY_SIZE(logic_keyboard_typing_message.keyboard_symbols))
+    {
+        nb_symbols_sent = ARRAY_SIZE(logic_keyboard_typing_message.keyboard_symbols);
+    }
+    logic_keyboard_typing_flags = 0;
+    for (uint16_t i = 0; i + 1 < nb_symbols_sent; i++)
+    {
+        if (logic_keyboard_typing_message.keyboard_symbols[i] == 0)
+        {
+            logic_keyboard_typing_flags = logic_keyboard_typing_message.keyboard_symbols[i + 1];
+            break;
+        }
+    }
+    logic_keyboard_next_symbol_index = 0;
+    logic_keyboard_nb_reports_queued = 0;
+    logic_keyboard_reports_queue_read_index = 0;
+    memset(&logic_keyboard_last_queued_report, 0, sizeof(logic_keyboard_last_queued_report));
+    logic_keyboard_typing_state = KEYBOARD_TYPING_READY_TO_SEND;
+    timer_start_timer(TIMER_KEYBOARD_REPORT_INTERVAL, 0);
+    return RETURN_OK;
+}
+
+/*! \fn     logic_keyboard_routine(void)
+*   \brief  Keyboard routine: send the next queued report once the previous one was sent and the delay between types elapsed
+*/
+void logic_keyboard_routine(void)
+{
+    hid_interface_te interface = (hid_interface_te)logic_keyboard_typing_message.interface_identifier;
+    
+    /* Wait for the last report to be sent */
+    if (logic_keyboard_typing_state == KEYBOARD_TYPING_REPORT_SENDING)
+    {
+        if (((interface == USB_INTERFACE) && (logic_keyboard_usb_report_sent != FALSE)) || ((interface != USB_INTERFACE) && (logic_bluetooth_is_typed_report_sent() != FALSE)))
+        {
+            logic_keyboard_typing_state = KEYBOARD_TYPING_READY_TO_SEND;
+        }
+        else if (timer_has_timer_expired(TIMER_KEYBOARD_REPORT_TIMEOUT, FALSE) == TIMER_EXPIRED)
+        {
+            logic_keyboard_stop_typing(FALSE);
+            return;
+        }
+    }
+    
+    /* Wait for the delay between types */
+    if ((logic_keyboard_typing_state != KEYBOARD_TYPING_READY_TO_SEND) || (timer_has_timer_expired(TIMER_KEYBOARD_REPORT_INTERVAL, FALSE) == TIMER_RUNNING))
+    {
+        return;
+    }
+    
+    /* Queue as many symbols as we can, so their keys can be packed in the same reports */
+    while (((KEYBOARD_REPORT_QUEUE_LENGTH - logic_keyboard_nb_reports_queued) >= KEYBOARD_MAX_REPORTS_PER_SYMBOL) && (logic_keyboard_queue_next_symbol() != FALSE));
+    
+    /* Nothing left to send? */
+    if (logic_keyboard_nb_reports_queued == 0)
+    {
+        logic_keyboard_stop_typing(TRUE);
+        return;
+    }
+    
+    /* Check for enumeration */
+    if ((interface == USB_INTERFACE) && ((usb_get_config() == 0) || (udc_get_nb_ms_before_last_usb_activity() > 100)))
+    {
+        logic_keyboard_stop_typing(FALSE);
+        return;
+    }
+    
+    /* Send report */
+    keyboard_report_t* report_pt = &logic_keyboard_reports_queue[logic_keyboard_reports_queue_read_index];
+    if (interface == USB_INTERFACE)
+    {
+        logic_keyboard_usb_report_sent = FALSE;
+        memset(logic_keyboard_usb_hid_keys_buffer, 0, sizeof(logic_keyboard_usb_hid_keys_buffer));
+        logic_keyboard_usb_hid_keys_buffer[0] = report_pt->modifier;
+        memcpy(&logic_keyboard_usb_hid_keys_buffer[2], report_pt->keys, report_pt->nb_keys);
+        usb_send(USB_KEYBOARD_ENDPOINT, (uint8_t*)logic_keyboard_usb_hid_keys_buffer, sizeof(logic_keyboard_usb_hid_keys_buffer));
+    }
+    else if (logic_bluetooth_start_sending_keyboard_report(report_pt->modifier, report_pt->keys, report_pt->nb_keys) != RETURN_OK)
+    {
+        logic_keyboard_stop_typing(FALSE);
+        return;
+    }
+    logic_keyboard_reports_queue_read_index = (logic_keyboard_reports_queue_read_index + 1) % KEYBOARD_REPORT_QUEUE_LENGTH;
+    logic_keyboard_nb_reports_queued--;
+    
+    /* Next report once this one is sent and the delay between types elapsed */
+    timer_start_timer(TIMER_KEYBOARD_REPORT_TIMEOUT, KEYBOARD_REPORT_SENT_TIMEOUT_MS);
+    timer_start_timer(TIMER_KEYBOARD_REPORT_INTERVAL, logic_keyboard_typing_message.delay_between_types);
+    logic_keyboard_typing_state = KEYBOARD_TYPING_REPORT_SENDING;
+}
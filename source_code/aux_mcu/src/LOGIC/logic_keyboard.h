@@ -9,9 +9,16 @@
 #ifndef LOGIC_KEYBOARD_H_
 #define LOGIC_KEYBOARD_H_
 
+#include "comms_main_mcu.h"
 #include "defines.h"
 
 /* Defines */
+#define KEYBOARD_REPORT_QUEUE_LENGTH    16
+#define KEYBOARD_MAX_REPORTS_PER_SYMBOL 7
+/* Above this delay between reports, a packed key held for (KEYBOARD_MAX_REPORTS_PER_SYMBOL-1) reports could reach the host autorepeat delay (250ms at the shortest) */
+#define KEYBOARD_PACK_KEYS_MAX_DELAY_MS 40
+#define KEYBOARD_REPORT_SENT_TIMEOUT_MS 1000
+#define KEYBOARD_REPORT_NB_KEYS         6
 #define SHIFT_MASK  0x80
 #define ALTGR_MASK  0x40
 #define KEY_CTRL               0x01
@@ -133,9 +140,23 @@
 #define KEY_F15                0x6A
 #define KEY_WIN_L              0xE3
 
+/* Enums */
+typedef enum {KEYBOARD_TYPING_IDLE = 0, KEYBOARD_TYPING_READY_TO_SEND, KEYBOARD_TYPING_REPORT_SENDING} keyboard_typing_state_te;
+
+/* Structs */
+typedef struct
+{
+    uint8_t modifier;
+    uint8_t nb_keys;
+    uint8_t keys[KEYBOARD_REPORT_NB_KEYS];
+} keyboard_report_t;
+
 /* Prototypes */
 ret_type_te logic_keyboard_type_key_with_modifier(hid_interface_te interface, uint8_t key, uint8_t modifier, uint16_t delay_between_types);
-ret_type_te logic_keyboard_type_symbol(hid_interface_te interface, uint8_t symbol, BOOL is_dead_key, uint16_t delay_between_types);
+ret_type_te logic_keyboard_start_typing(keyboard_type_message_t* typing_message, uint16_t payload_length);
 void logic_keyboard_type_lock_shortcut(hid_interface_te interface_id, uint8_t l_symbol);
+void logic_keyboard_usb_report_sent_callback(void);
+BOOL logic_keyboard_is_typing(void);
+void logic_keyboard_routine(void);
 
 #endif /* LOGIC_KEYBOARD_H_ */
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "platform_defines.h"
 #include "logic_bluetooth.h"
 #include "comms_main_mcu.h"
+#include "logic_keyboard.h"
 #include "logic_battery.h"
 #include "driver_clocks.h"
 #include "comms_raw_hid.h"
@@ -169,6 +170,9 @@ int main(void)
         if (logic_sleep_is_full_platform_sleep_requested() == FALSE)
         {
             comms_main_mcu_routine(FALSE, 0, FALSE);
+            
+            /* Type the next keyboard report if needed */
+            logic_keyboard_routine();
         }
         
         /* ADC watchdog */
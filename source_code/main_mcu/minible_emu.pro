@@ -101,11 +101,21 @@ SOURCES += src/EMU/lis2hh12.c \
     src/TIMER/driver_timer.c \
     src/utils.c \
     src/debug.c \
+    src/profiler.c \
     src/main.c \
     src/EMU/emu_aux_mcu.c \
+    src/EMU/emu_benchmark.c \
+    src/EMU/emu_hid_trace.c \
+    src/EMU/emu_oled_fb.c \
+    src/EMU/emu_session.c \
     src/EMU/emulator.cpp \
+    src/EMU/emu_aux_fido2.cpp \
+    src/EMU/emu_benchmark_hid.cpp \
+    src/EMU/emu_hid_transport.cpp \
     src/EMU/emu_oled.cpp \
+    src/EMU/emu_oled_capture.cpp \
     src/EMU/emu_smartcard.cpp \
+    src/EMU/emu_snapshot.cpp \
     src/EMU/emu_storage.cpp \
     src/EMU/emulator_ui.cpp
 
@@ -150,6 +160,31 @@ DEFINES += DESTDIR=""
 DEFINES += PREFIX="/usr"
 DEFINES += PLAT_V6_SETUP
 
+# The aux mcu fido2 stack behind the ctaphid socket, built against the aux headers
+AUX_FIDO2_SOURCES = ../aux_mcu/src/fido2/ctap.c \
+    ../aux_mcu/src/fido2/ctap_parse.c \
+    ../aux_mcu/src/fido2/ctaphid.c \
+    ../aux_mcu/src/fido2/solo_compat_layer.c \
+    ../aux_mcu/src/tinycbor/src/cborencoder.c \
+    ../aux_mcu/src/tinycbor/src/cborerrorstrings.c \
+    ../aux_mcu/src/tinycbor/src/cborparser.c \
+    src/EMU/aux_fido2/emu_aux_fido2_drivers.c
+
+AUX_FIDO2_INCLUDEPATH = src/EMU/aux_fido2 \
+    ../aux_mcu/src \
+    ../aux_mcu/src/COMMS \
+    ../aux_mcu/src/fido2 \
+    ../aux_mcu/src/TIMER \
+    ../aux_mcu/src/PLATFORM \
+    ../aux_mcu/src/LOGIC \
+    ../aux_mcu/src/tinycbor/src
+
+aux_fido2.input = AUX_FIDO2_SOURCES
+aux_fido2.output = ${QMAKE_VAR_OBJECTS_DIR}${QMAKE_FILE_BASE}_aux$${first(QMAKE_EXT_OBJ)}
+aux_fido2.commands = $${QMAKE_CC} -c -std=gnu99 -fPIC -DDEBUG_LOG_DISABLED $$join(AUX_FIDO2_INCLUDEPATH, " -I$$PWD/", "-I$$PWD/") ${QMAKE_FILE_NAME} -o ${QMAKE_FILE_OUT}
+aux_fido2.variable_out = OBJECTS
+QMAKE_EXTRA_COMPILERS += aux_fido2
+
 HEADERS  += src/MainWindow.h \ \
     src/BearSSL/inc/bearssl.h \
     src/COMMS/comms_aux_mcu.h \
@@ -158,9 +193,18 @@ HEADERS  += src/MainWindow.h \ \
     src/COMMS/comms_hid_msgs.h \
     src/COMMS/comms_hid_msgs_debug.h \
     src/EMU/asf.h \
+    src/EMU/emu_aux_fido2.h \
     src/EMU/emu_aux_mcu.h \
+    src/EMU/emu_benchmark.h \
+    src/EMU/emu_hid_trace.h \
+    src/EMU/emu_hid_transport.h \
     src/EMU/emu_oled.h \
+    src/EMU/emu_oled_capture.h \
+    src/EMU/emu_oled_fb.h \
+    src/EMU/emu_session.h \
     src/EMU/emu_smartcard.h \
+    src/EMU/emu_snapshot.h \
+    src/EMU/emu_spsc_ring.h \
     src/EMU/emu_storage.h \
     src/EMU/emulator.h \
     src/EMU/emulator_ui.h \
@@ -192,5 +236,6 @@ HEADERS  += src/MainWindow.h \ \
     src/TIMER/driver_timer.h \
     src/defines.h \
     src/debug.h \
+    src/profiler.h \
     src/main.h \
     src/utils.h
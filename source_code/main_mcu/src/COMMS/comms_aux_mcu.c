@@ -35,6 +35,7 @@
 #include "logic_power.h"
 #include "logic_fido2.h"
 #include "gui_prompts.h"
+#include "profiler.h"
 #include "logic_user.h"
 #include "nodemgmt.h"
 #include "text_ids.h"
@@ -42,12 +43,23 @@
 #include "main.h"
 #include "dma.h"
 #include "rng.h"
+#ifdef EMULATOR_BUILD
+#include "emulator.h"
+#endif
 /* Received and sent MCU messages */
 aux_mcu_message_t aux_mcu_receive_message;
-aux_mcu_message_t aux_mcu_send_message_2;
-aux_mcu_message_t aux_mcu_send_message_1;
-BOOL aux_mcu_message_1_reserved = FALSE;
-BOOL aux_mcu_message_2_reserved = FALSE;
+aux_mcu_message_t aux_mcu_send_messages[AUX_MCU_NB_TX_SLOTS];
+volatile aux_mcu_tx_slot_state_te aux_mcu_tx_slot_states[AUX_MCU_NB_TX_SLOTS];
+/* Number of bytes following the header for tx slots: payload & CRC for framed ones, rest of the message for legacy ones */
+uint16_t aux_mcu_tx_slot_body_lengths[AUX_MCU_NB_TX_SLOTS];
+/* Committed tx slots, in commit order */
+volatile uint8_t aux_mcu_tx_committed_slots[AUX_MCU_NB_TX_SLOTS];
+volatile uint8_t aux_mcu_tx_committed_read_index = 0;
+volatile uint8_t aux_mcu_tx_nb_committed_slots = 0;
+/* Flag set when the header of the first committed slot was sent */
+volatile BOOL aux_mcu_tx_header_sent = FALSE;
+/* Flag set while committed slots are being sent, cleared by interrupt once they all are */
+volatile BOOL aux_mcu_tx_chain_running = FALSE;
 /* Flag set if comms are disabled */
 BOOL aux_mcu_comms_disabled = FALSE;
 /* Flag set if we have treated a message by only looking at its first bytes */
@@ -60,10 +72,14 @@ BOOL aux_mcu_comms_prev_aux_mcu_routine_wants_to_arm_rx = FALSE;
 BOOL aux_mcu_comms_invalid_message_received = FALSE;
 /* Flag set when rx transfer is already armed */
 BOOL aux_mcu_comms_rx_already_armed = FALSE;
-/* Flag set when the second tx buffer is requested */
-BOOL aux_mcu_comms_second_buffer_rerequested = FALSE;
+/* Flag set when a tx slot is requested while all of them are reserved */
+BOOL aux_mcu_comms_tx_slots_exhausted = FALSE;
 /* Timeout delay for aux MCU communications */
 BOOL aux_mcu_comms_timeout_delay = AUX_MCU_MESSAGE_REPLY_TIMEOUT_MS;
+/* Flag set when the aux MCU accepts framed messages */
+BOOL aux_mcu_comms_framing_enabled = FALSE;
+/* CRC16 CCITT lookup table, one nibble at a time */
+const uint16_t comms_aux_mcu_crc16_nibble_table[16] = {0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7, 0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF};
 
 
 /*! \fn     comms_aux_mcu_set_invalid_message_received(void)
@@ -74,6 +90,105 @@ void comms_aux_mcu_set_invalid_message_received(void)
     aux_mcu_comms_invalid_message_received = TRUE;
 }
 
+/*! \fn     comms_aux_mcu_crc16_update(uint16_t crc, uint8_t* data, uint16_t length)
+*   \brief  Update a CRC16 CCITT with a buffer
+*   \param  crc     Current CRC
+*   \param  data    Pointer to the data
+*   \param  length  Number of bytes
+*   \return The updated CRC
+*/
+uint16_t comms_aux_mcu_crc16_update(uint16_t crc, uint8_t* data, uint16_t length)
+{
+    for (uint16_t i = 0; i < length; i++)
+    {
+        crc = (crc << 4) ^ comms_aux_mcu_crc16_nibble_table[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (crc << 4) ^ comms_aux_mcu_crc16_nibble_table[(crc >> 12) ^ (data[i] & 0x0F)];
+    }
+    return crc;
+}
+
+/*! \fn     comms_aux_mcu_compute_frame_crc(aux_mcu_message_t* message)
+*   \brief  Compute the CRC16 of a framed message: header without the framed flag, then payload_length1 payload bytes
+*   \param  message Pointer to the message
+*   \return The CRC
+*   \note   payload_length1 should have been checked beforehand
+*/
+uint16_t comms_aux_mcu_compute_frame_crc(aux_mcu_message_t* message)
+{
+    uint16_t header[AUX_MCU_MSG_HEADER_LENGTH/sizeof(uint16_t)] = {message->message_type & ~AUX_MCU_MSG_TYPE_FRAMED_FLAG, message->payload_length1};
+    uint16_t crc = comms_aux_mcu_crc16_update(0xFFFF, (uint8_t*)header, sizeof(header));
+    return comms_aux_mcu_crc16_update(crc, message->payload, message->payload_length1);
+}
+
+/*! \fn     comms_aux_mcu_unframe_message(aux_mcu_message_t* message)
+*   \brief  Check a received message CRC and bring it back to its legacy layout if it is framed
+*   \param  message Pointer to the received message
+*   \return FALSE if the framed message is invalid, in which case it is also flagged invalid for the legacy checks
+*/
+BOOL comms_aux_mcu_unframe_message(aux_mcu_message_t* message)
+{
+    uint16_t payload_length = message->payload_length1;
+    uint16_t received_crc;
+    
+    /* Legacy message: nothing to do */
+    if (AUX_MCU_MSG_IS_FRAMED(message->message_type) == FALSE)
+    {
+        return TRUE;
+    }
+    
+    /* Remove flag, check length then CRC */
+    message->message_type &= ~AUX_MCU_MSG_TYPE_FRAMED_FLAG;
+    if (payload_length <= AUX_MCU_MSG_PAYLOAD_LENGTH)
+    {
+        uint8_t* crc_pt = (uint8_t*)message + AUX_MCU_MSG_HEADER_LENGTH + payload_length;
+        received_crc = (uint16_t)crc_pt[0] | ((uint16_t)crc_pt[1] << 8);
+        
+        /* Bytes after the payload: CRC and what previous messages left there */
+        memset((void*)crc_pt, 0, sizeof(*message) - AUX_MCU_MSG_HEADER_LENGTH - payload_length);
+        
+        if (comms_aux_mcu_compute_frame_crc(message) == received_crc)
+        {
+            return TRUE;
+        }
+    }
+    
+    /* Invalid message */
+    message->payload_length1 = 0;
+    message->rx_payload_valid_flag = 0;
+    return FALSE;
+}
+
+/*! \fn     comms_aux_mcu_check_and_clear_received_flag(void)
+*   \brief  Check if a message was received from the aux MCU, unframe it if so
+*   \note   If the flag is true, flag will be cleared to false
+*   \return TRUE or FALSE
+*/
+BOOL comms_aux_mcu_check_and_clear_received_flag(void)
+{
+    if (dma_aux_mcu_check_and_clear_dma_transfer_flag() != FALSE)
+    {
+        comms_aux_mcu_unframe_message(&aux_mcu_receive_message);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/*! \fn     comms_aux_mcu_disable_framing(void)
+*   \brief  Only send legacy full size messages to the aux MCU (before it reboots into code that may not support framing)
+*   \note   Our reception is re-armed for full size messages, as the aux MCU bootloader sends them without a gap after the header
+*/
+void comms_aux_mcu_disable_framing(void)
+{
+    aux_mcu_comms_framing_enabled = FALSE;
+    dma_aux_mcu_set_rx_header_split(FALSE);
+    
+    /* Reset our comms, re-arm reception */
+    comms_aux_mcu_wait_for_message_sent();
+    dma_aux_mcu_disable_transfer();
+    comms_aux_mcu_reset_tx_ring();
+    comms_aux_arm_rx_and_clear_no_comms();
+}
+
 /*! \fn     comms_aux_mcu_update_timeout_delay(uint16_t timeout_delay)
 *   \brief  Update the timeout delay for communications with the aux MCU
 *   \param  timeout_delay   New timeout delay for comms
@@ -103,13 +218,13 @@ BOOL comms_aux_mcu_get_and_clear_rx_transfer_already_armed(void)
     return ret_val;
 }
 
-/*! \fn     comms_aux_mcu_get_and_clear_second_tx_buffer_rerequested(void)
-*   \brief  Get and clear the tx buffer 2 re requested flag
+/*! \fn     comms_aux_mcu_get_and_clear_tx_slots_exhausted(void)
+*   \brief  Get and clear the tx slots exhausted flag
 */
-BOOL comms_aux_mcu_get_and_clear_second_tx_buffer_rerequested(void)
+BOOL comms_aux_mcu_get_and_clear_tx_slots_exhausted(void)
 {
-    BOOL ret_val = aux_mcu_comms_second_buffer_rerequested;
-    aux_mcu_comms_second_buffer_rerequested = FALSE;
+    BOOL ret_val = aux_mcu_comms_tx_slots_exhausted;
+    aux_mcu_comms_tx_slots_exhausted = FALSE;
     return ret_val;
 }
 
@@ -162,43 +277,125 @@ BOOL comms_aux_mcu_are_comms_disabled(void)
 }
 
 /*! \fn     comms_aux_mcu_wait_for_message_sent(void)
-*   \brief  Wait for previous message to be sent to aux MCU
+*   \brief  Wait for all committed messages to be sent to aux MCU
 */
 void comms_aux_mcu_wait_for_message_sent(void)
 {
-    dma_wait_for_aux_mcu_packet_sent();
+    while (aux_mcu_tx_chain_running != FALSE);
 }
 
-/*! \fn     comms_aux_mcu_get_free_tx_message_object_pt(void)
-*   \brief  Get a pointer to our temporary tx message object
+/*! \fn     comms_aux_mcu_start_next_tx_transfer(void)
+*   \brief  Start sending the first committed tx slot, or its next part if it is framed
+*   \note   Called by interrupt or in a critical section, once the flood protection delay has elapsed
 */
-aux_mcu_message_t* comms_aux_mcu_get_free_tx_message_object_pt(void)
-{    
-    /* Wait for possible ongoing message to be sent */
-    comms_aux_mcu_wait_for_message_sent();
+void comms_aux_mcu_start_next_tx_transfer(void)
+{
+    uint8_t slot_id = aux_mcu_tx_committed_slots[aux_mcu_tx_committed_read_index];
+    aux_mcu_message_t* message_pt = &aux_mcu_send_messages[slot_id];
+    
+    if (aux_mcu_tx_header_sent == FALSE)
+    {
+        /* Message header: the rest is sent once the aux MCU had time to arm its reception, even for legacy messages */
+        dma_aux_mcu_init_tx_transfer(AUXMCU_SERCOM, (void*)message_pt, AUX_MCU_MSG_HEADER_LENGTH);
+    }
+    else
+    {
+        /* Payload & CRC for framed messages, rest of the message for legacy ones */
+        dma_aux_mcu_init_tx_transfer(AUXMCU_SERCOM, (void*)message_pt->payload, aux_mcu_tx_slot_body_lengths[slot_id]);
+    }
+}
+
+/*! \fn     comms_aux_mcu_reset_tx_ring(void)
+*   \brief  Drop the messages waiting to be sent to the aux MCU and free all tx slots
+*   \note   To be called right after dma_aux_mcu_disable_transfer, once the chain is drained when not recovering from an error
+*/
+void comms_aux_mcu_reset_tx_ring(void)
+{
+    cpu_irq_enter_critical();
+    
+    /* Stop the timer starting the next transfer */
+    timer_stop_aux_tx_gap_timer();
+    
+    /* Free slots, reset ring */
+    for (uint16_t i = 0; i < AUX_MCU_NB_TX_SLOTS; i++)
+    {
+        aux_mcu_tx_slot_states[i] = AUX_MCU_TX_SLOT_FREE;
+    }
+    aux_mcu_tx_committed_read_index = 0;
+    aux_mcu_tx_nb_committed_slots = 0;
+    aux_mcu_tx_header_sent = FALSE;
+    aux_mcu_tx_chain_running = FALSE;
+    
+    cpu_irq_leave_critical();
+}
+
+/*! \fn     comms_aux_mcu_tx_transfer_done_callback(void)
+*   \brief  Called by the DMA interrupt when a transfer to the aux MCU is done: free the sent slot, chain the next transfer
+*/
+void comms_aux_mcu_tx_transfer_done_callback(void)
+{
+    uint8_t slot_id = aux_mcu_tx_committed_slots[aux_mcu_tx_committed_read_index];
     
-    /* Check for error */
-    if (aux_mcu_message_2_reserved != FALSE)
+    if (aux_mcu_tx_header_sent == FALSE)
+    {
+        /* Message header sent, the rest of it is next */
+        aux_mcu_tx_header_sent = TRUE;
+    }
+    else
     {
-        aux_mcu_comms_second_buffer_rerequested = TRUE;
+        /* Message sent: free its slot */
+        aux_mcu_tx_slot_states[slot_id] = AUX_MCU_TX_SLOT_FREE;
+        aux_mcu_tx_committed_read_index = (aux_mcu_tx_committed_read_index + 1) % AUX_MCU_NB_TX_SLOTS;
+        aux_mcu_tx_nb_committed_slots--;
+        aux_mcu_tx_header_sent = FALSE;
     }
     
+    /* Next transfer is started by interrupt, once the aux MCU had time to deal with this one */
+    if (aux_mcu_tx_nb_committed_slots != 0)
+    {
+        timer_start_aux_tx_gap_timer();
+    }
+    else
+    {
+        aux_mcu_tx_chain_running = FALSE;
+    }
+}
+
+/*! \fn     comms_aux_mcu_get_free_tx_message_object_pt(void)
+*   \brief  Reserve a tx slot
+*   \return Pointer to the reserved tx message object
+*   \note   Only waits if no slot is free
+*/
+aux_mcu_message_t* comms_aux_mcu_get_free_tx_message_object_pt(void)
+{
     /* A bit of background: the code is structured in such a way that every time a
     pointer is asked, the message is shortly sent after. There are a few cases where 
     a pointer is asked to prepare a message, then another pointer is asked to get information
     through this new message to complete the first message.
     TLDR: for every pointer requested only one message is sent */
     
-    /* Check for message 1 reserved */
-    if (aux_mcu_message_1_reserved == FALSE)
-    {
-        aux_mcu_message_1_reserved = TRUE;
-        return &aux_mcu_send_message_1;
-    }
-    else
+    while (TRUE)
     {
-        aux_mcu_message_2_reserved = TRUE;
-        return &aux_mcu_send_message_2;        
+        /* Look for a free slot */
+        cpu_irq_enter_critical();
+        for (uint16_t i = 0; i < AUX_MCU_NB_TX_SLOTS; i++)
+        {
+            if (aux_mcu_tx_slot_states[i] == AUX_MCU_TX_SLOT_FREE)
+            {
+                aux_mcu_tx_slot_states[i] = AUX_MCU_TX_SLOT_RESERVED;
+                cpu_irq_leave_critical();
+                return &aux_mcu_send_messages[i];
+            }
+        }
+        
+        /* All slots reserved and none being sent: none will be freed, check for error */
+        if (aux_mcu_tx_nb_committed_slots == 0)
+        {
+            aux_mcu_comms_tx_slots_exhausted = TRUE;
+            cpu_irq_leave_critical();
+            return &aux_mcu_send_messages[AUX_MCU_NB_TX_SLOTS-1];
+        }
+        cpu_irq_leave_critical();
     }
 }
 
@@ -223,12 +420,15 @@ aux_mcu_message_t* comms_aux_mcu_get_empty_packet_ready_to_be_sent(uint16_t mess
 }
 
 /*! \fn     comms_aux_mcu_send_message(aux_mcu_message_t* message_to_send)
-*   \brief  Send a message to the AUX MCU
-*   \param  message_to_send Pointer to the message to send (should be equal to &aux_mcu_send_message !)
-*   \note   Transfer is done through DMA so aux_mcu_send_message will be accessed after this function returns if boolean is set to false
+*   \brief  Commit a tx slot to be sent to the AUX MCU
+*   \param  message_to_send Pointer to the message to send (should be a reserved tx slot !)
+*   \note   Transfer is done through DMA and chained by interrupt, so the message will be accessed after this function returns
 */
 void comms_aux_mcu_send_message(aux_mcu_message_t* message_to_send)
 {
+    BOOL start_chain = FALSE;
+    uint16_t slot_id;
+    
     /* Do we need to wake-up aux mcu? */
     if (aux_mcu_comms_disabled != FALSE)
     {
@@ -239,26 +439,65 @@ void comms_aux_mcu_send_message(aux_mcu_message_t* message_to_send)
         timer_delay_ms(200);
     }        
         
-    /* Check that we're indeed sending the aux_mcu_send_message.... */
-    if ((message_to_send != &aux_mcu_send_message_1) && (message_to_send != &aux_mcu_send_message_2))
+    /* Check that we're indeed sending one of our tx slots.... */
+    for (slot_id = 0; slot_id < AUX_MCU_NB_TX_SLOTS; slot_id++)
+    {
+        if (message_to_send == &aux_mcu_send_messages[slot_id])
+        {
+            break;
+        }
+    }
+    if (slot_id == AUX_MCU_NB_TX_SLOTS)
     {
         main_reboot();
     }
     
-    /* Is reserved message 1 freed? */
-    if ((aux_mcu_message_1_reserved != FALSE) && (message_to_send == &aux_mcu_send_message_1))
+    /* Message sent again: wait for its previous transfer to be done */
+    while (aux_mcu_tx_slot_states[slot_id] == AUX_MCU_TX_SLOT_COMMITTED);
+    
+    /* Message may be sent again */
+    if (AUX_MCU_MSG_IS_FRAMED(message_to_send->message_type) != FALSE)
+    {
+        message_to_send->message_type &= ~AUX_MCU_MSG_TYPE_FRAMED_FLAG;
+    }
+    
+    /* Legacy message: header, then the rest of the message */
+    aux_mcu_tx_slot_body_lengths[slot_id] = sizeof(*message_to_send) - AUX_MCU_MSG_HEADER_LENGTH;
+    
+    /* Framed message: header, then payload & CRC */
+    if ((aux_mcu_comms_framing_enabled != FALSE) && (message_to_send->message_type != 0xFFFF) && (message_to_send->payload_length1 <= AUX_MCU_MSG_PAYLOAD_LENGTH))
     {
-        aux_mcu_message_1_reserved = FALSE;
+        uint16_t payload_length = message_to_send->payload_length1;
+        uint8_t* crc_pt = (uint8_t*)message_to_send + AUX_MCU_MSG_HEADER_LENGTH + payload_length;
+        uint16_t crc = comms_aux_mcu_compute_frame_crc(message_to_send);
+        crc_pt[0] = (uint8_t)crc;
+        crc_pt[1] = (uint8_t)(crc >> 8);
+        message_to_send->message_type |= AUX_MCU_MSG_TYPE_FRAMED_FLAG;
+        aux_mcu_tx_slot_body_lengths[slot_id] = payload_length + AUX_MCU_MSG_CRC_LENGTH;
     }
     
-    /* Is reserved message 2 freed? */
-    if ((aux_mcu_message_2_reserved != FALSE) && (message_to_send == &aux_mcu_send_message_2))
+    /* Commit slot, start sending if nothing is being sent */
+    cpu_irq_enter_critical();
+    aux_mcu_tx_slot_states[slot_id] = AUX_MCU_TX_SLOT_COMMITTED;
+    aux_mcu_tx_committed_slots[(aux_mcu_tx_committed_read_index + aux_mcu_tx_nb_committed_slots) % AUX_MCU_NB_TX_SLOTS] = (uint8_t)slot_id;
+    aux_mcu_tx_nb_committed_slots++;
+    if (aux_mcu_tx_chain_running == FALSE)
     {
-        aux_mcu_message_2_reserved = FALSE;
+        aux_mcu_tx_chain_running = TRUE;
+        start_chain = TRUE;
     }
+    cpu_irq_leave_critical();
     
-    /* The function below does wait for a previous transfer to finish */
-    dma_aux_mcu_init_tx_transfer(AUXMCU_SERCOM, (void*)message_to_send, sizeof(*message_to_send));
+    /* Otherwise the next transfer is started by interrupt */
+    if (start_chain != FALSE)
+    {
+        /* Wait for flood protection to expire (120us around) */
+        timer_wait_for_aux_tx_flood_protection();
+        
+        cpu_irq_enter_critical();
+        comms_aux_mcu_start_next_tx_transfer();
+        cpu_irq_leave_critical();
+    }
 }
 
 /*! \fn     comms_aux_mcu_send_simple_command_message(uint16_t command)
@@ -293,6 +532,10 @@ void comms_aux_mcu_hard_comms_reset_with_aux_mcu_reboot(void)
 {
     /* Set no comms (keep platform in sleep after its reboot) */
     platform_io_set_no_comms();
+    
+    /* Aux MCU will boot with framing disabled */
+    aux_mcu_comms_framing_enabled = FALSE;
+    dma_aux_mcu_set_rx_header_split(FALSE);
 
     /* Generate two packets full of 0xFF... */
     aux_mcu_message_t* temp_tx_message_pt = comms_aux_mcu_get_empty_packet_ready_to_be_sent(0xFFFF);
@@ -301,12 +544,14 @@ void comms_aux_mcu_hard_comms_reset_with_aux_mcu_reboot(void)
     temp_tx_message_pt = comms_aux_mcu_get_empty_packet_ready_to_be_sent(0xFFFF);
     memset((void*)temp_tx_message_pt, 0xFF, sizeof(*temp_tx_message_pt));
     comms_aux_mcu_send_message(temp_tx_message_pt);
+    comms_aux_mcu_wait_for_message_sent();
 
     /* Wait for platform to boot */
     timer_delay_ms(100);
 
     /* Reset our comms */
     dma_aux_mcu_disable_transfer();
+    comms_aux_mcu_reset_tx_ring();
 
     /* Enable our comms, clear no comms signal */
     comms_aux_arm_rx_and_clear_no_comms();
@@ -338,6 +583,45 @@ RET_TYPE comms_aux_mcu_send_receive_ping(void)
     return return_val;
 }
 
+/*! \fn     comms_aux_mcu_negotiate_framing(void)
+*   \brief  Let the aux MCU know we support framed messages, only send framed messages if it does too
+*   \return Success or not
+*   \note   Messages are received in one go until the aux MCU supports framing
+*/
+RET_TYPE comms_aux_mcu_negotiate_framing(void)
+{
+    aux_mcu_message_t* temp_rx_message_pt;
+    RET_TYPE return_val;
+    
+    /* Legacy messages until the aux MCU answers, which it does with a legacy message */
+    aux_mcu_comms_framing_enabled = FALSE;
+    dma_aux_mcu_set_rx_header_split(FALSE);
+
+    /* Platform details request, advertising our framing support */
+    aux_mcu_message_t* temp_tx_message_pt = comms_aux_mcu_get_empty_packet_ready_to_be_sent(AUX_MCU_MSG_TYPE_PLAT_DETAILS);
+    temp_tx_message_pt->payload_length1 = sizeof(aux_plat_details_message_t);
+    temp_tx_message_pt->aux_details_message.framing_magic = AUX_MCU_MSG_FRAMING_MAGIC;
+    comms_aux_mcu_send_message(temp_tx_message_pt);
+
+    /* Wait for answer: older aux MCU firmwares answer without the magic */
+    return_val = comms_aux_mcu_active_wait(&temp_rx_message_pt, AUX_MCU_MSG_TYPE_PLAT_DETAILS, FALSE, -1);
+    if ((return_val == RETURN_OK) && (temp_rx_message_pt->aux_details_message.framing_magic == AUX_MCU_MSG_FRAMING_MAGIC))
+    {
+        /* From now on the aux MCU leaves a gap after each header: receive them on their own */
+        aux_mcu_comms_framing_enabled = TRUE;
+        dma_aux_mcu_set_rx_header_split(TRUE);
+    }
+    else
+    {
+        return_val = RETURN_NOK;
+    }
+
+    /* Rearm receive */
+    comms_aux_arm_rx_and_clear_no_comms();
+
+    return return_val;
+}
+
 /*! \fn     comms_aux_mcu_get_aux_status(void)
 *   \brief  Request the aux MCU for its status, check if it's alive
 *   \return Different status (see enum)
@@ -793,6 +1077,9 @@ comms_msg_rcvd_te comms_aux_mcu_routine(msg_restrict_type_te answer_restrict_typ
     {
         return NO_MSG_RCVD;
     }
+    
+    /* Profiling: only the outermost call is timed */
+    PROFILER_BEGIN(PROFILER_AUX_MCU_ROUTINE);
 
     /* Recursivity: set function called flag */
     BOOL function_already_called = FALSE;
@@ -833,7 +1120,7 @@ comms_msg_rcvd_te comms_aux_mcu_routine(msg_restrict_type_te answer_restrict_typ
         platform_io_set_no_comms();
         
         /* Check if we were too slow to deal with the message before complete packet transfer */
-        if (dma_aux_mcu_check_and_clear_dma_transfer_flag() != FALSE)
+        if (comms_aux_mcu_check_and_clear_received_flag() != FALSE)
         {
             /* Complete packet receive, treat packet if valid flag is set or payload length #1 != 0 */
             aux_mcu_message_answered_using_first_bytes = FALSE;
@@ -869,7 +1156,7 @@ comms_msg_rcvd_te comms_aux_mcu_routine(msg_restrict_type_te answer_restrict_typ
             payload_length = aux_mcu_receive_message.payload_length1;
         }
     }
-    else if (dma_aux_mcu_check_and_clear_dma_transfer_flag() != FALSE)
+    else if (comms_aux_mcu_check_and_clear_received_flag() != FALSE)
     {
         /* Second part transfer, check if we have already dealt with this packet and if it is valid */
         if ((aux_mcu_message_answered_using_first_bytes == FALSE) && ((aux_mcu_receive_message.payload_length1 != 0) || ((aux_mcu_receive_message.payload_length1 == 0) && (aux_mcu_receive_message.rx_payload_valid_flag != 0))))
@@ -921,6 +1208,7 @@ comms_msg_rcvd_te comms_aux_mcu_routine(msg_restrict_type_te answer_restrict_typ
             aux_mcu_comms_aux_mcu_routine_function_called = FALSE;
         }
 
+        PROFILER_END(PROFILER_AUX_MCU_ROUTINE);
         return NO_MSG_RCVD;
     }
     
@@ -1051,6 +1339,7 @@ comms_msg_rcvd_te comms_aux_mcu_routine(msg_restrict_type_te answer_restrict_typ
     }
 
     /* Return type of message received */
+    PROFILER_END(PROFILER_AUX_MCU_ROUTINE);
     return msg_rcvd;
 }
 
@@ -1135,8 +1424,14 @@ RET_TYPE comms_aux_mcu_active_wait(aux_mcu_message_t** rx_message_pt_pt, uint16_
         timer_flag_te timer_flag_return = TIMER_RUNNING;
         while((dma_check_return == FALSE) && (timer_flag_return == TIMER_RUNNING))
         {
-            dma_check_return = dma_aux_mcu_check_and_clear_dma_transfer_flag();
+            dma_check_return = comms_aux_mcu_check_and_clear_received_flag();
             timer_flag_return = timer_has_allocated_timer_expired(temp_timer_id, FALSE);
+            #ifdef EMULATOR_BUILD
+            if (dma_check_return == FALSE)
+            {
+                emu_idle_wait();
+            }
+            #endif
         }
 
         /* Did the timer expire? */
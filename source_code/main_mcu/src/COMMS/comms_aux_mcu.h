@@ -28,6 +28,12 @@
 #include "comms_aux_mcu_defines.h"
 #include "defines.h"
 
+/* Defines */
+#define AUX_MCU_NB_TX_SLOTS     4
+
+/* Enums */
+typedef enum {AUX_MCU_TX_SLOT_FREE = 0, AUX_MCU_TX_SLOT_RESERVED, AUX_MCU_TX_SLOT_COMMITTED} aux_mcu_tx_slot_state_te;
+
 /* Prototypes */
 RET_TYPE comms_aux_mcu_active_wait(aux_mcu_message_t** rx_message_pt_pt, uint16_t expected_packet, BOOL single_try, int16_t expected_event);
 comms_msg_rcvd_te comms_aux_mcu_deal_with_ble_message(aux_mcu_message_t* received_message, msg_restrict_type_te answer_restrict_type);
@@ -37,7 +43,13 @@ void comms_aux_mcu_deal_with_received_event(aux_mcu_message_t* received_message)
 aux_mcu_message_t* comms_aux_mcu_wait_for_aux_event(uint16_t aux_mcu_event);
 aux_mcu_message_t* comms_aux_mcu_get_free_tx_message_object_pt(void);
 void comms_aux_mcu_send_message(aux_mcu_message_t* message_to_send);
-BOOL comms_aux_mcu_get_and_clear_second_tx_buffer_rerequested(void);
+uint16_t comms_aux_mcu_crc16_update(uint16_t crc, uint8_t* data, uint16_t length);
+uint16_t comms_aux_mcu_compute_frame_crc(aux_mcu_message_t* message);
+BOOL comms_aux_mcu_unframe_message(aux_mcu_message_t* message);
+BOOL comms_aux_mcu_check_and_clear_received_flag(void);
+RET_TYPE comms_aux_mcu_negotiate_framing(void);
+void comms_aux_mcu_disable_framing(void);
+BOOL comms_aux_mcu_get_and_clear_tx_slots_exhausted(void);
 void comms_aux_mcu_send_simple_command_message(uint16_t command);
 BOOL comms_aux_mcu_get_and_clear_rx_transfer_already_armed(void);
 void comms_aux_mcu_update_timeout_delay(uint16_t timeout_delay);
@@ -50,6 +62,9 @@ void comms_aux_mcu_set_invalid_message_received(void);
 void comms_aux_mcu_update_device_status_buffer(void);
 RET_TYPE comms_aux_mcu_send_receive_ping(void);
 void comms_aux_mcu_wait_for_message_sent(void);
+void comms_aux_mcu_tx_transfer_done_callback(void);
+void comms_aux_mcu_start_next_tx_transfer(void);
+void comms_aux_mcu_reset_tx_ring(void);
 void comms_aux_arm_rx_and_clear_no_comms(void);
 BOOL comms_aux_mcu_are_comms_disabled(void);
 void comms_aux_mcu_set_comms_disabled(void);
@@ -45,6 +45,13 @@
 #define AUX_MCU_MSG_TYPE_RNG_TRANSFER       0x000A
 #define AUX_MCU_MSG_TYPE_BLE_CMD            0x000B
 
+// Framed messages: header, payload_length1 payload bytes then a CRC16, message type flagged
+#define AUX_MCU_MSG_TYPE_FRAMED_FLAG        0x8000
+#define AUX_MCU_MSG_HEADER_LENGTH           4
+#define AUX_MCU_MSG_CRC_LENGTH              2
+#define AUX_MCU_MSG_FRAMING_MAGIC           0x4652
+#define AUX_MCU_MSG_IS_FRAMED(type)         ((((type) & AUX_MCU_MSG_TYPE_FRAMED_FLAG) != 0) && ((type) != 0xFFFF))
+
 // Main MCU commands
 #define MAIN_MCU_COMMAND_SLEEP              0x0001
 #define MAIN_MCU_COMMAND_ATTACH_USB         0x0002
@@ -96,6 +103,10 @@
 #define AUX_MCU_EVENT_BLE_CON_SPAM          0x0018
 #define AUX_MCU_EVENT_BONDING_CLEARED       0x0019
 
+// Keyboard typing flags, optional uint16_t after the keyboard symbols 0 terminator
+#define KEYBOARD_TYPING_FLAG_MERGE_MODIFIER 0x01
+#define KEYBOARD_TYPING_FLAG_PACK_KEYS      0x02
+
 // BLE commands
 #define BLE_MESSAGE_CMD_ENABLE              0x0001
 #define BLE_MESSAGE_CMD_RESERVED            0x0002
@@ -146,6 +157,7 @@ typedef struct
     uint32_t atbtlc_chip_id;
     uint8_t atbtlc_address[6];
     uint32_t aux_stack_low_watermark;
+    uint16_t framing_magic;
 } aux_plat_details_message_t;
 
 typedef struct
@@ -114,6 +114,12 @@
 #define HID_CMD_GET_CPZ_LUT_ENTRY   0x010E
 #define HID_CMD_GET_FAVORITES       0x010F
 #define HID_CMD_CHANGE_NODE_PWD     0x0110
+#define HID_CMD_BULK_IMPORT_BEGIN   0x0111
+#define HID_CMD_BULK_IMPORT_END     0x0112
+#define HID_CMD_READ_NODES          0x0113
+#define HID_CMD_WRITE_NODES         0x0114
+#define HID_CMD_EXPORT_STREAM       0x0115
+#define HID_CMD_READ_NODE_RANGE     0x0116
 // Define used to identify commands
 #define HID_FIRST_CMD_FOR_MMM       HID_CMD_GET_START_PARENTS
 #define HID_LAST_CMD_FOR_MMM        0x0200
@@ -168,6 +174,42 @@ typedef struct
     TOTPcredentials_t TOTPcreds;
 } hid_message_store_TOTP_cred_t;
 
+typedef struct
+{
+    uint16_t node_address;
+    uint16_t node_length;
+    uint16_t node_block[0];
+} hid_message_node_block_t;
+
+typedef struct
+{
+    uint16_t start_address;     // First node slot to scan
+    uint16_t nb_slots;          // Number of node slots to scan, child nodes taking two
+} hid_message_node_range_t;
+
+typedef struct
+{
+    hid_message_node_range_t remaining;     // Node slots left to be scanned, nb_slots is 0 once the range is done
+    uint16_t nb_nodes;
+    uint16_t reserved;
+    uint16_t node_blocks[0];
+} hid_message_node_range_answer_t;
+
+typedef struct
+{
+    uint16_t list_id;           // Credential types first, then data types. Equal to the number of lists once the export is done
+    uint16_t parent_address;    // Parent node to resume from, NODE_ADDR_NULL for the list start
+    uint32_t checksum;          // Running checksum of the node blocks sent before the parent above
+} hid_message_export_cursor_t;
+
+typedef struct
+{
+    hid_message_export_cursor_t cursor;
+    uint16_t nb_nodes;
+    uint16_t reserved;
+    uint16_t node_blocks[0];
+} hid_message_export_stream_t;
+
 typedef struct
 {
     uint16_t service_name_index;
@@ -35,6 +35,7 @@
 #include "logic_power.h"
 #include "logic_user.h"
 #include "custom_fs.h"
+#include "profiler.h"
 #include "dataflash.h"
 #include "text_ids.h"
 #include "nodemgmt.h"
@@ -199,6 +200,165 @@ void comms_hid_msgs_send_ack_nack_message(BOOL usb_hid_message, uint16_t message
     comms_aux_mcu_send_message(temp_tx_message_pt);
 }
 
+/*! \fn     comms_hid_msgs_export_stream_checksum(uint32_t checksum, uint16_t* buffer, uint16_t nb_words)
+*   \brief  Add a buffer to the export stream running checksum (Fletcher-32)
+*   \param  checksum    Current checksum
+*   \param  buffer      Pointer to the 16 bits words to add
+*   \param  nb_words    Number of words, 359 max so the sums can't overflow before the final reduction
+*   \return Updated checksum
+*/
+static uint32_t comms_hid_msgs_export_stream_checksum(uint32_t checksum, uint16_t* buffer, uint16_t nb_words)
+{
+    uint32_t sum1 = checksum & 0xFFFF;
+    uint32_t sum2 = checksum >> 16;
+    
+    for (uint16_t i = 0; i < nb_words; i++)
+    {
+        sum1 += buffer[i];
+        sum2 += sum1;
+    }
+    
+    return ((sum2 % 0xFFFF) << 16) | (sum1 % 0xFFFF);
+}
+
+/*! \fn     comms_hid_msgs_send_export_stream(BOOL usb_hid_message, uint16_t message_type, uint16_t max_payload_size, hid_message_export_cursor_t* cursor)
+*   \brief  Push the user database node blocks back-to-back, without waiting for host requests
+*   \param  usb_hid_message     TRUE for USB HID message
+*   \param  message_type        HID message type
+*   \param  max_payload_size    Max HID payload size
+*   \param  cursor              Pointer to the cursor to start from, updated as the export goes
+*   \note   Lists are walked parent by parent: credential lists (children) then data lists (data nodes)
+*   \note   Each message cursor points to its last parent boundary: resuming from it sends that parent and its children again
+*   \note   The stream ends with an empty message, or with a 1 byte NACK if a node couldn't be exported
+*/
+static void comms_hid_msgs_send_export_stream(BOOL usb_hid_message, uint16_t message_type, uint16_t max_payload_size, hid_message_export_cursor_t* cursor)
+{
+    uint16_t start_addresses[MEMBER_ARRAY_SIZE(nodemgmt_profile_main_data_t, cred_start_addresses) + MEMBER_ARRAY_SIZE(nodemgmt_profile_main_data_t, data_start_addresses)];
+    uint16_t nb_lists = nodemgmt_get_start_addresses(start_addresses);
+    uint16_t next_parent_address = NODE_ADDR_NULL;
+    uint16_t child_address = NODE_ADDR_NULL;
+    uint32_t checksum = cursor->checksum;
+    uint32_t nb_exported_nodes = 0;
+    node_type_te temp_node_type;
+    BOOL parent_sent = FALSE;
+    
+    /* Check cursor and that a child node block fits in one message */
+    if ((cursor->list_id > nb_lists) || (sizeof(hid_message_export_stream_t) + sizeof(hid_message_node_block_t) + sizeof(child_node_t) > max_payload_size))
+    {
+        comms_hid_msgs_send_ack_nack_message(usb_hid_message, message_type, FALSE);
+        return;
+    }
+    
+    while (TRUE)
+    {
+        aux_mcu_message_t* temp_tx_message_pt = comms_hid_msgs_get_empty_hid_packet(usb_hid_message, message_type, 0);
+        hid_message_export_stream_t* stream_message_pt = (hid_message_export_stream_t*)temp_tx_message_pt->hid_message.payload;
+        uint16_t answer_length = sizeof(hid_message_export_stream_t);
+        
+        /* Pack node blocks until the message is full or all lists are exported */
+        while (cursor->list_id < nb_lists)
+        {
+            BOOL is_data_list = (cursor->list_id >= MEMBER_ARRAY_SIZE(nodemgmt_profile_main_data_t, cred_start_addresses))? TRUE:FALSE;
+            uint16_t node_address;
+            uint16_t node_length;
+            
+            /* List start: skip empty lists */
+            if (cursor->parent_address == NODE_ADDR_NULL)
+            {
+                cursor->parent_address = start_addresses[cursor->list_id];
+                if (cursor->parent_address == NODE_ADDR_NULL)
+                {
+                    cursor->list_id++;
+                    continue;
+                }
+            }
+            
+            /* Next node: parent, then its children */
+            if (parent_sent == FALSE)
+            {
+                node_address = cursor->parent_address;
+                node_length = sizeof(parent_node_t);
+            }
+            else if (child_address != NODE_ADDR_NULL)
+            {
+                node_address = child_address;
+                node_length = sizeof(child_node_t);
+            }
+            else
+            {
+                /* Parent and its children exported: move cursor to next parent, or to next list start */
+                cursor->parent_address = next_parent_address;
+                cursor->checksum = checksum;
+                parent_sent = FALSE;
+                if (next_parent_address == NODE_ADDR_NULL)
+                {
+                    cursor->list_id++;
+                }
+                continue;
+            }
+            
+            /* Check for space */
+            if (answer_length + sizeof(hid_message_node_block_t) + node_length > max_payload_size)
+            {
+                break;
+            }
+            
+            /* Only export user nodes (both slots for children), parents having the list type, and stop on looping lists */
+            if ((nodemgmt_check_user_permission(node_address, &temp_node_type) != RETURN_OK) \
+                || ((parent_sent == FALSE) && (temp_node_type != ((is_data_list != FALSE)? NODE_TYPE_PARENT_DATA:NODE_TYPE_PARENT))) \
+                || ((parent_sent != FALSE) && (nodemgmt_check_user_permission(nodemgmt_get_incremented_address(node_address), &temp_node_type) != RETURN_OK)) \
+                || (++nb_exported_nodes > NODEMGMT_NB_NODE_SLOTS))
+            {
+                temp_tx_message_pt->hid_message.payload[0] = HID_1BYTE_NACK;
+                comms_hid_msgs_update_message_payload_length_fields(temp_tx_message_pt, sizeof(uint8_t));
+                comms_aux_mcu_send_message(temp_tx_message_pt);
+                return;
+            }
+            
+            /* Read node and fetch the next addresses in the lists */
+            hid_message_node_block_t* node_block_pt = (hid_message_node_block_t*)&temp_tx_message_pt->hid_message.payload[answer_length];
+            node_block_pt->node_address = node_address;
+            node_block_pt->node_length = node_length;
+            if (parent_sent == FALSE)
+            {
+                parent_node_t* parent_node_pt = (parent_node_t*)node_block_pt->node_block;
+                nodemgmt_read_parent_node_data_block_from_flash(node_address, parent_node_pt);
+                next_parent_address = parent_node_pt->cred_parent.nextParentAddress;
+                child_address = parent_node_pt->cred_parent.nextChildAddress;
+                parent_sent = TRUE;
+            }
+            else
+            {
+                child_node_t* child_node_pt = (child_node_t*)node_block_pt->node_block;
+                nodemgmt_read_child_node_data_block_from_flash(node_address, child_node_pt);
+                child_address = (is_data_list != FALSE)? child_node_pt->data_child.nextDataAddress:child_node_pt->cred_child.nextChildAddress;
+            }
+            
+            /* Update running checksum */
+            checksum = comms_hid_msgs_export_stream_checksum(checksum, (uint16_t*)node_block_pt, (sizeof(hid_message_node_block_t) + node_length)/sizeof(uint16_t));
+            answer_length += sizeof(hid_message_node_block_t) + node_length;
+            stream_message_pt->nb_nodes++;
+        }
+        
+        /* Send message with the current cursor */
+        memcpy(&stream_message_pt->cursor, cursor, sizeof(stream_message_pt->cursor));
+        comms_hid_msgs_update_message_payload_length_fields(temp_tx_message_pt, answer_length);
+        comms_aux_mcu_send_message(temp_tx_message_pt);
+        
+        /* Empty message: export done */
+        if (stream_message_pt->nb_nodes == 0)
+        {
+            return;
+        }
+        
+        /* Flow control: aux MCU only has one HID buffer, and answers pings once it has pushed our message to the host */
+        if (comms_aux_mcu_send_receive_ping() != RETURN_OK)
+        {
+            return;
+        }
+    }
+}
+
 /*! \fn     comms_hid_msgs_parse(hid_message_t* rcv_msg, uint16_t supposed_payload_length, msg_restrict_type_te answer_restrict_type, BOOL is_message_from_usb)
 *   \brief  Parse an incoming message from USB or BLE
 *   \param  rcv_msg                 Received message
@@ -685,6 +845,7 @@ void comms_hid_msgs_parse(hid_message_t* rcv_msg, uint16_t supposed_payload_leng
             {
                 /* Store new address */
                 nodemgmt_set_cred_start_address(rcv_msg->payload_as_uint16[1], rcv_msg->payload_as_uint16[0]);
+                nodemgmt_invalidate_ram_caches();
 
                 /* Set success byte */
                 comms_hid_msgs_send_ack_nack_message(is_message_from_usb, rcv_message_type, TRUE);
@@ -705,6 +866,7 @@ void comms_hid_msgs_parse(hid_message_t* rcv_msg, uint16_t supposed_payload_leng
             {
                 /* Store new address */
                 nodemgmt_set_data_start_address(rcv_msg->payload_as_uint16[1], rcv_msg->payload_as_uint16[0]);
+                nodemgmt_invalidate_ram_caches();
 
                 /* Set success byte */
                 comms_hid_msgs_send_ack_nack_message(is_message_from_usb, rcv_message_type, TRUE);
@@ -725,6 +887,7 @@ void comms_hid_msgs_parse(hid_message_t* rcv_msg, uint16_t supposed_payload_leng
             {
                 /* Store new addresses */
                 nodemgmt_set_start_addresses(rcv_msg->payload_as_uint16);
+                nodemgmt_invalidate_ram_caches();
 
                 /* Set success byte */
                 comms_hid_msgs_send_ack_nack_message(is_message_from_usb, rcv_message_type, TRUE);
@@ -767,6 +930,7 @@ void comms_hid_msgs_parse(hid_message_t* rcv_msg, uint16_t supposed_payload_leng
                 /* Clear bool */
                 logic_device_activity_detected();
                 logic_security_clear_management_mode();
+                logic_user_bulk_import_end();
                 
                 /* Trigger dedicated actions */
                 nodemgmt_trigger_db_ext_changed_actions();
@@ -929,10 +1093,219 @@ void comms_hid_msgs_parse(hid_message_t* rcv_msg, uint16_t supposed_payload_leng
             }
         }
 
+        case HID_CMD_READ_NODES:
+        {
+            node_type_te temp_node_type;
+            
+            /* Check addresses length and first node permission */
+            if ((rcv_msg->payload_length < sizeof(uint16_t)) || ((rcv_msg->payload_length % sizeof(uint16_t)) != 0) || (nodemgmt_check_user_permission(rcv_msg->payload_as_uint16[0], &temp_node_type) != RETURN_OK))
+            {
+                /* Set nack, leave same command id */
+                comms_hid_msgs_send_ack_nack_message(is_message_from_usb, rcv_message_type, FALSE);
+                return;
+            }
+            
+            /* Answer: number of nodes, then packed node blocks */
+            aux_mcu_message_t* temp_tx_message_pt = comms_hid_msgs_get_empty_hid_packet(is_message_from_usb, rcv_message_type, 0);
+            uint16_t nb_addresses = rcv_msg->payload_length / sizeof(uint16_t);
+            uint16_t answer_length = sizeof(uint16_t);
+            uint16_t nb_nodes = 0;
+            
+            /* Pack as many nodes as possible, stopping at the first one the user can't read: the host asks again for the remaining ones */
+            while ((nb_nodes < nb_addresses) && (nodemgmt_check_user_permission(rcv_msg->payload_as_uint16[nb_nodes], &temp_node_type) == RETURN_OK))
+            {
+                hid_message_node_block_t* node_block_pt = (hid_message_node_block_t*)&temp_tx_message_pt->hid_message.payload[answer_length];
+                BOOL is_parent_block = ((temp_node_type == NODE_TYPE_PARENT) || (temp_node_type == NODE_TYPE_PARENT_DATA) || (temp_node_type == NODE_TYPE_NULL))? TRUE:FALSE;
+                uint16_t node_length = (is_parent_block != FALSE)? sizeof(parent_node_t):sizeof(child_node_t);
+                
+                /* Check for space */
+                if (answer_length + sizeof(hid_message_node_block_t) + node_length > max_payload_size)
+                {
+                    break;
+                }
+                
+                /* Read node */
+                node_block_pt->node_address = rcv_msg->payload_as_uint16[nb_nodes];
+                node_block_pt->node_length = node_length;
+                if (is_parent_block != FALSE)
+                {
+                    nodemgmt_read_parent_node_data_block_from_flash(node_block_pt->node_address, (parent_node_t*)node_block_pt->node_block);
+                }
+                else
+                {
+                    nodemgmt_read_child_node_data_block_from_flash(node_block_pt->node_address, (child_node_t*)node_block_pt->node_block);
+                }
+                answer_length += sizeof(hid_message_node_block_t) + node_length;
+                nb_nodes++;
+            }
+            
+            /* Send answer */
+            temp_tx_message_pt->hid_message.payload_as_uint16[0] = nb_nodes;
+            comms_hid_msgs_update_message_payload_length_fields(temp_tx_message_pt, answer_length);
+            comms_aux_mcu_send_message(temp_tx_message_pt);
+            return;
+        }
+        
+        case HID_CMD_READ_NODE_RANGE:
+        {
+            hid_message_node_range_t node_range;
+            node_type_te temp_node_type;
+            
+            /* Check payload length */
+            if (rcv_msg->payload_length != sizeof(node_range))
+            {
+                /* Set nack, leave same command id */
+                comms_hid_msgs_send_ack_nack_message(is_message_from_usb, rcv_message_type, FALSE);
+                return;
+            }
+            memcpy(&node_range, rcv_msg->payload, sizeof(node_range));
+            
+            /* Answer: remaining range, number of nodes, then packed node blocks */
+            aux_mcu_message_t* temp_tx_message_pt = comms_hid_msgs_get_empty_hid_packet(is_message_from_usb, rcv_message_type, 0);
+            hid_message_node_range_answer_t* range_answer_pt = (hid_message_node_range_answer_t*)temp_tx_message_pt->hid_message.payload;
+            uint16_t answer_length = sizeof(hid_message_node_range_answer_t);
+            uint16_t nb_nodes = 0;
+            
+            /* Scan node slots, skipping the ones that don't start a node the user can read */
+            while (node_range.nb_slots != 0)
+            {
+                uint16_t nb_slots_taken = 1;
+                
+                if (nodemgmt_check_user_node_start(node_range.start_address, &temp_node_type) == RETURN_OK)
+                {
+                    hid_message_node_block_t* node_block_pt = (hid_message_node_block_t*)&temp_tx_message_pt->hid_message.payload[answer_length];
+                    BOOL is_parent_block = ((temp_node_type == NODE_TYPE_PARENT) || (temp_node_type == NODE_TYPE_PARENT_DATA))? TRUE:FALSE;
+                    uint16_t node_length = (is_parent_block != FALSE)? sizeof(parent_node_t):sizeof(child_node_t);
+                    
+                    /* Check for space: the host asks again from there */
+                    if (answer_length + sizeof(hid_message_node_block_t) + node_length > max_payload_size)
+                    {
+                        break;
+                    }
+                    
+                    /* Read node */
+                    node_block_pt->node_address = node_range.start_address;
+                    node_block_pt->node_length = node_length;
+                    if (is_parent_block != FALSE)
+                    {
+                        nodemgmt_read_parent_node_data_block_from_flash(node_block_pt->node_address, (parent_node_t*)node_block_pt->node_block);
+                    }
+                    else
+                    {
+                        nodemgmt_read_child_node_data_block_from_flash(node_block_pt->node_address, (child_node_t*)node_block_pt->node_block);
+                        nb_slots_taken = 2;
+                    }
+                    answer_length += sizeof(hid_message_node_block_t) + node_length;
+                    nb_nodes++;
+                }
+                
+                /* Move to the next node slot */
+                for (uint16_t i = 0; (i < nb_slots_taken) && (node_range.nb_slots != 0); i++)
+                {
+                    node_range.start_address = nodemgmt_get_incremented_address(node_range.start_address);
+                    node_range.nb_slots--;
+                }
+            }
+            
+            /* Send answer */
+            memcpy(&range_answer_pt->remaining, &node_range, sizeof(node_range));
+            range_answer_pt->nb_nodes = nb_nodes;
+            comms_hid_msgs_update_message_payload_length_fields(temp_tx_message_pt, answer_length);
+            comms_aux_mcu_send_message(temp_tx_message_pt);
+            return;
+        }
+        
+        case HID_CMD_WRITE_NODES:
+        {
+            hid_message_node_block_t* node_block_pt;
+            node_type_te temp_node_type_te;
+            uint16_t payload_index = 0;
+            
+            /* Parent and children lists may be modified by the host */
+            nodemgmt_invalidate_ram_caches();
+            
+            /* Check all packed node blocks before writing any of them */
+            while (payload_index + sizeof(hid_message_node_block_t) <= rcv_msg->payload_length)
+            {
+                node_block_pt = (hid_message_node_block_t*)&rcv_msg->payload[payload_index];
+                if ((node_block_pt->node_length == sizeof(child_node_t)) \
+                        && (nodemgmt_check_user_permission(node_block_pt->node_address, &temp_node_type_te) == RETURN_OK) \
+                        && (nodemgmt_check_user_permission(nodemgmt_get_incremented_address(node_block_pt->node_address), &temp_node_type_te) == RETURN_OK))
+                {
+                    payload_index += sizeof(hid_message_node_block_t) + sizeof(child_node_t);
+                }
+                else if ((node_block_pt->node_length == sizeof(parent_node_t)) \
+                        && (nodemgmt_check_user_permission(node_block_pt->node_address, &temp_node_type_te) == RETURN_OK))
+                {
+                    payload_index += sizeof(hid_message_node_block_t) + sizeof(parent_node_t);
+                }
+                else
+                {
+                    break;
+                }
+            }
+            
+            /* Payload should only contain valid blocks */
+            if ((payload_index == 0) || (payload_index != rcv_msg->payload_length))
+            {
+                /* Set failure byte */
+                comms_hid_msgs_send_ack_nack_message(is_message_from_usb, rcv_message_type, FALSE);
+                return;
+            }
+            
+            /* Write nodes */
+            for (payload_index = 0; payload_index < rcv_msg->payload_length; payload_index += sizeof(hid_message_node_block_t) + node_block_pt->node_length)
+            {
+                node_block_pt = (hid_message_node_block_t*)&rcv_msg->payload[payload_index];
+                if (node_block_pt->node_length == sizeof(child_node_t))
+                {
+                    nodemgmt_write_child_node_block_to_flash(node_block_pt->node_address, (child_node_t*)node_block_pt->node_block, FALSE);
+                }
+                else
+                {
+                    nodemgmt_write_parent_node_data_block_to_flash(node_block_pt->node_address, (parent_node_t*)node_block_pt->node_block);
+                }
+            }
+            
+            /* Set success byte */
+            comms_hid_msgs_send_ack_nack_message(is_message_from_usb, rcv_message_type, TRUE);
+            return;
+        }
+        
+        case HID_CMD_EXPORT_STREAM:
+        {
+            hid_message_export_cursor_t export_cursor;
+            
+            /* Optional payload: cursor to resume an interrupted export */
+            if (rcv_msg->payload_length == sizeof(export_cursor))
+            {
+                memcpy(&export_cursor, rcv_msg->payload, sizeof(export_cursor));
+            }
+            else if (rcv_msg->payload_length == 0)
+            {
+                export_cursor.list_id = 0;
+                export_cursor.parent_address = NODE_ADDR_NULL;
+                export_cursor.checksum = 0;
+            }
+            else
+            {
+                /* Set nack, leave same command id */
+                comms_hid_msgs_send_ack_nack_message(is_message_from_usb, rcv_message_type, FALSE);
+                return;
+            }
+            
+            /* Stream database: rcv_msg is overwritten by the flow control pings from here */
+            comms_hid_msgs_send_export_stream(is_message_from_usb, rcv_message_type, max_payload_size, &export_cursor);
+            return;
+        }
+        
         case HID_CMD_WRITE_NODE:
         {
             node_type_te temp_node_type_te;
 
+            /* Parent and children lists may be modified by the host */
+            nodemgmt_invalidate_ram_caches();
+
             /* Check for big or small node size */
             if ((rcv_msg->payload_length == sizeof(uint16_t) + sizeof(child_node_t)) \
                     && (nodemgmt_check_user_permission(rcv_msg->payload_as_uint16[0], &temp_node_type_te) == RETURN_OK) \
@@ -1036,6 +1409,7 @@ void comms_hid_msgs_parse(hid_message_t* rcv_msg, uint16_t supposed_payload_leng
             if (rcv_msg->payload_length == MEMBER_SIZE(nodemgmt_profile_main_data_t, current_ctr))
             {
                 nodemgmt_set_profile_ctr(rcv_msg->payload);
+                logic_encryption_clear_ctr_reservation();
 
                 /* Set success byte */
                 comms_hid_msgs_send_ack_nack_message(is_message_from_usb, rcv_message_type, TRUE);
@@ -1328,6 +1702,30 @@ void comms_hid_msgs_parse(hid_message_t* rcv_msg, uint16_t supposed_payload_leng
             }
         }
         
+        case HID_CMD_BULK_IMPORT_BEGIN:
+        {
+            /* Payload: number of credentials that are going to be stored */
+            if ((rcv_msg->payload_length == sizeof(uint16_t)) && (logic_user_bulk_import_begin(rcv_msg->payload_as_uint16[0]) == RETURN_OK))
+            {
+                comms_hid_msgs_send_ack_nack_message(is_message_from_usb, rcv_message_type, TRUE);
+                return;
+            }
+            else
+            {
+                comms_hid_msgs_send_ack_nack_message(is_message_from_usb, rcv_message_type, FALSE);
+                return;
+            }
+        }
+        
+        case HID_CMD_BULK_IMPORT_END:
+        {
+            logic_user_bulk_import_end();
+            
+            /* Set ack, leave same command id */
+            comms_hid_msgs_send_ack_nack_message(is_message_from_usb, rcv_message_type, TRUE);
+            return;
+        }
+        
         case HID_CMD_ID_STORE_CRED:
         {               
             /********************************/
@@ -1939,7 +2337,7 @@ void comms_hid_msgs_parse(hid_message_t* rcv_msg, uint16_t supposed_payload_leng
                         password_buffer[0] = suggested_counter_value;
                     }
                     password_buffer[1] = custom_fs_get_platform_serial_number();
-                    br_aes_ct_ctrcbc_ctr(&device_operations_aes_context, (void*)temp_ctr, password_buffer, sizeof(password_buffer));
+                    PROFILER_CALL(PROFILER_AES_CTR, br_aes_ct_ctrcbc_ctr(&device_operations_aes_context, (void*)temp_ctr, password_buffer, sizeof(password_buffer)));
                     
                     /* Check for match */
                     if (utils_side_channel_safe_memcmp((uint8_t*)password_buffer, &rcv_msg->payload[sizeof(uint32_t)], sizeof(password_buffer)) == 0)
@@ -1964,7 +2362,7 @@ void comms_hid_msgs_parse(hid_message_t* rcv_msg, uint16_t supposed_payload_leng
                         {
                             password_buffer[0] = suggested_counter_value;
                         }
-                        br_aes_ct_ctrcbc_ctr(&device_operations_aes_context, (void*)temp_ctr, password_buffer, sizeof(password_buffer));
+                        PROFILER_CALL(PROFILER_AES_CTR, br_aes_ct_ctrcbc_ctr(&device_operations_aes_context, (void*)temp_ctr, password_buffer, sizeof(password_buffer)));
                         
                         /* Increment challenge counter */
                         if (current_counter_value != UINT32_MAX)
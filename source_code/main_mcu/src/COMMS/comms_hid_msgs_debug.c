@@ -34,6 +34,8 @@
 #include "platform_io.h"
 #include "logic_power.h"
 #include "dataflash.h"
+#include "profiler.h"
+#include "dbflash.h"
 #include "sh1122.h"
 #include "main.h"
 #include "dma.h"
@@ -344,6 +346,36 @@ void comms_hid_msgs_parse_debug(hid_message_t* rcv_msg, uint16_t supposed_payloa
             comms_aux_mcu_send_message(temp_tx_message_pt);
             return;          
         }
+        case HID_CMD_ID_GET_DBFLASH_CACHE_STATS:
+        {
+            aux_mcu_message_t* temp_tx_message_pt;
+            dbflash_page_cache_stats_t cache_stats;
+            
+            /* Get stats, reset them if asked to */
+            dbflash_get_page_cache_stats(&cache_stats, ((rcv_msg->payload_length != 0) && (rcv_msg->payload[0] != 0))?TRUE:FALSE);
+            
+            /* Get empty message, fill it and send it */
+            temp_tx_message_pt = comms_hid_msgs_get_empty_hid_packet(is_message_from_usb, rcv_message_type, sizeof(cache_stats));
+            memcpy(temp_tx_message_pt->hid_message.payload, &cache_stats, sizeof(cache_stats));
+            comms_aux_mcu_send_message(temp_tx_message_pt);
+            return;
+        }
+#ifdef HOT_PATH_PROFILER_ENABLED
+        case HID_CMD_ID_GET_PROFILER_STATS:
+        {
+            aux_mcu_message_t* temp_tx_message_pt;
+            profiler_entry_t profiler_entries[PROFILER_NB_SECTIONS];
+            
+            /* Get profiler table, reset it if asked to */
+            profiler_get_entries(profiler_entries, ((rcv_msg->payload_length != 0) && (rcv_msg->payload[0] != 0))?TRUE:FALSE);
+            
+            /* Get empty message, fill it and send it */
+            temp_tx_message_pt = comms_hid_msgs_get_empty_hid_packet(is_message_from_usb, rcv_message_type, sizeof(profiler_entries));
+            memcpy(temp_tx_message_pt->hid_message.payload, profiler_entries, sizeof(profiler_entries));
+            comms_aux_mcu_send_message(temp_tx_message_pt);
+            return;
+        }
+#endif
         case HID_CMD_ID_GET_BATTERY_STATUS:
         {
             aux_mcu_message_t* temp_tx_message_pt;
@@ -43,5 +43,7 @@
 #define HID_CMD_ID_FLASH_AUX_AND_MAIN       0x800E
 #define HID_CMD_ID_GET_TIMESTAMP            0x800F
 #define HID_CMD_ID_SET_PLAT_UNIQUE_DATA     0x8010
+#define HID_CMD_ID_GET_DBFLASH_CACHE_STATS  0x8011
+#define HID_CMD_ID_GET_PROFILER_STATS       0x8012
 
 #endif /* COMMS_HID_MSGS_DEBUG_DEFINES_H_ */
\ No newline at end of file
@@ -44,12 +44,35 @@ volatile BOOL dma_oled_transfer_done = FALSE;
 volatile BOOL dma_acc_transfer_done = FALSE;
 /* Boolean to specify if we received a packet from aux MCU */
 volatile BOOL dma_aux_mcu_packet_received = FALSE;
-/* Boolean to specify if we sent a packet to aux MCU */
-volatile BOOL dma_aux_mcu_packet_sent = TRUE;
 /* Boolean to specify if DMA needs to be rearmed to receive an aux MCU packet (use with caution) */
 volatile BOOL dma_aux_mcu_rx_transfer_to_be_rearmed = TRUE;
+/* Aux MCU packet reception stage: header first, then the rest of the message */
+volatile dma_aux_mcu_rx_stage_te dma_aux_mcu_rx_stage = DMA_AUX_MCU_RX_STAGE_IDLE;
+/* Set to receive headers on their own: only once the aux MCU negotiated framing, as it then leaves a gap after each header */
+volatile BOOL dma_aux_mcu_rx_header_split = FALSE;
+/* Buffer & size given for the aux MCU packet reception */
+uint8_t* dma_aux_mcu_rx_buffer;
+uint16_t dma_aux_mcu_rx_size;
 
 
+/*! \fn     dma_aux_mcu_arm_rx_descriptor(uint8_t* datap, uint16_t size)
+*   \brief  Arm the aux MCU comms RX channel
+*   \param  datap       Pointer to where to store the data
+*   \param  size        Number of bytes for transfer
+*   \note   Called from the DMA interrupt or in a critical section
+*/
+static void dma_aux_mcu_arm_rx_descriptor(uint8_t* datap, uint16_t size)
+{
+    /* Setup transfer size */
+    dma_descriptors[DMA_DESCID_RX_COMMS].BTCNT.bit.BTCNT = size;
+    /* Source address: DATA register from SPI */
+    dma_descriptors[DMA_DESCID_RX_COMMS].DSTADDR.reg = (uint32_t)datap + size;
+    
+    /* Resume DMA channel operation */
+    DMAC->CHID.reg= DMAC_CHID_ID(DMA_DESCID_RX_COMMS);
+    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_ENABLE;
+}
+
 /*! \fn     DMAC_Handler(void)
 *   \brief  Function called by interrupt when RX is done
 */
@@ -60,23 +83,46 @@ void DMAC_Handler(void)
     DMAC->CHID.reg = DMAC_CHID_ID(DMA_DESCID_RX_COMMS);
     if ((DMAC->CHINTFLAG.reg & DMAC_CHINTFLAG_TCMPL) != 0)
     {
-        /* Set transfer done boolean, clear interrupt */
-        platform_io_set_no_comms();
-        dma_aux_mcu_packet_received = TRUE;
+        aux_mcu_message_t* rx_header = (aux_mcu_message_t*)dma_aux_mcu_rx_buffer;
         DMAC->CHINTFLAG.reg = DMAC_CHINTFLAG_TCMPL;
-        dma_aux_mcu_rx_transfer_to_be_rearmed = TRUE;
+        
+        /* Header received: arm the remainder of the message right away, framed or not */
+        if ((dma_aux_mcu_rx_stage == DMA_AUX_MCU_RX_STAGE_HEADER) && (AUX_MCU_MSG_IS_FRAMED(rx_header->message_type) == FALSE))
+        {
+            dma_aux_mcu_rx_stage = DMA_AUX_MCU_RX_STAGE_LEGACY_BODY;
+            dma_aux_mcu_arm_rx_descriptor(dma_aux_mcu_rx_buffer + AUX_MCU_MSG_HEADER_LENGTH, dma_aux_mcu_rx_size - AUX_MCU_MSG_HEADER_LENGTH);
+        }
+        else if ((dma_aux_mcu_rx_stage == DMA_AUX_MCU_RX_STAGE_HEADER) && (rx_header->payload_length1 <= AUX_MCU_MSG_PAYLOAD_LENGTH))
+        {
+            dma_aux_mcu_rx_stage = DMA_AUX_MCU_RX_STAGE_FRAMED_BODY;
+            dma_aux_mcu_arm_rx_descriptor(dma_aux_mcu_rx_buffer + AUX_MCU_MSG_HEADER_LENGTH, rx_header->payload_length1 + AUX_MCU_MSG_CRC_LENGTH);
+        }
+        else
+        {
+            /* Legacy message while receiving split messages: the aux MCU went back to legacy messages, which it may not send with a gap */
+            if ((dma_aux_mcu_rx_stage == DMA_AUX_MCU_RX_STAGE_LEGACY_BODY) && (AUX_MCU_MSG_IS_FRAMED(rx_header->message_type) == FALSE))
+            {
+                dma_aux_mcu_rx_header_split = FALSE;
+            }
+            
+            /* Set transfer done boolean (framed message with an invalid length is discarded by comms) */
+            platform_io_set_no_comms();
+            dma_aux_mcu_packet_received = TRUE;
+            dma_aux_mcu_rx_stage = DMA_AUX_MCU_RX_STAGE_IDLE;
+            dma_aux_mcu_rx_transfer_to_be_rearmed = TRUE;
+        }
     }
     
-    /* AUX MCU RX routine */
+    /* AUX MCU TX routine */
     DMAC->CHID.reg = DMAC_CHID_ID(DMA_DESCID_TX_COMMS);
     if ((DMAC->CHINTFLAG.reg & DMAC_CHINTFLAG_TCMPL) != 0)
     {
         /* Arm MCU systick for tx flood protection */
         timer_arm_mcu_systick_for_aux_tx_flood_protection();
         
-        /* Set transfer done boolean, clear interrupt */
-        dma_aux_mcu_packet_sent = TRUE;
+        /* Clear interrupt, free sent message & chain the next one */
         DMAC->CHINTFLAG.reg = DMAC_CHINTFLAG_TCMPL;
+        comms_aux_mcu_tx_transfer_done_callback();
     }
     #endif
     
@@ -124,14 +170,6 @@ void dma_set_custom_fs_flag_done(void)
     dma_custom_fs_transfer_done = TRUE;
 }
 
-/*! \fn     dma_wait_for_aux_mcu_packet_sent(void)
-*   \brief  Wait for aux mcu packet to be sent
-*/
-void dma_wait_for_aux_mcu_packet_sent(void)
-{
-    while (dma_aux_mcu_packet_sent == FALSE);
-}
-
 /*! \fn     dma_reset(void)
 *   \brief  Reset DMA controller
 */
@@ -365,7 +403,13 @@ BOOL dma_acc_check_dma_transfer_flag(void)
 */
 uint16_t dma_aux_mcu_get_remaining_bytes_for_rx_transfer(void)
 {
-    /* Check for active channel */
+    /* Nothing can be dealt with before the header, framed messages are only dealt with once their CRC is received */
+    if ((dma_aux_mcu_rx_stage == DMA_AUX_MCU_RX_STAGE_HEADER) || (dma_aux_mcu_rx_stage == DMA_AUX_MCU_RX_STAGE_FRAMED_BODY))
+    {
+        return dma_aux_mcu_rx_size;
+    }
+    
+    /* Check for active channel: the legacy message body ends with the message */
     DMAC_ACTIVE_Type active_reg_copy = DMAC->ACTIVE;
     if (active_reg_copy.bit.ID == DMA_DESCID_RX_COMMS && active_reg_copy.bit.ABUSY != 0)
     {
@@ -687,22 +731,12 @@ void dma_acc_init_transfer(Sercom *sercom, void* datap, uint16_t size, uint8_t*
 *   \param  sercom      Pointer to a sercom module
 *   \param  datap       Pointer to the data
 *   \param  size        Number of bytes to transfer
+*   \note   Called by interrupt or in a critical section, when no transfer is ongoing (see comms_aux_mcu_start_next_tx_transfer)
 */
 void dma_aux_mcu_init_tx_transfer(Sercom* sercom, void* datap, uint16_t size)
 {
     volatile void *usart_data_p = &sercom->USART.DATA.reg;
     
-    /* Wait for previous transfer to be done */
-    while (dma_aux_mcu_packet_sent == FALSE);
-    
-    /* Wait for flood protection to expire (120us around) */
-    timer_wait_for_aux_tx_flood_protection();
-    
-    cpu_irq_enter_critical();
-    
-    /* Set bool */
-    dma_aux_mcu_packet_sent = FALSE;
-    
     /* Setup transfer size */
     dma_descriptors[DMA_DESCID_TX_COMMS].BTCNT.bit.BTCNT = (uint16_t)size;
     /* Source address: DATA register from SPI */
@@ -713,8 +747,6 @@ void dma_aux_mcu_init_tx_transfer(Sercom* sercom, void* datap, uint16_t size)
     /* Resume DMA channel operation */
     DMAC->CHID.reg= DMAC_CHID_ID(DMA_DESCID_TX_COMMS);
     DMAC->CHCTRLA.reg = DMAC_CHCTRLA_ENABLE;
-    
-    cpu_irq_leave_critical();
 }
 
 /*! \fn     dma_aux_mcu_disable_transfer(void)
@@ -738,12 +770,24 @@ void dma_aux_mcu_disable_transfer(void)
     /* Wait for bit clear */
     while(DMAC->CHCTRLA.reg != 0);
     
-    /* Reset bool */
+    /* Reset bools & reception stage */
     dma_aux_mcu_packet_received = FALSE;
+    dma_aux_mcu_rx_transfer_to_be_rearmed = TRUE;
+    dma_aux_mcu_rx_stage = DMA_AUX_MCU_RX_STAGE_IDLE;
     
     cpu_irq_leave_critical();    
 }
 
+/*! \fn     dma_aux_mcu_set_rx_header_split(BOOL header_split)
+*   \brief  Select if aux MCU messages are received as a header then the rest of the message, or in one go
+*   \param  header_split    TRUE to receive the header on its own (framed messages)
+*   \note   Only taken into account when the reception is next armed
+*/
+void dma_aux_mcu_set_rx_header_split(BOOL header_split)
+{
+    dma_aux_mcu_rx_header_split = header_split;
+}
+
 /*! \fn     dma_aux_mcu_init_rx_transfer(Sercom* sercom, void* datap, uint16_t size)
 *   \brief  Initialize a DMA transfer from the AUX MCU
 *   \param  sercom      Pointer to a sercom module
@@ -755,16 +799,25 @@ void dma_aux_mcu_init_rx_transfer(Sercom* sercom, void* datap, uint16_t size)
     volatile void *usart_data_p = &sercom->USART.DATA.reg;
     cpu_irq_enter_critical();
     
-    /* Setup transfer size */
-    dma_descriptors[DMA_DESCID_RX_COMMS].BTCNT.bit.BTCNT = (uint16_t)size;
-    /* Source address: DATA register from SPI */
-    dma_descriptors[DMA_DESCID_RX_COMMS].DSTADDR.reg = (uint32_t)datap + size;
+    /* Store buffer */
+    dma_aux_mcu_rx_buffer = (uint8_t*)datap;
+    dma_aux_mcu_rx_size = size;
+    
     /* Destination address: given value */
     dma_descriptors[DMA_DESCID_RX_COMMS].SRCADDR.reg = (uint32_t)usart_data_p;
     
-    /* Resume DMA channel operation */
-    DMAC->CHID.reg= DMAC_CHID_ID(DMA_DESCID_RX_COMMS);
-    DMAC->CHCTRLA.reg = DMAC_CHCTRLA_ENABLE;
+    if (dma_aux_mcu_rx_header_split != FALSE)
+    {
+        /* Setup header transfer, the DMA interrupt arms the rest of the message once it is received */
+        dma_aux_mcu_rx_stage = DMA_AUX_MCU_RX_STAGE_HEADER;
+        dma_aux_mcu_arm_rx_descriptor((uint8_t*)datap, AUX_MCU_MSG_HEADER_LENGTH);
+    }
+    else
+    {
+        /* Setup full message transfer: legacy senders do not leave time to re-arm after the header */
+        dma_aux_mcu_rx_stage = DMA_AUX_MCU_RX_STAGE_LEGACY_BODY;
+        dma_aux_mcu_arm_rx_descriptor((uint8_t*)datap, size);
+    }
     
     /* Set boolean */
     dma_aux_mcu_rx_transfer_to_be_rearmed = FALSE;
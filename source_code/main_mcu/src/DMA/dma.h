@@ -28,6 +28,9 @@
 #include "platform_defines.h"
 #include "defines.h"
 
+/* Enums */
+typedef enum {DMA_AUX_MCU_RX_STAGE_IDLE = 0, DMA_AUX_MCU_RX_STAGE_HEADER, DMA_AUX_MCU_RX_STAGE_LEGACY_BODY, DMA_AUX_MCU_RX_STAGE_FRAMED_BODY} dma_aux_mcu_rx_stage_te;
+
 /* Prototypes */
 void dma_oled_init_transfer(Sercom* sercom, void* datap, uint16_t size, uint16_t dma_trigger);
 void dma_acc_init_transfer(Sercom* sercom, void* datap, uint16_t size, uint8_t* read_cmd);
@@ -43,7 +46,7 @@ BOOL dma_oled_check_and_clear_dma_transfer_flag(void);
 BOOL dma_acc_check_and_clear_dma_transfer_flag(void);
 BOOL dma_aux_mcu_is_rx_transfer_already_init(void);
 BOOL dma_aux_mcu_check_dma_transfer_flag(void);
-void dma_wait_for_aux_mcu_packet_sent(void);
+void dma_aux_mcu_set_rx_header_split(BOOL header_split);
 BOOL dma_acc_check_dma_transfer_flag(void);
 void dma_aux_mcu_disable_transfer(void);
 void dma_set_custom_fs_flag_done(void);
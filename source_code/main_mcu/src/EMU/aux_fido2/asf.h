@@ -0,0 +1,13 @@
+#pragma once
+#include <inttypes.h>
+#include <string.h>
+
+/* Stand-in for the aux mcu asf, only what the fido2 stack headers need. Found before the
+ * main mcu EMU/asf.h because this directory comes first in the aux fido2 include path. */
+
+typedef uint32_t RTC_MODE2_CLOCK_Type;
+
+/* the aux timers share their names with the main mcu ones they are linked with */
+#define timer_start_timer       emu_aux_timer_start_timer
+#define timer_has_timer_expired emu_aux_timer_has_timer_expired
+#define timer_get_systick       emu_aux_timer_get_systick
@@ -0,0 +1,133 @@
+#include "comms_main_mcu.h"
+#include "comms_raw_hid.h"
+#include "driver_timer.h"
+#include "ctap.h"
+#include "../emu_aux_fido2.h"
+
+#include <time.h>
+
+/* What the aux mcu fido2 stack expects from the rest of the aux firmware: main mcu comms,
+ * raw hid and timers. Built with the aux include path, runs on the emulator ctap thread. */
+
+/* the main mcu answers well within this, keep it short so that keepalives go out on time */
+#define EMU_AUX_RESPONSE_WAIT_MS    5
+
+static aux_mcu_message_t main_mcu_send_message;
+static aux_mcu_message_t comms_main_mcu_temp_message;
+static hid_packet_t ctap_send_buffer;
+static uint32_t timer_deadlines[TOTAL_NUMBER_OF_TIMERS];
+static timer_flag_te timer_flags[TOTAL_NUMBER_OF_TIMERS];
+static BOOL timer_armed[TOTAL_NUMBER_OF_TIMERS];
+
+static uint32_t emu_aux_get_ms(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+aux_mcu_message_t* comms_main_mcu_get_temp_rx_message_object_pt(void)
+{
+    return &comms_main_mcu_temp_message;
+}
+
+void comms_main_mcu_get_empty_packet_ready_to_be_sent(aux_mcu_message_t** message_pt_pt, uint16_t message_type)
+{
+    memset(&main_mcu_send_message, 0, sizeof(main_mcu_send_message));
+    main_mcu_send_message.message_type = message_type;
+    *message_pt_pt = &main_mcu_send_message;
+}
+
+void comms_main_mcu_send_message(volatile aux_mcu_message_t* message, uint16_t message_length)
+{
+    /* kept in main_mcu_send_message for a possible resend, like the dma buffer on the aux */
+    if(message != &main_mcu_send_message)
+        memcpy(&main_mcu_send_message, (void*)message, message_length);
+    emu_aux_fido2_post_request((char*)&main_mcu_send_message, message_length);
+}
+
+/* the ctap client went away while waiting: deny, or the aux loops would wait forever */
+static void emu_aux_deny_request(aux_mcu_message_t *msg)
+{
+    uint16_t request_type = main_mcu_send_message.fido2_message.message_type;
+
+    memset(msg, 0, sizeof(*msg));
+    msg->message_type = AUX_MCU_MSG_TYPE_FIDO2;
+    msg->payload_length1 = sizeof(fido2_message_t);
+    msg->fido2_message.message_type = request_type + 1;
+    if(request_type == AUX_MCU_FIDO2_MC_REQ)
+        msg->fido2_message.fido2_make_credential_rsp_message.error_code = OPERATION_DENIED;
+    else if(request_type == AUX_MCU_FIDO2_GA_REQ)
+        msg->fido2_message.fido2_get_assertion_rsp_message.error_code = OPERATION_DENIED;
+}
+
+/* only ever called by ctap.c, filtering on fido2 messages */
+ret_type_te comms_main_mcu_routine(BOOL filter_and_force_use_of_temp_receive_buffer, uint16_t expected_message_type, BOOL resend_send_msg_if_retry_of_type_received)
+{
+    aux_mcu_message_t msg;
+    int nb = emu_aux_fido2_wait_response((char*)&msg, sizeof(msg), EMU_AUX_RESPONSE_WAIT_MS);
+
+    (void)filter_and_force_use_of_temp_receive_buffer;
+
+    if(nb < 0) {
+        emu_aux_deny_request(&comms_main_mcu_temp_message);
+        return RETURN_OK;
+    }
+
+    if(nb != sizeof(msg) || msg.message_type != expected_message_type)
+        return RETURN_NOK;
+
+    /* please retry: the main mcu was busy, send the same request again */
+    if(msg.fido2_message.message_type == AUX_MCU_FIDO2_RETRY) {
+        if(resend_send_msg_if_retry_of_type_received != FALSE)
+            emu_aux_fido2_post_request((char*)&main_mcu_send_message, sizeof(main_mcu_send_message));
+        return RETURN_NOK;
+    }
+
+    memcpy(&comms_main_mcu_temp_message, &msg, sizeof(msg));
+    return RETURN_OK;
+}
+
+hid_packet_t* comms_raw_hid_get_send_buffer(hid_interface_te hid_interface)
+{
+    (void)hid_interface;
+    return &ctap_send_buffer;
+}
+
+void comms_raw_hid_send_packet(hid_interface_te hid_interface, hid_packet_t* packet, BOOL wait_send, uint16_t payload_size)
+{
+    (void)hid_interface;
+    (void)wait_send;
+    (void)payload_size;
+    emu_aux_fido2_send_report(packet->raw_packet);
+}
+
+/* the renamed aux timers, see asf.h: host milliseconds instead of the aux timebase */
+void timer_start_timer(timer_id_te uid, uint32_t val)
+{
+    timer_deadlines[uid] = emu_aux_get_ms() + val;
+    timer_flags[uid] = (val == 0)? TIMER_EXPIRED:TIMER_RUNNING;
+    timer_armed[uid] = (val == 0)? FALSE:TRUE;
+}
+
+timer_flag_te timer_has_timer_expired(timer_id_te uid, BOOL clear)
+{
+    /* expires once, like the aux timers counting down to 0 */
+    if(timer_armed[uid] != FALSE && (int32_t)(emu_aux_get_ms() - timer_deadlines[uid]) >= 0) {
+        timer_armed[uid] = FALSE;
+        timer_flags[uid] = TIMER_EXPIRED;
+    }
+
+    if(timer_flags[uid] == TIMER_EXPIRED) {
+        if(clear != FALSE)
+            timer_flags[uid] = TIMER_RUNNING;
+        return TIMER_EXPIRED;
+    }
+    return TIMER_RUNNING;
+}
+
+uint32_t timer_get_systick(void)
+{
+    return emu_aux_get_ms();
+}
@@ -1,14 +1,50 @@
 #include "dataflash.h"
 #include "emu_dataflash.h"
+#include <sys/stat.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <stdio.h>
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
+/* The bundle is mapped read-only once: reads are a memcpy instead of a syscall, and all the
+ * emulator instances share the same page cache copy. The continuous read cursor lives here. */
+static const uint8_t *bundle_data;
+static uint32_t bundle_size;
+static uint32_t bundle_cursor;
+
+static BOOL emu_dataflash_map(int fd)
+{
+    struct stat st;
+
+    if(fstat(fd, &st) != 0 || st.st_size == 0)
+        return FALSE;
+
+#ifndef WIN32
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if(data == MAP_FAILED)
+        return FALSE;
+#else
+    /* no mmap: one private copy per process */
+    uint8_t *data = malloc(st.st_size);
+    if(!data || read(fd, data, st.st_size) != st.st_size) {
+        free(data);
+        return FALSE;
+    }
+#endif
 
-static int bundle_fd = -1;
+    bundle_data = data;
+    bundle_size = st.st_size;
+    return TRUE;
+}
 
 void emu_dataflash_init(const char *path)
 {
     int i;
+    int bundle_fd;
     const char *bundle_paths[] = {
     #ifndef WIN32    
         XSTR(DESTDIR) XSTR(PREFIX) "/share/misc/miniblebundle.img",
@@ -31,8 +67,13 @@ void emu_dataflash_init(const char *path)
 #else
         bundle_fd = open(bundle_paths[i], O_RDONLY);
 #endif
-        if(bundle_fd >= 0)
-            return;
+        if(bundle_fd >= 0) {
+            /* the mapping stays valid once the file is closed */
+            BOOL mapped = emu_dataflash_map(bundle_fd);
+            close(bundle_fd);
+            if(mapped)
+                return;
+        }
     }
 
     fprintf(stderr, "Failed to open bundle file, tried:\n");
@@ -41,21 +82,35 @@ void emu_dataflash_init(const char *path)
 
 }
 
+/* past the end of the bundle reads like erased flash */
+static void emu_dataflash_copy(uint32_t address, uint8_t* data, uint32_t length)
+{
+    uint32_t available = (address < bundle_size)? bundle_size - address : 0;
+
+    if(available > length)
+        available = length;
+    if(available > 0)
+        memcpy(data, bundle_data + address, available);
+    if(available < length)
+        memset(data + available, 0xFF, length - available);
+}
+
 void dataflash_write_array_to_memory(spi_flash_descriptor_t* descriptor_pt, uint32_t address, uint8_t* data, uint32_t length){}
 void dataflash_read_data_array(spi_flash_descriptor_t* descriptor_pt, uint32_t address, uint8_t* data, uint32_t length) 
 {
-    lseek(bundle_fd, address, SEEK_SET);
-    read(bundle_fd, data, length);
+    emu_dataflash_copy(address, data, length);
+    bundle_cursor = address + length;
 }
 
 void dataflash_read_bytes_from_opened_transfer(spi_flash_descriptor_t* descriptor_pt, uint8_t* data, uint32_t length) {
-    read(bundle_fd, data, length);
+    emu_dataflash_copy(bundle_cursor, data, length);
+    bundle_cursor += length;
 }
 
 void dataflash_send_command(spi_flash_descriptor_t* descriptor_pt, uint8_t* data, uint32_t length){}
 void dataflash_send_single_byte_command(spi_flash_descriptor_t* descriptor_pt, uint8_t command){}
 void dataflash_read_data_array_start(spi_flash_descriptor_t* descriptor_pt, uint32_t address) {
-    lseek(bundle_fd, address, SEEK_SET);
+    bundle_cursor = address;
 }
 
 void dataflash_erase_64kb_block(spi_flash_descriptor_t* descriptor_pt, uint32_t address){}
@@ -1,9 +1,14 @@
 #include "dbflash.h"
 #include "emu_storage.h"
+#include "profiler.h"
 
 #include <stdlib.h>
 #include <string.h>
 
+static uint8_t page_cache[BYTES_PER_PAGE];
+static uint16_t page_cache_page_number = DBFLASH_PAGE_CACHE_NO_PAGE;
+static dbflash_page_cache_stats_t page_cache_stats;
+
 void dbflash_write_data_pattern_to_flash(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber, uint16_t offset, uint16_t dataSize, uint8_t pattern)
 {
     char *tmp = malloc(dataSize);
@@ -14,12 +19,52 @@ void dbflash_write_data_pattern_to_flash(spi_flash_descriptor_t* descriptor_pt,
 
 void dbflash_read_data_from_flash(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber, uint16_t offset, uint16_t dataSize, void *data)
 {
+    PROFILER_BEGIN(PROFILER_DBFLASH_READ);
     emu_dbflash_read(pageNumber * BYTES_PER_PAGE + offset, data, dataSize);
+    PROFILER_END(PROFILER_DBFLASH_READ);
 }
 
 void dbflash_write_data_to_flash(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber, uint16_t offset, uint16_t dataSize, void *data)
 {
     emu_dbflash_write(pageNumber * BYTES_PER_PAGE + offset, data, dataSize);
+    if(pageNumber == page_cache_page_number)
+        dbflash_invalidate_page_cache();
+}
+
+void dbflash_invalidate_page_cache(void)
+{
+    page_cache_page_number = DBFLASH_PAGE_CACHE_NO_PAGE;
+}
+
+void dbflash_read_page_to_cache(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber)
+{
+    if(pageNumber != page_cache_page_number) {
+        dbflash_read_data_from_flash(descriptor_pt, pageNumber, 0, BYTES_PER_PAGE, page_cache);
+        page_cache_page_number = pageNumber;
+    }
+}
+
+void dbflash_read_data_from_page_cache(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber, uint16_t offset, uint16_t dataSize, void *data)
+{
+    if(offset + dataSize > BYTES_PER_PAGE) {
+        dbflash_read_data_from_flash(descriptor_pt, pageNumber, offset, dataSize, data);
+        return;
+    }
+
+    if(pageNumber == page_cache_page_number) {
+        page_cache_stats.hits++;
+    } else {
+        page_cache_stats.misses++;
+        dbflash_read_page_to_cache(descriptor_pt, pageNumber);
+    }
+    memcpy(data, &page_cache[offset], dataSize);
+}
+
+void dbflash_get_page_cache_stats(dbflash_page_cache_stats_t* stats, BOOL reset_stats)
+{
+    *stats = page_cache_stats;
+    if(reset_stats)
+        memset(&page_cache_stats, 0, sizeof(page_cache_stats));
 }
 
 void dbflash_page_erase(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber)
@@ -1,5 +1,6 @@
 #include "dma.h"
 #include "emu_aux_mcu.h"
+#include "comms_aux_mcu.h"
 
 void dma_oled_init_transfer(Sercom* sercom, void* datap, uint16_t size, uint16_t dma_trigger){}
 void dma_acc_init_transfer(Sercom* sercom, void* datap, uint16_t size, uint8_t* read_cmd){}
@@ -8,6 +9,8 @@ uint32_t dma_compute_crc32_from_spi(Sercom* sercom, uint32_t size){return 0;}
 void dma_aux_mcu_init_tx_transfer(Sercom* sercom, void* datap, uint16_t size)
 {
     emu_send_aux(datap, size);
+    /* transfer done right away, like the dma interrupt */
+    comms_aux_mcu_tx_transfer_done_callback();
 }
 
 static BOOL dma_aux_mcu_packet_received = FALSE;
@@ -56,6 +59,8 @@ BOOL dma_aux_mcu_check_dma_transfer_flag(void)
     return dma_aux_mcu_packet_received;
 }
 
+void dma_aux_mcu_set_rx_header_split(BOOL header_split){}
+
 void dma_aux_mcu_disable_transfer(void){
     aux_rcvbuf = NULL;
     aux_rcv_remain = 0;
@@ -66,7 +71,6 @@ BOOL dma_custom_fs_check_and_clear_dma_transfer_flag(void){return TRUE;}
 BOOL dma_oled_check_and_clear_dma_transfer_flag(void){return TRUE;}
 BOOL dma_acc_check_and_clear_dma_transfer_flag(void){return TRUE;}
 BOOL dma_aux_mcu_is_rx_transfer_already_init(void){return FALSE;}
-void dma_wait_for_aux_mcu_packet_sent(void){}
 void dma_set_custom_fs_flag_done(void){}
 void dma_acc_disable_transfer(void){}
 void dma_reset(void){}
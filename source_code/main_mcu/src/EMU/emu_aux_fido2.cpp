@@ -0,0 +1,157 @@
+#include "emu_aux_fido2.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QByteArray>
+#include <QSemaphore>
+#include <QMutex>
+#include <QThread>
+
+#include <atomic>
+#include <cstring>
+
+/* aux_mcu/src/fido2/ctaphid.h, its includes need the aux include path */
+extern "C" void ctaphid_init(void);
+extern "C" void ctap_init(void);
+extern "C" uint8_t ctaphid_handle_packet(uint32_t *pkt_raw);
+
+#define CTAPHID_REPORT_SIZE     64
+
+/* a single request in flight: the aux waits for its answer before sending the next one */
+static QMutex request_mutex;
+static QByteArray request;
+static QMutex response_mutex;
+static QByteArray response;
+static QSemaphore response_ready;
+
+static std::atomic<bool> bridge_running{false};
+static QLocalSocket *ctap_client;
+
+class CtapHidThread: public QThread {
+public:
+    QString socket_name;
+    QSemaphore listening;
+
+    void run() {
+        QLocalServer server;
+
+        ctaphid_init();
+        ctap_init();
+
+        /* one authenticator, one client at a time */
+        QObject::connect(&server, &QLocalServer::newConnection, [&server] () {
+            QLocalSocket *client = server.nextPendingConnection();
+            if(ctap_client) {
+                client->abort();
+                client->deleteLater();
+                return;
+            }
+
+            ctap_client = client;
+            QObject::connect(client, &QLocalSocket::readyRead, [client] () {
+                uint32_t report[CTAPHID_REPORT_SIZE / 4];
+
+                /* blocks for as long as the main mcu takes to answer, keepalives included */
+                while(client->bytesAvailable() >= CTAPHID_REPORT_SIZE) {
+                    client->read((char*)report, CTAPHID_REPORT_SIZE);
+                    ctaphid_handle_packet(report);
+                }
+            });
+            QObject::connect(client, &QLocalSocket::disconnected, [client] () {
+                if(ctap_client == client)
+                    ctap_client = nullptr;
+                client->deleteLater();
+            });
+        });
+
+        QLocalServer::removeServer(socket_name);
+        server.listen(socket_name);
+        listening.release();
+        exec();
+
+        delete ctap_client;
+        ctap_client = nullptr;
+    }
+};
+
+static CtapHidThread ctap_thread;
+
+void emu_aux_fido2_start(const QString & socket_name)
+{
+    bridge_running.store(true);
+    ctap_thread.socket_name = socket_name;
+    ctap_thread.start();
+    ctap_thread.listening.acquire();
+}
+
+void emu_aux_fido2_stop(void)
+{
+    if(!ctap_thread.isRunning())
+        return;
+
+    /* a pending request is denied, see emu_aux_fido2_drivers.c */
+    bridge_running.store(false);
+    response_ready.release();
+    ctap_thread.quit();
+    ctap_thread.wait();
+}
+
+/* firmware thread: the aux has a fido2 message for us */
+int emu_aux_fido2_rcv_request(char *data, int size)
+{
+    QMutexLocker locker(&request_mutex);
+    int nb = request.size();
+
+    if(nb == 0 || nb > size)
+        return 0;
+
+    memcpy(data, request.constData(), nb);
+    request.clear();
+    return nb;
+}
+
+/* firmware thread: answer to the aux */
+void emu_aux_fido2_send_response(char *data, int size)
+{
+    if(!bridge_running.load())
+        return;
+
+    response_mutex.lock();
+    response = QByteArray(data, size);
+    response_mutex.unlock();
+    response_ready.release();
+}
+
+/* ctap thread */
+void emu_aux_fido2_post_request(const char *data, int size)
+{
+    QMutexLocker locker(&request_mutex);
+    request = QByteArray(data, size);
+}
+
+int emu_aux_fido2_wait_response(char *data, int size, int timeout_ms)
+{
+    if(!bridge_running.load())
+        return -1;
+    if(!response_ready.tryAcquire(1, timeout_ms))
+        return 0;
+
+    QMutexLocker locker(&response_mutex);
+    int nb = response.size();
+
+    if(nb == 0 || nb > size)
+        return 0;
+
+    memcpy(data, response.constData(), nb);
+    response.clear();
+    return nb;
+}
+
+void emu_aux_fido2_send_report(const uint8_t *report)
+{
+    if(!ctap_client || ctap_client->state() != QLocalSocket::ConnectedState)
+        return;
+
+    ctap_client->write((const char*)report, CTAPHID_REPORT_SIZE);
+    ctap_client->flush();
+}
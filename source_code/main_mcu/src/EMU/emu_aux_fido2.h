@@ -0,0 +1,32 @@
+#ifndef EMU_AUX_FIDO2_H
+#define EMU_AUX_FIDO2_H
+
+#include <stdint.h>
+
+/* The aux mcu fido2 stack (aux_mcu/src/fido2) runs on its own thread behind a local socket
+ * speaking CTAPHID, 64 byte reports both ways. Its fido2 messages to the main mcu go through
+ * the bridge below, raw aux_mcu_message_t bytes as they would on the serial link. */
+
+#ifdef __cplusplus
+#include <QString>
+
+void emu_aux_fido2_start(const QString & socket_name);
+void emu_aux_fido2_stop(void);
+
+extern "C" {
+#endif
+
+/* firmware thread, from emu_aux_mcu.c */
+int emu_aux_fido2_rcv_request(char *data, int size);
+void emu_aux_fido2_send_response(char *data, int size);
+
+/* ctap thread, from the aux mcu driver stand-ins */
+void emu_aux_fido2_post_request(const char *data, int size);
+int emu_aux_fido2_wait_response(char *data, int size, int timeout_ms);
+void emu_aux_fido2_send_report(const uint8_t *report);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
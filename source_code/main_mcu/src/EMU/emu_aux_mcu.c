@@ -1,5 +1,8 @@
 #include "emu_aux_mcu.h"
 #include "comms_aux_mcu.h"
+#include "emu_aux_fido2.h"
+#include "emu_hid_trace.h"
+#include "emu_storage.h"
 #include "emulator.h"
 
 #include <assert.h>
@@ -9,7 +12,14 @@
 static BOOL typing_return;
 static BOOL response_valid;
 static aux_mcu_message_t response;
+static aux_mcu_message_t replay_request;
 static BOOL has_been_already_paired_to_device = FALSE;
+static emu_hid_sink_t hid_sink;
+/* requests come as a header, then payload & crc (framed) or the rest of the message (legacy) */
+static aux_mcu_message_t split_request;
+static BOOL split_header_received;
+/* like the aux mcu, only expect framed requests once the main mcu explicitly negotiated framing */
+static BOOL framing_negotiated;
 
 static void send_hid_message(aux_mcu_message_t *msg);
 static BOOL process_main_cmd(aux_mcu_message_t *msg, aux_mcu_message_t *response);
@@ -21,6 +31,31 @@ static lb_state_machine_te emu_charger_status;
 void emu_send_aux(char *data, int size)
 {
     aux_mcu_message_t *msg = (aux_mcu_message_t*)data;
+
+    if(!split_header_received && size == AUX_MCU_MSG_HEADER_LENGTH) {
+        memcpy(&split_request, data, size);
+        split_header_received = TRUE;
+        return;
+    }
+    if(split_header_received) {
+        memcpy(split_request.payload, data, size);
+        split_header_received = FALSE;
+        msg = &split_request;
+        if(!AUX_MCU_MSG_IS_FRAMED(split_request.message_type)) {
+            assert(size == sizeof(split_request) - AUX_MCU_MSG_HEADER_LENGTH);
+        } else {
+            if(!framing_negotiated) {
+                fprintf(stderr, "Framed message from the main mcu before framing was negotiated\n");
+                return;
+            }
+            assert(size == split_request.payload_length1 + AUX_MCU_MSG_CRC_LENGTH);
+            if(comms_aux_mcu_unframe_message(msg) == FALSE) {
+                fprintf(stderr, "Invalid framed message from the main mcu\n");
+                return;
+            }
+        }
+        size = sizeof(split_request);
+    }
     assert(size == sizeof(aux_mcu_message_t));
     assert(response_valid == FALSE);
 
@@ -57,6 +92,12 @@ void emu_send_aux(char *data, int size)
             response.aux_details_message.atbtlc_rf_ver = 66;
             response.aux_details_message.atbtlc_chip_id = 55;
             memcpy(response.aux_details_message.atbtlc_address, "\x11\x22\x33\x44\x55\x66", 6);
+            /* framing is only negotiated on explicit request, plain requests keep the current state */
+            /* answers stay legacy: the main mcu takes both */
+            if(msg->aux_details_message.framing_magic == AUX_MCU_MSG_FRAMING_MAGIC) {
+                response.aux_details_message.framing_magic = AUX_MCU_MSG_FRAMING_MAGIC;
+                framing_negotiated = TRUE;
+            }
             response_valid = TRUE;
             break;
 
@@ -80,6 +121,11 @@ void emu_send_aux(char *data, int size)
             response_valid = TRUE;
             break;
 
+        case AUX_MCU_MSG_TYPE_FIDO2:
+            /* answers and please retry for the aux fido2 stack, see emu_aux_fido2.cpp */
+            emu_aux_fido2_send_response((char*)msg, size);
+            break;
+
         case AUX_MCU_MSG_TYPE_PING_WITH_INFO:
             memset(&response, 0, sizeof(response));
             response.message_type = AUX_MCU_MSG_TYPE_AUX_MCU_EVENT;
@@ -258,9 +304,29 @@ int emu_rcv_aux(char *data, int size)
         }
     }
 
+    /* requests from the ctaphid client, already through ctaphid.c & ctap.c */
+    if(emu_aux_fido2_rcv_request(data, size) == size)
+        return size;
+
+    /* replayed host session instead of moolticute */
+    int replay_length = emu_hid_trace_replay_next(replay_request.payload, sizeof(replay_request.payload));
+    if(replay_length > 0) {
+        replay_request.message_type = AUX_MCU_MSG_TYPE_USB;
+        replay_request.payload_length1 = replay_length;
+        emu_hid_trace_request(replay_request.payload, replay_length);
+        memcpy(data, &replay_request, sizeof(replay_request));
+        return sizeof(replay_request);
+    }
+
     return emu_rcv_aux_hid((aux_mcu_message_t*)data);
 }
 
+/* in-process consumer of the device hid messages instead of moolticute, used by benchmarks */
+void emu_aux_set_hid_sink(emu_hid_sink_t sink)
+{
+    hid_sink = sink;
+}
+
 /*! \fn     send_hid_message(aux_mcu_message_t *msg)
 *   \brief  Send simulated "hid" messages to moolticute
 *   \param  msg   The message to be sent
@@ -273,10 +339,22 @@ static void send_hid_message(aux_mcu_message_t *msg)
     int payload_length = msg->payload_length1;
 
     int n_hid_packets = (payload_length+61) / 62;
+    char hidPackets[(AUX_MCU_MSG_PAYLOAD_LENGTH+61) / 62 * 64];
+    int hidPacketsLength = 0;
     int p;
 
+    /* answering the host: whatever the command wrote should now be on disk */
+    emu_storage_command_done();
+    emu_hid_trace_response(payload, payload_length);
+
+    if(hid_sink) {
+        hid_sink(payload, payload_length);
+        return;
+    }
+
+    /* packets are concatenated and handed over in one go, the transport batches the socket writes */
     for(p=0;p < n_hid_packets;p++) {
-        char hidPacket[64];
+        char *hidPacket = hidPackets + hidPacketsLength;
         int bytesRemain = payload_length - p * 62;
         if(bytesRemain > 62)
             bytesRemain = 62;
@@ -284,9 +362,10 @@ static void send_hid_message(aux_mcu_message_t *msg)
         hidPacket[0] = bytesRemain;
         hidPacket[1] = (p<<4) | (n_hid_packets-1);
         memcpy(hidPacket+2, payload + p * 62, bytesRemain);
-
-        emu_send_hid(hidPacket, bytesRemain+2);
+        hidPacketsLength += bytesRemain+2;
     }
+
+    emu_send_hid(hidPackets, hidPacketsLength);
 }
 
 
@@ -423,6 +502,7 @@ static int emu_rcv_aux_hid(aux_mcu_message_t *msg)
     }
 
     if(hid_response_valid) {
+        emu_hid_trace_request(hid_response.payload, hid_response.payload_length1);
         memcpy(msg, &hid_response, sizeof(hid_response));
         hid_response_valid = FALSE;
         return sizeof(hid_response);
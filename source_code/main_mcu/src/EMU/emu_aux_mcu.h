@@ -1,7 +1,12 @@
 #ifndef EMU_AUX_MCU_H
 #define EMU_AUX_MCU_H
 
+#include <stdint.h>
+
+typedef void (*emu_hid_sink_t)(uint8_t *payload, int payload_length);
+
 void emu_send_aux(char *data, int size);
 int emu_rcv_aux(char *data, int size);
+void emu_aux_set_hid_sink(emu_hid_sink_t sink);
 
 #endif
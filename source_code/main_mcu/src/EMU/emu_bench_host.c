@@ -0,0 +1,140 @@
+#include "asf.h"
+#include "driver_timer.h"
+#include "emulator.h"
+#include "emu_aux_fido2.h"
+#include "emu_smartcard.h"
+
+#include <stdlib.h>
+#include <time.h>
+
+/* Host side of the native benchmark build: what emulator.cpp, emu_oled.cpp and emu_smartcard.cpp
+ * provide otherwise. No ui, no hid, no card, and waits don't cost any host time. */
+
+static struct emu_port_t _PORT;
+struct emu_port_t *PORT=&_PORT;
+
+void cpu_irq_enter_critical(void) {}
+void cpu_irq_leave_critical(void) {}
+
+/* monotonic wall clock, only used for timestamps */
+uint64_t emu_get_elapsed_us(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+BOOL emu_get_systick(uint32_t *value)
+{
+    static uint64_t last_systick;
+
+    // microseconds to 48MHz ticks
+    uint64_t systick = emu_get_elapsed_us() * 48;
+    BOOL wrapped = ((systick & 0xffffff) != (last_systick & 0xffffff))? TRUE:FALSE;
+
+    *value = systick & 0xffffff;
+    last_systick = systick;
+    return wrapped;
+}
+
+/* the firmware busy waits for peripherals that answer instantly here */
+void emu_delay_us(uint32_t us)
+{
+    (void)us;
+}
+
+/* nothing else runs: hand out timer ticks as they are waited for */
+void emu_idle_wait(void)
+{
+    timer_ms_tick();
+}
+
+void emu_appexit_test(void)
+{
+}
+
+void emu_send_hid(char *data, int size)
+{
+    (void)data;
+    (void)size;
+}
+
+int emu_rcv_hid(char *data, int size)
+{
+    (void)data;
+    (void)size;
+    return 0;
+}
+
+int emu_get_battery_level(void)
+{
+    return 100;
+}
+
+BOOL emu_get_usb_charging(void)
+{
+    return TRUE;
+}
+
+void emu_charger_enable(BOOL en)
+{
+    (void)en;
+}
+
+BOOL emu_get_lefthanded(void)
+{
+    return FALSE;
+}
+
+int emu_get_failure_flags(void)
+{
+    return 0;
+}
+
+/* no display and no wheel */
+void emu_oled_byte(uint8_t data);
+void emu_oled_flush(void);
+void inputs_scan(void);
+
+void emu_oled_byte(uint8_t data)
+{
+    (void)data;
+}
+
+void emu_oled_flush(void)
+{
+}
+
+void inputs_scan(void)
+{
+}
+
+/* no card inserted */
+struct emu_smartcard_t *emu_open_smartcard(void)
+{
+    return NULL;
+}
+
+void emu_close_smartcard(BOOL written)
+{
+    (void)written;
+}
+
+void emu_reset_smartcard(void)
+{
+}
+
+/* no ctaphid client */
+int emu_aux_fido2_rcv_request(char *data, int size)
+{
+    (void)data;
+    (void)size;
+    return 0;
+}
+
+void emu_aux_fido2_send_response(char *data, int size)
+{
+    (void)data;
+    (void)size;
+}
@@ -0,0 +1,415 @@
+#include "emu_benchmark.h"
+#include "emu_aux_mcu.h"
+#include "emu_storage.h"
+#include "emulator.h"
+#include "dbflash.h"
+#include "comms_hid_msgs.h"
+#include "comms_aux_mcu.h"
+#include "logic_database.h"
+#include "logic_security.h"
+#include "nodemgmt.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_DB_FILE       "dbflash_bench.bin"
+#define BENCH_NB_LOOKUPS    200
+#define BENCH_INSERT_STEP   256
+#define BENCH_INSERT_ROWS   (NODEMGMT_NB_NODE_SLOTS / BENCH_INSERT_STEP - 1)
+#define BENCH_SYNC_SERVICES 512
+#define BENCH_SYNC_NODES    (2 * BENCH_SYNC_SERVICES)
+/* full speed hid interrupt endpoints move one 64B packet per ms */
+#define BENCH_HID_PACKET_US 1000
+
+static const uint16_t bench_db_sizes[] = {16, 64, 128, 256, 512, 1024, 2048};
+
+/* names are spread over the alphabet and not created in alphabetical order */
+void emu_benchmark_service_name(cust_char_t *service, uint16_t id)
+{
+    char ascii[16];
+
+    snprintf(ascii, sizeof(ascii), "%c%c%05u.com", 'a' + (id * 7) % 26, 'a' + (id / 26 * 11) % 26, id);
+    memset(service, 0, SERVICE_NAME_MAX_LEN * sizeof(cust_char_t));
+    for(int i = 0; ascii[i] != 0; i++)
+        service[i] = (cust_char_t)ascii[i];
+}
+
+/* formats user 0 profile on the current dbflash image and logs it in */
+void emu_benchmark_blank_profile(void)
+{
+    uint16_t sec_flags, language, layout, ble_layout;
+
+    emu_dbflash_open();
+    dbflash_invalidate_page_cache();
+    nodemgmt_format_user_profile(0, 0, 0, 0, 0);
+    nodemgmt_init_context(0, &sec_flags, &language, &layout, &ble_layout);
+}
+
+/* stores services #from to #nb_services - 1, their addresses go to addresses[id] if not NULL */
+BOOL emu_benchmark_populate_services(uint16_t from, uint16_t nb_services, uint16_t *addresses)
+{
+    cust_char_t service[SERVICE_NAME_MAX_LEN];
+
+    for(uint16_t i = from; i < nb_services; i++) {
+        emu_benchmark_service_name(service, i);
+        uint16_t address = logic_database_add_service(service, SERVICE_CRED_TYPE, NODEMGMT_STANDARD_CRED_TYPE_ID);
+        if(address == NODE_ADDR_NULL) {
+            fprintf(stderr, "Couldn't store service #%u\n", i);
+            return FALSE;
+        }
+        if(addresses != NULL)
+            addresses[i] = address;
+    }
+    return TRUE;
+}
+
+/* average time and dbflash reads for a lookup of an existing service */
+static BOOL bench_lookups(uint16_t nb_services, uint32_t *us_per_lookup, uint32_t *reads_per_lookup)
+{
+    cust_char_t service[SERVICE_NAME_MAX_LEN];
+
+    /* warm up: rebuilds the service index if it was dropped */
+    emu_benchmark_service_name(service, 0);
+    logic_database_search_service(service, COMPARE_MODE_MATCH, TRUE, NODEMGMT_STANDARD_CRED_TYPE_ID);
+
+    uint32_t start_reads = emu_dbflash_get_read_count();
+    uint64_t start_us = emu_get_elapsed_us();
+    for(uint16_t i = 0; i < BENCH_NB_LOOKUPS; i++) {
+        emu_benchmark_service_name(service, (uint16_t)((i * 37u) % nb_services));
+        if(logic_database_search_service(service, COMPARE_MODE_MATCH, TRUE, NODEMGMT_STANDARD_CRED_TYPE_ID) == NODE_ADDR_NULL)
+            return FALSE;
+    }
+
+    *us_per_lookup = (uint32_t)((emu_get_elapsed_us() - start_us) / BENCH_NB_LOOKUPS);
+    *reads_per_lookup = (emu_dbflash_get_read_count() - start_reads) / BENCH_NB_LOOKUPS;
+    return TRUE;
+}
+
+int emu_benchmark_db_search(void)
+{
+    uint32_t walk_us, walk_reads, index_us, index_reads;
+    uint16_t nb_services = 0;
+
+    /* scratch database, the emulated device one is left untouched */
+    remove(BENCH_DB_FILE);
+    emu_dbflash_set_filename(BENCH_DB_FILE);
+    emu_benchmark_blank_profile();
+
+    printf("services;walk_us;walk_reads;index_us;index_reads;index_used\n");
+    for(size_t i = 0; i < ARRAY_SIZE(bench_db_sizes); i++) {
+        if(!emu_benchmark_populate_services(nb_services, bench_db_sizes[i], NULL))
+            return 1;
+        nb_services = bench_db_sizes[i];
+
+        nodemgmt_service_index_invalidate();
+        if(!bench_lookups(nb_services, &index_us, &index_reads))
+            goto lookup_failed;
+        BOOL index_used = (nodemgmt_service_index_build() == RETURN_OK);
+
+        nodemgmt_service_index_disable();
+        if(!bench_lookups(nb_services, &walk_us, &walk_reads))
+            goto lookup_failed;
+        nodemgmt_service_index_invalidate();
+
+        printf("%u;%u;%u;%u;%u;%s\n", nb_services, walk_us, walk_reads, index_us, index_reads, index_used ? "yes" : "no");
+        fflush(stdout);
+    }
+
+    return 0;
+
+lookup_failed:
+    fprintf(stderr, "Service lookup failed with %u services\n", nb_services);
+    return 1;
+}
+
+/* fills a fresh database, recording time and dbflash reads per insert for each step */
+static BOOL bench_inserts(BOOL use_skip_index, uint32_t *us_per_insert, uint32_t *reads_per_insert)
+{
+    remove(BENCH_DB_FILE);
+    emu_benchmark_blank_profile();
+    if(!use_skip_index)
+        nodemgmt_skip_index_disable();
+
+    for(uint16_t row = 0; row < BENCH_INSERT_ROWS; row++) {
+        uint32_t start_reads = emu_dbflash_get_read_count();
+        uint64_t start_us = emu_get_elapsed_us();
+        if(!emu_benchmark_populate_services(row * BENCH_INSERT_STEP, (row + 1) * BENCH_INSERT_STEP, NULL))
+            return FALSE;
+        us_per_insert[row] = (uint32_t)((emu_get_elapsed_us() - start_us) / BENCH_INSERT_STEP);
+        reads_per_insert[row] = (emu_dbflash_get_read_count() - start_reads) / BENCH_INSERT_STEP;
+    }
+    return TRUE;
+}
+
+int emu_benchmark_db_insert(void)
+{
+    uint32_t walk_us[BENCH_INSERT_ROWS], walk_reads[BENCH_INSERT_ROWS];
+    uint32_t skip_us[BENCH_INSERT_ROWS], skip_reads[BENCH_INSERT_ROWS];
+
+    /* scratch database, the emulated device one is left untouched */
+    emu_dbflash_set_filename(BENCH_DB_FILE);
+    if(!bench_inserts(FALSE, walk_us, walk_reads) || !bench_inserts(TRUE, skip_us, skip_reads))
+        return 1;
+
+    /* last row leaves a few free slots */
+    printf("services;walk_us;walk_reads;skip_us;skip_reads\n");
+    for(uint16_t row = 0; row < BENCH_INSERT_ROWS; row++)
+        printf("%u;%u;%u;%u;%u\n", (row + 1) * BENCH_INSERT_STEP, walk_us[row], walk_reads[row], skip_us[row], skip_reads[row]);
+    return 0;
+}
+
+/* host side of the node sync benchmark: the device answers end up here instead of moolticute */
+static struct {
+    uint32_t messages;
+    uint32_t hid_packets;
+    uint32_t stream_nodes;
+    uint32_t stream_checksum;
+    BOOL stream_error;
+    hid_message_t answer;
+} sync_host;
+
+static uint16_t sync_addresses[BENCH_SYNC_NODES];
+static child_node_t *sync_blocks;
+
+static uint16_t sync_node_length(uint16_t node_id)
+{
+    /* parents first, then children */
+    return node_id < BENCH_SYNC_SERVICES ? sizeof(parent_node_t) : sizeof(child_node_t);
+}
+
+static int sync_node_id(uint16_t address)
+{
+    for(int i = 0; i < BENCH_SYNC_NODES; i++)
+        if(sync_addresses[i] == address)
+            return i;
+    return -1;
+}
+
+/* drains export stream messages as they come, checking blocks and running checksum */
+static void sync_drain_stream(hid_message_t *answer)
+{
+    hid_message_export_stream_t *stream = (hid_message_export_stream_t*)answer->payload;
+    hid_message_node_block_t *node_block = (hid_message_node_block_t*)stream->node_blocks;
+
+    if(answer->payload_length < sizeof(*stream)) {
+        sync_host.stream_error = TRUE;
+        return;
+    }
+    for(uint16_t i = 0; i < stream->nb_nodes; i++) {
+        int id = sync_node_id(node_block->node_address);
+        if(id < 0 || node_block->node_length != sync_node_length(id) || memcmp(node_block->node_block, &sync_blocks[id], node_block->node_length) != 0)
+            sync_host.stream_error = TRUE;
+
+        /* fletcher-32 over the 16 bits words of the block */
+        uint32_t sum1 = sync_host.stream_checksum & 0xFFFF, sum2 = sync_host.stream_checksum >> 16;
+        for(uint16_t j = 0; j < (sizeof(*node_block) + node_block->node_length) / 2; j++) {
+            sum1 = (sum1 + ((uint16_t*)node_block)[j]) % 0xFFFF;
+            sum2 = (sum2 + sum1) % 0xFFFF;
+        }
+        sync_host.stream_checksum = (sum2 << 16) | sum1;
+        sync_host.stream_nodes++;
+        node_block = (hid_message_node_block_t*)((uint8_t*)node_block + sizeof(*node_block) + node_block->node_length);
+    }
+}
+
+static void sync_sink(uint8_t *payload, int payload_length)
+{
+    sync_host.hid_packets += (payload_length + 61) / 62;
+    memcpy(&sync_host.answer, payload, payload_length);
+    if(sync_host.answer.message_type == HID_CMD_EXPORT_STREAM && sync_host.answer.payload_length != 1)
+        sync_drain_stream(&sync_host.answer);
+}
+
+/* returns FALSE if the device nacked */
+static BOOL sync_send(hid_message_t *msg)
+{
+    sync_host.messages++;
+    sync_host.hid_packets += (msg->payload_length + 4 + 61) / 62;
+    comms_hid_msgs_parse(msg, msg->payload_length, MSG_NO_RESTRICT, TRUE);
+    return (sync_host.answer.message_type == msg->message_type) && (sync_host.answer.payload_length != 1 || sync_host.answer.payload[0] == HID_1BYTE_ACK);
+}
+
+static BOOL sync_read_nodes(BOOL vectored)
+{
+    hid_message_t msg;
+    uint16_t i = 0;
+
+    while(i < BENCH_SYNC_NODES) {
+        memset(&msg, 0, sizeof(msg));
+        if(vectored) {
+            /* only ask for what fits in one answer */
+            uint16_t nb = 0, answer_length = sizeof(uint16_t);
+            while(i + nb < BENCH_SYNC_NODES && answer_length + sizeof(hid_message_node_block_t) + sync_node_length(i + nb) <= sizeof(msg.payload))
+                answer_length += sizeof(hid_message_node_block_t) + sync_node_length(i + nb++);
+            msg.message_type = HID_CMD_READ_NODES;
+            msg.payload_length = nb * sizeof(uint16_t);
+            memcpy(msg.payload_as_uint16, &sync_addresses[i], msg.payload_length);
+            if(!sync_send(&msg) || sync_host.answer.payload_as_uint16[0] == 0)
+                return FALSE;
+
+            /* blocks should match the ones read one by one */
+            hid_message_node_block_t *node_block = (hid_message_node_block_t*)&sync_host.answer.payload_as_uint16[1];
+            for(uint16_t j = 0; j < sync_host.answer.payload_as_uint16[0]; j++, i++) {
+                if(node_block->node_address != sync_addresses[i] || memcmp(node_block->node_block, &sync_blocks[i], node_block->node_length) != 0)
+                    return FALSE;
+                node_block = (hid_message_node_block_t*)((uint8_t*)node_block + sizeof(*node_block) + node_block->node_length);
+            }
+        } else {
+            msg.message_type = HID_CMD_READ_NODE;
+            msg.payload_length = sizeof(uint16_t);
+            msg.payload_as_uint16[0] = sync_addresses[i];
+            if(!sync_send(&msg) || sync_host.answer.payload_length != sync_node_length(i))
+                return FALSE;
+            memcpy(&sync_blocks[i], sync_host.answer.payload, sync_host.answer.payload_length);
+            i++;
+        }
+    }
+    return TRUE;
+}
+
+/* host only knows the slots used by the database, empty ones are skipped by the device */
+static BOOL sync_read_node_range(BOOL vectored)
+{
+    hid_message_node_range_t range = {0xFFFF, 0};
+    hid_message_t msg;
+    uint16_t nb_nodes = 0;
+
+    for(int i = 0; i < BENCH_SYNC_NODES; i++) {
+        if(sync_addresses[i] < range.start_address)
+            range.start_address = sync_addresses[i];
+        if(sync_addresses[i] > range.nb_slots)
+            range.nb_slots = sync_addresses[i];
+    }
+    /* last node may be a child, taking two slots */
+    range.nb_slots = (range.nb_slots - range.start_address) / nodemgmt_get_incremented_address(0) + 2;
+
+    while(range.nb_slots != 0) {
+        memset(&msg, 0, sizeof(msg));
+        msg.message_type = HID_CMD_READ_NODE_RANGE;
+        msg.payload_length = sizeof(range);
+        memcpy(msg.payload, &range, sizeof(range));
+        if(!sync_send(&msg))
+            return FALSE;
+
+        /* blocks should match the ones read one by one */
+        hid_message_node_range_answer_t *answer = (hid_message_node_range_answer_t*)sync_host.answer.payload;
+        hid_message_node_block_t *node_block = (hid_message_node_block_t*)answer->node_blocks;
+        for(uint16_t j = 0; j < answer->nb_nodes; j++, nb_nodes++) {
+            int id = sync_node_id(node_block->node_address);
+            if(id < 0 || node_block->node_length != sync_node_length(id) || memcmp(node_block->node_block, &sync_blocks[id], node_block->node_length) != 0)
+                return FALSE;
+            node_block = (hid_message_node_block_t*)((uint8_t*)node_block + sizeof(*node_block) + node_block->node_length);
+        }
+        memcpy(&range, &answer->remaining, sizeof(range));
+    }
+    return nb_nodes == BENCH_SYNC_NODES;
+}
+
+static BOOL sync_write_nodes(BOOL vectored)
+{
+    hid_message_t msg;
+    uint16_t i = 0;
+
+    while(i < BENCH_SYNC_NODES) {
+        memset(&msg, 0, sizeof(msg));
+        if(vectored) {
+            msg.message_type = HID_CMD_WRITE_NODES;
+            while(i < BENCH_SYNC_NODES && msg.payload_length + sizeof(hid_message_node_block_t) + sync_node_length(i) <= sizeof(msg.payload)) {
+                hid_message_node_block_t *node_block = (hid_message_node_block_t*)&msg.payload[msg.payload_length];
+                node_block->node_address = sync_addresses[i];
+                node_block->node_length = sync_node_length(i);
+                memcpy(node_block->node_block, &sync_blocks[i], node_block->node_length);
+                msg.payload_length += sizeof(hid_message_node_block_t) + node_block->node_length;
+                i++;
+            }
+        } else {
+            msg.message_type = HID_CMD_WRITE_NODE;
+            msg.payload_length = sizeof(uint16_t) + sync_node_length(i);
+            msg.payload_as_uint16[0] = sync_addresses[i];
+            memcpy(&msg.payload_as_uint16[1], &sync_blocks[i], sync_node_length(i));
+            i++;
+        }
+        if(!sync_send(&msg))
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* single request, the device pushes the whole database */
+static BOOL sync_export_stream(BOOL vectored)
+{
+    hid_message_t msg;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.message_type = HID_CMD_EXPORT_STREAM;
+    if(!sync_send(&msg) || sync_host.stream_error || sync_host.stream_nodes != BENCH_SYNC_NODES)
+        return FALSE;
+
+    /* last message is empty and carries the final checksum */
+    hid_message_export_stream_t *stream = (hid_message_export_stream_t*)sync_host.answer.payload;
+    return stream->nb_nodes == 0 && stream->cursor.checksum == sync_host.stream_checksum;
+}
+
+static BOOL sync_run(const char *op, const char *mode, BOOL (*sync_fn)(BOOL))
+{
+    BOOL vectored = strcmp(mode, "single") != 0;
+
+    memset(&sync_host, 0, sizeof(sync_host));
+    uint64_t start_us = emu_get_elapsed_us();
+    if(!sync_fn(vectored)) {
+        fprintf(stderr, "Node %s failed (%s)\n", op, mode);
+        return FALSE;
+    }
+    uint64_t device_us = emu_get_elapsed_us() - start_us;
+    uint64_t total_us = device_us + (uint64_t)sync_host.hid_packets * BENCH_HID_PACKET_US;
+    uint64_t nodes_per_s = (uint64_t)BENCH_SYNC_NODES * 1000000 / total_us;
+
+    printf("%s;%s;%u;%u;%u;%u;%u\n", op, mode, BENCH_SYNC_NODES, sync_host.messages, sync_host.hid_packets,
+           (uint32_t)device_us, (uint32_t)nodes_per_s);
+    return TRUE;
+}
+
+int emu_benchmark_node_sync(void)
+{
+    child_cred_node_t child;
+    int ret = 1;
+
+    /* scratch database, the emulated device one is left untouched */
+    remove(BENCH_DB_FILE);
+    emu_dbflash_set_filename(BENCH_DB_FILE);
+    emu_benchmark_blank_profile();
+    if(!emu_benchmark_populate_services(0, BENCH_SYNC_SERVICES, sync_addresses))
+        return 1;
+
+    /* one login per service */
+    for(uint16_t i = 0; i < BENCH_SYNC_SERVICES; i++) {
+        memset(&child, 0, sizeof(child));
+        emu_benchmark_service_name(child.login, i);
+        if(nodemgmt_create_child_node(sync_addresses[i], &child, &sync_addresses[BENCH_SYNC_SERVICES + i]) != RETURN_OK) {
+            fprintf(stderr, "Couldn't store login #%u\n", i);
+            return 1;
+        }
+    }
+
+    /* host tools talk to the device in management mode */
+    sync_blocks = malloc(BENCH_SYNC_NODES * sizeof(*sync_blocks));
+    logic_security_set_management_mode(TRUE);
+    emu_aux_set_hid_sink(sync_sink);
+
+    /* the export stream waits for aux answers between its messages */
+    comms_aux_arm_rx_and_clear_no_comms();
+
+    /* nodes_per_s accounts for one hid packet per ms on top of the device time */
+    printf("op;mode;nodes;messages;hid_packets;device_us;nodes_per_s\n");
+    if(sync_run("read", "single", sync_read_nodes) && sync_run("read", "vectored", sync_read_nodes) &&
+       sync_run("read", "range", sync_read_node_range) &&
+       sync_run("export", "stream", sync_export_stream) &&
+       sync_run("write", "single", sync_write_nodes) && sync_run("write", "vectored", sync_write_nodes))
+        ret = 0;
+
+    emu_aux_set_hid_sink(NULL);
+    logic_security_clear_management_mode();
+    free(sync_blocks);
+    return ret;
+}
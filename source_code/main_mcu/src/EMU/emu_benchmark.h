@@ -0,0 +1,23 @@
+#ifndef EMU_BENCHMARK_H
+#define EMU_BENCHMARK_H
+#include "defines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int emu_benchmark_db_search(void);
+int emu_benchmark_db_insert(void);
+int emu_benchmark_node_sync(void);
+int emu_benchmark_hid_transport(void);
+
+/* database fixture shared with the native microbenchmarks */
+void emu_benchmark_service_name(cust_char_t *service, uint16_t id);
+void emu_benchmark_blank_profile(void);
+BOOL emu_benchmark_populate_services(uint16_t from, uint16_t nb_services, uint16_t *addresses);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,132 @@
+#include "emu_benchmark.h"
+#include "emu_hid_transport.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QSemaphore>
+#include <QThread>
+
+#include <algorithm>
+#include <vector>
+#include <stdio.h>
+
+/* Round trips through the hid transport against an in-process moolticute stand-in that
+ * echoes everything back. The calling thread plays the firmware side. */
+
+#define BENCH_HID_PACKET_SIZE       64
+#define BENCH_HID_MESSAGES          5000
+#define BENCH_HID_CONNECT_TIMEOUT   1000
+
+class EchoServerThread: public QThread {
+public:
+    QString socket_name;
+    QSemaphore listening;
+
+    void run() {
+        QLocalServer server;
+
+        QObject::connect(&server, &QLocalServer::newConnection, [&server] () {
+            QLocalSocket *client = server.nextPendingConnection();
+            QObject::connect(client, &QLocalSocket::readyRead, [client] () {
+                client->write(client->readAll());
+            });
+        });
+
+        QLocalServer::removeServer(socket_name);
+        server.listen(socket_name);
+        listening.release();
+        exec();
+    }
+};
+
+static uint32_t bench_percentile(std::vector<qint64> & samples, int percent)
+{
+    size_t idx = (samples.size() - 1) * percent / 100;
+    std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+    return (uint32_t)(samples[idx] / 1000);
+}
+
+/* window: number of messages allowed in flight, 1 for a strict request/response pattern */
+static bool bench_hid_run(const char *mode, int nb_packets, int window)
+{
+    int message_size = nb_packets * BENCH_HID_PACKET_SIZE;
+    std::vector<char> message(message_size);
+    std::vector<char> echo(message_size);
+    std::vector<qint64> sent_at(BENCH_HID_MESSAGES);
+    std::vector<qint64> latency_ns;
+    QElapsedTimer clock;
+    int nb_sent = 0, echo_fill = 0;
+
+    for(int i = 0; i < message_size; i++)
+        message[i] = (char)i;
+
+    latency_ns.reserve(BENCH_HID_MESSAGES);
+    clock.start();
+
+    while((int)latency_ns.size() < BENCH_HID_MESSAGES) {
+        while(nb_sent < BENCH_HID_MESSAGES && nb_sent - (int)latency_ns.size() < window) {
+            sent_at[nb_sent++] = clock.nsecsElapsed();
+            emu_hid_transport_send(message.data(), message_size);
+        }
+
+        int nb = emu_hid_transport_rcv(echo.data() + echo_fill, message_size - echo_fill);
+        if(nb < 0)
+            return false;
+        if(nb == 0) {
+            /* same idle path as the firmware thread */
+            if(!emu_hid_transport_wait(BENCH_HID_CONNECT_TIMEOUT))
+                return false;
+            continue;
+        }
+
+        echo_fill += nb;
+        if(echo_fill == message_size) {
+            if(echo != message)
+                return false;
+            latency_ns.push_back(clock.nsecsElapsed() - sent_at[latency_ns.size()]);
+            echo_fill = 0;
+        }
+    }
+
+    qint64 total_ns = clock.nsecsElapsed();
+    printf("%s;%u;%u;%u;%u;%u;%u;%u\n", mode, message_size, window, BENCH_HID_MESSAGES,
+           bench_percentile(latency_ns, 50), bench_percentile(latency_ns, 99), bench_percentile(latency_ns, 100),
+           (uint32_t)(BENCH_HID_MESSAGES * (qint64)1000000000 / total_ns));
+    return true;
+}
+
+int emu_benchmark_hid_transport(void)
+{
+    EchoServerThread server;
+    QElapsedTimer clock;
+
+    server.socket_name = QString("moolticuted_local_dev_bench_%1").arg(QCoreApplication::applicationPid());
+    server.start();
+    server.listening.acquire();
+
+    emu_hid_transport_start(server.socket_name);
+    clock.start();
+    while(!emu_hid_transport_connected() && clock.elapsed() < BENCH_HID_CONNECT_TIMEOUT)
+        QThread::msleep(1);
+
+    bool ok = emu_hid_transport_connected();
+
+    /* single packets, whole messages as send_hid_message() batches them, then pipelined */
+    printf("mode;bytes;window;messages;p50_us;p99_us;max_us;messages_per_s\n");
+    ok = ok && bench_hid_run("rtt", 1, 1);
+    ok = ok && bench_hid_run("rtt", 10, 1);
+    ok = ok && bench_hid_run("pipelined", 1, 32);
+    ok = ok && bench_hid_run("pipelined", 10, 32);
+
+    emu_hid_transport_stop();
+    server.quit();
+    server.wait();
+
+    if(!ok) {
+        fprintf(stderr, "Hid transport benchmark failed\n");
+        return 1;
+    }
+    return 0;
+}
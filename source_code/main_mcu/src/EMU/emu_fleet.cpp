@@ -0,0 +1,92 @@
+#include "emu_fleet.h"
+
+#include <QDebug>
+#include <QDir>
+
+#include <csignal>
+#include <cstdlib>
+#include <vector>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#ifdef Q_OS_LINUX
+#include <sys/prctl.h>
+#endif
+
+static std::vector<pid_t> workers;
+
+static void emu_fleet_forward_signal(int sig)
+{
+    for(size_t i = 0; i < workers.size(); i++)
+        if(workers[i] > 0)
+            kill(workers[i], sig);
+}
+
+static void emu_fleet_supervise(int exit_code)
+{
+    size_t nb_running = workers.size();
+
+    std::signal(SIGINT, emu_fleet_forward_signal);
+    std::signal(SIGTERM, emu_fleet_forward_signal);
+
+    while(nb_running > 0) {
+        int status;
+        pid_t pid = waitpid(-1, &status, 0);
+        if(pid < 0) {
+            if(errno == EINTR)
+                continue;
+            break;
+        }
+
+        for(size_t i = 0; i < workers.size(); i++) {
+            if(workers[i] != pid)
+                continue;
+
+            if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                qWarning() << "Instance" << i << "died, status" << status;
+                exit_code = 1;
+            }
+            workers[i] = 0;
+            nb_running--;
+        }
+    }
+
+    exit(exit_code);
+}
+
+int emu_fleet_fork_workers(int nb_instances, const QString & base_dir)
+{
+    workers.assign(nb_instances, 0);
+
+    for(int i = 0; i < nb_instances; i++) {
+        QString instance_dir = QString("%1/%2").arg(base_dir).arg(i);
+        if(!QDir().mkpath(instance_dir)) {
+            qWarning() << "Can't create instance directory" << instance_dir;
+            emu_fleet_forward_signal(SIGTERM);
+            emu_fleet_supervise(1);
+        }
+
+        pid_t pid = fork();
+        if(pid == 0) {
+#ifdef Q_OS_LINUX
+            /* don't outlive the supervisor, even if it gets killed */
+            prctl(PR_SET_PDEATHSIG, SIGTERM);
+#endif
+            workers.clear();
+            if(!QDir::setCurrent(instance_dir))
+                exit(1);
+            return i;
+        }
+
+        if(pid < 0) {
+            qWarning() << "Can't fork instance" << i;
+            emu_fleet_forward_signal(SIGTERM);
+            emu_fleet_supervise(1);
+        }
+        workers[i] = pid;
+    }
+
+    emu_fleet_supervise(0);
+    return -1;
+}
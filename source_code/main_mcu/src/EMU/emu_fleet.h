@@ -0,0 +1,13 @@
+#ifndef EMU_FLEET_H
+#define EMU_FLEET_H
+
+#include <QString>
+
+/* Fleet mode: the firmware is built around globals, so each emulated device is a forked
+ * worker process running in its own <base_dir>/<id> directory, where its eeprom.bin,
+ * dbflash.bin and smartcard live. Must be called before any thread is started.
+ * Returns the instance id in the workers. The supervisor never returns: it forwards
+ * SIGINT/SIGTERM to the workers and exits once all of them are gone. */
+int emu_fleet_fork_workers(int nb_instances, const QString & base_dir);
+
+#endif
@@ -0,0 +1,279 @@
+#include "emu_hid_trace.h"
+#include "emulator.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <time.h>
+
+/* Trace file: a header, then one record per message, host endianness.
+ * Replays only wait for a response when the recorded session got one before its next request,
+ * and time requests with the host clock: the headless virtual clock doesn't see firmware cpu time. */
+
+#define EMU_HID_TRACE_MAGIC         "MHTR"
+#define EMU_HID_TRACE_VERSION       1
+#define EMU_HID_TRACE_REQUEST       0
+#define EMU_HID_TRACE_RESPONSE      1
+#define EMU_HID_TRACE_MAX_CMDS      128
+
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t reserved;
+} emu_hid_trace_header_t;
+
+typedef struct {
+    uint64_t timestamp_us;
+    uint16_t length;
+    uint8_t direction;
+    uint8_t reserved;
+} emu_hid_trace_record_t;
+
+/* replayed request, in the trace buffer */
+typedef struct {
+    const uint8_t *payload;
+    uint16_t length;
+    BOOL expects_response;
+} emu_hid_trace_req_t;
+
+/* latency samples of one HID_CMD_* id */
+typedef struct {
+    uint16_t cmd;
+    uint32_t nb_samples;
+    uint32_t capacity;
+    uint32_t *samples_us;
+} emu_hid_trace_stats_t;
+
+static FILE *record_file;
+
+static uint8_t *replay_buffer;
+static emu_hid_trace_req_t *replay_requests;
+static uint32_t replay_nb_requests;
+static uint32_t replay_next_request;
+static BOOL replay_in_flight;
+static uint16_t replay_in_flight_cmd;
+static uint64_t replay_sent_ns;
+static uint64_t replay_start_ns;
+static emu_hid_trace_stats_t replay_stats[EMU_HID_TRACE_MAX_CMDS];
+static uint32_t replay_nb_cmds;
+
+static uint64_t emu_hid_trace_host_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + (uint64_t)now.tv_nsec;
+}
+
+static uint16_t emu_hid_trace_get_cmd(const uint8_t *payload, int length)
+{
+    uint16_t cmd = 0xFFFF;
+
+    if(length >= (int)sizeof(cmd))
+        memcpy(&cmd, payload, sizeof(cmd));
+    return cmd;
+}
+
+static void emu_hid_trace_write(uint8_t direction, const uint8_t *payload, int length)
+{
+    emu_hid_trace_record_t record;
+
+    memset(&record, 0, sizeof(record));
+    record.timestamp_us = emu_get_elapsed_us();
+    record.length = (uint16_t)length;
+    record.direction = direction;
+    fwrite(&record, sizeof(record), 1, record_file);
+    fwrite(payload, 1, length, record_file);
+}
+
+BOOL emu_hid_trace_record_open(const char *filename)
+{
+    emu_hid_trace_header_t header = {EMU_HID_TRACE_MAGIC, EMU_HID_TRACE_VERSION, 0};
+
+    record_file = fopen(filename, "wb");
+    if(!record_file) {
+        fprintf(stderr, "Can't create hid trace %s\n", filename);
+        return FALSE;
+    }
+
+    fwrite(&header, sizeof(header), 1, record_file);
+    return TRUE;
+}
+
+BOOL emu_hid_trace_replay_open(const char *filename)
+{
+    emu_hid_trace_header_t header;
+    emu_hid_trace_record_t record;
+    FILE *f = fopen(filename, "rb");
+    long size, offset;
+
+    if(!f || fseek(f, 0, SEEK_END) != 0 || (size = ftell(f)) < (long)sizeof(header)) {
+        fprintf(stderr, "Can't read hid trace %s\n", filename);
+        if(f)
+            fclose(f);
+        return FALSE;
+    }
+
+    replay_buffer = malloc(size);
+    rewind(f);
+    if(!replay_buffer || fread(replay_buffer, 1, size, f) != (size_t)size) {
+        fprintf(stderr, "Can't read hid trace %s\n", filename);
+        free(replay_buffer);
+        replay_buffer = NULL;
+        fclose(f);
+        return FALSE;
+    }
+    fclose(f);
+
+    memcpy(&header, replay_buffer, sizeof(header));
+    if(memcmp(header.magic, EMU_HID_TRACE_MAGIC, sizeof(header.magic)) != 0 || header.version != EMU_HID_TRACE_VERSION) {
+        fprintf(stderr, "%s is not a hid trace\n", filename);
+        free(replay_buffer);
+        replay_buffer = NULL;
+        return FALSE;
+    }
+
+    /* at most one request per record */
+    replay_requests = malloc((size / sizeof(record) + 1) * sizeof(*replay_requests));
+    if(!replay_requests)
+        abort();
+
+    for(offset = sizeof(header); offset + (long)sizeof(record) <= size; offset += sizeof(record) + record.length) {
+        memcpy(&record, replay_buffer + offset, sizeof(record));
+        if(offset + (long)sizeof(record) + record.length > size)
+            break;
+
+        if(record.direction == EMU_HID_TRACE_REQUEST) {
+            replay_requests[replay_nb_requests].payload = replay_buffer + offset + sizeof(record);
+            replay_requests[replay_nb_requests].length = record.length;
+            replay_requests[replay_nb_requests].expects_response = FALSE;
+            replay_nb_requests++;
+        } else if(replay_nb_requests > 0) {
+            emu_hid_trace_req_t *req = &replay_requests[replay_nb_requests - 1];
+            if(emu_hid_trace_get_cmd(req->payload, req->length) == emu_hid_trace_get_cmd(replay_buffer + offset + sizeof(record), record.length))
+                req->expects_response = TRUE;
+        }
+    }
+
+    replay_start_ns = emu_hid_trace_host_ns();
+    return TRUE;
+}
+
+static void emu_hid_trace_add_sample(uint16_t cmd, uint32_t latency_us)
+{
+    emu_hid_trace_stats_t *stats = NULL;
+    uint32_t i;
+
+    for(i = 0; i < replay_nb_cmds && !stats; i++) {
+        if(replay_stats[i].cmd == cmd)
+            stats = &replay_stats[i];
+    }
+
+    if(!stats) {
+        if(replay_nb_cmds == EMU_HID_TRACE_MAX_CMDS)
+            return;
+        stats = &replay_stats[replay_nb_cmds++];
+        stats->cmd = cmd;
+    }
+
+    if(stats->nb_samples == stats->capacity) {
+        stats->capacity = stats->capacity ? stats->capacity * 2 : 64;
+        stats->samples_us = realloc(stats->samples_us, stats->capacity * sizeof(uint32_t));
+        if(!stats->samples_us)
+            abort();
+    }
+    stats->samples_us[stats->nb_samples++] = latency_us;
+}
+
+static int emu_hid_trace_compare_us(const void *a, const void *b)
+{
+    uint32_t us_a = *(const uint32_t*)a, us_b = *(const uint32_t*)b;
+    return (us_a > us_b) - (us_a < us_b);
+}
+
+static int emu_hid_trace_compare_cmd(const void *a, const void *b)
+{
+    return (int)((const emu_hid_trace_stats_t*)a)->cmd - (int)((const emu_hid_trace_stats_t*)b)->cmd;
+}
+
+/* same output format as the other emulator benchmarks */
+static void emu_hid_trace_print_report(void)
+{
+    uint64_t elapsed_ns = emu_hid_trace_host_ns() - replay_start_ns;
+    uint32_t i;
+
+    qsort(replay_stats, replay_nb_cmds, sizeof(replay_stats[0]), emu_hid_trace_compare_cmd);
+
+    printf("cmd;requests;p50_us;p99_us;max_us\n");
+    for(i = 0; i < replay_nb_cmds; i++) {
+        emu_hid_trace_stats_t *stats = &replay_stats[i];
+        qsort(stats->samples_us, stats->nb_samples, sizeof(uint32_t), emu_hid_trace_compare_us);
+        printf("0x%04x;%u;%u;%u;%u\n", stats->cmd, stats->nb_samples,
+               stats->samples_us[(stats->nb_samples - 1) * 50 / 100],
+               stats->samples_us[(stats->nb_samples - 1) * 99 / 100],
+               stats->samples_us[stats->nb_samples - 1]);
+        free(stats->samples_us);
+    }
+    printf("\nrequests;elapsed_ms;requests_per_s\n");
+    printf("%u;%u;%u\n", replay_next_request, (uint32_t)(elapsed_ns / 1000000),
+           elapsed_ns ? (uint32_t)(replay_next_request * (uint64_t)1000000000 / elapsed_ns) : 0);
+    fflush(stdout);
+}
+
+void emu_hid_trace_close(void)
+{
+    if(record_file) {
+        fclose(record_file);
+        record_file = NULL;
+    }
+
+    if(replay_buffer) {
+        emu_hid_trace_print_report();
+        free(replay_requests);
+        free(replay_buffer);
+        replay_requests = NULL;
+        replay_buffer = NULL;
+    }
+}
+
+void emu_hid_trace_request(const uint8_t *payload, int length)
+{
+    if(record_file)
+        emu_hid_trace_write(EMU_HID_TRACE_REQUEST, payload, length);
+}
+
+void emu_hid_trace_response(const uint8_t *payload, int length)
+{
+    if(record_file)
+        emu_hid_trace_write(EMU_HID_TRACE_RESPONSE, payload, length);
+
+    /* unsolicited messages (status updates...) don't answer the request in flight */
+    if(replay_in_flight && emu_hid_trace_get_cmd(payload, length) == replay_in_flight_cmd) {
+        emu_hid_trace_add_sample(replay_in_flight_cmd, (uint32_t)((emu_hid_trace_host_ns() - replay_sent_ns) / 1000));
+        replay_in_flight = FALSE;
+    }
+}
+
+/* returns the next request length, 0 while the previous one isn't answered or once done */
+int emu_hid_trace_replay_next(uint8_t *payload, int max_length)
+{
+    emu_hid_trace_req_t *req;
+
+    if(!replay_buffer || replay_in_flight || replay_next_request == replay_nb_requests)
+        return 0;
+
+    req = &replay_requests[replay_next_request++];
+    if(req->length > max_length)
+        return 0;
+
+    memcpy(payload, req->payload, req->length);
+    replay_in_flight_cmd = emu_hid_trace_get_cmd(req->payload, req->length);
+    replay_in_flight = req->expects_response;
+    replay_sent_ns = emu_hid_trace_host_ns();
+    return req->length;
+}
+
+BOOL emu_hid_trace_replay_done(void)
+{
+    return (replay_buffer && !replay_in_flight && replay_next_request == replay_nb_requests)? TRUE:FALSE;
+}
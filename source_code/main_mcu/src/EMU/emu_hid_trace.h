@@ -0,0 +1,28 @@
+#ifndef EMU_HID_TRACE_H
+#define EMU_HID_TRACE_H
+#include <inttypes.h>
+#include "defines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Host sessions at the reassembled message level: every request and response payload
+ * (hid_message_t bytes) with an emu_get_elapsed_us() timestamp, see emu_hid_trace.c */
+BOOL emu_hid_trace_record_open(const char *filename);
+/* feed a recorded session back instead of moolticute, one request at a time */
+BOOL emu_hid_trace_replay_open(const char *filename);
+/* flushes the recording, prints the per command latencies of the replay */
+void emu_hid_trace_close(void);
+
+/* from emu_aux_mcu.c */
+void emu_hid_trace_request(const uint8_t *payload, int length);
+void emu_hid_trace_response(const uint8_t *payload, int length);
+int emu_hid_trace_replay_next(uint8_t *payload, int max_length);
+BOOL emu_hid_trace_replay_done(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
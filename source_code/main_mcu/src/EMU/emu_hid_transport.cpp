@@ -0,0 +1,180 @@
+#include "emu_hid_transport.h"
+#include "emu_spsc_ring.h"
+
+#include "qt_metacall_helper.h"
+#include <QLocalSocket>
+#include <QSemaphore>
+#include <QThread>
+#include <QTimer>
+
+#include <atomic>
+
+#define HID_RING_SIZE           (64 * 1024)
+#define HID_IO_CHUNK_SIZE       4096
+#define HID_RECONNECT_PERIOD_MS 10
+
+/* rx: filled by the I/O thread, drained by the firmware. tx: the other way round */
+static EmuSpscRing<HID_RING_SIZE> rx_ring;
+static EmuSpscRing<HID_RING_SIZE> tx_ring;
+
+static std::atomic<QLocalSocket*> io_socket{nullptr};
+static std::atomic<bool> io_connected{false};
+static std::atomic<bool> tx_flush_pending{false};
+static std::atomic<bool> rx_stalled{false};
+static std::atomic<bool> rx_waiting{false};
+static QSemaphore rx_wakeup;
+
+/* I/O thread: move whatever the socket has into the rx ring, wake the firmware if it sleeps */
+static void emu_hid_io_read(void)
+{
+    QLocalSocket *socket = io_socket.load();
+    char chunk[HID_IO_CHUNK_SIZE];
+
+    /* posted events are still run when the socket goes away at exit */
+    if(!socket)
+        return;
+
+    while(socket->bytesAvailable() > 0) {
+        qint64 nb = rx_ring.room();
+        if(nb == 0) {
+            /* firmware is lagging: leave the rest in the socket until it asks for more */
+            rx_stalled.store(true);
+            if(rx_ring.room() == 0)
+                break;
+            continue;
+        }
+
+        if(nb > (qint64)sizeof(chunk))
+            nb = sizeof(chunk);
+
+        nb = socket->read(chunk, nb);
+        if(nb <= 0)
+            break;
+        rx_ring.push(chunk, nb);
+    }
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(rx_waiting.exchange(false))
+        rx_wakeup.release();
+}
+
+/* I/O thread: write everything queued so far in as few socket writes as possible */
+static void emu_hid_io_flush(void)
+{
+    QLocalSocket *socket = io_socket.load();
+    char chunk[HID_IO_CHUNK_SIZE];
+    size_t nb;
+
+    if(!socket)
+        return;
+
+    tx_flush_pending.store(false);
+    while((nb = tx_ring.pop(chunk, sizeof(chunk))) > 0) {
+        /* like a real usb link, packets sent while unplugged are lost */
+        if(socket->state() == QLocalSocket::ConnectedState)
+            socket->write(chunk, nb);
+    }
+    socket->flush();
+}
+
+/* firmware thread: have the I/O thread run a handler */
+static void emu_hid_io_post(void (*handler)(void))
+{
+    QLocalSocket *socket = io_socket.load();
+    if(socket)
+        postToObject(handler, socket);
+}
+
+class HidIoThread: public QThread {
+public:
+    QString socket_name;
+
+    void run() {
+        QLocalSocket socket;
+        QTimer reconnect_timer;
+
+        QObject::connect(&socket, &QLocalSocket::connected, [] () { io_connected.store(true); });
+        QObject::connect(&socket, &QLocalSocket::disconnected, [] () { io_connected.store(false); });
+        QObject::connect(&socket, &QLocalSocket::readyRead, emu_hid_io_read);
+        QObject::connect(&reconnect_timer, &QTimer::timeout, [this, &socket] () {
+            if(socket.state() == QLocalSocket::UnconnectedState)
+                socket.connectToServer(socket_name);
+        });
+
+        io_socket.store(&socket);
+        socket.connectToServer(socket_name);
+        reconnect_timer.start(HID_RECONNECT_PERIOD_MS);
+
+        exec();
+
+        io_socket.store(nullptr);
+        io_connected.store(false);
+    }
+};
+
+static HidIoThread io_thread;
+
+void emu_hid_transport_start(const QString & socket_name)
+{
+    io_thread.socket_name = socket_name;
+    io_thread.start();
+}
+
+void emu_hid_transport_stop(void)
+{
+    io_thread.quit();
+    io_thread.wait();
+}
+
+bool emu_hid_transport_connected(void)
+{
+    return io_connected.load();
+}
+
+void emu_hid_transport_send(const char *data, int size)
+{
+    if(!io_connected.load())
+        return;
+
+    while(size > 0) {
+        size_t nb = tx_ring.push(data, size);
+        data += nb;
+        size -= nb;
+
+        /* one queued flush per batch, not per packet */
+        if(!tx_flush_pending.exchange(true))
+            emu_hid_io_post(emu_hid_io_flush);
+
+        /* a full ring only happens if the host stopped reading: let the I/O thread catch up */
+        if(size > 0)
+            QThread::usleep(100);
+    }
+}
+
+int emu_hid_transport_rcv(char *data, int size)
+{
+    if(!io_connected.load()) {
+        /* moolticute went away: anything partial is meaningless now */
+        rx_ring.clear();
+        return -1;
+    }
+
+    int nb = rx_ring.pop(data, size);
+    if(nb > 0 && rx_stalled.exchange(false))
+        emu_hid_io_post(emu_hid_io_read);
+
+    return nb;
+}
+
+/* firmware thread, only when it has nothing else to do: sleep until hid data arrives */
+bool emu_hid_transport_wait(int timeout_ms)
+{
+    rx_waiting.store(true);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if(rx_ring.available() == 0)
+        rx_wakeup.tryAcquire(1, timeout_ms);
+
+    rx_waiting.store(false);
+    return rx_ring.available() > 0;
+}
@@ -0,0 +1,17 @@
+#ifndef EMU_HID_TRANSPORT_H
+#define EMU_HID_TRANSPORT_H
+
+#include <QString>
+
+/* The local socket to moolticute lives on its own I/O thread, the firmware thread only
+ * exchanges bytes with it through lock-free rings and never waits on the socket itself. */
+void emu_hid_transport_start(const QString & socket_name);
+void emu_hid_transport_stop(void);
+
+/* firmware thread side */
+bool emu_hid_transport_connected(void);
+void emu_hid_transport_send(const char *data, int size);
+int emu_hid_transport_rcv(char *data, int size);
+bool emu_hid_transport_wait(int timeout_ms);
+
+#endif
@@ -0,0 +1,347 @@
+#include "emu_benchmark.h"
+#include "emu_dataflash.h"
+#include "emu_storage.h"
+#include "emulator.h"
+#include "custom_fs.h"
+#include "gui_dispatcher.h"
+#include "logic_database.h"
+#include "logic_encryption.h"
+#include "main.h"
+#include "nodemgmt.h"
+#include "sh1122.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Native benchmarks of the firmware hot paths, without Qt and without the emulator main loop.
+ * The real database, encryption and display code runs against the in-memory flash images of
+ * emu_storage_ram.c and the bundle file. Results go to stdout as JSON, one object per
+ * measurement, so that they can be compared from one commit to the next. */
+
+#define BENCH_NB_LOOKUPS    200
+#define BENCH_SCAN_ROUNDS   10
+#define BENCH_AES_ROUNDS    2000
+#define BENCH_GLYPH_ROUNDS  200
+#define BENCH_BITMAP_ROUNDS 50
+#define BENCH_FREE_NODES    32
+#define BENCH_MAX_SIZES     16
+/* a parent takes one node slot, its credential two */
+#define BENCH_MAX_SERVICES  (NODEMGMT_NB_NODE_SLOTS / 3 - 16)
+#define BENCH_IMPORT_CREDS  (BENCH_MAX_SERVICES < 2000 ? BENCH_MAX_SERVICES : 2000)
+
+static const uint16_t bench_default_sizes[] = {16, 64, 256, 512, 1024};
+static const uint16_t bench_aes_lengths[] = {16, 128, 1024};
+static const cust_char_t bench_glyph_string[] = u"The quick brown fox jumps over";
+
+static BOOL bench_first_result = TRUE;
+
+static uint64_t bench_now_ns(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/* services: database size the measurement was done with, 0 if not relevant. bytes: payload per op */
+static void bench_result(const char *name, uint16_t services, uint16_t bytes, uint32_t nb_ops, uint64_t total_ns, uint32_t dbflash_reads)
+{
+    printf("%s\n    {\"name\": \"%s\", \"services\": %u, \"bytes\": %u, \"ops\": %" PRIu32 ", \"ns_per_op\": %" PRIu64 ", \"dbflash_reads_per_op\": %" PRIu32 "}",
+           bench_first_result ? "" : ",", name, services, bytes, nb_ops, total_ns / nb_ops, dbflash_reads / nb_ops);
+    bench_first_result = FALSE;
+}
+
+/* grows the database to nb_services, each with one credential, timing the credential stores */
+static BOOL bench_fill(uint16_t from, uint16_t nb_services)
+{
+    cust_char_t service[SERVICE_NAME_MAX_LEN];
+    uint8_t password[MEMBER_SIZE(child_cred_node_t, password)];
+    uint8_t ctr[MEMBER_SIZE(child_cred_node_t, ctr)];
+    uint16_t addresses[BENCH_MAX_SERVICES];
+
+    memset(ctr, 0, sizeof(ctr));
+    if(!emu_benchmark_populate_services(from, nb_services, addresses))
+        return FALSE;
+
+    uint32_t start_reads = emu_dbflash_get_read_count();
+    uint64_t start_ns = bench_now_ns();
+    for(uint16_t i = from; i < nb_services; i++) {
+        memset(password, i, sizeof(password));
+        emu_benchmark_service_name(service, i);
+        if(logic_database_add_credential_for_service(addresses[i], service, NULL, NULL, password, ctr) != RETURN_OK) {
+            fprintf(stderr, "Couldn't store credential #%u\n", i);
+            return FALSE;
+        }
+    }
+    bench_result("credential_store", nb_services, sizeof(password), nb_services - from, bench_now_ns() - start_ns, emu_dbflash_get_read_count() - start_reads);
+    return TRUE;
+}
+
+/* spread over the alphabet but sorted the same way as ids, as a host import would send them */
+static void bench_import_service_name(cust_char_t *service, uint16_t id)
+{
+    uint16_t letters = (uint16_t)((uint32_t)id * 26 * 26 / BENCH_IMPORT_CREDS);
+    char ascii[16];
+
+    snprintf(ascii, sizeof(ascii), "%c%c%05u.com", 'a' + letters / 26, 'a' + letters % 26, id);
+    memset(service, 0, SERVICE_NAME_MAX_LEN * sizeof(cust_char_t));
+    for(int i = 0; ascii[i] != 0; i++)
+        service[i] = (cust_char_t)ascii[i];
+}
+
+/* what logic_user_store_credential() does for each imported credential, minus the smartcard check.
+ * Blank profile, with or without the reservation and merge cursor set by logic_user_bulk_import_begin() */
+static BOOL bench_import(BOOL bulk, const uint8_t *aes_key, cpz_lut_entry_t *cpz_entry)
+{
+    cust_char_t service[SERVICE_NAME_MAX_LEN];
+    uint8_t password[MEMBER_SIZE(child_cred_node_t, password)];
+    uint8_t ctr[MEMBER_SIZE(child_cred_node_t, ctr)];
+
+    emu_benchmark_blank_profile();
+    logic_encryption_init_context((uint8_t*)aes_key, cpz_entry);
+
+    uint32_t start_reads = emu_dbflash_get_read_count();
+    uint64_t start_ns = bench_now_ns();
+    if(bulk) {
+        logic_encryption_reserve_ctr_blocks((uint32_t)BENCH_IMPORT_CREDS * ((sizeof(password) * 8 + AES256_CTR_LENGTH - 1) / AES256_CTR_LENGTH));
+        nodemgmt_merge_cursor_enable();
+    }
+    for(uint16_t i = 0; i < BENCH_IMPORT_CREDS; i++) {
+        bench_import_service_name(service, i);
+        uint16_t parent_address = logic_database_search_service(service, COMPARE_MODE_MATCH, TRUE, NODEMGMT_STANDARD_CRED_TYPE_ID);
+        if(parent_address == NODE_ADDR_NULL)
+            parent_address = logic_database_add_service(service, SERVICE_CRED_TYPE, NODEMGMT_STANDARD_CRED_TYPE_ID);
+        if(parent_address == NODE_ADDR_NULL)
+            return FALSE;
+        memset(password, i, sizeof(password));
+        logic_encryption_ctr_encrypt(password, sizeof(password), ctr);
+        if(logic_database_add_credential_for_service(parent_address, service, NULL, NULL, password, ctr) != RETURN_OK)
+            return FALSE;
+    }
+    if(bulk) {
+        logic_encryption_clear_ctr_reservation();
+        nodemgmt_merge_cursor_disable();
+    }
+    bench_result(bulk ? "bulk_import" : "import", BENCH_IMPORT_CREDS, sizeof(password), BENCH_IMPORT_CREDS, bench_now_ns() - start_ns, emu_dbflash_get_read_count() - start_reads);
+    return TRUE;
+}
+
+static BOOL bench_service_search(uint16_t nb_services)
+{
+    cust_char_t service[SERVICE_NAME_MAX_LEN];
+
+    uint32_t start_reads = emu_dbflash_get_read_count();
+    uint64_t start_ns = bench_now_ns();
+    for(uint16_t i = 0; i < BENCH_NB_LOOKUPS; i++) {
+        emu_benchmark_service_name(service, (uint16_t)((i * 37u) % nb_services));
+        if(logic_database_search_service(service, COMPARE_MODE_MATCH, TRUE, NODEMGMT_STANDARD_CRED_TYPE_ID) == NODE_ADDR_NULL)
+            return FALSE;
+    }
+    bench_result("service_search", nb_services, 0, BENCH_NB_LOOKUPS, bench_now_ns() - start_ns, emu_dbflash_get_read_count() - start_reads);
+    return TRUE;
+}
+
+/* service address lookups are not part of the measurement */
+static BOOL bench_credential_fetch(uint16_t nb_services)
+{
+    cust_char_t service[SERVICE_NAME_MAX_LEN];
+    uint8_t password[MEMBER_SIZE(child_cred_node_t, password)];
+    uint8_t ctr[MEMBER_SIZE(child_cred_node_t, ctr)];
+    uint16_t addresses[BENCH_NB_LOOKUPS];
+    BOOL prev_gen_credential_flag;
+    uint64_t total_ns = 0;
+
+    for(uint16_t i = 0; i < BENCH_NB_LOOKUPS; i++) {
+        emu_benchmark_service_name(service, (uint16_t)((i * 37u) % nb_services));
+        addresses[i] = logic_database_search_service(service, COMPARE_MODE_MATCH, TRUE, NODEMGMT_STANDARD_CRED_TYPE_ID);
+    }
+
+    uint32_t start_reads = emu_dbflash_get_read_count();
+    for(uint16_t i = 0; i < BENCH_NB_LOOKUPS; i++) {
+        emu_benchmark_service_name(service, (uint16_t)((i * 37u) % nb_services));
+        uint64_t start_ns = bench_now_ns();
+        uint16_t child_addr = logic_database_search_login_in_service(addresses[i], service, FALSE);
+        if(child_addr == NODE_ADDR_NULL)
+            return FALSE;
+        logic_database_fetch_encrypted_password(child_addr, password, ctr, &prev_gen_credential_flag);
+        total_ns += bench_now_ns() - start_ns;
+        if(password[0] != (uint8_t)((i * 37u) % nb_services))
+            return FALSE;
+    }
+    bench_result("credential_fetch", nb_services, sizeof(password), BENCH_NB_LOOKUPS, total_ns, emu_dbflash_get_read_count() - start_reads);
+    return TRUE;
+}
+
+/* full scan of the node flags, then what moolticute asks for before a sync: free slots from the start */
+static void bench_free_node_scan(uint16_t nb_services)
+{
+    uint16_t parents[BENCH_FREE_NODES], children[BENCH_FREE_NODES];
+
+    uint32_t start_reads = emu_dbflash_get_read_count();
+    uint64_t start_ns = bench_now_ns();
+    for(uint16_t i = 0; i < BENCH_SCAN_ROUNDS; i++)
+        nodemgmt_node_bitmap_build();
+    bench_result("free_node_scan", nb_services, 0, BENCH_SCAN_ROUNDS, bench_now_ns() - start_ns, emu_dbflash_get_read_count() - start_reads);
+
+    start_reads = emu_dbflash_get_read_count();
+    start_ns = bench_now_ns();
+    for(uint16_t i = 0; i < BENCH_NB_LOOKUPS; i++)
+        nodemgmt_find_free_nodes(BENCH_FREE_NODES, parents, BENCH_FREE_NODES, children, 0, 0);
+    bench_result("free_node_find", nb_services, 0, BENCH_NB_LOOKUPS, bench_now_ns() - start_ns, emu_dbflash_get_read_count() - start_reads);
+}
+
+static BOOL bench_aes_ctr(void)
+{
+    uint8_t data[1024], reference[1024];
+    uint8_t ctr[AES256_CTR_LENGTH/8];
+
+    for(size_t i = 0; i < ARRAY_SIZE(bench_aes_lengths); i++) {
+        uint16_t length = bench_aes_lengths[i];
+        uint64_t encrypt_ns = 0, decrypt_ns = 0;
+
+        for(uint16_t j = 0; j < length; j++)
+            reference[j] = (uint8_t)j;
+
+        for(uint16_t round = 0; round < BENCH_AES_ROUNDS; round++) {
+            memcpy(data, reference, length);
+            uint64_t start_ns = bench_now_ns();
+            logic_encryption_ctr_encrypt(data, length, ctr);
+            uint64_t mid_ns = bench_now_ns();
+            logic_encryption_ctr_decrypt(data, ctr, length, FALSE);
+            decrypt_ns += bench_now_ns() - mid_ns;
+            encrypt_ns += mid_ns - start_ns;
+            if(memcmp(data, reference, length) != 0)
+                return FALSE;
+        }
+        bench_result("aes_ctr_encrypt", 0, length, BENCH_AES_ROUNDS, encrypt_ns, 0);
+        bench_result("aes_ctr_decrypt", 0, length, BENCH_AES_ROUNDS, decrypt_ns, 0);
+    }
+    return TRUE;
+}
+
+static void bench_display(void)
+{
+    uint16_t nb_glyphs = ARRAY_SIZE(bench_glyph_string) - 1;
+
+    sh1122_init_display(&plat_oled_descriptor, FALSE);
+    sh1122_refresh_used_font(&plat_oled_descriptor, FONT_UBUNTU_REGULAR_16_ID);
+
+    /* to the frame buffer, as the gui does */
+    uint64_t start_ns = bench_now_ns();
+    for(uint16_t round = 0; round < BENCH_GLYPH_ROUNDS; round++)
+        sh1122_put_string_xy(&plat_oled_descriptor, 0, 0, OLED_ALIGN_LEFT, bench_glyph_string, TRUE);
+    bench_result("glyph_render", 0, 0, BENCH_GLYPH_ROUNDS * nb_glyphs, bench_now_ns() - start_ns, 0);
+
+    /* lock screen: full screen, streamed straight to the display */
+    start_ns = bench_now_ns();
+    for(uint16_t round = 0; round < BENCH_BITMAP_ROUNDS; round++)
+        sh1122_display_bitmap_from_flash(&plat_oled_descriptor, 0, 0, GUI_LOCKED_MINI_BITMAP_ID, FALSE);
+    bench_result("bitmap_decode_fullscreen", 0, SH1122_OLED_WIDTH * SH1122_OLED_HEIGHT / 2, BENCH_BITMAP_ROUNDS, bench_now_ns() - start_ns, 0);
+
+    start_ns = bench_now_ns();
+    for(uint16_t round = 0; round < BENCH_BITMAP_ROUNDS; round++)
+        sh1122_display_bitmap_from_flash(&plat_oled_descriptor, 0, 0, GUI_LOCKED_MINI_BITMAP_ID, TRUE);
+    bench_result("bitmap_decode_buffered", 0, SH1122_OLED_WIDTH * SH1122_OLED_HEIGHT / 2, BENCH_BITMAP_ROUNDS, bench_now_ns() - start_ns, 0);
+}
+
+static int bench_compare_sizes(const void *a, const void *b)
+{
+    return *(const uint16_t*)a - *(const uint16_t*)b;
+}
+
+/* comma separated, sorted as the database only grows */
+static size_t bench_parse_sizes(const char *arg, uint16_t *sizes)
+{
+    size_t nb_sizes = 0;
+    char *end;
+
+    while(*arg != 0 && nb_sizes < BENCH_MAX_SIZES) {
+        unsigned long size = strtoul(arg, &end, 10);
+        if(end == arg || size == 0 || size > BENCH_MAX_SERVICES)
+            return 0;
+        sizes[nb_sizes++] = (uint16_t)size;
+        arg = (*end == ',') ? end + 1 : end;
+    }
+    qsort(sizes, nb_sizes, sizeof(sizes[0]), bench_compare_sizes);
+    return nb_sizes;
+}
+
+int main(int argc, char **argv)
+{
+    uint16_t sizes[BENCH_MAX_SIZES];
+    size_t nb_sizes = ARRAY_SIZE(bench_default_sizes);
+    const char *bundle = NULL;
+    cpz_lut_entry_t cpz_entry;
+    uint8_t aes_key[AES_KEY_LENGTH/8];
+    uint16_t nb_services = 0;
+
+    memcpy(sizes, bench_default_sizes, sizeof(bench_default_sizes));
+    for(int i = 1; i < argc; i++) {
+        if(strcmp(argv[i], "--bundle") == 0 && i + 1 < argc) {
+            bundle = argv[++i];
+        } else if(strcmp(argv[i], "--sizes") == 0 && i + 1 < argc) {
+            nb_sizes = bench_parse_sizes(argv[++i], sizes);
+            if(nb_sizes == 0) {
+                fprintf(stderr, "Invalid database sizes, expected e.g. 16,256,1024 (max %u)\n", BENCH_MAX_SERVICES);
+                return 1;
+            }
+        } else {
+            fprintf(stderr, "Usage: %s [--bundle miniblebundle.img] [--sizes 16,256,1024]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    /* no bundle: the display benchmarks are skipped */
+    emu_dataflash_init(bundle);
+    custom_fs_settings_init();
+    custom_fs_set_dataflash_descriptor(&dataflash_descriptor);
+    BOOL bundle_present = (custom_fs_init() == RETURN_OK)? TRUE:FALSE;
+
+    /* blank user profile, default (non provisioned) key */
+    emu_benchmark_blank_profile();
+    memset(&cpz_entry, 0, sizeof(cpz_entry));
+    for(size_t i = 0; i < sizeof(aes_key); i++)
+        aes_key[i] = (uint8_t)(i * 13);
+    logic_encryption_init_context(aes_key, &cpz_entry);
+
+    printf("{\n  \"suite\": \"minible_bench\",\n  \"bundle\": %s,\n  \"results\": [", bundle_present ? "true" : "false");
+
+    for(size_t i = 0; i < nb_sizes; i++) {
+        if(sizes[i] == nb_services)
+            continue;
+        if(!bench_fill(nb_services, sizes[i]))
+            return 1;
+        nb_services = sizes[i];
+
+        if(!bench_service_search(nb_services) || !bench_credential_fetch(nb_services)) {
+            fprintf(stderr, "Credential lookup failed with %u services\n", nb_services);
+            return 1;
+        }
+        bench_free_node_scan(nb_services);
+        fflush(stdout);
+    }
+
+    /* sorted stream of credentials on a blank profile, after the database size runs as it wipes the database */
+    if(!bench_import(FALSE, aes_key, &cpz_entry) || !bench_import(TRUE, aes_key, &cpz_entry)) {
+        fprintf(stderr, "Credential import failed\n");
+        return 1;
+    }
+
+    if(!bench_aes_ctr()) {
+        fprintf(stderr, "AES-CTR round trip mismatch\n");
+        return 1;
+    }
+
+    if(bundle_present)
+        bench_display();
+    else
+        fprintf(stderr, "No bundle, display benchmarks skipped\n");
+
+    printf("\n  ]\n}\n");
+    logic_encryption_delete_context();
+    emu_storage_close();
+    return 0;
+}
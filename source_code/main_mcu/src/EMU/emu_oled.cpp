@@ -1,4 +1,6 @@
 #include "emu_oled.h"
+#include "emu_oled_fb.h"
+#include "emu_oled_capture.h"
 #include "emulator.h"
 extern "C" {
 #include <asf.h>
@@ -11,116 +13,65 @@ extern "C" {
 #include <QSemaphore>
 #include <QApplication>
 #include <QPainter>
+#include <QPaintEvent>
 #include <QWheelEvent>
 #include <QMouseEvent>
 #include <QKeyEvent>
 #include <QThread>
 #include <QTimer>
 
-#define FB_WIDTH (256)
-#define FB_HEIGHT (64)
-
-/// grayscale 8-bit
-static uint8_t oled_fb[FB_WIDTH * FB_HEIGHT];
-static int oled_col, oled_row;
-
 void emu_oled_byte(uint8_t data)
 {
-    static int cmdargs = 0;
-    static uint8_t last_cmd = 0;
-
-    if(PORT->Group[OLED_CD_GROUP].OUTCLR.reg == OLED_CD_MASK) {
-        // command byte
-        //printf("Oled CMD: %02x\n", data);
-        if(cmdargs == 0) {
-            switch(data) {
-            case SH1122_CMD_SET_HIGH_COLUMN_ADDR ... SH1122_CMD_SET_HIGH_COLUMN_ADDR+15:
-                oled_col = (oled_col & 0xf) | ((data & 0xf) << 4);
-                break;
-            case SH1122_CMD_SET_LOW_COLUMN_ADDR ... SH1122_CMD_SET_LOW_COLUMN_ADDR+15:
-                oled_col = (oled_col & 0xf0) | (data & 0xf);
-                break;
-            case SH1122_CMD_SET_ROW_ADDR:
-                cmdargs = 1;
-                break;
-            case SH1122_CMD_SET_CLOCK_DIVIDER:
-            case SS1122_CMD_SET_DISCHARGE_PRECHARGE_PERIOD:
-            case SH1122_CMD_SET_CONTRAST_CURRENT:
-            case SH1122_CMD_SET_DISPLAY_OFFSET:
-            case SH1122_CMD_SET_VCOM_DESELECT_LEVEL:
-            case SH1122_CMD_SET_VSEGM_LEVEL:
-                cmdargs = 1;
-                break;
-            case SH1122_CMD_SET_DISPLAY_ON:
-                postToObject([]() { oled->set_display_on(true); }, oled);
-                break;
-            case SH1122_CMD_SET_DISPLAY_OFF:
-                postToObject([]() { oled->set_display_on(false); }, oled);
-                break;
-            }
+    int event = emu_oled_fb_byte(data);
 
-            last_cmd = data;
-
-        } else {
-            if(cmdargs == 1 && last_cmd == SH1122_CMD_SET_ROW_ADDR) {
-                oled_row = data;
-            }
-
-            cmdargs--;
-        }
-    } else {
-        // data byte
-        //printf("Oled DATA @%d,%d: %02x\n", oled_col, oled_row, data);
-        oled_fb[FB_WIDTH * oled_row + oled_col*2] = data & 0xf0;
-        oled_fb[FB_WIDTH * oled_row + oled_col*2 + 1] = (data & 0x0f) << 4;
-        
-        if(oled_col == SH1122_OLED_Max_Column) {
-            if(oled_row == SH1122_OLED_Max_Row) {
-                oled_row = 0;
-
-            } else {
-                oled_row++;
-            }
-            oled_col = 0;
-        } else {
-            oled_col++;
-        }
+    if(event != EMU_OLED_FB_NO_EVENT) {
+        bool on = (event == EMU_OLED_FB_DISPLAY_ON);
+        postToObject([on]() { oled->set_display_on(on); }, oled);
+        emu_oled_capture_frame(emu_oled_fb_get(), NULL, on);
     }
 }
 
+/// what the widget shows, and the part of it not painted yet
 static QMutex fb_update;
-static uint8_t framebuffers[2][256*64];
-static int fb_next=0, fb_pending=-1;
+static uint8_t shown_fb[EMU_OLED_FB_WIDTH * EMU_OLED_FB_HEIGHT];
+static QRect fb_pending;
 
 void emu_oled_flush(void)
 {
+    emu_oled_rect_t damage;
+    const uint8_t *fb = emu_oled_fb_get();
+
     emu_appexit_test();
+
+    // transitions flush once per row or column: only copy what changed
+    if(!emu_oled_fb_take_damage(&damage))
+        return;
+    emu_oled_capture_frame(fb, &damage, emu_oled_fb_is_display_on() != FALSE);
+
+    QRect rect(damage.x, damage.y, damage.width, damage.height);
     fb_update.lock();
-    if(fb_pending >= 0) {
-        // an update is queued, just replace the contents
-        memcpy(framebuffers[fb_pending], oled_fb, 256*64);
-
-    } else {
-        // request an update
-        int fb_req = fb_next;
-        memcpy(framebuffers[fb_next], oled_fb, 256*64);
-        fb_pending = fb_req;
-        fb_next = (fb_next+1)%2;
-
-        // use a timer to coalesce multiple repaints 
-        QTimer::singleShot(2, oled, [fb_req]() {
+    for(int y = rect.top(); y <= rect.bottom(); y++)
+        memcpy(&shown_fb[EMU_OLED_FB_WIDTH * y + rect.x()], &fb[EMU_OLED_FB_WIDTH * y + rect.x()], rect.width());
+
+    // an update is queued: it will also cover this rect
+    bool queued = !fb_pending.isNull();
+    fb_pending |= rect;
+    fb_update.unlock();
+
+    if(!queued) {
+        // use a timer to coalesce multiple repaints
+        QTimer::singleShot(2, oled, []() {
             fb_update.lock();
-            if(fb_req == fb_pending)
-                fb_pending = -1;
+            oled->update_display(shown_fb, fb_pending);
+            fb_pending = QRect();
             fb_update.unlock();
-            oled->update_display(framebuffers[fb_req]);
         });
     }
-
-    fb_update.unlock();
 }
 
-OLEDWidget::OLEDWidget(): display(256, 64, QImage::Format_RGB888) {
+OLEDWidget::OLEDWidget(): display(EMU_OLED_FB_WIDTH, EMU_OLED_FB_HEIGHT, QImage::Format_RGB888) {
+    // pixels are only converted once damaged, start from a blank panel like the framebuffer
+    display.fill(Qt::black);
     setMinimumSize(display.size());
     setMaximumSize(display.size());
 }
@@ -131,16 +82,18 @@ OLEDWidget::~OLEDWidget() {
     QApplication::removePostedEvents(this);
 }
 
-void OLEDWidget::update_display(const uint8_t *fb) {
-    uint8_t *optr = display.bits();
+void OLEDWidget::update_display(const uint8_t *fb, const QRect &rect) {
+    for(int y=rect.top();y<=rect.bottom();y++) {
+        const uint8_t *iptr = &fb[EMU_OLED_FB_WIDTH * y + rect.x()];
+        uint8_t *optr = display.scanLine(y) + rect.x()*3;
 
-    for(int y=0;y<64;y++)
-        for(int x=0;x<256;x++) {
-            optr[0] = optr[1] = optr[2] = *fb++;
+        for(int x=0;x<rect.width();x++) {
+            optr[0] = optr[1] = optr[2] = *iptr++;
             optr+=3;
         }
-   
-    repaint();
+    }
+
+    update(rect);
 }
 
 void OLEDWidget::set_display_on(bool on) {
@@ -148,12 +101,13 @@ void OLEDWidget::set_display_on(bool on) {
     repaint();
 }
 
-void OLEDWidget::paintEvent(QPaintEvent *) {
+void OLEDWidget::paintEvent(QPaintEvent *evt) {
+    // the widget has the size of the display
     QPainter painter(this);
     if(display_on)
-        painter.drawImage(QRect(0, 0, width(), height()), display, QRect(0, 0, display.width(), display.height()));
+        painter.drawImage(evt->rect(), display, evt->rect());
     else
-        painter.eraseRect(QRect(0, 0, width(), height()));
+        painter.eraseRect(evt->rect());
 }
 
 // see INPUTS/inputs.c
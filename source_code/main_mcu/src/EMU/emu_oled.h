@@ -14,7 +14,7 @@ public:
     OLEDWidget();
     ~OLEDWidget();
 
-    void update_display(const uint8_t *fb);
+    void update_display(const uint8_t *fb, const QRect &rect);
     void set_display_on(bool on);
 
 protected:
@@ -0,0 +1,123 @@
+#include "emu_oled_capture.h"
+extern "C" {
+#include "emulator.h"
+}
+
+#include <QDir>
+#include <QImage>
+
+#include <cstdio>
+#include <cstring>
+
+/* Raw stream: one record per frame, host endianness, then the full grayscale 8-bit frame.
+ * Frames are captured from the firmware thread on flush, only when a pixel changed. */
+
+#define EMU_OLED_CAPTURE_MAGIC      "MOFR"
+#define EMU_OLED_CAPTURE_VERSION    1
+
+typedef struct {
+    char magic[4];
+    uint16_t version;
+    uint16_t width;
+    uint16_t height;
+    uint16_t reserved;
+} emu_oled_capture_header_t;
+
+typedef struct {
+    uint64_t timestamp_us;
+    uint16_t x, y, width, height;
+    uint8_t display_on;
+    uint8_t reserved[7];
+} emu_oled_capture_record_t;
+
+static FILE *raw_file;
+static FILE *index_file;
+static QDir png_dir;
+static uint32_t nb_frames;
+static uint64_t first_frame_us, last_frame_us;
+
+bool emu_oled_capture_start(const QString & path)
+{
+    if(path.endsWith(".raw")) {
+        emu_oled_capture_header_t header = {{0}, EMU_OLED_CAPTURE_VERSION, EMU_OLED_FB_WIDTH, EMU_OLED_FB_HEIGHT, 0};
+
+        memcpy(header.magic, EMU_OLED_CAPTURE_MAGIC, sizeof(header.magic));
+        raw_file = fopen(path.toUtf8().constData(), "wb");
+        if(!raw_file) {
+            fprintf(stderr, "Can't create frame capture %s\n", path.toUtf8().constData());
+            return false;
+        }
+        fwrite(&header, sizeof(header), 1, raw_file);
+        return true;
+    }
+
+    png_dir = QDir(path);
+    if(!png_dir.mkpath(".") || !(index_file = fopen(png_dir.filePath("frames.csv").toUtf8().constData(), "w"))) {
+        fprintf(stderr, "Can't create frame capture directory %s\n", path.toUtf8().constData());
+        return false;
+    }
+    fprintf(index_file, "frame;timestamp_us;x;y;width;height;display_on\n");
+    return true;
+}
+
+bool emu_oled_capture_active(void)
+{
+    return raw_file || index_file;
+}
+
+void emu_oled_capture_frame(const uint8_t *fb, const emu_oled_rect_t *dirty, bool display_on)
+{
+    emu_oled_rect_t screen = {0, 0, EMU_OLED_FB_WIDTH, EMU_OLED_FB_HEIGHT};
+    uint64_t now_us = emu_get_elapsed_us();
+
+    if(!emu_oled_capture_active())
+        return;
+    if(!dirty)
+        dirty = &screen;
+
+    if(raw_file) {
+        emu_oled_capture_record_t record;
+
+        memset(&record, 0, sizeof(record));
+        record.timestamp_us = now_us;
+        record.x = dirty->x;
+        record.y = dirty->y;
+        record.width = dirty->width;
+        record.height = dirty->height;
+        record.display_on = display_on ? 1 : 0;
+        fwrite(&record, sizeof(record), 1, raw_file);
+        fwrite(fb, 1, EMU_OLED_FB_WIDTH * EMU_OLED_FB_HEIGHT, raw_file);
+    } else {
+        QImage image(fb, EMU_OLED_FB_WIDTH, EMU_OLED_FB_HEIGHT, EMU_OLED_FB_WIDTH, QImage::Format_Grayscale8);
+
+        /* what the panel shows: black while the display is off */
+        if(!display_on) {
+            image = QImage(EMU_OLED_FB_WIDTH, EMU_OLED_FB_HEIGHT, QImage::Format_Grayscale8);
+            image.fill(0);
+        }
+        image.save(png_dir.filePath(QString("frame_%1.png").arg(nb_frames, 6, 10, QChar('0'))));
+        fprintf(index_file, "%u;%llu;%d;%d;%d;%d;%d\n", nb_frames, (unsigned long long)now_us,
+                dirty->x, dirty->y, dirty->width, dirty->height, display_on ? 1 : 0);
+    }
+
+    if(nb_frames++ == 0)
+        first_frame_us = now_us;
+    last_frame_us = now_us;
+}
+
+/* same output format as the other emulator benchmarks */
+void emu_oled_capture_stop(void)
+{
+    if(!emu_oled_capture_active())
+        return;
+
+    if(raw_file)
+        fclose(raw_file);
+    if(index_file)
+        fclose(index_file);
+    raw_file = index_file = NULL;
+
+    printf("frames;first_us;last_us\n");
+    printf("%u;%llu;%llu\n", nb_frames, (unsigned long long)first_frame_us, (unsigned long long)last_frame_us);
+    fflush(stdout);
+}
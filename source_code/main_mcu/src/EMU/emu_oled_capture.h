@@ -0,0 +1,16 @@
+#ifndef EMU_OLED_CAPTURE_H
+#define EMU_OLED_CAPTURE_H
+
+#include <QString>
+#include "emu_oled_fb.h"
+
+/* Every displayed frame with its emu_get_elapsed_us() timestamp, for counting frames and
+ * timing animations without a window. A .raw path gets all frames in a single stream,
+ * anything else is a directory of PNG files with a frames.csv index, see emu_oled_capture.cpp */
+bool emu_oled_capture_start(const QString & path);
+bool emu_oled_capture_active(void);
+/* NULL dirty: the whole screen, eg display on/off */
+void emu_oled_capture_frame(const uint8_t *fb, const emu_oled_rect_t *dirty, bool display_on);
+void emu_oled_capture_stop(void);
+
+#endif
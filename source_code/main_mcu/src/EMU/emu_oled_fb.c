@@ -0,0 +1,118 @@
+#include "emu_oled_fb.h"
+#include <asf.h>
+#include "platform_defines.h"
+#include "sh1122.h"
+
+static uint8_t oled_fb[EMU_OLED_FB_WIDTH * EMU_OLED_FB_HEIGHT];
+static int oled_col, oled_row;
+static BOOL oled_display_on = TRUE;
+
+/* damaged pixels since the last take, inclusive bounds */
+static BOOL damaged;
+static int damage_x0, damage_y0, damage_x1, damage_y1;
+
+static void emu_oled_fb_damage(int x, int y)
+{
+    if(!damaged) {
+        damaged = TRUE;
+        damage_x0 = damage_x1 = x;
+        damage_y0 = damage_y1 = y;
+        return;
+    }
+
+    if(x < damage_x0) damage_x0 = x;
+    if(x > damage_x1) damage_x1 = x;
+    if(y < damage_y0) damage_y0 = y;
+    if(y > damage_y1) damage_y1 = y;
+}
+
+int emu_oled_fb_byte(uint8_t data)
+{
+    static int cmdargs = 0;
+    static uint8_t last_cmd = 0;
+
+    if(PORT->Group[OLED_CD_GROUP].OUTCLR.reg == OLED_CD_MASK) {
+        // command byte
+        if(cmdargs == 0) {
+            last_cmd = data;
+            switch(data) {
+            case SH1122_CMD_SET_HIGH_COLUMN_ADDR ... SH1122_CMD_SET_HIGH_COLUMN_ADDR+15:
+                oled_col = (oled_col & 0xf) | ((data & 0xf) << 4);
+                break;
+            case SH1122_CMD_SET_LOW_COLUMN_ADDR ... SH1122_CMD_SET_LOW_COLUMN_ADDR+15:
+                oled_col = (oled_col & 0xf0) | (data & 0xf);
+                break;
+            case SH1122_CMD_SET_ROW_ADDR:
+            case SH1122_CMD_SET_CLOCK_DIVIDER:
+            case SS1122_CMD_SET_DISCHARGE_PRECHARGE_PERIOD:
+            case SH1122_CMD_SET_CONTRAST_CURRENT:
+            case SH1122_CMD_SET_DISPLAY_OFFSET:
+            case SH1122_CMD_SET_VCOM_DESELECT_LEVEL:
+            case SH1122_CMD_SET_VSEGM_LEVEL:
+                cmdargs = 1;
+                break;
+            case SH1122_CMD_SET_DISPLAY_ON:
+                oled_display_on = TRUE;
+                return EMU_OLED_FB_DISPLAY_ON;
+            case SH1122_CMD_SET_DISPLAY_OFF:
+                oled_display_on = FALSE;
+                return EMU_OLED_FB_DISPLAY_OFF;
+            }
+
+        } else {
+            if(cmdargs == 1 && last_cmd == SH1122_CMD_SET_ROW_ADDR) {
+                oled_row = data;
+            }
+
+            cmdargs--;
+        }
+    } else {
+        // data byte: two pixels, only damaged when they change
+        uint8_t *pixels = &oled_fb[EMU_OLED_FB_WIDTH * oled_row + oled_col*2];
+        uint8_t left = data & 0xf0, right = (data & 0x0f) << 4;
+
+        if(pixels[0] != left || pixels[1] != right) {
+            pixels[0] = left;
+            pixels[1] = right;
+            emu_oled_fb_damage(oled_col*2, oled_row);
+            emu_oled_fb_damage(oled_col*2 + 1, oled_row);
+        }
+
+        if(oled_col == SH1122_OLED_Max_Column) {
+            if(oled_row == SH1122_OLED_Max_Row) {
+                oled_row = 0;
+
+            } else {
+                oled_row++;
+            }
+            oled_col = 0;
+        } else {
+            oled_col++;
+        }
+    }
+
+    return EMU_OLED_FB_NO_EVENT;
+}
+
+BOOL emu_oled_fb_take_damage(emu_oled_rect_t *rect)
+{
+    if(!damaged)
+        return FALSE;
+
+    rect->x = damage_x0;
+    rect->y = damage_y0;
+    rect->width = damage_x1 - damage_x0 + 1;
+    rect->height = damage_y1 - damage_y0 + 1;
+    damaged = FALSE;
+    return TRUE;
+}
+
+const uint8_t *emu_oled_fb_get(void)
+{
+    return oled_fb;
+}
+
+BOOL emu_oled_fb_is_display_on(void)
+{
+    return oled_display_on;
+}
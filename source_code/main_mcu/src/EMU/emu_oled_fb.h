@@ -0,0 +1,33 @@
+#ifndef EMU_OLED_FB_H
+#define EMU_OLED_FB_H
+#include <inttypes.h>
+#include "defines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EMU_OLED_FB_WIDTH       256
+#define EMU_OLED_FB_HEIGHT      64
+
+/* what emu_oled_fb_byte() saw besides pixels */
+#define EMU_OLED_FB_NO_EVENT        0
+#define EMU_OLED_FB_DISPLAY_ON      1
+#define EMU_OLED_FB_DISPLAY_OFF     2
+
+typedef struct {
+    int x, y, width, height;
+} emu_oled_rect_t;
+
+/* The SH1122 as seen from the spi bus, grayscale 8-bit. Data writes that change a pixel
+ * grow the damaged rectangle, which the display & frame capture take on each flush. */
+int emu_oled_fb_byte(uint8_t data);
+BOOL emu_oled_fb_take_damage(emu_oled_rect_t *rect);
+const uint8_t *emu_oled_fb_get(void);
+BOOL emu_oled_fb_is_display_on(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,98 @@
+#include "emu_session.h"
+#include "smartcard_highlevel.h"
+#include "smartcard_lowlevel.h"
+#include "logic_encryption.h"
+#include "logic_security.h"
+#include "driver_timer.h"
+#include "logic_device.h"
+#include "logic_user.h"
+#include "custom_fs.h"
+#include "nodemgmt.h"
+
+#include <string.h>
+
+/* bump when the layout changes, older snapshots are then refused */
+#define EMU_SESSION_VERSION 1
+
+typedef struct {
+    uint32_t version;
+    uint32_t rtc_cnt;
+    uint32_t rtc_last_set_timestamp;
+    uint16_t current_date;
+    BOOL time_set;
+    BOOL user_logged_in;
+    nodemgmtHandle_t nodemgmt_handle;
+} emu_session_t;
+
+extern nodemgmtHandle_t nodemgmt_current_handle;
+
+static emu_session_t pending_session;
+static BOOL pending_session_valid;
+
+uint32_t emu_session_get_size(void)
+{
+    return sizeof(emu_session_t);
+}
+
+/* only called while the firmware thread is stopped */
+void emu_session_capture(uint8_t *buffer)
+{
+    emu_session_t session;
+
+    memset(&session, 0, sizeof(session));
+    session.version = EMU_SESSION_VERSION;
+    timer_get_emulated_rtc_state(&session.rtc_cnt, &session.rtc_last_set_timestamp);
+    session.current_date = nodemgmt_get_current_date();
+    session.time_set = logic_device_is_time_set();
+    session.user_logged_in = logic_security_is_smc_inserted_unlocked();
+    memcpy(&session.nodemgmt_handle, &nodemgmt_current_handle, sizeof(session.nodemgmt_handle));
+
+    memcpy(buffer, &session, sizeof(session));
+}
+
+/* applied by the firmware once booted, see emu_session_restore() */
+BOOL emu_session_set_pending(const uint8_t *buffer, uint32_t size)
+{
+    if(size != sizeof(pending_session))
+        return FALSE;
+
+    memcpy(&pending_session, buffer, sizeof(pending_session));
+    pending_session_valid = (pending_session.version == EMU_SESSION_VERSION)? TRUE:FALSE;
+    return pending_session_valid;
+}
+
+/* Called at boot: restores the clock, then the user session if there was one.
+ * Secrets are not part of the snapshot: the card is restored unlocked, as it was when the
+ * snapshot was taken, so the encryption context is derived again like after a PIN entry. */
+BOOL emu_session_restore(void)
+{
+    uint8_t temp_buffer[AES_KEY_LENGTH/8];
+    cpz_lut_entry_t *cpz_user_entry;
+
+    if(pending_session_valid == FALSE)
+        return FALSE;
+    pending_session_valid = FALSE;
+
+    timer_set_emulated_rtc_state(pending_session.rtc_cnt, pending_session.rtc_last_set_timestamp);
+    nodemgmt_set_current_date(pending_session.current_date);
+    if(pending_session.time_set != FALSE)
+        logic_device_set_time_set();
+
+    if((pending_session.user_logged_in == FALSE) || (smartcard_low_level_is_smc_absent() == RETURN_OK))
+        return FALSE;
+
+    _Static_assert(sizeof(temp_buffer) >= SMARTCARD_CPZ_LENGTH, "Invalid buffer reuse");
+    smartcard_highlevel_read_code_protected_zone(temp_buffer);
+    if((custom_fs_get_cpz_lut_entry(temp_buffer, &cpz_user_entry) != RETURN_OK) || (cpz_user_entry->user_id != pending_session.nodemgmt_handle.currentUserId))
+        return FALSE;
+
+    logic_user_init_context(cpz_user_entry->user_id);
+    smartcard_highlevel_read_aes_key(temp_buffer);
+    logic_encryption_init_context(temp_buffer, cpz_user_entry);
+    logic_security_smartcard_unlocked_actions();
+    memset(temp_buffer, 0, sizeof(temp_buffer));
+
+    /* db changed flags & current category are not stored in flash */
+    memcpy(&nodemgmt_current_handle, &pending_session.nodemgmt_handle, sizeof(nodemgmt_current_handle));
+    return TRUE;
+}
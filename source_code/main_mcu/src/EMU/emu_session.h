@@ -0,0 +1,21 @@
+#ifndef EMU_SESSION_H
+#define EMU_SESSION_H
+#include <inttypes.h>
+#include "defines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Firmware side of the emulator snapshots: emulated RTC and logged in user session.
+ * The snapshot code only sees an opaque blob of emu_session_get_size() bytes. */
+uint32_t emu_session_get_size(void);
+void emu_session_capture(uint8_t *buffer);
+BOOL emu_session_set_pending(const uint8_t *buffer, uint32_t size);
+BOOL emu_session_restore(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
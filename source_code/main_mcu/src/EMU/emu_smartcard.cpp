@@ -86,3 +86,24 @@ bool emu_is_smartcard_inserted()
 {
     return card_present;
 }
+
+bool emu_get_smartcard_state(emu_smartcard_t *smartcard)
+{
+    QMutexLocker locker(&smc_mutex);
+    if(!card_present)
+        return false;
+
+    memcpy(smartcard, &card, sizeof(card));
+    return true;
+}
+
+/* snapshot restore: the card keeps its unlocked state and has no backing file */
+void emu_insert_smartcard_state(const emu_smartcard_t *smartcard)
+{
+    QMutexLocker locker(&smc_mutex);
+    smartcardFile.close();
+    smartcardFile.setFileName(QString());
+
+    memcpy(&card, smartcard, sizeof(card));
+    card_present = true;
+}
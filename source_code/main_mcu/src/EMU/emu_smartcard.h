@@ -26,7 +26,7 @@ void emu_close_smartcard(BOOL written);
 
 enum { EMU_SMARTCARD_REGULAR, EMU_SMARTCARD_INVALID, EMU_SMARTCARD_BROKEN };
 void emu_init_smartcard(struct emu_smartcard_storage_t *smartcard, int smartcard_type);
-void emu_reset_smartcard();
+void emu_reset_smartcard(void);
 
 #ifdef __cplusplus
 
@@ -34,6 +34,8 @@ bool emu_insert_smartcard(QString filePath);
 bool emu_insert_new_smartcard(QString filePath, int smartcard_type = EMU_SMARTCARD_REGULAR);
 void emu_remove_smartcard();
 bool emu_is_smartcard_inserted();
+bool emu_get_smartcard_state(emu_smartcard_t *smartcard);
+void emu_insert_smartcard_state(const emu_smartcard_t *smartcard);
 
 
 }
@@ -0,0 +1,115 @@
+#include "emu_snapshot.h"
+#include "emu_smartcard.h"
+#include "emu_session.h"
+#include "emu_storage.h"
+
+#include <QSaveFile>
+#include <QDebug>
+#include <QFile>
+
+#include <string.h>
+#include <vector>
+
+#define EMU_SNAPSHOT_MAGIC      "MBLESNAP"
+#define EMU_SNAPSHOT_VERSION    1
+/* images are page aligned in the file so that they can be mapped in place */
+#define EMU_SNAPSHOT_ALIGN      4096
+
+struct emu_snapshot_header_t {
+    char magic[8];
+    uint32_t version;
+    uint32_t session_size;
+    uint64_t eeprom_offset;
+    uint32_t eeprom_size;
+    uint32_t smartcard_present;
+    uint64_t dbflash_offset;
+    uint32_t dbflash_size;
+    uint32_t reserved;
+    emu_smartcard_t smartcard;
+};
+
+static uint64_t emu_snapshot_align(uint64_t offset)
+{
+    return (offset + EMU_SNAPSHOT_ALIGN - 1) & ~(uint64_t)(EMU_SNAPSHOT_ALIGN - 1);
+}
+
+static bool emu_snapshot_write_at(QSaveFile & file, uint64_t offset, const void *data, uint32_t size)
+{
+    /* padding between sections is never read */
+    return file.seek(offset) && file.write((const char *)data, size) == size;
+}
+
+bool emu_snapshot_save(const QString & filename)
+{
+    emu_snapshot_header_t header;
+    const uint8_t *eeprom_image, *dbflash_image;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, EMU_SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = EMU_SNAPSHOT_VERSION;
+    header.session_size = emu_session_get_size();
+    header.smartcard_present = emu_get_smartcard_state(&header.smartcard);
+
+    eeprom_image = emu_storage_get_eeprom_image(&header.eeprom_size);
+    dbflash_image = emu_storage_get_dbflash_image(&header.dbflash_size);
+    if(!eeprom_image || !dbflash_image) {
+        qWarning() << "Storage isn't open, can't take a snapshot";
+        return false;
+    }
+
+    std::vector<uint8_t> session(header.session_size);
+    emu_session_capture(session.data());
+
+    /* header, session blob, eeprom, dbflash */
+    header.eeprom_offset = emu_snapshot_align(sizeof(header) + header.session_size);
+    header.dbflash_offset = emu_snapshot_align(header.eeprom_offset + header.eeprom_size);
+
+    /* written aside then renamed: workers may be mapping the previous snapshot */
+    QSaveFile file(filename);
+    if(!file.open(QIODevice::WriteOnly) ||
+       !emu_snapshot_write_at(file, 0, &header, sizeof(header)) ||
+       !emu_snapshot_write_at(file, sizeof(header), session.data(), header.session_size) ||
+       !emu_snapshot_write_at(file, header.eeprom_offset, eeprom_image, header.eeprom_size) ||
+       !emu_snapshot_write_at(file, header.dbflash_offset, dbflash_image, header.dbflash_size) ||
+       !file.commit()) {
+        qWarning() << "Failed to write snapshot" << filename;
+        return false;
+    }
+
+    return true;
+}
+
+bool emu_snapshot_load(const QString & filename)
+{
+    emu_snapshot_header_t header;
+    uint32_t eeprom_size, dbflash_size;
+    QFile file(filename);
+
+    if(!file.open(QIODevice::ReadOnly) || file.read((char *)&header, sizeof(header)) != sizeof(header)) {
+        qWarning() << "Failed to read snapshot" << filename;
+        return false;
+    }
+
+    /* the images must match what this build emulates */
+    emu_storage_get_eeprom_image(&eeprom_size);
+    emu_storage_get_dbflash_image(&dbflash_size);
+    if(memcmp(header.magic, EMU_SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 || header.version != EMU_SNAPSHOT_VERSION ||
+       header.eeprom_size != eeprom_size || header.dbflash_size != dbflash_size ||
+       (uint64_t)file.size() < header.dbflash_offset + header.dbflash_size) {
+        qWarning() << "Invalid or incompatible snapshot" << filename;
+        return false;
+    }
+
+    std::vector<uint8_t> session(header.session_size);
+    if(file.read((char *)session.data(), header.session_size) != header.session_size ||
+       !emu_session_set_pending(session.data(), header.session_size)) {
+        qWarning() << "Incompatible session in snapshot" << filename;
+        return false;
+    }
+
+    if(header.smartcard_present)
+        emu_insert_smartcard_state(&header.smartcard);
+
+    emu_storage_use_snapshot(filename.toUtf8().constData(), header.eeprom_offset, header.dbflash_offset);
+    return true;
+}
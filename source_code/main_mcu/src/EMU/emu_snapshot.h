@@ -0,0 +1,11 @@
+#ifndef EMU_SNAPSHOT_H
+#define EMU_SNAPSHOT_H
+
+#include <QString>
+
+/* Whole device state in one file: eeprom & dbflash images, smartcard, RTC and user session.
+ * Loading maps the images copy-on-write, so any number of emulators can start from one file. */
+bool emu_snapshot_load(const QString & filename);
+bool emu_snapshot_save(const QString & filename);
+
+#endif
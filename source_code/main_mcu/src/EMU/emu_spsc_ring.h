@@ -0,0 +1,69 @@
+#ifndef EMU_SPSC_RING_H
+#define EMU_SPSC_RING_H
+
+#include <atomic>
+#include <stddef.h>
+#include <string.h>
+
+/* Lock-free byte ring with exactly one producer thread and one consumer thread.
+ * Indexes run freely and are only masked on access, so head - tail is the fill level. */
+template <size_t SIZE>
+class EmuSpscRing {
+    static_assert((SIZE & (SIZE - 1)) == 0, "ring size must be a power of two");
+
+public:
+    /* producer side: returns the number of bytes actually queued */
+    size_t push(const char *data, size_t size) {
+        size_t head = head_idx.load(std::memory_order_relaxed);
+        size_t room = SIZE - (head - tail_idx.load(std::memory_order_acquire));
+        if(size > room)
+            size = room;
+
+        size_t offset = head & (SIZE - 1);
+        size_t first = SIZE - offset < size ? SIZE - offset : size;
+        memcpy(buf + offset, data, first);
+        memcpy(buf, data + first, size - first);
+
+        head_idx.store(head + size, std::memory_order_release);
+        return size;
+    }
+
+    /* producer side */
+    size_t room(void) const {
+        return SIZE - (head_idx.load(std::memory_order_relaxed) - tail_idx.load(std::memory_order_acquire));
+    }
+
+    /* consumer side: returns the number of bytes dequeued */
+    size_t pop(char *data, size_t size) {
+        size_t tail = tail_idx.load(std::memory_order_relaxed);
+        size_t fill = head_idx.load(std::memory_order_acquire) - tail;
+        if(size > fill)
+            size = fill;
+
+        size_t offset = tail & (SIZE - 1);
+        size_t first = SIZE - offset < size ? SIZE - offset : size;
+        memcpy(data, buf + offset, first);
+        memcpy(data + first, buf, size - first);
+
+        tail_idx.store(tail + size, std::memory_order_release);
+        return size;
+    }
+
+    /* consumer side */
+    size_t available(void) const {
+        return head_idx.load(std::memory_order_acquire) - tail_idx.load(std::memory_order_relaxed);
+    }
+
+    /* consumer side: drop everything queued so far */
+    void clear(void) {
+        tail_idx.store(head_idx.load(std::memory_order_acquire), std::memory_order_release);
+    }
+
+private:
+    char buf[SIZE];
+    /* keep the two indexes on separate cache lines, each is written by one thread only */
+    alignas(64) std::atomic<size_t> head_idx{0};
+    alignas(64) std::atomic<size_t> tail_idx{0};
+};
+
+#endif
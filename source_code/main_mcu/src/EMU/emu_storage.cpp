@@ -1,52 +1,119 @@
 #include "emu_storage.h"
+extern "C" {
+#include "dbflash.h"
+}
 
 #include <stdlib.h>
+#include <string.h>
 #include <QDebug>
 #include <QFile>
 
-static QFile eeprom("eeprom.bin");
-static QFile dbflash("dbflash.bin");
-static bool emu_open_flash(QFile & flashFile)
+#ifdef Q_OS_WIN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#define EMU_DBFLASH_SIZE    (PAGE_COUNT * BYTES_PER_PAGE)
+
+/* flash images are mapped in memory, durability only comes from the sync policy */
+struct emu_flash_image {
+    emu_flash_image(const char *filename, qint64 image_size): file(filename), size(image_size) {}
+
+    QFile file;
+    qint64 size;
+    uchar *map = nullptr;
+    bool dirty = false;
+    /* set when started from a snapshot: private mapping at that offset of the snapshot file */
+    qint64 snapshot_offset = -1;
+};
+
+static emu_flash_image eeprom("eeprom.bin", EMU_EEPROM_SIZE);
+static emu_flash_image dbflash("dbflash.bin", EMU_DBFLASH_SIZE);
+static emu_storage_sync_policy_te sync_policy = EMU_STORAGE_SYNC_ON_EXIT;
+static uint32_t dbflash_read_count;
+
+static void emu_sync_flash(emu_flash_image & image)
 {
-    if(!flashFile.open(QIODevice::ReadWrite)) {
-        qWarning() << "Failed to open emulated flash" << flashFile.fileName();
-        abort();
+    if(image.map) {
+#ifdef Q_OS_WIN
+        FlushViewOfFile(image.map, image.size);
+#else
+        msync(image.map, image.size, MS_SYNC);
+#endif
     }
-
-    return flashFile.size() > 0;
+    image.dirty = false;
 }
 
-static void emu_extend_flash(QFile & flashFile, int size)
+static void emu_close_flash(emu_flash_image & image)
 {
-    if(flashFile.size() < size) {
-        flashFile.seek(flashFile.size());
-        int extend_size = size - flashFile.size();
-        flashFile.write(QByteArray(extend_size, '\xff'));
+    if(image.map) {
+        emu_sync_flash(image);
+        image.file.unmap(image.map);
+        image.map = nullptr;
     }
-    
-    flashFile.flush();
+    image.file.close();
 }
 
-static void emu_flash_read(QFile & flashFile, int offset, uint8_t *buf, int length) 
+static bool emu_open_flash(emu_flash_image & image)
 {
-    if(flashFile.isOpen()) {
-        emu_extend_flash(flashFile, offset+length);
-        flashFile.seek(offset);
-        flashFile.read((char*)buf, length);
+    /* may be reopened, e.g. after a file name change */
+    emu_close_flash(image);
+
+    /* copy-on-write: the snapshot is shared by all emulators started from it and never written */
+    if(image.snapshot_offset >= 0) {
+        if(image.file.open(QIODevice::ReadOnly))
+            image.map = image.file.map(image.snapshot_offset, image.size, QFileDevice::MapPrivateOption);
+        if(!image.map) {
+            qWarning() << "Failed to map snapshot" << image.file.fileName();
+            abort();
+        }
+        return true;
+    }
+
+    if(!image.file.open(QIODevice::ReadWrite)) {
+        qWarning() << "Failed to open emulated flash" << image.file.fileName();
+        abort();
+    }
 
+    /* preallocate the whole chip, erased */
+    qint64 initial_size = image.file.size();
+    if(initial_size < image.size) {
+        image.file.seek(initial_size);
+        image.file.write(QByteArray(image.size - initial_size, '\xff'));
+        image.file.flush();
+    }
+
+    image.map = image.file.map(0, image.size);
+    if(!image.map) {
+        qWarning() << "Failed to map emulated flash" << image.file.fileName();
+        abort();
+    }
+
+    return initial_size > 0;
+}
+
+static void emu_flash_read(emu_flash_image & image, int offset, uint8_t *buf, int length)
+{
+    if(image.map && offset >= 0 && offset + length <= image.size) {
+        memcpy(buf, image.map + offset, length);
     } else {
         memset(buf, 0xff, length);
     }
 }
 
-static void emu_flash_write(QFile & flashFile, int offset, uint8_t *buf, int length)
+static void emu_flash_write(emu_flash_image & image, int offset, uint8_t *buf, int length)
 {
-    if(flashFile.isOpen()) {
-        emu_extend_flash(flashFile, offset+length);
-        flashFile.seek(offset);
-        flashFile.write((char*)buf, length);
-        flashFile.flush();
+    if(!image.map)
+        return;
+
+    if(offset < 0 || offset + length > image.size) {
+        qWarning() << "Write outside of emulated flash" << image.file.fileName() << offset << length;
+        return;
     }
+
+    memcpy(image.map + offset, buf, length);
+    image.dirty = true;
 }
 
 BOOL emu_eeprom_open()
@@ -71,6 +138,7 @@ BOOL emu_dbflash_open()
 
 void emu_dbflash_read(int offset, uint8_t *buf, int length)
 {
+    dbflash_read_count++;
     return emu_flash_read(dbflash, offset, buf, length);
 }
 
@@ -79,3 +147,65 @@ void emu_dbflash_write(int offset, uint8_t *buf, int length)
     return emu_flash_write(dbflash, offset, buf, length);
 }
 
+void emu_dbflash_set_filename(const char *filename)
+{
+    emu_close_flash(dbflash);
+    dbflash.file.setFileName(filename);
+    dbflash.snapshot_offset = -1;
+}
+
+uint32_t emu_dbflash_get_read_count(void)
+{
+    return dbflash_read_count;
+}
+
+void emu_storage_use_snapshot(const char *filename, uint64_t eeprom_offset, uint64_t dbflash_offset)
+{
+    emu_close_flash(eeprom);
+    emu_close_flash(dbflash);
+
+    eeprom.file.setFileName(filename);
+    eeprom.snapshot_offset = eeprom_offset;
+    dbflash.file.setFileName(filename);
+    dbflash.snapshot_offset = dbflash_offset;
+}
+
+const uint8_t *emu_storage_get_eeprom_image(uint32_t *size)
+{
+    *size = eeprom.size;
+    return eeprom.map;
+}
+
+const uint8_t *emu_storage_get_dbflash_image(uint32_t *size)
+{
+    *size = dbflash.size;
+    return dbflash.map;
+}
+
+void emu_storage_set_sync_policy(emu_storage_sync_policy_te policy)
+{
+    sync_policy = policy;
+}
+
+void emu_storage_command_done(void)
+{
+    if(sync_policy != EMU_STORAGE_SYNC_PER_COMMAND)
+        return;
+
+    if(eeprom.dirty)
+        emu_sync_flash(eeprom);
+    if(dbflash.dirty)
+        emu_sync_flash(dbflash);
+}
+
+void emu_storage_sync(void)
+{
+    emu_sync_flash(eeprom);
+    emu_sync_flash(dbflash);
+}
+
+void emu_storage_close(void)
+{
+    emu_close_flash(eeprom);
+    emu_close_flash(dbflash);
+}
@@ -3,10 +3,20 @@
 #include <inttypes.h>
 #include "defines.h"
 
+/* emulated eeprom: the custom storage slots of custom_fs.c, 128 slots of 256B */
+#define EMU_EEPROM_SIZE     (256 * 128)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/* when the mapped flash images are synced to disk */
+typedef enum {
+    EMU_STORAGE_SYNC_ON_EXIT = 0,
+    EMU_STORAGE_SYNC_PER_COMMAND = 1,
+    EMU_STORAGE_SYNC_PERIODIC = 2,
+} emu_storage_sync_policy_te;
+
 BOOL emu_eeprom_open(void);
 void emu_eeprom_read(int offset, uint8_t *buf, int length);
 void emu_eeprom_write(int offset, uint8_t *buf, int length);
@@ -14,6 +24,19 @@ void emu_eeprom_write(int offset, uint8_t *buf, int length);
 BOOL emu_dbflash_open(void);
 void emu_dbflash_read(int offset, uint8_t *buf, int length);
 void emu_dbflash_write(int offset, uint8_t *buf, int length);
+void emu_dbflash_set_filename(const char *filename);
+uint32_t emu_dbflash_get_read_count(void);
+
+/* start from a snapshot file: both images are privately mapped, so writes never reach the disk */
+void emu_storage_use_snapshot(const char *filename, uint64_t eeprom_offset, uint64_t dbflash_offset);
+/* current contents, NULL until the image is opened */
+const uint8_t *emu_storage_get_eeprom_image(uint32_t *size);
+const uint8_t *emu_storage_get_dbflash_image(uint32_t *size);
+
+void emu_storage_set_sync_policy(emu_storage_sync_policy_te policy);
+void emu_storage_command_done(void);
+void emu_storage_sync(void);
+void emu_storage_close(void);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,127 @@
+#include "emu_storage.h"
+#include "dbflash.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Qt-free flash images for the host benchmarks: same api as emu_storage.cpp, but the
+ * images only live in memory and every open starts from an erased chip. */
+
+#define EMU_DBFLASH_SIZE    (PAGE_COUNT * BYTES_PER_PAGE)
+
+struct emu_ram_image {
+    uint8_t *data;
+    uint32_t size;
+};
+
+static struct emu_ram_image eeprom = {NULL, EMU_EEPROM_SIZE};
+static struct emu_ram_image dbflash = {NULL, EMU_DBFLASH_SIZE};
+static uint32_t dbflash_read_count;
+
+static BOOL emu_ram_open(struct emu_ram_image *image)
+{
+    if(!image->data)
+        image->data = malloc(image->size);
+    if(!image->data)
+        abort();
+
+    memset(image->data, 0xff, image->size);
+    return FALSE;
+}
+
+static void emu_ram_read(struct emu_ram_image *image, int offset, uint8_t *buf, int length)
+{
+    if(image->data && offset >= 0 && (uint32_t)(offset + length) <= image->size) {
+        memcpy(buf, image->data + offset, length);
+    } else {
+        memset(buf, 0xff, length);
+    }
+}
+
+static void emu_ram_write(struct emu_ram_image *image, int offset, uint8_t *buf, int length)
+{
+    if(image->data && offset >= 0 && (uint32_t)(offset + length) <= image->size)
+        memcpy(image->data + offset, buf, length);
+}
+
+BOOL emu_eeprom_open(void)
+{
+    return emu_ram_open(&eeprom);
+}
+
+void emu_eeprom_read(int offset, uint8_t *buf, int length)
+{
+    emu_ram_read(&eeprom, offset, buf, length);
+}
+
+void emu_eeprom_write(int offset, uint8_t *buf, int length)
+{
+    emu_ram_write(&eeprom, offset, buf, length);
+}
+
+BOOL emu_dbflash_open(void)
+{
+    return emu_ram_open(&dbflash);
+}
+
+void emu_dbflash_read(int offset, uint8_t *buf, int length)
+{
+    dbflash_read_count++;
+    emu_ram_read(&dbflash, offset, buf, length);
+}
+
+void emu_dbflash_write(int offset, uint8_t *buf, int length)
+{
+    emu_ram_write(&dbflash, offset, buf, length);
+}
+
+/* nothing on disk */
+void emu_dbflash_set_filename(const char *filename)
+{
+    (void)filename;
+}
+
+uint32_t emu_dbflash_get_read_count(void)
+{
+    return dbflash_read_count;
+}
+
+void emu_storage_use_snapshot(const char *filename, uint64_t eeprom_offset, uint64_t dbflash_offset)
+{
+    (void)filename;
+    (void)eeprom_offset;
+    (void)dbflash_offset;
+}
+
+const uint8_t *emu_storage_get_eeprom_image(uint32_t *size)
+{
+    *size = eeprom.size;
+    return eeprom.data;
+}
+
+const uint8_t *emu_storage_get_dbflash_image(uint32_t *size)
+{
+    *size = dbflash.size;
+    return dbflash.data;
+}
+
+void emu_storage_set_sync_policy(emu_storage_sync_policy_te policy)
+{
+    (void)policy;
+}
+
+void emu_storage_command_done(void)
+{
+}
+
+void emu_storage_sync(void)
+{
+}
+
+void emu_storage_close(void)
+{
+    free(eeprom.data);
+    free(dbflash.data);
+    eeprom.data = NULL;
+    dbflash.data = NULL;
+}
@@ -13,13 +13,22 @@ extern "C" {
 #include <QSemaphore>
 #include <QMutex>
 #include <QTime>
-#include <QLocalSocket>
 #include <QCommandLineParser>
 #include <QElapsedTimer>
+#include <QDebug>
+
+#include <unistd.h>
 
 #include "emu_oled.h"
 #include "emu_smartcard.h"
+#include "emu_snapshot.h"
 #include "emu_dataflash.h"
+#include "emu_benchmark.h"
+#include "emu_hid_transport.h"
+#include "emu_aux_fido2.h"
+#include "emu_hid_trace.h"
+#include "emu_oled_capture.h"
+#include "emu_storage.h"
 #include "emulator_ui.h"
 
 static struct emu_port_t _PORT;
@@ -53,26 +62,19 @@ static void pseudo_irq(void)
 
 extern "C" void minible_main();
 
+#define HID_IDLE_POLLS  64
+
 class AppThread: public QThread {
 private:
     QMutex appexit_mutex;
     bool app_exiting = false;
     QSemaphore app_thread_blocked;
 
-    QLocalSocket *hid;
-
-    bool reconnect_hid() {
-        if(hid->state() != QLocalSocket::ConnectedState) {
-            hid->connectToServer("moolticuted_local_dev");
-            hid->waitForConnected(10);
-        }
-        
-        return hid->state() == QLocalSocket::ConnectedState;
-    }
+    /* consecutive empty hid polls, the firmware is considered idle past a threshold */
+    int hid_idle_polls = 0;
 
 public:
     void run() {
-        hid = new QLocalSocket;
         minible_main();
     }
 
@@ -95,30 +97,21 @@ public:
     }
 
     void send_hid(char *data, int size) {
-        if(!reconnect_hid())
-            return;
-
-        while(size > 0) {
-            int nb = hid->write(data, size);
-            if(nb <= 0)
-                break;
-
-            data += nb;
-            size -= nb;
-
-            while(hid->bytesToWrite() > 0 && hid->state() == QLocalSocket::ConnectedState)
-                hid->waitForBytesWritten();
-        }
+        emu_hid_transport_send(data, size);
     }
 
     int rcv_hid(char *data, int size) {
         test_stop();
-        if(!reconnect_hid())
-            return -1;
-
-        hid->waitForReadyRead(0);
-        int nb = hid->read(data, size);
-        return nb > 0 ? nb : 0;
+        int nb = emu_hid_transport_rcv(data, size);
+
+        /* the main loop keeps polling us: only sleep once it has stopped finding work */
+        if(nb > 0) {
+            hid_idle_polls = 0;
+        } else if(++hid_idle_polls >= HID_IDLE_POLLS) {
+            hid_idle_polls = 0;
+            emu_hid_transport_wait(1);
+        }
+        return nb;
     }
 };
 
@@ -160,6 +153,21 @@ BOOL emu_get_systick(uint32_t *value)
     return wrapped;
 }
 
+uint64_t emu_get_elapsed_us(void)
+{
+    return systick_timer.nsecsElapsed() / 1000;
+}
+
+void emu_delay_us(uint32_t us)
+{
+    usleep(us);
+}
+
+void emu_idle_wait(void)
+{
+    /* wall clock: the 1ms timer moves time for us */
+}
+
 int main(int ac, char ** av)
 {
     // Qt needs to run on the main thread. We run the application code on a separate thread
@@ -177,12 +185,49 @@ int main(int ac, char ** av)
 
     parser.addOption(QCommandLineOption("smartcard", "Smartcard file to be used at startup", "smartcard"));
     parser.addOption(QCommandLineOption("bundle", "Specify path to bundle.img file", "bundle"));
+    parser.addOption(QCommandLineOption("snapshot", "Start from a snapshot, copy-on-write: changes are not written back to it", "snapshot"));
+    parser.addOption(QCommandLineOption("snapshot-save", "Save a snapshot of the device when exiting", "snapshot"));
+    parser.addOption(QCommandLineOption("bench-db-search", "Benchmark service searches against database size, then exit"));
+    parser.addOption(QCommandLineOption("bench-db-insert", "Benchmark service inserts until the database is full, then exit"));
+    parser.addOption(QCommandLineOption("bench-node-sync", "Benchmark single, vectored and range node reads & writes in management mode, then exit"));
+    parser.addOption(QCommandLineOption("bench-hid", "Benchmark the hid transport against a local moolticute stand-in, then exit"));
+    parser.addOption(QCommandLineOption("storage-sync", "When to sync the eeprom & dbflash images to disk: exit, command or periodic", "policy", "exit"));
+    parser.addOption(QCommandLineOption("storage-sync-period", "Sync period in ms for the periodic storage sync policy", "ms", "1000"));
+    parser.addOption(QCommandLineOption("hid-socket", "Local socket to connect to", "name", "moolticuted_local_dev"));
+    parser.addOption(QCommandLineOption("hid-record", "Record the host session into a hid trace file, to be replayed by the headless emulator", "trace"));
+    parser.addOption(QCommandLineOption("ctaphid-socket", "Local socket to serve CTAPHID on for software FIDO2 clients", "name"));
+    parser.addOption(QCommandLineOption("capture-frames", "Capture the display frames with their timestamps: a .raw file, or a directory of PNG files", "path"));
     parser.process(app);
 
+    QString storage_sync = parser.value("storage-sync");
+    if(storage_sync == "command") {
+        emu_storage_set_sync_policy(EMU_STORAGE_SYNC_PER_COMMAND);
+    } else if(storage_sync == "periodic") {
+        emu_storage_set_sync_policy(EMU_STORAGE_SYNC_PERIODIC);
+    } else if(storage_sync != "exit") {
+        qWarning() << "Unknown storage sync policy" << storage_sync;
+        return 1;
+    }
+
+    if(parser.isSet("bench-db-search"))
+        return emu_benchmark_db_search();
+    if(parser.isSet("bench-db-insert"))
+        return emu_benchmark_db_insert();
+    if(parser.isSet("bench-node-sync"))
+        return emu_benchmark_node_sync();
+    if(parser.isSet("bench-hid"))
+        return emu_benchmark_hid_transport();
+
     QTimer ms_timer;
     ms_timer.setInterval(1);
     ms_timer.start();
 
+    QTimer storage_sync_timer;
+    if(storage_sync == "periodic") {
+        QObject::connect(&storage_sync_timer, &QTimer::timeout, emu_storage_sync);
+        storage_sync_timer.start(parser.value("storage-sync-period").toInt());
+    }
+
     QObject::connect(&ms_timer, &QTimer::timeout, [] () {
         if (true)
         {
@@ -203,17 +248,35 @@ int main(int ac, char ** av)
     if(parser.isSet("smartcard"))
         emu_insert_smartcard(parser.value("smartcard"));
 
+    if(parser.isSet("snapshot") && !emu_snapshot_load(parser.value("snapshot")))
+        return 1;
+
     emu_dataflash_init(parser.value("bundle").toUtf8().constData());
 
     EmuWindow emu_window;
     emu_window.show();
 
     oled->show();
+    if(parser.isSet("hid-record") && !emu_hid_trace_record_open(parser.value("hid-record").toUtf8().constData()))
+        return 1;
+    if(parser.isSet("capture-frames") && !emu_oled_capture_start(parser.value("capture-frames")))
+        return 1;
+
+    emu_hid_transport_start(parser.value("hid-socket"));
+    if(parser.isSet("ctaphid-socket"))
+        emu_aux_fido2_start(parser.value("ctaphid-socket"));
     app_thread.start();
 
     app.exec();
 
     app_thread.stop();
+    emu_aux_fido2_stop();
+    emu_hid_transport_stop();
+    emu_hid_trace_close();
+    emu_oled_capture_stop();
+    if(parser.isSet("snapshot-save"))
+        emu_snapshot_save(parser.value("snapshot-save"));
+    emu_storage_close();
 
     delete oled;
     return 0;
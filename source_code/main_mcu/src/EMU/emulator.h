@@ -23,6 +23,9 @@ BOOL emu_get_usb_charging(void);
 void emu_charger_enable(BOOL en);
 
 BOOL emu_get_systick(uint32_t *value);
+uint64_t emu_get_elapsed_us(void);
+/* firmware idle waits, only the headless build uses these to move its virtual clock (busy waits: emu_delay_us() in driver_timer.h) */
+void emu_idle_wait(void);
 
 BOOL emu_get_lefthanded(void);
 
@@ -0,0 +1,296 @@
+extern "C" {
+#include "asf.h"
+#include "driver_timer.h"
+#include "emulator.h"
+#include "logic_power.h"
+}
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFileInfo>
+#include <QDebug>
+
+#include <csignal>
+#include <cstdlib>
+
+#include "emu_smartcard.h"
+#include "emu_snapshot.h"
+#include "emu_dataflash.h"
+#include "emu_fleet.h"
+#include "emu_hid_transport.h"
+#include "emu_aux_fido2.h"
+#include "emu_hid_trace.h"
+#include "emu_oled_capture.h"
+#include "emu_storage.h"
+
+/* Headless emulator: no display, no event loop, and a virtual clock that only moves
+ * when the firmware waits, so regression runs don't depend on the host load. */
+
+static struct emu_port_t _PORT;
+struct emu_port_t *PORT=&_PORT;
+
+/* everything runs on a single thread, "interrupts" are delivered when the clock moves */
+void cpu_irq_enter_critical(void) {}
+void cpu_irq_leave_critical(void) {}
+
+extern "C" void minible_main();
+
+static volatile std::sig_atomic_t exit_requested;
+
+static uint64_t virtual_us;
+static uint64_t last_systick;
+static uint32_t storage_sync_period_ms;
+static QString snapshot_save_filename;
+static bool replaying;
+static bool capturing_frames;
+
+static int battery_level = 75;
+static bool usb_charging = false;
+
+static void emu_exit_signal(int)
+{
+    exit_requested = 1;
+}
+
+static void emu_ms_tick(void)
+{
+    uint64_t now_ms = virtual_us / 1000;
+
+    timer_ms_tick();
+    logic_power_ms_tick();
+
+    /* same charging speed as the ui slider */
+    if(usb_charging && battery_level < 100 && now_ms % 500 == 0)
+        battery_level = battery_level + 5 > 100 ? 100 : battery_level + 5;
+
+    if(storage_sync_period_ms && now_ms % storage_sync_period_ms == 0)
+        emu_storage_sync();
+}
+
+static void emu_advance_us(uint64_t us)
+{
+    while(us > 0) {
+        uint64_t step = 1000 - virtual_us % 1000;
+        if(step > us)
+            step = us;
+
+        virtual_us += step;
+        us -= step;
+        if(virtual_us % 1000 == 0)
+            emu_ms_tick();
+    }
+}
+
+void emu_delay_us(uint32_t us)
+{
+    emu_advance_us(us);
+}
+
+void emu_idle_wait(void)
+{
+    /* jump straight to the next timer deadline */
+    uint32_t nb_ms = timer_get_ms_to_next_deadline();
+    emu_advance_us((nb_ms != 0 ? nb_ms : 1) * (uint64_t)1000);
+}
+
+BOOL emu_get_systick(uint32_t *value)
+{
+    // microseconds to 48MHz ticks
+    uint64_t systick = virtual_us * (uint64_t)48;
+    BOOL wrapped = FALSE;
+    if((systick & 0xffffff) != (last_systick & 0xffffff))
+        wrapped = TRUE;
+
+    *value = systick & 0xffffff;
+    last_systick = systick;
+    return wrapped;
+}
+
+uint64_t emu_get_elapsed_us(void)
+{
+    return virtual_us;
+}
+
+void emu_appexit_test(void)
+{
+    if(exit_requested || emu_hid_trace_replay_done()) {
+        emu_aux_fido2_stop();
+        emu_hid_transport_stop();
+        emu_hid_trace_close();
+        emu_oled_capture_stop();
+        if(!snapshot_save_filename.isEmpty())
+            emu_snapshot_save(snapshot_save_filename);
+        emu_storage_close();
+        exit(0);
+    }
+}
+
+void emu_send_hid(char *data, int size)
+{
+    emu_hid_transport_send(data, size);
+}
+
+int emu_rcv_hid(char *data, int size)
+{
+    emu_appexit_test();
+
+    /* nothing pending: sleep a little instead of spinning, the clock doesn't move meanwhile.
+     * Replays run as fast as possible, and without moolticute */
+    if(replaying)
+        return 0;
+
+    int nb = emu_hid_transport_rcv(data, size);
+    if(nb <= 0 && emu_hid_transport_wait(1))
+        nb = emu_hid_transport_rcv(data, size);
+
+    return nb;
+}
+
+/* no ui: fixed platform state */
+int emu_get_battery_level(void)
+{
+    return battery_level;
+}
+
+BOOL emu_get_usb_charging(void)
+{
+    return TRUE;
+}
+
+void emu_charger_enable(BOOL en)
+{
+    usb_charging = en;
+}
+
+BOOL emu_get_lefthanded(void)
+{
+    return FALSE;
+}
+
+int emu_get_failure_flags(void)
+{
+    return 0;
+}
+
+/* no display and no wheel, see emu_oled.cpp: the framebuffer is only emulated for frame captures */
+extern "C" void emu_oled_byte(uint8_t data);
+extern "C" void emu_oled_flush(void);
+extern "C" void inputs_scan(void);
+
+extern "C" void emu_oled_byte(uint8_t data)
+{
+    if(capturing_frames && emu_oled_fb_byte(data) != EMU_OLED_FB_NO_EVENT)
+        emu_oled_capture_frame(emu_oled_fb_get(), NULL, emu_oled_fb_is_display_on() != FALSE);
+}
+
+extern "C" void emu_oled_flush(void)
+{
+    emu_oled_rect_t damage;
+
+    emu_appexit_test();
+    if(capturing_frames && emu_oled_fb_take_damage(&damage))
+        emu_oled_capture_frame(emu_oled_fb_get(), &damage, emu_oled_fb_is_display_on() != FALSE);
+}
+
+extern "C" void inputs_scan(void)
+{
+}
+
+int main(int ac, char ** av)
+{
+    QCoreApplication app(ac, av);
+
+    // ensure that the calendar works in UTC, so that time doesn't shift unpredictably
+    qputenv("TZ", "");
+
+    QCommandLineParser parser;
+    parser.addHelpOption();
+
+    parser.addOption(QCommandLineOption("smartcard", "Smartcard file to be used at startup", "smartcard"));
+    parser.addOption(QCommandLineOption("bundle", "Specify path to bundle.img file", "bundle"));
+    parser.addOption(QCommandLineOption("snapshot", "Start from a snapshot, copy-on-write: changes are not written back to it", "snapshot"));
+    parser.addOption(QCommandLineOption("snapshot-save", "Save a snapshot of the device when exiting", "snapshot"));
+    parser.addOption(QCommandLineOption("storage-sync", "When to sync the eeprom & dbflash images to disk: exit, command or periodic", "policy", "exit"));
+    parser.addOption(QCommandLineOption("storage-sync-period", "Sync period in virtual ms for the periodic storage sync policy", "ms", "1000"));
+    parser.addOption(QCommandLineOption("hid-socket", "Local socket to connect to, %1 is replaced by the instance id", "name", "moolticuted_local_dev"));
+    parser.addOption(QCommandLineOption("ctaphid-socket", "Local socket to serve CTAPHID on for software FIDO2 clients, %1 is replaced by the instance id", "name"));
+    parser.addOption(QCommandLineOption("hid-record", "Record the host session into a hid trace file", "trace"));
+    parser.addOption(QCommandLineOption("hid-replay", "Replay a hid trace instead of connecting to moolticute, print per command latencies and exit", "trace"));
+    parser.addOption(QCommandLineOption("capture-frames", "Capture the display frames with their virtual timestamps: a .raw file, or a directory of PNG files", "path"));
+    parser.addOption(QCommandLineOption("instances", "Number of emulated devices, each in its own process", "count", "1"));
+    parser.addOption(QCommandLineOption("instances-dir", "Directory holding one storage directory per instance", "dir", "instances"));
+    parser.process(app);
+
+    QString storage_sync = parser.value("storage-sync");
+    if(storage_sync == "command") {
+        emu_storage_set_sync_policy(EMU_STORAGE_SYNC_PER_COMMAND);
+    } else if(storage_sync == "periodic") {
+        emu_storage_set_sync_policy(EMU_STORAGE_SYNC_PERIODIC);
+        storage_sync_period_ms = parser.value("storage-sync-period").toUInt();
+    } else if(storage_sync != "exit") {
+        qWarning() << "Unknown storage sync policy" << storage_sync;
+        return 1;
+    }
+
+    /* workers run from their own directory: resolve the shared inputs first */
+    QString smartcard = parser.isSet("smartcard") ? QFileInfo(parser.value("smartcard")).absoluteFilePath() : QString();
+    QString snapshot = parser.isSet("snapshot") ? QFileInfo(parser.value("snapshot")).absoluteFilePath() : QString();
+    QString bundle = parser.isSet("bundle") ? QFileInfo(parser.value("bundle")).absoluteFilePath() : QString();
+    QString hid_replay = parser.isSet("hid-replay") ? QFileInfo(parser.value("hid-replay")).absoluteFilePath() : QString();
+    QString hid_socket = parser.value("hid-socket");
+    QString ctaphid_socket = parser.value("ctaphid-socket");
+
+    int nb_instances = parser.value("instances").toInt();
+    if(nb_instances < 1) {
+        qWarning() << "Invalid number of instances";
+        return 1;
+    }
+
+    int instance_id = 0;
+    if(nb_instances > 1) {
+        instance_id = emu_fleet_fork_workers(nb_instances, parser.value("instances-dir"));
+
+        /* each device writes to its own copy of the card, kept from one run to the next */
+        if(!smartcard.isEmpty()) {
+            QFile::copy(smartcard, "smartcard.bin");
+            smartcard = "smartcard.bin";
+        }
+    }
+
+    /* without %1, all instances connect to the same server as separate clients */
+    if(hid_socket.contains("%1"))
+        hid_socket = hid_socket.arg(instance_id);
+    if(ctaphid_socket.contains("%1"))
+        ctaphid_socket = ctaphid_socket.arg(instance_id);
+
+    if(!smartcard.isEmpty())
+        emu_insert_smartcard(smartcard);
+
+    if(!snapshot.isEmpty() && !emu_snapshot_load(snapshot))
+        return 1;
+    snapshot_save_filename = parser.value("snapshot-save");
+
+    emu_dataflash_init(bundle.toUtf8().constData());
+
+    /* minible_main() doesn't return: exit from the hid polling once asked to */
+    std::signal(SIGINT, emu_exit_signal);
+    std::signal(SIGTERM, emu_exit_signal);
+
+    if(parser.isSet("hid-record") && !emu_hid_trace_record_open(parser.value("hid-record").toUtf8().constData()))
+        return 1;
+
+    capturing_frames = parser.isSet("capture-frames");
+    if(capturing_frames && !emu_oled_capture_start(parser.value("capture-frames")))
+        return 1;
+
+    replaying = !hid_replay.isEmpty();
+    if(replaying && !emu_hid_trace_replay_open(hid_replay.toUtf8().constData()))
+        return 1;
+
+    if(!replaying)
+        emu_hid_transport_start(hid_socket);
+    if(!ctaphid_socket.isEmpty())
+        emu_aux_fido2_start(ctaphid_socket);
+    minible_main();
+    return 0;
+}
@@ -30,6 +30,7 @@
 #include "logic_device.h"
 #include "custom_fs.h"
 #include "dataflash.h"
+#include "profiler.h"
 #include "utils.h"
 #include "dma.h"
 #include "rng.h"
@@ -66,7 +67,9 @@ const uint8_t custom_fs_default_device_settings[NB_DEVICE_SETTINGS] = { 0,
                                                                         30,                                      // SETTINGS_INFORMATION_TIME_DELAY
                                                                         FALSE,                                   // SETTINGS_BLUETOOTH_SHORTCUTS
                                                                         0,                                       // SETTINGS_SCREEN_SAVER_ID
-                                                                        TRUE};                                   // SETTINGS_PREF_ST_SERV_FEATURE
+                                                                        TRUE,                                    // SETTINGS_PREF_ST_SERV_FEATURE
+                                                                        FALSE,                                   // SETTINGS_MERGE_MODIFIER_PRESS
+                                                                        FALSE};                                  // SETTINGS_PACK_KEY_PRESSES
 #ifndef EMULATOR_BUILD
 /* Pointer to the platform unique data, stored at the last page of our bootloader */
 platform_unique_data_t* custom_fs_plat_data_ptr = (platform_unique_data_t*)(FLASH_ADDR + APP_START_ADDR - NVMCTRL_ROW_SIZE);
@@ -91,10 +94,10 @@ cust_char_t custom_fs_temp_string1[64];
 cust_char_t custom_fs_temp_string2[64];
 /* Current language id */
 uint8_t custom_fs_cur_language_id = 0;
-/* Current keyboard layout id */
-custom_fs_address_t custom_fs_usb_keyboard_layout_addr = 0;
+/* Current keyboard layout id & RAM cached layouts */
+custom_fs_keyb_layout_cache_t custom_fs_usb_keyboard_layout;
 uint8_t custom_fs_cur_usb_keyboard_id = 0;
-custom_fs_address_t custom_fs_ble_keyboard_layout_addr = 0;
+custom_fs_keyb_layout_cache_t custom_fs_ble_keyboard_layout;
 uint8_t custom_fs_cur_ble_keyboard_id = 0;
 /* CPZ look up table */
 cpz_lut_entry_t* custom_fs_cpz_lut;
@@ -170,6 +173,8 @@ uint16_t custom_fs_get_platform_bundle_version(void)
 */
 RET_TYPE custom_fs_read_from_flash(uint8_t* datap, custom_fs_address_t address, uint32_t size)
 {
+    PROFILER_BEGIN(PROFILER_CUSTOM_FS_READ);
+    
     /* Check for emergency font file exception */
     if ((address >= CUSTOM_FS_EMERGENCY_FONT_FILE_ADDR) && (size <= sizeof(custom_fs_emergency_font_file)) && ((address-CUSTOM_FS_EMERGENCY_FONT_FILE_ADDR) + size <= sizeof(custom_fs_emergency_font_file)))
     {
@@ -180,6 +185,8 @@ RET_TYPE custom_fs_read_from_flash(uint8_t* datap, custom_fs_address_t address,
         dataflash_read_data_array(custom_fs_dataflash_desc, address, datap, size);
         //memcpy(datap, &mooltipass_bundle[address], size);
     }
+    
+    PROFILER_END(PROFILER_CUSTOM_FS_READ);
     return RETURN_OK;
 }
 
@@ -427,6 +434,146 @@ ret_type_te custom_fs_get_keyboard_descriptor_string(uint8_t keyboard_id, cust_c
     return RETURN_OK;
 }
 
+/*! \fn     custom_fs_add_keyboard_layout_ext_interval(custom_fs_keyb_layout_cache_t* layout_pt, uint16_t interval_start, uint16_t interval_end, uint16_t file_symbol_offset, uint16_t* nb_cached_symbols)
+*   \brief  Add an interval outside the dense range to a RAM cached keyboard layout, caching its symbols if they fit
+*   \param  layout_pt           Pointer to the cached layout
+*   \param  interval_start      First described point
+*   \param  interval_end        Last described point
+*   \param  file_symbol_offset  Offset of the interval start symbol in the layout file symbol table
+*   \param  nb_cached_symbols   Pointer to the number of symbols already stored in the cached symbol pool
+*/
+static void custom_fs_add_keyboard_layout_ext_interval(custom_fs_keyb_layout_cache_t* layout_pt, uint16_t interval_start, uint16_t interval_end, uint16_t file_symbol_offset, uint16_t* nb_cached_symbols)
+{
+    uint16_t nb_interval_symbols = interval_end - interval_start + 1;
+    uint16_t insert_index = layout_pt->nb_ext_intervals;
+    
+    /* Keep the intervals sorted */
+    while ((insert_index > 0) && (layout_pt->ext_intervals[insert_index-1].interval_start > interval_start))
+    {
+        layout_pt->ext_intervals[insert_index] = layout_pt->ext_intervals[insert_index-1];
+        insert_index--;
+    }
+    layout_pt->ext_intervals[insert_index].interval_start = interval_start;
+    layout_pt->ext_intervals[insert_index].interval_end = interval_end;
+    layout_pt->ext_intervals[insert_index].file_symbol_offset = file_symbol_offset;
+    layout_pt->ext_intervals[insert_index].cache_symbol_offset = CUSTOM_FS_KEYB_EXT_SYMB_NOT_CACHED;
+    layout_pt->nb_ext_intervals++;
+    
+    /* Cache symbols if there's still room in the pool, otherwise they'll be read from flash */
+    if ((*nb_cached_symbols + nb_interval_symbols) <= ARRAY_SIZE(layout_pt->ext_symbols))
+    {
+        custom_fs_read_from_flash((uint8_t*)&layout_pt->ext_symbols[*nb_cached_symbols], layout_pt->layout_address + CUSTOM_FS_KEYBOARD_DESC_LGTH*sizeof(cust_char_t) + CUSTOM_FS_KEYB_NB_INT_DESCRIBED*sizeof(unicode_interval_desc_t) + file_symbol_offset*sizeof(uint16_t), nb_interval_symbols*sizeof(uint16_t));
+        layout_pt->ext_intervals[insert_index].cache_symbol_offset = *nb_cached_symbols;
+        *nb_cached_symbols += nb_interval_symbols;
+    }
+}
+
+/*! \fn     custom_fs_load_keyboard_layout_cache(custom_fs_keyb_layout_cache_t* layout_pt, custom_fs_address_t layout_address)
+*   \brief  Decode a keyboard layout file into its RAM cache
+*   \param  layout_pt       Pointer to the cached layout
+*   \param  layout_address  Layout file address
+*   \note   The Latin range goes into a dense table, other described intervals into a sorted list
+*/
+static void custom_fs_load_keyboard_layout_cache(custom_fs_keyb_layout_cache_t* layout_pt, custom_fs_address_t layout_address)
+{
+    unicode_interval_desc_t description_intervals[CUSTOM_FS_KEYB_NB_INT_DESCRIBED];
+    uint16_t symbol_desc_pt_offset = 0;
+    uint16_t nb_cached_symbols = 0;
+    
+    /* Reset cache: points not described aren't supported */
+    memset(layout_pt->dense_symbols, 0xFF, sizeof(layout_pt->dense_symbols));
+    layout_pt->layout_address = layout_address;
+    layout_pt->nb_ext_intervals = 0;
+    
+    /* Load the layout flags and description intervals */
+    custom_fs_read_from_flash((uint8_t*)&layout_pt->layout_flags, layout_address + CUSTOM_FS_KEYB_FLAGS_DESC_INDEX*sizeof(cust_char_t), sizeof(layout_pt->layout_flags));
+    custom_fs_read_from_flash((uint8_t*)description_intervals, layout_address + CUSTOM_FS_KEYBOARD_DESC_LGTH*sizeof(cust_char_t), sizeof(description_intervals));
+    
+    /* Iterate over intervals */
+    for (uint16_t i = 0; i < ARRAY_SIZE(description_intervals); i++)
+    {
+        uint16_t interval_start = description_intervals[i].interval_start;
+        uint16_t interval_end = description_intervals[i].interval_end;
+        
+        if ((interval_start != 0xFFFF) && (interval_start <= interval_end))
+        {
+            /* Part of the interval in the dense range: read all its symbols at once */
+            if ((interval_start <= CUSTOM_FS_KEYB_DENSE_LAST_POINT) && (interval_end >= CUSTOM_FS_KEYB_DENSE_FIRST_POINT))
+            {
+                uint16_t dense_start = (interval_start < CUSTOM_FS_KEYB_DENSE_FIRST_POINT)? CUSTOM_FS_KEYB_DENSE_FIRST_POINT:interval_start;
+                uint16_t dense_end = (interval_end > CUSTOM_FS_KEYB_DENSE_LAST_POINT)? CUSTOM_FS_KEYB_DENSE_LAST_POINT:interval_end;
+                custom_fs_read_from_flash((uint8_t*)&layout_pt->dense_symbols[dense_start - CUSTOM_FS_KEYB_DENSE_FIRST_POINT], layout_address + CUSTOM_FS_KEYBOARD_DESC_LGTH*sizeof(cust_char_t) + sizeof(description_intervals) + (symbol_desc_pt_offset + dense_start - interval_start)*sizeof(uint16_t), (dense_end - dense_start + 1)*sizeof(uint16_t));
+            }
+            
+            /* Part below the dense range */
+            if (interval_start < CUSTOM_FS_KEYB_DENSE_FIRST_POINT)
+            {
+                uint16_t ext_end = (interval_end < CUSTOM_FS_KEYB_DENSE_FIRST_POINT)? interval_end:CUSTOM_FS_KEYB_DENSE_FIRST_POINT-1;
+                custom_fs_add_keyboard_layout_ext_interval(layout_pt, interval_start, ext_end, symbol_desc_pt_offset, &nb_cached_symbols);
+            }
+            
+            /* Part above the dense range */
+            if (interval_end > CUSTOM_FS_KEYB_DENSE_LAST_POINT)
+            {
+                uint16_t ext_start = (interval_start > CUSTOM_FS_KEYB_DENSE_LAST_POINT)? interval_start:CUSTOM_FS_KEYB_DENSE_LAST_POINT+1;
+                custom_fs_add_keyboard_layout_ext_interval(layout_pt, ext_start, interval_end, symbol_desc_pt_offset + ext_start - interval_start, &nb_cached_symbols);
+            }
+        }
+        
+        /* Add offset to descriptor */
+        symbol_desc_pt_offset += interval_end - interval_start + 1;
+    }
+}
+
+/*! \fn     custom_fs_get_keyboard_symbol_for_point(custom_fs_keyb_layout_cache_t* layout_pt, cust_char_t point, uint16_t* symbol_pt)
+*   \brief  Get the keyboard symbol for a given unicode point from a RAM cached keyboard layout
+*   \param  layout_pt   Pointer to the cached layout
+*   \param  point       The unicode point
+*   \param  symbol_pt   Where to store the symbol, 0xFFFF if not supported
+*   \return If support for this point is described by the layout
+*/
+static BOOL custom_fs_get_keyboard_symbol_for_point(custom_fs_keyb_layout_cache_t* layout_pt, cust_char_t point, uint16_t* symbol_pt)
+{
+    int16_t low_index = 0;
+    int16_t high_index = (int16_t)layout_pt->nb_ext_intervals - 1;
+    
+    /* Dense range */
+    if ((point >= CUSTOM_FS_KEYB_DENSE_FIRST_POINT) && (point <= CUSTOM_FS_KEYB_DENSE_LAST_POINT))
+    {
+        *symbol_pt = layout_pt->dense_symbols[point - CUSTOM_FS_KEYB_DENSE_FIRST_POINT];
+        return TRUE;
+    }
+    
+    /* Binary search in the other intervals */
+    while (low_index <= high_index)
+    {
+        int16_t mid_index = (low_index + high_index) / 2;
+        custom_fs_keyb_ext_interval_t* interval_pt = &layout_pt->ext_intervals[mid_index];
+        
+        if (point < interval_pt->interval_start)
+        {
+            high_index = mid_index - 1;
+        }
+        else if (point > interval_pt->interval_end)
+        {
+            low_index = mid_index + 1;
+        }
+        else if (interval_pt->cache_symbol_offset != CUSTOM_FS_KEYB_EXT_SYMB_NOT_CACHED)
+        {
+            *symbol_pt = layout_pt->ext_symbols[interval_pt->cache_symbol_offset + point - interval_pt->interval_start];
+            return TRUE;
+        }
+        else
+        {
+            /* Symbols didn't fit in the pool */
+            custom_fs_read_from_flash((uint8_t*)symbol_pt, layout_pt->layout_address + CUSTOM_FS_KEYBOARD_DESC_LGTH*sizeof(cust_char_t) + CUSTOM_FS_KEYB_NB_INT_DESCRIBED*sizeof(unicode_interval_desc_t) + (interval_pt->file_symbol_offset + point - interval_pt->interval_start)*sizeof(uint16_t), sizeof(*symbol_pt));
+            return TRUE;
+        }
+    }
+    
+    return FALSE;
+}
+
 /*! \fn     custom_fs_set_current_keyboard_id(uint8_t keyboard_id, BOOL usb_layout)
 *   \brief  Set current keyboard ID
 *   \param  keyboard_id     Keyboard ID
@@ -446,21 +593,45 @@ ret_type_te custom_fs_set_current_keyboard_id(uint8_t keyboard_id, BOOL usb_layo
         return RETURN_NOK;
     }
     
-    /* Store address and ID */
+    /* Store ID and decode layout in RAM */
     if (usb_layout == FALSE)
     {
-        custom_fs_ble_keyboard_layout_addr = layout_file_addr;
+        custom_fs_load_keyboard_layout_cache(&custom_fs_ble_keyboard_layout, layout_file_addr);
         custom_fs_cur_ble_keyboard_id = keyboard_id;
     } 
     else
     {
-        custom_fs_usb_keyboard_layout_addr = layout_file_addr;
+        custom_fs_load_keyboard_layout_cache(&custom_fs_usb_keyboard_layout, layout_file_addr);
         custom_fs_cur_usb_keyboard_id = keyboard_id;
     }
     
     return RETURN_OK;
 }
 
+/*! \fn     custom_fs_get_current_keyboard_flags(BOOL usb_layout)
+*   \brief  Get the flags of the current keyboard layout
+*   \param  usb_layout  Set to TRUE to get the USB layout flags, FALSE for the BLE layout ones
+*   \return The layout flags (see CUSTOM_FS_KEYB_FLAG_xxx), 0 if no layout is setup
+*/
+uint16_t custom_fs_get_current_keyboard_flags(BOOL usb_layout)
+{
+    custom_fs_keyb_layout_cache_t* layout_pt = &custom_fs_usb_keyboard_layout;
+    
+    /* Layout selection */
+    if (usb_layout == FALSE)
+    {
+        layout_pt = &custom_fs_ble_keyboard_layout;
+    }
+    
+    /* Check for correctly setup keyboard layout */
+    if (layout_pt->layout_address == 0)
+    {
+        return 0;
+    }
+    
+    return layout_pt->layout_flags;
+}
+
 /*! \fn     custom_fs_get_keyboard_symbols_for_unicode_string(cust_char_t* string_pt, uint16_t* buffer, BOOL usb_layout)
 *   \brief  Get keyboard symbols (not keys) for a given unicode string
 *   \param  string_pt   Pointer to the unicode BMP string
@@ -471,53 +642,26 @@ ret_type_te custom_fs_set_current_keyboard_id(uint8_t keyboard_id, BOOL usb_layo
 */
 ret_type_te custom_fs_get_keyboard_symbols_for_unicode_string(cust_char_t* string_pt, uint16_t* buffer, BOOL usb_layout)
 {
-    unicode_interval_desc_t description_intervals[CUSTOM_FS_KEYB_NB_INT_DESCRIBED];
-    custom_fs_address_t layout_address = custom_fs_usb_keyboard_layout_addr;
-    BOOL point_support_described = FALSE;
-    uint16_t symbol_desc_pt_offset = 0;
+    custom_fs_keyb_layout_cache_t* layout_pt = &custom_fs_usb_keyboard_layout;
     BOOL all_points_described = TRUE;
-    uint16_t interval_start = 0;
     
     /* Check for correctly setup keyboard layout */
-    if ((custom_fs_usb_keyboard_layout_addr == 0) || (custom_fs_ble_keyboard_layout_addr == 0))
+    if ((custom_fs_usb_keyboard_layout.layout_address == 0) || (custom_fs_ble_keyboard_layout.layout_address == 0))
     {
         return RETURN_NOK;
     }   
     
-    /* Mapping address based on layout selection */
+    /* Mapping based on layout selection */
     if (usb_layout == FALSE)
     {
-        layout_address = custom_fs_ble_keyboard_layout_addr;
+        layout_pt = &custom_fs_ble_keyboard_layout;
     }
     
-    /* Load the description intervals */
-    custom_fs_read_from_flash((uint8_t*)description_intervals, layout_address + CUSTOM_FS_KEYBOARD_DESC_LGTH*sizeof(cust_char_t), sizeof(description_intervals));
-    
     /* Iterate over string */
     while (*string_pt != 0)
     {
-        /* Reset vars */
-        point_support_described = FALSE;
-        symbol_desc_pt_offset = 0;
-        interval_start = 0;
-        
-        /* Check that support for this point is described */
-        for (uint16_t i = 0; i < ARRAY_SIZE(description_intervals); i++)
-        {
-            /* Check if char is within this interval */
-            if ((description_intervals[i].interval_start != 0xFFFF) && (description_intervals[i].interval_start <= *string_pt) && (description_intervals[i].interval_end >= *string_pt))
-            {
-                interval_start = description_intervals[i].interval_start;
-                point_support_described = TRUE;
-                break;
-            }
-            
-            /* Add offset to descriptor */
-            symbol_desc_pt_offset += description_intervals[i].interval_end - description_intervals[i].interval_start + 1;
-        }
-        
         /* Check for described point support */
-        if (point_support_described == FALSE)
+        if (custom_fs_get_keyboard_symbol_for_point(layout_pt, *string_pt, buffer) == FALSE)
         {
             /* Check for tab or return */
             if (*string_pt == 0x09)
@@ -534,17 +678,11 @@ ret_type_te custom_fs_get_keyboard_symbols_for_unicode_string(cust_char_t* strin
                 *buffer = 0xFFFF;
             }
         }
-        else
+        else if (*buffer == 0xFFFF)
         {
-            /* Fetch keyboard symbol: 0xFFFF for "not supported" matches with our definition of not described */
-            custom_fs_read_from_flash((uint8_t*)buffer, layout_address + CUSTOM_FS_KEYBOARD_DESC_LGTH*sizeof(cust_char_t) + sizeof(description_intervals) + symbol_desc_pt_offset*sizeof(*string_pt) + (*string_pt - interval_start)*sizeof(*string_pt), sizeof(*buffer));       
-            
-            /* Is this symbol supported? */
-            if (*buffer == 0xFFFF)
-            {
-                all_points_described = FALSE;
-            }
-        }        
+            /* 0xFFFF for "not supported" matches with our definition of not described */
+            all_points_described = FALSE;
+        }
         
         /* Move on to the next point */
         string_pt++;
@@ -1018,7 +1156,7 @@ void custom_fs_read_256B_at_internal_custom_storage_slot(uint32_t slot_id, void*
 
 /* This part is used on the emulator build */
 
-static uint8_t eeprom[256 * 128];
+static uint8_t eeprom[EMU_EEPROM_SIZE];
 
 static void custom_fs_init_custom_storage_slots(void)
 {
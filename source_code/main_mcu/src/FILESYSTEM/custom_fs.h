@@ -65,6 +65,7 @@ void custom_fs_set_auth_challenge_counter(uint32_t counter_value);
 RET_TYPE custom_fs_compute_and_check_external_bundle_crc32(void);
 ret_type_te custom_fs_set_current_language(uint8_t language_id);
 void custom_fs_set_device_default_language(uint8_t language_id);
+uint16_t custom_fs_get_current_keyboard_flags(BOOL usb_layout);
 RET_TYPE custom_fs_get_platform_ble_mac_addr(uint8_t* buffer);
 void* custom_fs_get_custom_storage_slot_ptr(uint32_t slot_id);
 void custom_fs_get_device_operations_aes_key(uint8_t* buffer);
@@ -49,6 +49,16 @@
 #define CUSTOM_FS_KEYBOARD_DESC_LGTH        20
 #define CUSTOM_FS_KEYB_NB_INT_DESCRIBED     20
 
+/* Keyboard layout flags, stored in the last (always 0 terminated) description character */
+#define CUSTOM_FS_KEYB_FLAGS_DESC_INDEX     (CUSTOM_FS_KEYBOARD_DESC_LGTH-1)
+#define CUSTOM_FS_KEYB_FLAG_NO_KEY_PACKING  0x0001
+
+/* RAM cached keyboard layouts: dense table for the Latin range, symbol pool for the other described intervals */
+#define CUSTOM_FS_KEYB_DENSE_FIRST_POINT    0x0020
+#define CUSTOM_FS_KEYB_DENSE_LAST_POINT     0x00FF
+#define CUSTOM_FS_KEYB_NB_CACHED_EXT_SYMB   160
+#define CUSTOM_FS_KEYB_EXT_SYMB_NOT_CACHED  0xFFFF
+
 /* Settings IDs */
 #define NB_DEVICE_SETTINGS                  64
 #define SETTING_RESERVED_ID                 0
@@ -78,8 +88,11 @@
 #define SETTINGS_BLUETOOTH_SHORTCUTS        24
 #define SETTINGS_SCREEN_SAVER_ID            25
 #define SETTINGS_PREF_ST_SERV_FEATURE       26
+#define SETTINGS_MERGE_MODIFIER_PRESS       27
+/* Key packing is ignored above KEYBOARD_PACK_KEYS_MAX_DELAY_MS (40ms, aux MCU) between presses, as held keys would be autorepeated */
+#define SETTINGS_PACK_KEY_PRESSES           28
 /* Set to define the number of settings used */
-#define SETTINGS_NB_USED                    27
+#define SETTINGS_NB_USED                    29
 
 /* Flags IDs */
 #define NB_DEVICE_FLAGS                     32
@@ -214,6 +227,26 @@ typedef struct
     uint16_t interval_end;
 } unicode_interval_desc_t;
 
+// Keyboard layout interval outside the dense range
+typedef struct
+{
+    uint16_t interval_start;
+    uint16_t interval_end;
+    uint16_t file_symbol_offset;    // Offset of the interval start symbol in the layout file symbol table
+    uint16_t cache_symbol_offset;   // Offset of the interval start symbol in the cached symbol pool, CUSTOM_FS_KEYB_EXT_SYMB_NOT_CACHED if it didn't fit
+} custom_fs_keyb_ext_interval_t;
+
+// RAM cached keyboard layout
+typedef struct
+{
+    custom_fs_address_t layout_address;                                                                     // Layout file address, 0 if not set
+    uint16_t layout_flags;                                                                                  // Layout flags (see CUSTOM_FS_KEYB_FLAG_xxx)
+    uint16_t nb_ext_intervals;                                                                              // Number of intervals outside the dense range
+    uint16_t dense_symbols[CUSTOM_FS_KEYB_DENSE_LAST_POINT - CUSTOM_FS_KEYB_DENSE_FIRST_POINT + 1];         // Symbols for the dense range, 0xFFFF if not supported
+    custom_fs_keyb_ext_interval_t ext_intervals[CUSTOM_FS_KEYB_NB_INT_DESCRIBED+1];                         // Intervals outside the dense range, sorted
+    uint16_t ext_symbols[CUSTOM_FS_KEYB_NB_CACHED_EXT_SYMB];                                                // Cached symbols for these intervals
+} custom_fs_keyb_layout_cache_t;
+
 // Glyph struct
 typedef struct
 {
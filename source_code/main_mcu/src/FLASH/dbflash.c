@@ -19,11 +19,17 @@
 *    Created:  10/11/2017
 *    Author:   Mathieu Stephan
 */
+#include <string.h>
 #include "platform_defines.h"
 #include "driver_sercom.h"
+#include "profiler.h"
 #include "dbflash.h"
 #include "main.h"
 
+/* Page cache: copy of the last page loaded for node traversals */
+uint8_t dbflash_page_cache[BYTES_PER_PAGE];
+uint16_t dbflash_page_cache_page_number = DBFLASH_PAGE_CACHE_NO_PAGE;
+dbflash_page_cache_stats_t dbflash_page_cache_stats;
 
 /*! \fn     dbflash_memory_boundary_error_callblack(void)
 *   \brief  Function called when a memory boundary issue occurs
@@ -37,6 +43,14 @@ void dbflash_memory_boundary_error_callblack(void)
     main_reboot();
 }
 
+/*! \fn     dbflash_invalidate_page_cache(void)
+*   \brief  Invalidate the page cache, to be called when the memory contents change
+*/
+void dbflash_invalidate_page_cache(void)
+{
+    dbflash_page_cache_page_number = DBFLASH_PAGE_CACHE_NO_PAGE;
+}
+
 /*! \fn     dbflash_send_command(spi_flash_descriptor_t* descriptor_pt, uint8_t* data, uint32_t length)
 *   \brief  Send a command to the flash
 *   \param  descriptor_pt   Pointer to dbflash descriptor
@@ -244,6 +258,9 @@ void dbflash_sector_zero_erase(spi_flash_descriptor_t* descriptor_pt, uint8_t se
     
     /* Wait until memory is ready */
     dbflash_wait_for_not_busy(descriptor_pt);
+    
+    /* Cached page may have changed */
+    dbflash_invalidate_page_cache();
 }
 
 /*! \fn     dbflash_sector_erase(spi_flash_descriptor_t* descriptor_pt, uint8_t sectorNumber)
@@ -268,6 +285,9 @@ void dbflash_sector_erase(spi_flash_descriptor_t* descriptor_pt, uint8_t sectorN
     
     /* Wait until memory is ready */
     dbflash_wait_for_not_busy(descriptor_pt);   
+    
+    /* Cached page may have changed */
+    dbflash_invalidate_page_cache();
 }
 
 /*! \fn     dbflash_chip_erase(spi_flash_descriptor_t* descriptor_pt)
@@ -281,6 +301,9 @@ void dbflash_chip_erase(spi_flash_descriptor_t* descriptor_pt)
     
     /* Wait until memory is ready */
     dbflash_wait_for_not_busy(descriptor_pt);   
+    
+    /* Cached page may have changed */
+    dbflash_invalidate_page_cache();
 }
 
 /*! \fn     dbflash_block_erase(spi_flash_descriptor_t* descriptor_pt, uint16_t blockNumber)
@@ -305,6 +328,9 @@ void dbflash_block_erase(spi_flash_descriptor_t* descriptor_pt, uint16_t blockNu
     
     /* Wait until memory is ready */
     dbflash_wait_for_not_busy(descriptor_pt);
+    
+    /* Cached page may have changed */
+    dbflash_invalidate_page_cache();
 }
 
 /*! \fn     dbflash_page_erase(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber)
@@ -329,6 +355,12 @@ void dbflash_page_erase(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumb
     
     /* Wait until memory is ready */
     dbflash_wait_for_not_busy(descriptor_pt);
+    
+    /* Cached page may have changed */
+    if (pageNumber == dbflash_page_cache_page_number)
+    {
+        dbflash_invalidate_page_cache();
+    }
 }
 
 /*! \fn     dbflash_format_flash(spi_flash_descriptor_t* descriptor_pt) 
@@ -409,6 +441,12 @@ void dbflash_write_data_pattern_to_flash(spi_flash_descriptor_t* descriptor_pt,
     
     /* Wait until memory is ready */
     dbflash_wait_for_not_busy(descriptor_pt);
+    
+    /* Cached page may have changed */
+    if (pageNumber == dbflash_page_cache_page_number)
+    {
+        dbflash_invalidate_page_cache();
+    }
 }
 
 /*! \fn     dbflash_write_data_to_flash(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber, uint16_t offset, uint16_t dataSize, void *data)
@@ -449,6 +487,12 @@ void dbflash_write_data_to_flash(spi_flash_descriptor_t* descriptor_pt, uint16_t
     
     /* Wait until memory is ready */
     dbflash_wait_for_not_busy(descriptor_pt);
+    
+    /* Cached page may have changed */
+    if (pageNumber == dbflash_page_cache_page_number)
+    {
+        dbflash_invalidate_page_cache();
+    }
 }
 
 /*! \fn     dbflash_read_data_from_flash(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber, uint16_t offset, uint16_t dataSize, void *data)
@@ -462,6 +506,8 @@ void dbflash_write_data_to_flash(spi_flash_descriptor_t* descriptor_pt, uint16_t
 */
 void dbflash_read_data_from_flash(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber, uint16_t offset, uint16_t dataSize, void *data)
 {        
+    PROFILER_BEGIN(PROFILER_DBFLASH_READ);
+    
     #ifdef DBFLASH_MEMORY_BOUNDARY_CHECKS
         /* Use of ifs for speed */
         uint16_t pages_used_for_command = offset + dataSize;
@@ -488,8 +534,70 @@ void dbflash_read_data_from_flash(spi_flash_descriptor_t* descriptor_pt, uint16_
     uint8_t opcode[4] = {DBFLASH_OPCODE_LOWF_READ};
     dbflash_fill_page_read_write_erase_opcode_from_address(pageNumber, offset, &opcode[1]);
     dbflash_send_data_with_four_bytes_opcode(descriptor_pt, opcode, data, dataSize);
+    
+    PROFILER_END(PROFILER_DBFLASH_READ);
 } 
 
+/*! \fn     dbflash_read_page_to_cache(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber)
+*   \brief  Read ahead a complete page into the page cache, in a single read command
+*   \param  descriptor_pt   Pointer to dbflash descriptor
+*   \param  pageNumber      The target page number of flash memory
+*/
+void dbflash_read_page_to_cache(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber)
+{
+    if (pageNumber != dbflash_page_cache_page_number)
+    {
+        dbflash_read_data_from_flash(descriptor_pt, pageNumber, 0, sizeof(dbflash_page_cache), dbflash_page_cache);
+        dbflash_page_cache_page_number = pageNumber;
+    }
+}
+
+/*! \fn     dbflash_read_data_from_page_cache(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber, uint16_t offset, uint16_t dataSize, void *data)
+*   \brief  Reads a data buffer of flash memory through the page cache, loading the page if it isn't cached
+*   \param  descriptor_pt   Pointer to dbflash descriptor
+*   \param  pageNumber      The target page number of flash memory
+*   \param  offset          The starting byte offset to begin reading in pageNumber
+*   \param  dataSize        The number of bytes to read from the flash memory into the data buffer (assuming the data buffer is sufficiently large)
+*   \param  data            The buffer used to store the data read from flash
+*   \note   Reads crossing page boundaries go directly to the flash
+*/
+void dbflash_read_data_from_page_cache(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber, uint16_t offset, uint16_t dataSize, void *data)
+{
+    if ((offset + dataSize) > BYTES_PER_PAGE)
+    {
+        dbflash_read_data_from_flash(descriptor_pt, pageNumber, offset, dataSize, data);
+        return;
+    }
+    
+    /* Update stats, load page if needed */
+    if (pageNumber == dbflash_page_cache_page_number)
+    {
+        dbflash_page_cache_stats.hits++;
+    }
+    else
+    {
+        dbflash_page_cache_stats.misses++;
+        dbflash_read_page_to_cache(descriptor_pt, pageNumber);
+    }
+    
+    memcpy(data, &dbflash_page_cache[offset], dataSize);
+}
+
+/*! \fn     dbflash_get_page_cache_stats(dbflash_page_cache_stats_t* stats, BOOL reset_stats)
+*   \brief  Get the page cache hit / miss counters
+*   \param  stats           Where to store the counters
+*   \param  reset_stats     Set to TRUE to reset the counters afterwards
+*/
+void dbflash_get_page_cache_stats(dbflash_page_cache_stats_t* stats, BOOL reset_stats)
+{
+    *stats = dbflash_page_cache_stats;
+    
+    if (reset_stats != FALSE)
+    {
+        memset(&dbflash_page_cache_stats, 0, sizeof(dbflash_page_cache_stats));
+    }
+}
+
 /*! \fn     dbflash_raw_read(spi_flash_descriptor_t* descriptor_pt, uint8_t* datap, uint16_t addr, uint16_t size)
 *   \brief  Contiguous data read across flash page boundaries with a max 65k bytes addressing space
 *   \param  descriptor_pt   Pointer to dbflash descriptor
@@ -536,4 +644,10 @@ void dbflash_flash_write_buffer_to_page(spi_flash_descriptor_t* descriptor_pt, u
     dbflash_fill_page_read_write_erase_opcode_from_address(page, 0, &op[1]);
     dbflash_send_data_with_four_bytes_opcode(descriptor_pt, op, op, 0);
     dbflash_wait_for_not_busy(descriptor_pt);
+    
+    /* Cached page may have changed */
+    if (page == dbflash_page_cache_page_number)
+    {
+        dbflash_invalidate_page_cache();
+    }
 }
\ No newline at end of file
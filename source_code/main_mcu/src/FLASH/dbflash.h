@@ -29,6 +29,16 @@
 // Enable boundary checks
 #define DBFLASH_MEMORY_BOUNDARY_CHECKS
 
+// Page cache: page number when nothing is cached
+#define DBFLASH_PAGE_CACHE_NO_PAGE      0xFFFF
+
+/* Typedefs */
+typedef struct
+{
+    uint32_t hits;                  // Reads served from the cached page
+    uint32_t misses;                // Reads that required a page load
+} dbflash_page_cache_stats_t;
+
 /* Prototypes */
 void dbflash_write_data_pattern_to_flash(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber, uint16_t offset, uint16_t dataSize, uint8_t pattern);
 void dbflash_send_data_with_four_bytes_opcode_no_readback(spi_flash_descriptor_t* descriptor_pt, uint8_t* opcode, uint8_t* buffer, uint16_t buffer_size);
@@ -36,6 +46,7 @@ void dbflash_send_pattern_data_with_four_bytes_opcode(spi_flash_descriptor_t* de
 void dbflash_read_data_from_flash(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber, uint16_t offset, uint16_t dataSize, void *data);
 void dbflash_send_data_with_four_bytes_opcode(spi_flash_descriptor_t* descriptor_pt, uint8_t* opcode, uint8_t* buffer, uint16_t buffer_size);
 void dbflash_write_data_to_flash(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber, uint16_t offset, uint16_t dataSize, void *data);
+void dbflash_read_data_from_page_cache(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber, uint16_t offset, uint16_t dataSize, void *data);
 void dbflash_write_buffer(spi_flash_descriptor_t* descriptor_pt, uint8_t* datap, uint16_t offset, uint16_t size);
 void dbflash_raw_read(spi_flash_descriptor_t* descriptor_pt, uint8_t* datap, uint16_t addr, uint16_t size);
 void dbflash_load_page_to_internal_buffer(spi_flash_descriptor_t* descriptor_pt, uint16_t page_number);
@@ -45,12 +56,15 @@ void dbflash_sector_zero_erase(spi_flash_descriptor_t* descriptor_pt, uint8_t se
 void dbflash_sector_erase(spi_flash_descriptor_t* descriptor_pt, uint8_t sectorNumber);
 void dbflash_block_erase(spi_flash_descriptor_t* descriptor_pt, uint16_t blockNumber);
 void dbflash_page_erase(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber);
+void dbflash_read_page_to_cache(spi_flash_descriptor_t* descriptor_pt, uint16_t pageNumber);
+void dbflash_get_page_cache_stats(dbflash_page_cache_stats_t* stats, BOOL reset_stats);
 void dbflash_enter_ultra_deep_power_down(spi_flash_descriptor_t* descriptor_pt);
 RET_TYPE dbflash_check_presence(spi_flash_descriptor_t* descriptor_pt);
 void dbflash_wait_for_not_busy(spi_flash_descriptor_t* descriptor_pt);
 void dbflash_format_flash(spi_flash_descriptor_t* descriptor_pt);
 void dbflash_chip_erase(spi_flash_descriptor_t* descriptor_pt);
 void dbflash_memory_boundary_error_callblack(void);
+void dbflash_invalidate_page_cache(void);
 
 /* Defines */
 #if defined(DBFLASH_CHIP_1M)      // Used to identify a 1M Flash Chip (AT45DB011D)
@@ -25,6 +25,7 @@
 #include "gui_carousel.h"
 #include "driver_timer.h"
 #include "logic_power.h"
+#include "profiler.h"
 #include "sh1122.h"
 #include "main.h"
 #include <stdlib.h>
@@ -44,6 +45,8 @@ const uint16_t gui_carousel_left_spacing[] = {0,0,0,CAROUSEL_LS_SM(3),CAROUSEL_L
 */
 void gui_carousel_render(uint16_t nb_elements, const uint16_t* pic_ids, const uint16_t* text_ids, uint16_t selected_id, int16_t anim_step)
 {
+    PROFILER_BEGIN(PROFILER_GUI_CAROUSEL_RENDER);
+    
     #ifdef OLED_INTERNAL_FRAME_BUFFER
     /* Clear frame buffer */
     sh1122_clear_frame_buffer(&plat_oled_descriptor);
@@ -151,6 +154,8 @@ void gui_carousel_render(uint16_t nb_elements, const uint16_t* pic_ids, const ui
     /* Flush */
     sh1122_flush_frame_buffer(&plat_oled_descriptor);
     #endif
+    
+    PROFILER_END(PROFILER_GUI_CAROUSEL_RENDER);
 }
 
 
@@ -29,6 +29,7 @@
 #include "gui_carousel.h"
 #include "logic_device.h"
 #include "gui_prompts.h"
+#include "profiler.h"
 #include "logic_power.h"
 #include "platform_io.h"
 #include "logic_user.h"
@@ -156,6 +157,8 @@ void gui_dispatcher_set_current_screen(gui_screen_te screen, BOOL reset_states,
 */
 void gui_dispatcher_get_back_to_current_screen(void)
 {
+    PROFILER_BEGIN(PROFILER_GUI_SCREEN_RENDER);
+    
     if (gui_dispatcher_current_screen == GUI_SCREEN_LOGIN_NOTIF)
     {
         /* We're currently displaying a login notification but were interrupted for another prompt... go to main menu */
@@ -201,6 +204,8 @@ void gui_dispatcher_get_back_to_current_screen(void)
                                             }                                                
         default: break;
     }
+    
+    PROFILER_END(PROFILER_GUI_SCREEN_RENDER);
 }
 
 /*! \fn     gui_dispatcher_event_dispatch(wheel_action_ret_te wheel_action)
@@ -228,6 +228,9 @@ RET_TYPE logic_aux_mcu_flash_firmware_update(BOOL connect_to_usb_if_needed)
     custom_fs_read_from_flash((uint8_t*)&fw_file_size, fw_file_address, sizeof(fw_file_size));
     fw_file_address += sizeof(fw_file_size);
     
+    /* The aux MCU bootloader only takes legacy messages */
+    comms_aux_mcu_disable_framing();
+    
     /* Prepare programming command */
     temp_tx_message_pt = comms_aux_mcu_get_empty_packet_ready_to_be_sent(AUX_MCU_MSG_TYPE_BOOTLOADER);
     temp_tx_message_pt->bootloader_message.command = BOOTLOADER_START_PROGRAMMING_COMMAND;
@@ -295,6 +298,9 @@ RET_TYPE logic_aux_mcu_flash_firmware_update(BOOL connect_to_usb_if_needed)
     /* Let the aux MCU boot */
     timer_delay_ms(1000);
     
+    /* New aux MCU firmware: check for framing support again */
+    comms_aux_mcu_negotiate_framing();
+    
     /* If USB present, send USB attach message */
     if ((platform_io_is_usb_3v3_present() != FALSE) && (connect_to_usb_if_needed != FALSE))
     {
@@ -46,11 +46,36 @@ uint16_t logic_database_get_prev_2_fletters_services(uint16_t start_address, cus
     BOOL first_loop_bool = TRUE;
     int16_t storage_index = 1;
     parent_node_t temp_pnode;
+    uint16_t nb_buckets;
+    uint16_t bucket_id;
     
     /* To start with the loop below */
     temp_pnode.cred_parent.prevParentAddress = start_address;
     char_array[0] = ' '; char_array[1] = ' ';
     
+    /* Jump table available: the first previous letter with logins in the current category is skipped, the two ones before it are stored */
+    if (nodemgmt_fletter_table_get_bucket_for_parent(credential_type_id, start_address, start_char, &bucket_id, &nb_buckets) == RETURN_OK)
+    {
+        for (uint16_t i = 1; (i < nb_buckets) && (storage_index >= 0); i++)
+        {
+            current_node_addr = nodemgmt_fletter_table_get_parent_for_cur_category(credential_type_id, (bucket_id + nb_buckets - i) % nb_buckets, NODE_ADDR_NULL, &cur_char);
+            
+            if (current_node_addr != NODE_ADDR_NULL)
+            {
+                char_array[storage_index] = cur_char;
+                
+                /* First previous letter, store address */
+                if (storage_index == 1)
+                {
+                    return_value = current_node_addr;
+                }
+                storage_index--;
+            }
+        }
+        
+        return return_value;
+    }
+    
     while(TRUE)
     {
         /* Update current node address */
@@ -76,7 +101,7 @@ uint16_t logic_database_get_prev_2_fletters_services(uint16_t start_address, cus
         nodemgmt_read_parent_node(current_node_addr, &temp_pnode, FALSE);
         
         /* Part of current category? */
-        if (nodemgmt_check_for_logins_with_category_in_parent_node(temp_pnode.cred_parent.nextChildAddress, nodemgmt_get_current_category_flags()) != NODE_ADDR_NULL)
+        if (nodemgmt_parent_has_logins_with_category(current_node_addr, temp_pnode.cred_parent.nextChildAddress, nodemgmt_get_current_category_flags()) != FALSE)
         {
             /* Check if the fchar changed */
             if (temp_pnode.cred_parent.service[0] != cur_char)
@@ -140,11 +165,36 @@ uint16_t logic_database_get_next_2_fletters_services(uint16_t start_address, cus
     BOOL first_loop_bool = TRUE;
     uint16_t storage_index = 0;
     parent_node_t temp_pnode;
+    uint16_t nb_buckets;
+    uint16_t bucket_id;
     
     /* To start with the loop below */
     temp_pnode.cred_parent.nextParentAddress = start_address;
     char_array[0] = ' '; char_array[1] = ' ';
     
+    /* Jump table available: check the next buckets, then the current one up to the start address */
+    if (nodemgmt_fletter_table_get_bucket_for_parent(credential_type_id, start_address, cur_char, &bucket_id, &nb_buckets) == RETURN_OK)
+    {
+        for (uint16_t i = 1; (i <= nb_buckets) && (storage_index < 2); i++)
+        {
+            current_node_addr = nodemgmt_fletter_table_get_parent_for_cur_category(credential_type_id, (bucket_id + i) % nb_buckets, (i == nb_buckets)? start_address:NODE_ADDR_NULL, &cur_char);
+            
+            /* Current letter only counts once another one was found */
+            if ((current_node_addr != NODE_ADDR_NULL) && ((i != nb_buckets) || (storage_index != 0)))
+            {
+                char_array[storage_index++] = cur_char;
+                
+                /* First next letter, store address */
+                if (storage_index == 1)
+                {
+                    return_value = current_node_addr;
+                }
+            }
+        }
+        
+        return return_value;
+    }
+    
     while(TRUE)
     {
         /* Check for credential loop */
@@ -163,7 +213,7 @@ uint16_t logic_database_get_next_2_fletters_services(uint16_t start_address, cus
         nodemgmt_read_parent_node(current_node_addr, &temp_pnode, FALSE);
         
         /* Check if the fchar changed */
-        if ((temp_pnode.cred_parent.service[0] != cur_char) && (nodemgmt_check_for_logins_with_category_in_parent_node(temp_pnode.cred_parent.nextChildAddress, nodemgmt_get_current_category_flags()) != NODE_ADDR_NULL))
+        if ((temp_pnode.cred_parent.service[0] != cur_char) && (nodemgmt_parent_has_logins_with_category(current_node_addr, temp_pnode.cred_parent.nextChildAddress, nodemgmt_get_current_category_flags()) != FALSE))
         {            
             /* Store node */
             char_array[storage_index++] = temp_pnode.cred_parent.service[0];
@@ -264,7 +314,7 @@ uint16_t logic_database_search_for_next_data_parent_after_addr(uint16_t node_add
 *   \param  cred_type               set to TRUE to search for credential, FALSE for data 
 *   \param  category_id             Credential/Data category ID
 *   \return Address of the found node, NODE_ADDR_NULL otherwise
-*   \note   Full 8Mb database search has been timed at 581ms
+*   \note   Full 8Mb database search has been timed at 581ms, the service index usually brings it down to one node read
 */
 uint16_t logic_database_search_service(cust_char_t* name, service_compare_mode_te compare_type, BOOL cred_type, uint16_t category_id)
 {
@@ -272,13 +322,30 @@ uint16_t logic_database_search_service(cust_char_t* name, service_compare_mode_t
     uint16_t next_node_addr;
     int16_t compare_result;
     
-    /* Get start node */
-    if (cred_type != FALSE)
+    /* Use the service index to skip the nodes coming alphabetically before the name */
+    if (nodemgmt_service_index_get_search_start_addr(name, (cred_type != FALSE)? FALSE:TRUE, category_id, &next_node_addr) == RETURN_OK)
+    {
+        if (next_node_addr == NODE_ADDR_NULL)
+        {
+            /* All nodes come before the name */
+            if ((cred_type != FALSE) && (compare_type == COMPARE_MODE_COMPARE))
+            {
+                return nodemgmt_get_starting_parent_addr(category_id);
+            }
+            else
+            {
+                return NODE_ADDR_NULL;
+            }
+        }
+    }
+    else if (cred_type != FALSE)
     {
+        /* Get start node */
         next_node_addr = nodemgmt_get_starting_parent_addr(category_id);
     }
     else
     {
+        /* Get start node */
         next_node_addr = nodemgmt_get_starting_data_parent_addr(category_id);
     }
     
@@ -30,6 +30,7 @@
 #include "platform_io.h"
 #include "logic_power.h"
 #include "logic_user.h"
+#include "profiler.h"
 #include "custom_fs.h"
 #include "bearssl.h"
 #include "sh1122.h"
@@ -294,7 +295,7 @@ ret_type_te logic_device_bundle_update_start(BOOL from_debug_messages, uint8_t*
             memset(password_buffer, 0, sizeof(password_buffer));
             password_buffer[0] = custom_fs_get_platform_bundle_version();
             password_buffer[1] = custom_fs_get_platform_serial_number();
-            br_aes_ct_ctrcbc_ctr(&device_operations_aes_context, (void*)temp_ctr, password_buffer, sizeof(password_buffer));
+            PROFILER_CALL(PROFILER_AES_CTR, br_aes_ct_ctrcbc_ctr(&device_operations_aes_context, (void*)temp_ctr, password_buffer, sizeof(password_buffer)));
             
             /* We have the data we want to compare to, memset everything */
             memset(&device_operations_aes_context, 0, sizeof(device_operations_aes_context));
@@ -27,6 +27,7 @@
 #include "bearssl_hmac.h"
 #include "bearssl_rand.h"
 #include "bearssl_ec.h"
+#include "profiler.h"
 #include "custom_fs.h"
 #include "nodemgmt.h"
 #include "utils.h"
@@ -35,6 +36,8 @@
 
 // Next CTR value for our AES encryption
 uint8_t logic_encryption_next_ctr_val[MEMBER_SIZE(nodemgmt_profile_main_data_t, current_ctr)];
+// Number of CTR blocks already covered by the CTR value stored in flash
+uint32_t logic_encryption_reserved_ctr_blocks = 0;
 // Current encryption context */
 br_aes_ct_ctrcbc_keys logic_encryption_cur_aes_context;
 // Current user CPZ user entry
@@ -140,6 +143,7 @@ void logic_encryption_init_context(uint8_t* card_aes_key, cpz_lut_entry_t* cpz_u
 {
     /* Store CPZ user entry */
     logic_encryption_cur_cpz_entry = cpz_user_entry;
+    logic_encryption_clear_ctr_reservation();
     
     /* Is this a fleet managed user account ? */
     if (logic_encryption_cur_cpz_entry->use_provisioned_key_flag == CUSTOM_FS_PROV_KEY_FLAG)
@@ -155,7 +159,7 @@ void logic_encryption_init_context(uint8_t* card_aes_key, cpz_lut_entry_t* cpz_u
         
         /* Use card AES key to decrypt flash-stored AES key */
         br_aes_ct_ctrcbc_init(&logic_encryption_cur_aes_context, card_aes_key, AES_KEY_LENGTH/8);        
-        br_aes_ct_ctrcbc_ctr(&logic_encryption_cur_aes_context, (void*)temp_ctr, (void*)user_provisioned_key, sizeof(user_provisioned_key));
+        PROFILER_CALL(PROFILER_AES_CTR, br_aes_ct_ctrcbc_ctr(&logic_encryption_cur_aes_context, (void*)temp_ctr, (void*)user_provisioned_key, sizeof(user_provisioned_key)));
         
         /* Initialize encryption context */
         br_aes_ct_ctrcbc_init(&logic_encryption_cur_aes_context, user_provisioned_key, AES_KEY_LENGTH/8);
@@ -181,9 +185,46 @@ void logic_encryption_init_context(uint8_t* card_aes_key, cpz_lut_entry_t* cpz_u
 void logic_encryption_delete_context(void)
 {
     memset((void*)&logic_encryption_cur_aes_context, 0, sizeof(logic_encryption_cur_aes_context));
+    logic_encryption_clear_ctr_reservation();
     logic_encryption_cur_cpz_entry = 0;
 }
 
+/*! \fn     logic_encryption_reserve_ctr_blocks(uint32_t nb_blocks)
+*   \brief  Advance the CTR value stored in flash once for a batch of encryptions
+*   \param  nb_blocks   Number of CTR blocks the batch is going to use
+*   \note   Encryptions covered by the reservation skip the per-call flash CTR check
+*/
+void logic_encryption_reserve_ctr_blocks(uint32_t nb_blocks)
+{
+    uint8_t temp_buffer[MEMBER_SIZE(nodemgmt_profile_main_data_t, current_ctr)];
+    uint32_t carry = nb_blocks + CTR_FLASH_MIN_INCR;
+    
+    // Read CTR stored in flash
+    nodemgmt_read_profile_ctr(temp_buffer);
+    
+    /* Only write the flash CTR if the batch goes over it */
+    if (logic_encryption_ctr_array_to_uint32(logic_encryption_next_ctr_val) + nb_blocks >= logic_encryption_ctr_array_to_uint32(temp_buffer))
+    {
+        memcpy(temp_buffer, logic_encryption_next_ctr_val, sizeof(temp_buffer));
+        for (int16_t i = sizeof(temp_buffer)-1; i >= 0; i--)
+        {
+            carry = ((uint32_t)temp_buffer[i]) + carry;
+            temp_buffer[i] = (uint8_t)(carry);
+            carry = carry >> 8;
+        }
+        nodemgmt_set_profile_ctr(temp_buffer);
+    }
+    logic_encryption_reserved_ctr_blocks = nb_blocks;
+}
+
+/*! \fn     logic_encryption_clear_ctr_reservation(void)
+*   \brief  Go back to checking the flash CTR value for each encryption
+*/
+void logic_encryption_clear_ctr_reservation(void)
+{
+    logic_encryption_reserved_ctr_blocks = 0;
+}
+
 /*! \fn     logic_encryption_pre_ctr_tasks(void)
 *   \brief  CTR pre encryption tasks
 *   \param  ctr_inc     By how much we are planning to increment ctr value
@@ -194,6 +235,13 @@ void logic_encryption_pre_ctr_tasks(uint16_t ctr_inc)
     uint16_t carry = CTR_FLASH_MIN_INCR;
     int16_t i;
     
+    /* Blocks reserved beforehand are already covered by the flash CTR */
+    if (ctr_inc <= logic_encryption_reserved_ctr_blocks)
+    {
+        logic_encryption_reserved_ctr_blocks -= ctr_inc;
+        return;
+    }
+    
     // Read CTR stored in flash
     nodemgmt_read_profile_ctr(temp_buffer);
     
@@ -245,7 +293,7 @@ void logic_encryption_ctr_encrypt(uint8_t* data, uint16_t data_length, uint8_t*
         logic_encryption_add_vector_to_other(credential_ctr + (sizeof(credential_ctr) - sizeof(logic_encryption_next_ctr_val)), logic_encryption_next_ctr_val, sizeof(logic_encryption_next_ctr_val));
         
         /* Encrypt data */        
-        br_aes_ct_ctrcbc_ctr(&logic_encryption_cur_aes_context, (void*)credential_ctr, (void*)data, data_length);
+        PROFILER_CALL(PROFILER_AES_CTR, br_aes_ct_ctrcbc_ctr(&logic_encryption_cur_aes_context, (void*)credential_ctr, (void*)data, data_length));
         
         /* Reset vars */
         memset(credential_ctr, 0, sizeof(credential_ctr));
@@ -277,7 +325,7 @@ void logic_encryption_ctr_decrypt(uint8_t* data, uint8_t* cred_ctr, uint16_t dat
     }
     
     /* Decrypt data */
-    br_aes_ct_ctrcbc_ctr(&logic_encryption_cur_aes_context, (void*)credential_ctr, (void*)data, data_length);
+    PROFILER_CALL(PROFILER_AES_CTR, br_aes_ct_ctrcbc_ctr(&logic_encryption_cur_aes_context, (void*)credential_ctr, (void*)data, data_length));
     
     /* Reset vars */
     memset(credential_ctr, 0, sizeof(credential_ctr));  
@@ -63,6 +63,8 @@ cpz_lut_entry_t* logic_encryption_get_cur_cpz_lut_entry(void);
 void logic_encryption_get_cpz_lut_entry(uint8_t* buffer);
 void logic_encryption_post_ctr_tasks(uint16_t ctr_inc);
 void logic_encryption_pre_ctr_tasks(uint16_t ctr_inc);
+void logic_encryption_reserve_ctr_blocks(uint32_t nb_blocks);
+void logic_encryption_clear_ctr_reservation(void);
 void logic_encryption_delete_context(void);
 
 typedef struct
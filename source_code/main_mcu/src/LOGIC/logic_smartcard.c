@@ -34,6 +34,7 @@
 #include "logic_power.h"
 #include "platform_io.h"
 #include "logic_user.h"
+#include "profiler.h"
 #include "logic_gui.h"
 #include "nodemgmt.h"
 #include "text_ids.h"
@@ -295,7 +296,7 @@ valid_card_det_return_te logic_smartcard_valid_card_unlock(BOOL hash_allow_flag,
             _Static_assert(sizeof(password_buffer) == (AES_BLOCK_SIZE/8), "Invalid buffer size");
             memset(password_buffer, 0, sizeof(password_buffer));
             password_buffer[0] = custom_fs_get_platform_serial_number();
-            br_aes_ct_ctrcbc_ctr(&device_operations_aes_context, (void*)temp_ctr, password_buffer, sizeof(password_buffer));
+            PROFILER_CALL(PROFILER_AES_CTR, br_aes_ct_ctrcbc_ctr(&device_operations_aes_context, (void*)temp_ctr, password_buffer, sizeof(password_buffer)));
                         
             /* Display AESenc(CTRVAL) */
             if (gui_prompts_display_hash((uint8_t*)password_buffer, HASH_1_TEXT_ID) == FALSE)
@@ -346,7 +347,7 @@ valid_card_det_return_te logic_smartcard_valid_card_unlock(BOOL hash_allow_flag,
                 _Static_assert(sizeof(temp_ctr) == 8 + 8, "Invalid encryption technique");
                 memset(password_buffer, 0, sizeof(password_buffer));
                 password_buffer[0] = custom_fs_get_platform_serial_number();
-                br_aes_ct_ctrcbc_ctr(&device_operations_aes_context, (void*)temp_ctr, password_buffer, sizeof(password_buffer));
+                PROFILER_CALL(PROFILER_AES_CTR, br_aes_ct_ctrcbc_ctr(&device_operations_aes_context, (void*)temp_ctr, password_buffer, sizeof(password_buffer)));
                 
                 /* Display AESenc(AESkey) */
                 if (gui_prompts_display_hash((uint8_t*)password_buffer, HASH_2_TEXT_ID) == FALSE)
@@ -37,6 +37,7 @@
 #include "logic_fido2.h"
 #include "logic_user.h"
 #include "custom_fs.h"
+#include "profiler.h"
 #include "logic_gui.h"
 #include "nodemgmt.h"
 #include "text_ids.h"
@@ -69,6 +70,8 @@ uint16_t logic_user_preferred_starting_service = NODE_ADDR_NULL;
 uint32_t logic_user_prefered_st_service_ts = 0;
 // User security preferences
 uint16_t logic_user_cur_sec_preferences;
+// Set between bulk import begin & end commands
+BOOL logic_user_bulk_import_in_progress = FALSE;
 
 
 /*! \fn     logic_user_invalidate_preferred_starting_service(void)
@@ -161,6 +164,7 @@ void logic_user_init_context(uint8_t user_id)
     logic_user_data_service_addr = NODE_ADDR_NULL;
     logic_user_getting_data_from_service = FALSE;
     logic_user_adding_data_to_service = FALSE;
+    logic_user_bulk_import_in_progress = FALSE;
 }
 
 /*! \fn     logic_user_is_bluetooth_enabled_for_inserted_card(uint16_t* user_language_id)
@@ -430,7 +434,7 @@ ret_type_te logic_user_create_new_user(volatile uint16_t* pin_code, uint8_t* pro
         /* Use card AES key to encrypt provisioned key */
         br_aes_ct_ctrcbc_keys temp_aes_context;
         br_aes_ct_ctrcbc_init(&temp_aes_context, temp_buffer, AES_KEY_LENGTH/8);
-        br_aes_ct_ctrcbc_ctr(&temp_aes_context, (void*)temp_ctr, (void*)provisioned_key, AES_KEY_LENGTH/8);
+        PROFILER_CALL(PROFILER_AES_CTR, br_aes_ct_ctrcbc_ctr(&temp_aes_context, (void*)temp_ctr, (void*)provisioned_key, AES_KEY_LENGTH/8));
         
         /* Store encrypted provisioned key in user profile */
         memcpy(user_profile.provisioned_key, provisioned_key, AES_KEY_LENGTH/8);
@@ -1015,6 +1019,43 @@ void logic_user_change_node_password(uint16_t node_address, cust_char_t* passwor
     logic_database_update_credential(node_address, 0, 0, (uint8_t*)encrypted_password, temp_cred_ctr_val);
 }
 
+/*! \fn     logic_user_bulk_import_begin(uint16_t nb_credentials)
+*   \brief  Start a bulk credential import
+*   \param  nb_credentials  Number of credentials the host is going to store
+*   \note   Credentials are then expected in alphabetical service order, the CTR stored in flash is advanced once for all of them
+*   \return success or not
+*/
+RET_TYPE logic_user_bulk_import_begin(uint16_t nb_credentials)
+{
+    /* Smartcard present and unlocked? */
+    if ((logic_security_is_smc_inserted_unlocked() == FALSE) || (nb_credentials > NODEMGMT_NB_NODE_SLOTS))
+    {
+        return RETURN_NOK;
+    }
+    
+    /* Reserve CTR blocks for all the passwords */
+    logic_encryption_reserve_ctr_blocks((uint32_t)nb_credentials * ((MEMBER_SIZE(child_cred_node_t, password)*8 + AES256_CTR_LENGTH - 1)/AES256_CTR_LENGTH));
+    
+    /* Sorted services are linked right after the previously stored one */
+    nodemgmt_merge_cursor_enable();
+    logic_user_bulk_import_in_progress = TRUE;
+    return RETURN_OK;
+}
+
+/*! \fn     logic_user_bulk_import_end(void)
+*   \brief  End a bulk credential import
+*   \note   Unused reserved CTR blocks are simply skipped
+*/
+void logic_user_bulk_import_end(void)
+{
+    if (logic_user_bulk_import_in_progress != FALSE)
+    {
+        logic_encryption_clear_ctr_reservation();
+        nodemgmt_merge_cursor_disable();
+        logic_user_bulk_import_in_progress = FALSE;
+    }
+}
+
 /*! \fn     logic_user_store_credential(cust_char_t* service, cust_char_t* login, cust_char_t* desc, cust_char_t* third, cust_char_t* password)
 *   \brief  Store new credential
 *   \param  service     Pointer to service string
@@ -1873,6 +1914,34 @@ void logic_user_manual_select_login(void)
     }
 }
 
+/*! \fn     logic_user_append_keyboard_typing_flags(aux_mcu_message_t* typing_message, BOOL usb_layout)
+*   \brief  Append the typing flags after the 0 terminated symbols of a keyboard type message
+*   \param  typing_message  Keyboard type message, payload_length1 already set
+*   \param  usb_layout      TRUE if we're typing through USB, FALSE for BLE
+*   \note   Older aux MCU firmwares stop at the 0 terminator and therefore ignore the flags
+*/
+void logic_user_append_keyboard_typing_flags(aux_mcu_message_t* typing_message, BOOL usb_layout)
+{
+    uint16_t typing_flags = 0;
+    
+    /* Modifier pressed with the key */
+    if (custom_fs_settings_get_device_setting(SETTINGS_MERGE_MODIFIER_PRESS) != FALSE)
+    {
+        typing_flags |= KEYBOARD_TYPING_FLAG_MERGE_MODIFIER;
+    }
+    
+    /* Several keys per report, unless the layout opts out */
+    if ((custom_fs_settings_get_device_setting(SETTINGS_PACK_KEY_PRESSES) != FALSE) && ((custom_fs_get_current_keyboard_flags(usb_layout) & CUSTOM_FS_KEYB_FLAG_NO_KEY_PACKING) == 0))
+    {
+        typing_flags |= KEYBOARD_TYPING_FLAG_PACK_KEYS;
+    }
+    
+    /* Store flags right after the symbols 0 terminator, _Static_asserts guarantee enough space */
+    uint16_t symbols_length = typing_message->payload_length1 - MEMBER_SIZE(keyboard_type_message_t, interface_identifier) - MEMBER_SIZE(keyboard_type_message_t, delay_between_types);
+    typing_message->keyboard_type_message.keyboard_symbols[symbols_length/sizeof(uint16_t)] = typing_flags;
+    typing_message->payload_length1 += sizeof(uint16_t);
+}
+
 /*! \fn     logic_user_ask_for_credentials_keyb_output(uint16_t parent_address, uint16_t child_address, BOOL skip_login_prompt_and_int_choice, BOOL* usb_selected, lock_feature_te keys_to_send_before_login, BOOL skip_login_prompt, BOOL no_password_prompt)
 *   \brief  Ask the user to enter the login & password of a given service
 *   \param  parent_address                      Address of the parent
@@ -2049,6 +2118,7 @@ RET_TYPE logic_user_ask_for_credentials_keyb_output(uint16_t parent_address, uin
                         custom_fs_get_keyboard_symbols_for_unicode_string(&typing_message_to_be_sent->keyboard_type_message.keyboard_symbols[utils_strlen(temp_cnode.login)], &typing_message_to_be_sent->keyboard_type_message.keyboard_symbols[utils_strlen(temp_cnode.login)], *usb_selected);
                         typing_message_to_be_sent->keyboard_type_message.delay_between_types = custom_fs_settings_get_device_setting(SETTINGS_DELAY_BETWEEN_PRESSES);
                         typing_message_to_be_sent->keyboard_type_message.interface_identifier = interface_id;
+                        logic_user_append_keyboard_typing_flags(typing_message_to_be_sent, *usb_selected);
                         comms_aux_mcu_send_message(typing_message_to_be_sent);
                         
                         /* Wait for typing status */
@@ -2187,6 +2257,7 @@ RET_TYPE logic_user_ask_for_credentials_keyb_output(uint16_t parent_address, uin
                         custom_fs_get_keyboard_symbols_for_unicode_string(&typing_message_to_be_sent->keyboard_type_message.keyboard_symbols[utils_strlen(temp_cnode.cust_char_password)], &typing_message_to_be_sent->keyboard_type_message.keyboard_symbols[utils_strlen(temp_cnode.cust_char_password)], *usb_selected);
                         typing_message_to_be_sent->keyboard_type_message.delay_between_types = custom_fs_settings_get_device_setting(SETTINGS_DELAY_BETWEEN_PRESSES);
                         typing_message_to_be_sent->keyboard_type_message.interface_identifier = interface_id;
+                        logic_user_append_keyboard_typing_flags(typing_message_to_be_sent, *usb_selected);
                         comms_aux_mcu_send_message(typing_message_to_be_sent);
                         
                         /* Wait for typing status */
@@ -2318,6 +2389,7 @@ RET_TYPE logic_user_ask_for_credentials_keyb_output(uint16_t parent_address, uin
                     custom_fs_get_keyboard_symbols_for_unicode_string(&typing_message_to_be_sent->keyboard_type_message.keyboard_symbols[TOTP_len], &typing_message_to_be_sent->keyboard_type_message.keyboard_symbols[TOTP_len], *usb_selected);
                     typing_message_to_be_sent->keyboard_type_message.delay_between_types = custom_fs_settings_get_device_setting(SETTINGS_DELAY_BETWEEN_PRESSES);
                     typing_message_to_be_sent->keyboard_type_message.interface_identifier = interface_id;
+                    logic_user_append_keyboard_typing_flags(typing_message_to_be_sent, *usb_selected);
                     comms_aux_mcu_send_message(typing_message_to_be_sent);
 
                     /* Message is sent, clear everything */
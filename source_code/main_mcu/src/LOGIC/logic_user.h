@@ -40,6 +40,7 @@ fido2_return_code_te logic_user_store_webauthn_credential(cust_char_t* rp_id, ui
 ret_type_te logic_user_create_new_user_for_existing_card(cpz_lut_entry_t* cpz_entry, uint16_t sec_preferences, uint16_t language_id, uint16_t usb_layout_id, uint16_t ble_layout_id, uint8_t* new_user_id);
 RET_TYPE logic_user_get_data_from_service(cust_char_t* service, uint8_t* buffer, uint16_t* nb_bytes_written, BOOL is_message_from_usb, nodemgmt_data_category_te data_type);
 RET_TYPE logic_user_store_credential(cust_char_t* service, cust_char_t* login, cust_char_t* desc, cust_char_t* third, cust_char_t* password);
+RET_TYPE logic_user_bulk_import_begin(uint16_t nb_credentials);
 RET_TYPE logic_user_add_data_to_current_service(hid_message_store_data_into_file_t* store_data_request, BOOL is_message_from_usb);
 RET_TYPE logic_user_empty_data_service(cust_char_t* service, BOOL is_message_from_usb, nodemgmt_data_category_te data_type);
 RET_TYPE logic_user_store_TOTP_credential(cust_char_t* service, cust_char_t* login, TOTPcredentials_t const *TOTPcreds);
@@ -55,6 +56,7 @@ void logic_user_set_preferred_starting_service(uint16_t service_addr);
 void logic_user_set_layout_id(uint16_t layout_id, BOOL usb_layout);
 void logic_user_reset_computer_locked_state(BOOL usb_interface);
 BOOL logic_user_get_and_clear_user_to_be_logged_off_flag(void);
+void logic_user_append_keyboard_typing_flags(aux_mcu_message_t* typing_message, BOOL usb_layout);
 void logic_user_clear_user_security_flag(uint16_t bitmask);
 void logic_user_invalidate_preferred_starting_service(void);
 void logic_user_set_user_security_flag(uint16_t bitmask);
@@ -65,6 +67,7 @@ void logic_user_set_language(uint16_t language_id);
 uint16_t logic_user_get_user_security_flags(void);
 void logic_user_unlocked_feature_trigger(void);
 void logic_user_init_context(uint8_t user_id);
+void logic_user_bulk_import_end(void);
 void logic_user_locked_feature_trigger(void);
 uint8_t logic_user_get_current_user_id(void);
 void logic_user_manual_select_login(void);
@@ -38,6 +38,18 @@
 nodemgmtHandle_t nodemgmt_current_handle;
 // Current date
 uint16_t nodemgmt_current_date;
+// Service index
+nodemgmt_service_index_t nodemgmt_service_index;
+// Node usage bitmap
+nodemgmt_node_bitmap_t nodemgmt_node_bitmap;
+// Parent children categories cache
+nodemgmt_category_cache_t nodemgmt_category_cache;
+// First letter jump table
+nodemgmt_fletter_table_t nodemgmt_fletter_table;
+// Parent lists skip index
+nodemgmt_skip_index_t nodemgmt_skip_index;
+// Bulk import merge cursor
+nodemgmt_merge_cursor_t nodemgmt_merge_cursor;
 
 
 /*! \fn     nodemgmt_set_current_date(uint16_t date)
@@ -257,6 +269,177 @@ RET_TYPE nodemgmt_check_user_permission(uint16_t node_addr, node_type_te* node_t
     }
 }
 
+/*! \fn     nodemgmt_check_user_node_start(uint16_t node_addr, node_type_te* node_type)
+*   \brief  Check that a node slot holds the start of a valid node the user has the right to read/write
+*   \param  node_addr   Node slot address
+*   \param  node_type   Where to store the node type (see enum)
+*   \return RETURN_NOK for empty slots, second halves of child nodes, other users nodes and out of bounds addresses
+*/
+RET_TYPE nodemgmt_check_user_node_start(uint16_t node_addr, node_type_te* node_type)
+{
+    // Future node flags
+    uint16_t temp_flags;
+    // Node Page
+    uint16_t page_addr = nodemgmt_page_from_address(node_addr);
+    
+    // Check memory boundaries
+    if ((page_addr < PAGE_PER_SECTOR) || (page_addr >= PAGE_COUNT))
+    {
+        return RETURN_NOK;
+    }
+    
+    // Fetch the flags
+    dbflash_read_data_from_flash(&dbflash_descriptor, page_addr, BASE_NODE_SIZE * nodemgmt_node_from_address(node_addr), sizeof(temp_flags), (void*)&temp_flags);
+    
+    // Valid node start the user can access: child nodes second halves have their correct flags bit cleared
+    if ((validBitFromFlags(temp_flags) == NODEMGMT_VBIT_VALID) && (correctFlagsBitFromFlags(temp_flags) == NODEMGMT_VBIT_VALID) && (nodemgmt_check_user_perm_from_flags(temp_flags) == RETURN_OK))
+    {
+        *node_type = nodeTypeFromFlags(temp_flags);
+        return RETURN_OK;
+    }
+    else
+    {
+        return RETURN_NOK;
+    }
+}
+
+/*! \fn     nodemgmt_node_bitmap_set_slot(uint16_t address, BOOL used)
+*   \brief  Update the node usage bitmap after a node slot write
+*   \param  address     Node address
+*   \param  used        TRUE if the slot now holds a valid node
+*/
+static inline void nodemgmt_node_bitmap_set_slot(uint16_t address, BOOL used)
+{
+    uint16_t slot = (nodemgmt_page_from_address(address) - PAGE_PER_SECTOR) * (BYTES_PER_PAGE / BASE_NODE_SIZE) + nodemgmt_node_from_address(address);
+    
+    if (used != FALSE)
+    {
+        nodemgmt_node_bitmap.used_slots[slot / 32] |= (1UL << (slot % 32));
+    } 
+    else
+    {
+        nodemgmt_node_bitmap.used_slots[slot / 32] &= ~(1UL << (slot % 32));
+    }
+}
+
+/*! \fn     nodemgmt_node_bitmap_build(void)
+*   \brief  Build the node usage bitmap from the flags of all node slots
+*   \note   Should be called once per user login, the bitmap is then kept up to date by the node write & delete functions
+*/
+void nodemgmt_node_bitmap_build(void)
+{
+    _Static_assert(sizeof(nodemgmt_node_bitmap.used_slots) <= MAP_BYTES, "Node usage bitmap doesn't fit the map bytes budget");
+    uint16_t nodeFlags;
+    
+    // Mark everything as used: padding slots at the end of the last word will never be reported free
+    memset(nodemgmt_node_bitmap.used_slots, 0xFF, sizeof(nodemgmt_node_bitmap.used_slots));
+    
+    // Then clear the free slots
+    for (uint16_t pageItr = PAGE_PER_SECTOR; pageItr < PAGE_COUNT; pageItr++)
+    {
+        for (uint16_t nodeItr = 0; nodeItr < BYTES_PER_PAGE/BASE_NODE_SIZE; nodeItr++)
+        {
+            dbflash_read_data_from_flash(&dbflash_descriptor, pageItr, BASE_NODE_SIZE*nodeItr, sizeof(nodeFlags), &nodeFlags);
+            
+            if (validBitFromFlags(nodeFlags) == NODEMGMT_VBIT_INVALID)
+            {
+                nodemgmt_node_bitmap_set_slot(constructAddress(pageItr, nodeItr), FALSE);
+            }
+        }
+    }
+    
+    nodemgmt_node_bitmap.valid = TRUE;
+}
+
+/*! \fn     nodemgmt_node_bitmap_get_next_free_slot(uint16_t slot, BOOL pair)
+*   \brief  Find the next free slot in the node usage bitmap, one 32 slots word at a time
+*   \param  slot        Slot to start looking from
+*   \param  pair        TRUE to look for a free slot followed by another free slot (child nodes)
+*   \return The slot found, NODEMGMT_NB_NODE_SLOTS if none
+*/
+static uint16_t nodemgmt_node_bitmap_get_next_free_slot(uint16_t slot, BOOL pair)
+{
+    for (uint16_t word_index = slot / 32; word_index < ARRAY_SIZE(nodemgmt_node_bitmap.used_slots); word_index++)
+    {
+        uint32_t free_slots = ~nodemgmt_node_bitmap.used_slots[word_index];
+        
+        // Only keep the slots followed by a free one, the last slot of the word being followed by the first one of the next word
+        if (pair != FALSE)
+        {
+            uint32_t next_free_slots = free_slots >> 1;
+            if (word_index < ARRAY_SIZE(nodemgmt_node_bitmap.used_slots) - 1)
+            {
+                next_free_slots |= (~nodemgmt_node_bitmap.used_slots[word_index + 1]) << 31;
+            }
+            free_slots &= next_free_slots;
+        }
+        
+        // Discard the slots before our start slot
+        if (word_index == slot / 32)
+        {
+            free_slots &= (0xFFFFFFFFUL << (slot % 32));
+        }
+        
+        if (free_slots != 0)
+        {
+            return word_index * 32 + __builtin_ctz(free_slots);
+        }
+    }
+    
+    return NODEMGMT_NB_NODE_SLOTS;
+}
+
+/*! \fn     nodemgmt_node_bitmap_find_free_nodes(uint16_t nbParentNodes, uint16_t* parentNodeArray, uint16_t nbChildtNodes, uint16_t* childNodeArray, uint16_t startPage, uint16_t startNode)
+*   \brief  Find free nodes using the node usage bitmap
+*   \param  nbParentNodes   Number of parent nodes we want to find
+*   \param  parentNodeArray An array where to store the addresses
+*   \param  nbChildtNodes   Number of child nodes we want to find
+*   \param  childNodeArray  An array where to store the addresses
+*   \param  startPage       Page where to start the scanning
+*   \param  startNode       Scan start node address inside the start page
+*   \return the number of nodes found
+*   \note   Same results as the flash scan: parent nodes first, then pairs of adjacent slots after the last parent node
+*/
+static uint16_t nodemgmt_node_bitmap_find_free_nodes(uint16_t nbParentNodes, uint16_t* parentNodeArray, uint16_t nbChildtNodes, uint16_t* childNodeArray, uint16_t startPage, uint16_t startNode)
+{
+    uint16_t nbParentNodesFound = 0;
+    uint16_t nbChildNodesFound = 0;
+    uint16_t slot;
+    
+    // Out of bounds start page
+    if (startPage >= PAGE_COUNT)
+    {
+        return 0;
+    }
+    slot = (startPage - PAGE_PER_SECTOR) * (BYTES_PER_PAGE / BASE_NODE_SIZE) + startNode;
+    
+    // Fill parent nodes first (only one block)
+    while (nbParentNodesFound != nbParentNodes)
+    {
+        slot = nodemgmt_node_bitmap_get_next_free_slot(slot, FALSE);
+        if (slot >= NODEMGMT_NB_NODE_SLOTS)
+        {
+            return nbParentNodesFound;
+        }
+        parentNodeArray[nbParentNodesFound++] = constructAddress(PAGE_PER_SECTOR + slot / (BYTES_PER_PAGE / BASE_NODE_SIZE), slot % (BYTES_PER_PAGE / BASE_NODE_SIZE));
+        slot++;
+    }
+    
+    // Then child nodes (two adjacent blocks)
+    while (nbChildNodesFound != nbChildtNodes)
+    {
+        slot = nodemgmt_node_bitmap_get_next_free_slot(slot, TRUE);
+        if (slot >= NODEMGMT_NB_NODE_SLOTS)
+        {
+            break;
+        }
+        childNodeArray[nbChildNodesFound++] = constructAddress(PAGE_PER_SECTOR + slot / (BYTES_PER_PAGE / BASE_NODE_SIZE), slot % (BYTES_PER_PAGE / BASE_NODE_SIZE));
+        slot += 2;
+    }
+    
+    return nbChildNodesFound+nbParentNodesFound;
+}
+
 /*! \fn     nodemgmt_write_parent_node_data_block_to_flash(uint16_t address, parent_node_t* parent_node)
 *   \brief  Write a parent node data block to flash
 *   \param  address     Where to write
@@ -268,6 +451,7 @@ void nodemgmt_write_parent_node_data_block_to_flash(uint16_t address, parent_nod
     nodemgmt_check_address_validity_and_lock(address);
     nodemgmt_user_id_to_flags(&(parent_node->cred_parent.flags), nodemgmt_current_handle.currentUserId);
     dbflash_write_data_to_flash(&dbflash_descriptor, nodemgmt_page_from_address(address), BASE_NODE_SIZE * nodemgmt_node_from_address(address), BASE_NODE_SIZE, (void*)parent_node->node_as_bytes);
+    nodemgmt_node_bitmap_set_slot(address, (validBitFromFlags(parent_node->cred_parent.flags) == NODEMGMT_VBIT_VALID)?TRUE:FALSE);
 }
 
 /*! \fn     nodemgmt_write_child_node_block_to_flash(uint16_t address, child_node_t* child_node, BOOL write_category)
@@ -296,6 +480,26 @@ void nodemgmt_write_child_node_block_to_flash(uint16_t address, child_node_t* ch
     nodemgmt_check_address_validity_and_lock(address);
     dbflash_write_data_to_flash(&dbflash_descriptor, nodemgmt_page_from_address(address), BASE_NODE_SIZE * nodemgmt_node_from_address(address), BASE_NODE_SIZE, (void*)child_node->node_as_bytes);
     dbflash_write_data_to_flash(&dbflash_descriptor, nodemgmt_page_from_address(nodemgmt_get_incremented_address(address)), BASE_NODE_SIZE * nodemgmt_node_from_address(nodemgmt_get_incremented_address(address)), BASE_NODE_SIZE, (void*)(&child_node->node_as_bytes[BASE_NODE_SIZE]));
+    
+    /* Update node usage */
+    nodemgmt_node_bitmap_set_slot(address, (validBitFromFlags(child_node->cred_child.flags) == NODEMGMT_VBIT_VALID)?TRUE:FALSE);
+    nodemgmt_node_bitmap_set_slot(nodemgmt_get_incremented_address(address), (validBitFromFlags(child_node->cred_child.fakeFlags) == NODEMGMT_VBIT_VALID)?TRUE:FALSE);
+}
+
+/*! \fn     nodemgmt_read_node_walk_data_from_flash(uint16_t address, uint16_t size, void* data)
+*   \brief  Read the start of a node, as done by the node list walks
+*   \param  address     Node address
+*   \param  size        Number of bytes to read
+*   \param  data        Where to store the data
+*   \note   Only goes through the dbflash page cache when a page holds several nodes: with one node per page, each cache miss would read a complete page to get a node header
+*/
+static void nodemgmt_read_node_walk_data_from_flash(uint16_t address, uint16_t size, void* data)
+{
+#if (BYTES_PER_PAGE > BASE_NODE_SIZE)
+    dbflash_read_data_from_page_cache(&dbflash_descriptor, nodemgmt_page_from_address(address), BASE_NODE_SIZE*nodemgmt_node_from_address(address), size, data);
+#else
+    dbflash_read_data_from_flash(&dbflash_descriptor, nodemgmt_page_from_address(address), BASE_NODE_SIZE*nodemgmt_node_from_address(address), size, data);
+#endif
 }
 
 /*! \fn     nodemgmt_read_parent_node_data_block_from_flash(uint16_t address, parent_node_t* parent_node)
@@ -306,7 +510,7 @@ void nodemgmt_write_child_node_block_to_flash(uint16_t address, child_node_t* ch
 void nodemgmt_read_parent_node_data_block_from_flash(uint16_t address, parent_node_t* parent_node)
 {
     nodemgmt_check_address_validity_and_lock(address);
-    dbflash_read_data_from_flash(&dbflash_descriptor, nodemgmt_page_from_address(address), BASE_NODE_SIZE * nodemgmt_node_from_address(address), sizeof(parent_node->node_as_bytes), (void*)parent_node->node_as_bytes);
+    nodemgmt_read_node_walk_data_from_flash(address, sizeof(parent_node->node_as_bytes), (void*)parent_node->node_as_bytes);
 }
 
 /*! \fn     nodemgmt_read_parent_node(uint16_t address, parent_node_t* parent_node, BOOL data_clean)
@@ -1004,7 +1208,7 @@ uint16_t nodemgmt_get_prev_child_node_for_cur_category(uint16_t search_start_chi
     
     /* Read flags and prev/next address */
     nodemgmt_check_address_validity_and_lock(prev_child_node_addr_to_scan);
-    dbflash_read_data_from_flash(&dbflash_descriptor, nodemgmt_page_from_address(prev_child_node_addr_to_scan), BASE_NODE_SIZE*nodemgmt_node_from_address(prev_child_node_addr_to_scan), sizeof(child_read_buffer), &child_read_buffer);
+    nodemgmt_read_node_walk_data_from_flash(prev_child_node_addr_to_scan, sizeof(child_read_buffer), &child_read_buffer);
     prev_child_node_addr_to_scan = child_node_pt->prevChildAddress;
     
     /* Loop */
@@ -1012,7 +1216,7 @@ uint16_t nodemgmt_get_prev_child_node_for_cur_category(uint16_t search_start_chi
     {
         /* Read flags and prev/next address */
         nodemgmt_check_address_validity_and_lock(prev_child_node_addr_to_scan);
-        dbflash_read_data_from_flash(&dbflash_descriptor, nodemgmt_page_from_address(prev_child_node_addr_to_scan), BASE_NODE_SIZE*nodemgmt_node_from_address(prev_child_node_addr_to_scan), sizeof(child_read_buffer), &child_read_buffer);
+        nodemgmt_read_node_walk_data_from_flash(prev_child_node_addr_to_scan, sizeof(child_read_buffer), &child_read_buffer);
 
         /* Check if it is of the current selected category */
         if ((nodemgmt_current_handle.currentCategoryFlags == 0) || (categoryFromFlags(child_node_pt->flags) == nodemgmt_current_handle.currentCategoryFlags))
@@ -1050,7 +1254,7 @@ uint16_t nodemgmt_get_next_child_node_for_cur_category(uint16_t search_start_chi
         
     /* Read flags and prev/next address */
     nodemgmt_check_address_validity_and_lock(search_start_child_addr);
-    dbflash_read_data_from_flash(&dbflash_descriptor, nodemgmt_page_from_address(search_start_child_addr), BASE_NODE_SIZE*nodemgmt_node_from_address(search_start_child_addr), sizeof(child_read_buffer), &child_read_buffer);
+    nodemgmt_read_node_walk_data_from_flash(search_start_child_addr, sizeof(child_read_buffer), &child_read_buffer);
     search_start_child_addr = child_node_pt->nextChildAddress;
 
     /* Use the other function */
@@ -1083,7 +1287,7 @@ uint16_t nodemgmt_check_for_logins_with_category_in_parent_node(uint16_t start_c
     {
         /* Read flags and prev/next address */
         nodemgmt_check_address_validity_and_lock(next_child_node_addr_to_scan);
-        dbflash_read_data_from_flash(&dbflash_descriptor, nodemgmt_page_from_address(next_child_node_addr_to_scan), BASE_NODE_SIZE*nodemgmt_node_from_address(next_child_node_addr_to_scan), sizeof(child_read_buffer), &child_read_buffer);
+        nodemgmt_read_node_walk_data_from_flash(next_child_node_addr_to_scan, sizeof(child_read_buffer), &child_read_buffer);
         
         /* Check if it is of the current selected category */
         if ((category_flags == 0) || (categoryFromFlags(child_node_pt->flags) == category_flags))
@@ -1099,6 +1303,103 @@ uint16_t nodemgmt_check_for_logins_with_category_in_parent_node(uint16_t start_c
     return NODE_ADDR_NULL;
 }
 
+/*! \fn     nodemgmt_category_cache_get_entry_index(uint16_t parent_addr)
+ *  \brief  Get the category cache entry a parent address maps to
+ *  \param  parent_addr     Parent node address
+ *  \return Entry index
+ */
+static inline uint16_t nodemgmt_category_cache_get_entry_index(uint16_t parent_addr)
+{
+    return (nodemgmt_page_from_address(parent_addr)*(BYTES_PER_PAGE/BASE_NODE_SIZE) + nodemgmt_node_from_address(parent_addr)) % NODEMGMT_CATEGORY_CACHE_SIZE;
+}
+
+/*! \fn     nodemgmt_category_cache_invalidate(void)
+ *  \brief  Drop all category cache entries
+ */
+void nodemgmt_category_cache_invalidate(void)
+{
+    _Static_assert(NODE_ADDR_NULL == 0, "Category cache reset relies on null address being 0");
+    memset(&nodemgmt_category_cache, 0, sizeof(nodemgmt_category_cache));
+}
+
+/*! \fn     nodemgmt_category_cache_invalidate_parent(uint16_t parent_addr)
+ *  \brief  Drop the category cache entry of a given parent, to be called when its children list changes
+ *  \param  parent_addr     Parent node address
+ */
+void nodemgmt_category_cache_invalidate_parent(uint16_t parent_addr)
+{
+    uint16_t entry_index = nodemgmt_category_cache_get_entry_index(parent_addr);
+    
+    if (nodemgmt_category_cache.parent_addresses[entry_index] == parent_addr)
+    {
+        nodemgmt_category_cache.parent_addresses[entry_index] = NODE_ADDR_NULL;
+    }
+}
+
+/*! \fn     nodemgmt_parent_has_logins_with_category(uint16_t parent_addr, uint16_t start_child_addr, uint16_t category_flags)
+ *  \brief  See if a parent node contains children that have the desired category, using the category cache
+ *  \param  parent_addr         Parent node address
+ *  \param  start_child_addr    Address of the parent first child
+ *  \param  category_flags      Desired category flags
+ *  \return TRUE if the parent has a child of the desired category (any category if 0)
+ *  \note   The children list is only walked the first time a parent is queried, its categories mask is then cached
+ */
+BOOL nodemgmt_parent_has_logins_with_category(uint16_t parent_addr, uint16_t start_child_addr, uint16_t category_flags)
+{
+    uint16_t entry_index = nodemgmt_category_cache_get_entry_index(parent_addr);
+    uint16_t next_child_node_addr_to_scan = start_child_addr;
+    uint16_t child_read_buffer[4];
+    uint16_t category_mask = 0;
+    
+    /* One bit per category value */
+    _Static_assert(NODEMGMT_CAT_MASK_FINAL < 8*MEMBER_SIZE(nodemgmt_category_cache_t, category_masks[0]), "Category mask too small");
+    
+    /* Hack to read flags & prev / next address, see nodemgmt_check_for_logins_with_category_in_parent_node */
+    child_cred_node_t* child_node_pt = (child_cred_node_t*)child_read_buffer;
+    
+    /* Cache miss: walk the children */
+    if ((parent_addr == NODE_ADDR_NULL) || (nodemgmt_category_cache.parent_addresses[entry_index] != parent_addr))
+    {
+        while (next_child_node_addr_to_scan != NODE_ADDR_NULL)
+        {
+            /* Read flags and prev/next address */
+            nodemgmt_check_address_validity_and_lock(next_child_node_addr_to_scan);
+            nodemgmt_read_node_walk_data_from_flash(next_child_node_addr_to_scan, sizeof(child_read_buffer), &child_read_buffer);
+            
+            // CATSEARCHLOGIC
+            category_mask |= (1 << categoryFromFlags(child_node_pt->flags));
+            
+            /* Go to next child if there's any */
+            next_child_node_addr_to_scan = child_node_pt->nextChildAddress;
+        }
+        
+        /* Store in cache */
+        if (parent_addr != NODE_ADDR_NULL)
+        {
+            nodemgmt_category_cache.parent_addresses[entry_index] = parent_addr;
+            nodemgmt_category_cache.category_masks[entry_index] = category_mask;
+        }
+    }
+    else
+    {
+        category_mask = nodemgmt_category_cache.category_masks[entry_index];
+    }
+    
+    /* Any category: only check for children */
+    if (category_flags == 0)
+    {
+        return (category_mask != 0)?TRUE:FALSE;
+    }
+    else if (category_flags <= NODEMGMT_CAT_MASK_FINAL)
+    {
+        return ((category_mask & (1 << category_flags)) != 0)?TRUE:FALSE;
+    }
+    else
+    {
+        return FALSE;
+    }
+}
+
 /*! \fn     nodemgmt_get_prev_parent_node_for_cur_category(uint16_t search_start_parent_addr, uint16_t credential_type_id)
  *  \brief  Gets the prev parent node for the current category
  *  \param  search_start_parent_addr    The parent address from which to start looking.
@@ -1138,8 +1439,8 @@ uint16_t nodemgmt_get_prev_parent_node_for_cur_category(uint16_t search_start_pa
         
         /* Check if the last node could work */
         nodemgmt_check_address_validity_and_lock(search_start_parent_addr);
-        dbflash_read_data_from_flash(&dbflash_descriptor, nodemgmt_page_from_address(search_start_parent_addr), BASE_NODE_SIZE*nodemgmt_node_from_address(search_start_parent_addr), sizeof(parent_read_buffer), &parent_read_buffer);
-        if (nodemgmt_check_for_logins_with_category_in_parent_node(parent_node_pt->nextChildAddress, nodemgmt_current_handle.currentCategoryFlags) != NODE_ADDR_NULL)
+        nodemgmt_read_node_walk_data_from_flash(search_start_parent_addr, sizeof(parent_read_buffer), &parent_read_buffer);
+        if (nodemgmt_parent_has_logins_with_category(search_start_parent_addr, parent_node_pt->nextChildAddress, nodemgmt_current_handle.currentCategoryFlags) != FALSE)
         {
                 return search_start_parent_addr;
         }
@@ -1147,7 +1448,7 @@ uint16_t nodemgmt_get_prev_parent_node_for_cur_category(uint16_t search_start_pa
     
     /* Read flags and prev/next address */
     nodemgmt_check_address_validity_and_lock(search_start_parent_addr);
-    dbflash_read_data_from_flash(&dbflash_descriptor, nodemgmt_page_from_address(search_start_parent_addr), BASE_NODE_SIZE*nodemgmt_node_from_address(search_start_parent_addr), sizeof(parent_read_buffer), &parent_read_buffer);
+    nodemgmt_read_node_walk_data_from_flash(search_start_parent_addr, sizeof(parent_read_buffer), &parent_read_buffer);
     prev_parent_node_addr_to_scan = parent_node_pt->prevParentAddress;
     
     /* Loop */
@@ -1155,10 +1456,10 @@ uint16_t nodemgmt_get_prev_parent_node_for_cur_category(uint16_t search_start_pa
     {
         /* Read flags and prev/next address */
         nodemgmt_check_address_validity_and_lock(prev_parent_node_addr_to_scan);
-        dbflash_read_data_from_flash(&dbflash_descriptor, nodemgmt_page_from_address(prev_parent_node_addr_to_scan), BASE_NODE_SIZE*nodemgmt_node_from_address(prev_parent_node_addr_to_scan), sizeof(parent_read_buffer), &parent_read_buffer);
+        nodemgmt_read_node_walk_data_from_flash(prev_parent_node_addr_to_scan, sizeof(parent_read_buffer), &parent_read_buffer);
 
         /* Check for logins with desired category */
-        if (nodemgmt_check_for_logins_with_category_in_parent_node(parent_node_pt->nextChildAddress, nodemgmt_current_handle.currentCategoryFlags) != NODE_ADDR_NULL)
+        if (nodemgmt_parent_has_logins_with_category(prev_parent_node_addr_to_scan, parent_node_pt->nextChildAddress, nodemgmt_current_handle.currentCategoryFlags) != FALSE)
         {
             return prev_parent_node_addr_to_scan;
         }
@@ -1213,11 +1514,11 @@ uint16_t nodemgmt_get_next_parent_node_for_cur_category(uint16_t search_start_pa
     {
         /* Read flags and prev/next address */
         nodemgmt_check_address_validity_and_lock(search_start_parent_addr);
-        dbflash_read_data_from_flash(&dbflash_descriptor, nodemgmt_page_from_address(search_start_parent_addr), BASE_NODE_SIZE*nodemgmt_node_from_address(search_start_parent_addr), sizeof(parent_read_buffer), &parent_read_buffer);
+        nodemgmt_read_node_walk_data_from_flash(search_start_parent_addr, sizeof(parent_read_buffer), &parent_read_buffer);
         next_parent_node_addr_to_scan = parent_node_pt->nextParentAddress;
         
         /* Check that the provided parent node actually belongs to the current category.... */
-        if (nodemgmt_check_for_logins_with_category_in_parent_node(parent_node_pt->nextChildAddress, nodemgmt_current_handle.currentCategoryFlags) == NODE_ADDR_NULL)
+        if (nodemgmt_parent_has_logins_with_category(search_start_parent_addr, parent_node_pt->nextChildAddress, nodemgmt_current_handle.currentCategoryFlags) == FALSE)
         {
             return NODE_ADDR_NULL;
         }
@@ -1234,10 +1535,10 @@ uint16_t nodemgmt_get_next_parent_node_for_cur_category(uint16_t search_start_pa
     {
         /* Read flags and prev/next address */
         nodemgmt_check_address_validity_and_lock(next_parent_node_addr_to_scan);
-        dbflash_read_data_from_flash(&dbflash_descriptor, nodemgmt_page_from_address(next_parent_node_addr_to_scan), BASE_NODE_SIZE*nodemgmt_node_from_address(next_parent_node_addr_to_scan), sizeof(parent_read_buffer), &parent_read_buffer);
+        nodemgmt_read_node_walk_data_from_flash(next_parent_node_addr_to_scan, sizeof(parent_read_buffer), &parent_read_buffer);
 
         /* Check for logins with desired category */
-        if (nodemgmt_check_for_logins_with_category_in_parent_node(parent_node_pt->nextChildAddress, nodemgmt_current_handle.currentCategoryFlags) != NODE_ADDR_NULL)
+        if (nodemgmt_parent_has_logins_with_category(next_parent_node_addr_to_scan, parent_node_pt->nextChildAddress, nodemgmt_current_handle.currentCategoryFlags) != FALSE)
         {
             /* Check for single credential */
             if (next_parent_node_addr_to_scan == search_start_parent_addr)
@@ -1299,9 +1600,42 @@ uint16_t nodemgmt_get_starting_parent_addr(uint16_t credential_type_id)
     return temp_address;
 }
 
+/*! \fn     nodemgmt_fletter_table_append_parent(uint16_t credential_type_id, cust_char_t fchar, uint16_t address)
+ *  \brief  Add a parent node to the first letter jump table being built, parents being given in list order
+ *  \param  credential_type_id  Credential type ID
+ *  \param  fchar               Parent service first letter
+ *  \param  address             Parent node address
+ */
+static void nodemgmt_fletter_table_append_parent(uint16_t credential_type_id, cust_char_t fchar, uint16_t address)
+{
+    // Only while the table is being built
+    if (nodemgmt_fletter_table.state != FLETTER_TABLE_BUILDING)
+    {
+        return;
+    }
+    
+    // Same first letter as the previous parent: nothing to do
+    if ((nodemgmt_fletter_table.nb_buckets != nodemgmt_fletter_table.slice_start[credential_type_id]) && (nodemgmt_fletter_table.first_chars[nodemgmt_fletter_table.nb_buckets-1] == fchar))
+    {
+        return;
+    }
+    
+    // Not enough space: fall back to flash walks
+    if (nodemgmt_fletter_table.nb_buckets >= NODEMGMT_FLETTER_TABLE_SIZE)
+    {
+        nodemgmt_fletter_table.state = FLETTER_TABLE_UNAVAILABLE;
+        return;
+    }
+    
+    // New bucket
+    nodemgmt_fletter_table.first_chars[nodemgmt_fletter_table.nb_buckets] = fchar;
+    nodemgmt_fletter_table.first_addresses[nodemgmt_fletter_table.nb_buckets++] = address;
+}
+
 /*! \fn     nodemgmt_get_last_parent_addr(uint16_t credential_type_id)
  *  \brief  Search the users last parent node
  *  \return The address
+ *  \note   Credential parents are added to the first letter jump table when it is being built
  */
 uint16_t nodemgmt_get_last_parent_addr(BOOL data_parent, uint16_t credential_type_id)
 {
@@ -1350,7 +1684,7 @@ uint16_t nodemgmt_get_last_parent_addr(BOOL data_parent, uint16_t credential_typ
          }
          
          /* Read flags and prev/next address */
-         dbflash_read_data_from_flash(&dbflash_descriptor, nodemgmt_page_from_address(next_parent_node_addr_to_scan), BASE_NODE_SIZE*nodemgmt_node_from_address(next_parent_node_addr_to_scan), sizeof(parent_read_buffer), &parent_read_buffer);
+         nodemgmt_read_node_walk_data_from_flash(next_parent_node_addr_to_scan, sizeof(parent_read_buffer), &parent_read_buffer);
 
          /* Check ownership & validity */
          if (nodemgmt_check_user_perm_from_flags(parent_node_pt->flags) != RETURN_OK)
@@ -1367,6 +1701,12 @@ uint16_t nodemgmt_get_last_parent_addr(BOOL data_parent, uint16_t credential_typ
          /* Store last parent first char */
          last_parent_fchar = parent_node_pt->service[0];
          
+         /* Fill jump table */
+         if (data_parent == FALSE)
+         {
+             nodemgmt_fletter_table_append_parent(credential_type_id, last_parent_fchar, next_parent_node_addr_to_scan);
+         }
+         
          /* Check for end condition */
          if (parent_node_pt->nextParentAddress == NODE_ADDR_NULL)
          {
@@ -1789,6 +2129,12 @@ uint16_t nodemgmt_find_free_nodes(uint16_t nbParentNodes, uint16_t* parentNodeAr
     {
         startPage = PAGE_PER_SECTOR;
     }
+    
+    // Use the node usage bitmap once built, instead of reading the flags of every slot
+    if (nodemgmt_node_bitmap.valid != FALSE)
+    {
+        return nodemgmt_node_bitmap_find_free_nodes(nbParentNodes, parentNodeArray, nbChildtNodes, childNodeArray, startPage, startNode);
+    }
 
     // for each page
     for(pageItr = startPage; pageItr < PAGE_COUNT; pageItr++)
@@ -1850,7 +2196,10 @@ uint16_t nodemgmt_find_free_nodes(uint16_t nbParentNodes, uint16_t* parentNodeAr
 */
 void nodemgmt_trigger_db_ext_changed_actions(void)
 {
-    // Scan last parent nodes
+    // Parent and children lists may have been changed
+    nodemgmt_invalidate_ram_caches();
+    
+    // Scan last parent nodes, rebuilds the first letter jump table
     nodemgmt_scan_for_last_parent_nodes();
 }
 
@@ -1990,11 +2339,27 @@ uint16_t nodemgmt_get_sec_preference_for_user_id(uint16_t userIdNum)
  */
 void nodemgmt_scan_for_last_parent_nodes(void)
 {
+    // First letter jump table is built along the way
+    nodemgmt_fletter_table.nb_buckets = 0;
+    nodemgmt_fletter_table.state = FLETTER_TABLE_BUILDING;
+    
     // Get last cred parents
     for (uint16_t i = 0; i < MEMBER_ARRAY_SIZE(nodemgmtHandle_t, lastCredParentNodes); i++)
     {
+        nodemgmt_fletter_table.slice_start[i] = nodemgmt_fletter_table.nb_buckets;
         nodemgmt_current_handle.lastCredParentNodes[i] = nodemgmt_get_last_parent_addr(FALSE, i);
-    }    
+        
+        // Invalid or unsorted list
+        if ((nodemgmt_current_handle.lastCredParentNodes[i] == NODE_ADDR_NULL) && (nodemgmt_current_handle.firstCredParentNodes[i] != NODE_ADDR_NULL))
+        {
+            nodemgmt_fletter_table.state = FLETTER_TABLE_UNAVAILABLE;
+        }
+    }
+    nodemgmt_fletter_table.slice_start[MEMBER_ARRAY_SIZE(nodemgmtHandle_t, lastCredParentNodes)] = nodemgmt_fletter_table.nb_buckets;
+    if (nodemgmt_fletter_table.state == FLETTER_TABLE_BUILDING)
+    {
+        nodemgmt_fletter_table.state = FLETTER_TABLE_VALID;
+    }
     
     // Get last data parents
     for (uint16_t i = 0; i < MEMBER_ARRAY_SIZE(nodemgmtHandle_t, lastDataParentNodes); i++)
@@ -2003,70 +2368,816 @@ void nodemgmt_scan_for_last_parent_nodes(void)
     }
 }
 
-/*! \fn     nodemgmt_get_user_language_for_user_id(uint16_t userIdNum)
- *  \brief  Get the user language for a given user id
- *  \return The user language id
+/*! \fn     nodemgmt_service_index_prefix_key(cust_char_t* service)
+ *  \brief  Compute the prefix key of a service name
+ *  \param  service     The service name
+ *  \return The prefix key
+ *  \note   Keys are ordered the same way utils_custchar_strncmp orders service names
  */
-uint16_t nodemgmt_get_user_language_for_user_id(uint16_t userIdNum)
+static inline uint32_t nodemgmt_service_index_prefix_key(cust_char_t* service)
 {
-    uint16_t offsetUserProfile;             // The offset of the user profile
-    uint16_t pageUserProfile;               // The page of the user profile
-    uint16_t language_id;                   // Fetched languageid
-    
-    if(userIdNum >= NB_MAX_USERS)
+    if (service[0] == 0)
     {
-        /* No debug... no reason it should get stuck here as the data format doesn't allow such values */
-        main_reboot();
+        return 0;
     }
-    
-    /* Get page and page offset for the specified user profile */
-    nodemgmt_get_user_profile_starting_offset(userIdNum, &pageUserProfile, &offsetUserProfile);
-    
-    /* Each user profile is within a page, data starting parent node is at the end of the favorites */
-    dbflash_read_data_from_flash(&dbflash_descriptor, pageUserProfile, offsetUserProfile + (size_t)offsetof(nodemgmt_userprofile_t, main_data.language_id), sizeof(language_id), &language_id);
-    
-    /* Check for invalid language id */
-    if (language_id >= custom_fs_get_number_of_languages())
+    else
     {
-        language_id = 0;
+        return ((uint32_t)service[0] << 16) | (uint32_t)service[1];
     }
-    
-    /* Return language id */
-    return language_id;
 }
 
-/*! \fn     nodemgmt_allow_new_change_number_increment(void)
- *  \brief  Allows new change number increment (called by usb / ble connect in case the user doesn't get logged out between device connections)
+/*! \fn     nodemgmt_service_index_slice_id(BOOL data_parent, uint16_t type_id)
+ *  \brief  Get the index slice ID for a given parent list
+ *  \param  data_parent TRUE for a data parent list
+ *  \param  type_id     Credential / data type ID
+ *  \return The slice ID
  */
-void nodemgmt_allow_new_change_number_increment(void)
+static inline uint16_t nodemgmt_service_index_slice_id(BOOL data_parent, uint16_t type_id)
 {
-    nodemgmt_current_handle.datadbChanged = FALSE;
-    nodemgmt_current_handle.dbChanged = FALSE;
-}    
-    
-/*! \fn     nodemgmt_init_context(uint16_t userIdNum, uint16_t* userSecFlags, uint16_t* userLanguage, uint16_t* userLayout, uint16_t* userBLELayout)
- *  \brief  Initializes the Node Management Handle, scans memory for the next free node
- *  \param  userIdNum       The user id to initialize the handle for
- *  \param  userSecFlags    Pointer to where to store user security flags
- *  \param  userLanguage    Pointer to where to store user language
- *  \param  userLayout      Pointer to where to store user keyboard layout
- *  \param  userBLELayout   Pointer to where to store user BLE keyboard layout
+    if (data_parent == FALSE)
+    {
+        return type_id;
+    }
+    else
+    {
+        return MEMBER_ARRAY_SIZE(nodemgmtHandle_t, firstCredParentNodes) + type_id;
+    }
+}
+
+/*! \fn     nodemgmt_service_index_invalidate(void)
+ *  \brief  Drop the service index, it will be rebuilt from flash on next use
  */
-void nodemgmt_init_context(uint16_t userIdNum, uint16_t* userSecFlags, uint16_t* userLanguage, uint16_t* userLayout, uint16_t* userBLELayout)
+void nodemgmt_service_index_invalidate(void)
 {
-    if(userIdNum >= NB_MAX_USERS)
+    nodemgmt_service_index.state = SERVICE_INDEX_DROPPED;
+}
+
+/*! \fn     nodemgmt_invalidate_ram_caches(void)
+ *  \brief  Drop all RAM copies of the database lists, to be called when the host may have changed them
+ */
+void nodemgmt_invalidate_ram_caches(void)
+{
+    nodemgmt_service_index_invalidate();
+    nodemgmt_fletter_table_invalidate();
+    nodemgmt_skip_index_invalidate();
+    nodemgmt_category_cache_invalidate();
+}
+
+/*! \fn     nodemgmt_service_index_disable(void)
+ *  \brief  Disable the service index until next login or external database change
+ *  \note   Used to benchmark the flash walk
+ */
+void nodemgmt_service_index_disable(void)
+{
+    nodemgmt_service_index.state = SERVICE_INDEX_UNAVAILABLE;
+}
+
+/*! \fn     nodemgmt_service_index_halve(uint16_t nb_slices)
+ *  \brief  Make room in a full service index by only keeping one entry out of two in each slice
+ *  \param  nb_slices   Number of slices filled so far, the last one ending at slice_start[nb_slices]
+ *  \note   Slice first entries are kept: the index then still starts with each list first parent
+ *  \note   Slice last entries are kept too, so that parents appended at a list end keep being indexed
+ *  \note   Appended parents counts are reset as they refer to the previous stride
+ */
+static void nodemgmt_service_index_halve(uint16_t nb_slices)
+{
+    uint16_t nb_kept_entries = 0;
+    
+    for (uint16_t i = 0; i < nb_slices; i++)
     {
-        /* No debug... no reason it should get stuck here as the data format doesn't allow such values */
-        main_reboot();
+        uint16_t slice_end = nodemgmt_service_index.slice_start[i+1];
+        uint16_t entry_id = nodemgmt_service_index.slice_start[i];
+        nodemgmt_service_index.slice_start[i] = nb_kept_entries;
+        
+        // Entries are moved towards the index start, the slice last one is kept as well
+        while (entry_id < slice_end)
+        {
+            nodemgmt_service_index.prefix_keys[nb_kept_entries] = nodemgmt_service_index.prefix_keys[entry_id];
+            nodemgmt_service_index.node_addresses[nb_kept_entries++] = nodemgmt_service_index.node_addresses[entry_id];
+            entry_id = ((entry_id + 2 >= slice_end) && (entry_id + 1 < slice_end))? slice_end - 1 : entry_id + 2;
+        }
     }
     
-    /* Sanity checks */
-    _Static_assert(MEMBER_ARRAY_SIZE(nodemgmtHandle_t, firstCredParentNodes) == MEMBER_ARRAY_SIZE(nodemgmt_profile_main_data_t, cred_start_addresses), "Cred start addresses array incorrect size");
-    _Static_assert(MEMBER_ARRAY_SIZE(nodemgmtHandle_t, firstDataParentNodes) == MEMBER_ARRAY_SIZE(nodemgmt_profile_main_data_t, data_start_addresses), "Data start addresses array incorrect size");
-    _Static_assert(sizeof(generic_node_t) == 2*BASE_NODE_SIZE, "Invalid Node Sizes");
-            
-    // fill current user id, first parent node address, user profile page & offset
-    nodemgmt_get_user_category_names_starting_offset(userIdNum, &nodemgmt_current_handle.pageUserCategoryStrings, &nodemgmt_current_handle.offsetUserCategoryStrings);
+    nodemgmt_service_index.slice_start[nb_slices] = nb_kept_entries;
+    nodemgmt_service_index.nb_entries = nb_kept_entries;
+    nodemgmt_service_index.stride *= 2;
+    
+    // Appended parents are counted again against the new stride
+    memset(nodemgmt_service_index.tail_lengths, 0, sizeof(nodemgmt_service_index.tail_lengths));
+}
+
+/*! \fn     nodemgmt_service_index_build(void)
+ *  \brief  Build the service index by browsing through all the current user parent lists
+ *  \return RETURN_OK if the index could be built
+ *  \note   Only the flags, addresses and first two service characters of each parent are read
+ *  \note   When there are more parents than entries, the index becomes sparse instead of being given up
+ *  \note   The list last parents are always indexed so that parents appended later can be indexed at the slice end
+ */
+RET_TYPE nodemgmt_service_index_build(void)
+{
+    uint16_t nb_cred_slices = MEMBER_ARRAY_SIZE(nodemgmtHandle_t, firstCredParentNodes);
+    uint16_t nb_slices = MEMBER_ARRAY_SIZE(nodemgmt_service_index_t, slice_start) - 1;
+    uint16_t next_parent_addr = NODE_ADDR_NULL;
+    uint16_t parent_read_buffer[6];
+    uint32_t prev_prefix_key = 0;
+    uint16_t node_position;
+    uint32_t prefix_key;
+    
+    /* Sanity check for this hack */
+    _Static_assert(offsetof(parent_cred_node_t, nextParentAddress) == offsetof(parent_data_node_t, nextParentAddress), "Incorrect reuse of parent node structure");
+    _Static_assert(offsetof(parent_cred_node_t, service) == offsetof(parent_data_node_t, service), "Incorrect reuse of parent node structure");
+    _Static_assert(sizeof(parent_read_buffer) == offsetof(parent_cred_node_t, service) + 2*sizeof(cust_char_t), "Incorrect buffer for flags & service prefix read");
+    
+    /* Hack to read flags, addresses & service prefix */
+    parent_cred_node_t* parent_node_pt = (parent_cred_node_t*)parent_read_buffer;
+    
+    /* Reset index */
+    memset(nodemgmt_service_index.tail_lengths, 0, sizeof(nodemgmt_service_index.tail_lengths));
+    nodemgmt_service_index.nb_entries = 0;
+    nodemgmt_service_index.stride = 1;
+    
+    for (uint16_t i = 0; i < nb_slices; i++)
+    {
+        nodemgmt_service_index.slice_start[i] = nodemgmt_service_index.nb_entries;
+        node_position = 0;
+        
+        // Credential parents first, then data parents
+        if (i < nb_cred_slices)
+        {
+            next_parent_addr = nodemgmt_current_handle.firstCredParentNodes[i];
+        }
+        else
+        {
+            next_parent_addr = nodemgmt_current_handle.firstDataParentNodes[i - nb_cred_slices];
+        }
+        
+        while (next_parent_addr != NODE_ADDR_NULL)
+        {
+            // Read beginning of parent node
+            nodemgmt_check_address_validity_and_lock(next_parent_addr);
+            dbflash_read_data_from_flash(&dbflash_descriptor, nodemgmt_page_from_address(next_parent_addr), BASE_NODE_SIZE * nodemgmt_node_from_address(next_parent_addr), sizeof(parent_read_buffer), (void*)parent_node_pt);
+            nodemgmt_check_user_perm_from_flags_and_lock(parent_node_pt->flags);
+            prefix_key = nodemgmt_service_index_prefix_key(parent_node_pt->service);
+            
+            // A list that isn't alphabetically sorted can't be binary searched
+            if ((node_position != 0) && (prefix_key < prev_prefix_key))
+            {
+                nodemgmt_service_index.state = SERVICE_INDEX_UNAVAILABLE;
+                return RETURN_NOK;
+            }
+            
+            // Not enough space: only keep one entry out of two
+            if ((((node_position % nodemgmt_service_index.stride) == 0) || (parent_node_pt->nextParentAddress == NODE_ADDR_NULL)) && (nodemgmt_service_index.nb_entries >= NODEMGMT_SERVICE_INDEX_SIZE))
+            {
+                nodemgmt_service_index.slice_start[i+1] = nodemgmt_service_index.nb_entries;
+                nodemgmt_service_index_halve(i+1);
+            }
+            
+            // Store entry for one parent out of stride and for the list last parent
+            if (((node_position % nodemgmt_service_index.stride) == 0) || (parent_node_pt->nextParentAddress == NODE_ADDR_NULL))
+            {
+                nodemgmt_service_index.prefix_keys[nodemgmt_service_index.nb_entries] = prefix_key;
+                nodemgmt_service_index.node_addresses[nodemgmt_service_index.nb_entries++] = next_parent_addr;
+            }
+            prev_prefix_key = prefix_key;
+            next_parent_addr = parent_node_pt->nextParentAddress;
+            node_position++;
+        }
+    }
+    
+    nodemgmt_service_index.slice_start[nb_slices] = nodemgmt_service_index.nb_entries;
+    nodemgmt_service_index.state = SERVICE_INDEX_VALID;
+    return RETURN_OK;
+}
+
+/*! \fn     nodemgmt_service_index_insert(uint16_t slice_id, uint16_t prev_address, uint16_t next_address, uint16_t address, cust_char_t* service)
+ *  \brief  Insert a newly created parent node in the service index
+ *  \param  slice_id        Index slice ID
+ *  \param  prev_address    Address of the parent node preceding the new one, NODE_ADDR_NULL if first
+ *  \param  next_address    Address of the parent node following the new one, NODE_ADDR_NULL if last
+ *  \param  address         Address of the new parent node
+ *  \param  service         Service name of the new parent node
+ *  \note   In a sparse index, one parent out of stride appended at the list end is indexed
+ */
+static void nodemgmt_service_index_insert(uint16_t slice_id, uint16_t prev_address, uint16_t next_address, uint16_t address, cust_char_t* service)
+{
+    uint16_t insert_pos = nodemgmt_service_index.slice_start[slice_id];
+    
+    // Dropped index will be rebuilt from flash, unavailable index stays so
+    if (nodemgmt_service_index.state != SERVICE_INDEX_VALID)
+    {
+        return;
+    }
+    
+    // Check for space: a full index becomes sparse
+    if (nodemgmt_service_index.nb_entries >= NODEMGMT_SERVICE_INDEX_SIZE)
+    {
+        nodemgmt_service_index_halve(MEMBER_ARRAY_SIZE(nodemgmt_service_index_t, slice_start) - 1);
+    }
+    
+    // Sparse index & new node appended at the list end: goes at the slice end once stride parents were appended
+    if ((nodemgmt_service_index.stride > 1) && (prev_address != NODE_ADDR_NULL) && (next_address == NODE_ADDR_NULL))
+    {
+        if (++nodemgmt_service_index.tail_lengths[slice_id] < nodemgmt_service_index.stride)
+        {
+            return;
+        }
+        nodemgmt_service_index.tail_lengths[slice_id] = 0;
+        insert_pos = nodemgmt_service_index.slice_start[slice_id+1];
+    }
+    else if (prev_address != NODE_ADDR_NULL)
+    {
+        // New node goes right after its previous node
+        while ((insert_pos < nodemgmt_service_index.slice_start[slice_id+1]) && (nodemgmt_service_index.node_addresses[insert_pos] != prev_address))
+        {
+            insert_pos++;
+        }
+        
+        // Previous node not found: not indexed in a sparse index, otherwise index is out of sync
+        if (insert_pos == nodemgmt_service_index.slice_start[slice_id+1])
+        {
+            if (nodemgmt_service_index.stride == 1)
+            {
+                nodemgmt_service_index.state = SERVICE_INDEX_DROPPED;
+            }
+            return;
+        }
+        insert_pos++;
+    }
+    
+    // Make room for the new entry
+    memmove(&nodemgmt_service_index.prefix_keys[insert_pos+1], &nodemgmt_service_index.prefix_keys[insert_pos], (nodemgmt_service_index.nb_entries - insert_pos)*sizeof(nodemgmt_service_index.prefix_keys[0]));
+    memmove(&nodemgmt_service_index.node_addresses[insert_pos+1], &nodemgmt_service_index.node_addresses[insert_pos], (nodemgmt_service_index.nb_entries - insert_pos)*sizeof(nodemgmt_service_index.node_addresses[0]));
+    nodemgmt_service_index.prefix_keys[insert_pos] = nodemgmt_service_index_prefix_key(service);
+    nodemgmt_service_index.node_addresses[insert_pos] = address;
+    nodemgmt_service_index.nb_entries++;
+    
+    // Shift the next slices
+    for (uint16_t i = slice_id + 1; i < MEMBER_ARRAY_SIZE(nodemgmt_service_index_t, slice_start); i++)
+    {
+        nodemgmt_service_index.slice_start[i]++;
+    }
+}
+
+/*! \fn     nodemgmt_service_index_get_search_start_addr(cust_char_t* name, BOOL data_parent, uint16_t type_id, uint16_t* start_address)
+ *  \brief  Use the service index to find the first parent node that doesn't come alphabetically before a given name
+ *  \param  name            The service name
+ *  \param  data_parent     TRUE to search in a data parent list
+ *  \param  type_id         Credential / data type ID
+ *  \param  start_address   Where to store the parent address to start comparing from, NODE_ADDR_NULL if all nodes come before
+ *  \return RETURN_OK if the index could be used, RETURN_NOK if the caller should walk the list from its start
+ *  \note   The index is lazily rebuilt if it was dropped
+ *  \note   A sparse index may return a parent coming before the name: callers walk the list from the returned parent
+ */
+RET_TYPE nodemgmt_service_index_get_search_start_addr(cust_char_t* name, BOOL data_parent, uint16_t type_id, uint16_t* start_address)
+{
+    /* Boundary checks */
+    if (((data_parent == FALSE) && (type_id >= MEMBER_ARRAY_SIZE(nodemgmtHandle_t, firstCredParentNodes))) || ((data_parent != FALSE) && (type_id >= MEMBER_ARRAY_SIZE(nodemgmtHandle_t, firstDataParentNodes))))
+    {
+        return RETURN_NOK;
+    }
+    
+    /* Rebuild if needed */
+    if (nodemgmt_service_index.state == SERVICE_INDEX_DROPPED)
+    {
+        nodemgmt_service_index_build();
+    }
+    if (nodemgmt_service_index.state != SERVICE_INDEX_VALID)
+    {
+        return RETURN_NOK;
+    }
+    
+    uint16_t slice_id = nodemgmt_service_index_slice_id(data_parent, type_id);
+    uint16_t high = nodemgmt_service_index.slice_start[slice_id+1];
+    uint16_t low = nodemgmt_service_index.slice_start[slice_id];
+    uint32_t prefix_key = nodemgmt_service_index_prefix_key(name);
+    
+    /* Binary search for the first entry whose prefix key isn't below the name one */
+    uint16_t slice_first_entry = low;
+    while (low < high)
+    {
+        uint16_t mid = low + (high - low)/2;
+        
+        if (nodemgmt_service_index.prefix_keys[mid] < prefix_key)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    
+    /* Sparse index: non indexed parents before that entry may not come before the name, start from the previous entry */
+    if ((nodemgmt_service_index.stride > 1) && (low != slice_first_entry))
+    {
+        low--;
+    }
+    
+    if (low == nodemgmt_service_index.slice_start[slice_id+1])
+    {
+        *start_address = NODE_ADDR_NULL;
+    }
+    else
+    {
+        *start_address = nodemgmt_service_index.node_addresses[low];
+    }
+    return RETURN_OK;
+}
+
+/*! \fn     nodemgmt_fletter_table_invalidate(void)
+ *  \brief  Drop the first letter jump table, it will be rebuilt from flash on next use
+ */
+void nodemgmt_fletter_table_invalidate(void)
+{
+    nodemgmt_fletter_table.state = FLETTER_TABLE_DROPPED;
+}
+
+/*! \fn     nodemgmt_fletter_table_insert(uint16_t credential_type_id, parent_node_t* p, uint16_t address)
+ *  \brief  Update the first letter jump table with a newly created credential parent node
+ *  \param  credential_type_id  Credential type ID
+ *  \param  p                   The new parent node, linked
+ *  \param  address             Address of the new parent node
+ */
+static void nodemgmt_fletter_table_insert(uint16_t credential_type_id, parent_node_t* p, uint16_t address)
+{
+    uint16_t bucket_id = nodemgmt_fletter_table.slice_start[credential_type_id];
+    cust_char_t fchar = p->cred_parent.service[0];
+    
+    // Dropped table will be rebuilt from flash, unavailable table stays so
+    if (nodemgmt_fletter_table.state != FLETTER_TABLE_VALID)
+    {
+        return;
+    }
+    
+    // Buckets are sorted
+    while ((bucket_id < nodemgmt_fletter_table.slice_start[credential_type_id+1]) && (nodemgmt_fletter_table.first_chars[bucket_id] < fchar))
+    {
+        bucket_id++;
+    }
+    
+    // Existing bucket: new node may now be its first one
+    if ((bucket_id < nodemgmt_fletter_table.slice_start[credential_type_id+1]) && (nodemgmt_fletter_table.first_chars[bucket_id] == fchar))
+    {
+        if (p->cred_parent.nextParentAddress == nodemgmt_fletter_table.first_addresses[bucket_id])
+        {
+            nodemgmt_fletter_table.first_addresses[bucket_id] = address;
+        }
+        return;
+    }
+    
+    // Check for space
+    if (nodemgmt_fletter_table.nb_buckets >= NODEMGMT_FLETTER_TABLE_SIZE)
+    {
+        nodemgmt_fletter_table.state = FLETTER_TABLE_UNAVAILABLE;
+        return;
+    }
+    
+    // Make room for the new bucket
+    memmove(&nodemgmt_fletter_table.first_chars[bucket_id+1], &nodemgmt_fletter_table.first_chars[bucket_id], (nodemgmt_fletter_table.nb_buckets - bucket_id)*sizeof(nodemgmt_fletter_table.first_chars[0]));
+    memmove(&nodemgmt_fletter_table.first_addresses[bucket_id+1], &nodemgmt_fletter_table.first_addresses[bucket_id], (nodemgmt_fletter_table.nb_buckets - bucket_id)*sizeof(nodemgmt_fletter_table.first_addresses[0]));
+    nodemgmt_fletter_table.first_chars[bucket_id] = fchar;
+    nodemgmt_fletter_table.first_addresses[bucket_id] = address;
+    nodemgmt_fletter_table.nb_buckets++;
+    
+    // Shift the next slices
+    for (uint16_t i = credential_type_id + 1; i < MEMBER_ARRAY_SIZE(nodemgmt_fletter_table_t, slice_start); i++)
+    {
+        nodemgmt_fletter_table.slice_start[i]++;
+    }
+}
+
+/*! \fn     nodemgmt_fletter_table_get_bucket_for_parent(uint16_t credential_type_id, uint16_t parent_addr, cust_char_t fchar, uint16_t* bucket_id, uint16_t* nb_buckets)
+ *  \brief  Use the first letter jump table to find the bucket of a parent node of the current category
+ *  \param  credential_type_id  Credential type ID
+ *  \param  parent_addr         Parent node address
+ *  \param  fchar               Parent service first letter
+ *  \param  bucket_id           Where to store the bucket ID, relative to the credential type buckets
+ *  \param  nb_buckets          Where to store the number of buckets for that credential type
+ *  \return RETURN_OK if the table can be used, RETURN_NOK if the caller should walk the parent list
+ *  \note   The table is lazily rebuilt if it was dropped
+ */
+RET_TYPE nodemgmt_fletter_table_get_bucket_for_parent(uint16_t credential_type_id, uint16_t parent_addr, cust_char_t fchar, uint16_t* bucket_id, uint16_t* nb_buckets)
+{
+    uint16_t parent_read_buffer[5];
+    
+    /* Boundary checks */
+    if ((credential_type_id >= MEMBER_ARRAY_SIZE(nodemgmtHandle_t, firstCredParentNodes)) || (parent_addr == NODE_ADDR_NULL))
+    {
+        return RETURN_NOK;
+    }
+    
+    /* Rebuild if needed */
+    if (nodemgmt_fletter_table.state == FLETTER_TABLE_DROPPED)
+    {
+        nodemgmt_scan_for_last_parent_nodes();
+    }
+    if (nodemgmt_fletter_table.state != FLETTER_TABLE_VALID)
+    {
+        return RETURN_NOK;
+    }
+    
+    /* Sanity check for this hack */
+    _Static_assert(6 == offsetof(parent_cred_node_t, nextChildAddress), "Incorrect buffer for flags & addr read");
+    _Static_assert(8 == offsetof(parent_cred_node_t, service), "Incorrect buffer for flags & addr read");
+    _Static_assert(sizeof(parent_read_buffer) == offsetof(parent_cred_node_t, service) + sizeof(cust_char_t), "Incorrect buffer for flags & addr read");
+    
+    /* Hack to read flags, addresses & service first letter */
+    parent_cred_node_t* parent_node_pt = (parent_cred_node_t*)parent_read_buffer;
+    nodemgmt_check_address_validity_and_lock(parent_addr);
+    nodemgmt_read_node_walk_data_from_flash(parent_addr, sizeof(parent_read_buffer), &parent_read_buffer);
+    
+    /* Parent should be of the current category and have the provided first letter */
+    if ((parent_node_pt->service[0] != fchar) || (nodemgmt_parent_has_logins_with_category(parent_addr, parent_node_pt->nextChildAddress, nodemgmt_current_handle.currentCategoryFlags) == FALSE))
+    {
+        return RETURN_NOK;
+    }
+    
+    /* Look for its bucket */
+    for (uint16_t i = nodemgmt_fletter_table.slice_start[credential_type_id]; i < nodemgmt_fletter_table.slice_start[credential_type_id+1]; i++)
+    {
+        if (nodemgmt_fletter_table.first_chars[i] == fchar)
+        {
+            *bucket_id = i - nodemgmt_fletter_table.slice_start[credential_type_id];
+            *nb_buckets = nodemgmt_fletter_table.slice_start[credential_type_id+1] - nodemgmt_fletter_table.slice_start[credential_type_id];
+            return RETURN_OK;
+        }
+    }
+    
+    return RETURN_NOK;
+}
+
+/*! \fn     nodemgmt_fletter_table_get_parent_for_cur_category(uint16_t credential_type_id, uint16_t bucket_id, uint16_t stop_address, cust_char_t* fchar)
+ *  \brief  Get the first parent node of a jump table bucket that has logins in the current category
+ *  \param  credential_type_id  Credential type ID
+ *  \param  bucket_id           Bucket ID, as returned by nodemgmt_fletter_table_get_bucket_for_parent
+ *  \param  stop_address        Parent address at which to stop looking, NODE_ADDR_NULL to look in the whole bucket
+ *  \param  fchar               Where to store the bucket first letter
+ *  \return The address or NODE_ADDR_NULL
+ *  \note   Only to be called after nodemgmt_fletter_table_get_bucket_for_parent returned RETURN_OK
+ */
+uint16_t nodemgmt_fletter_table_get_parent_for_cur_category(uint16_t credential_type_id, uint16_t bucket_id, uint16_t stop_address, cust_char_t* fchar)
+{
+    uint16_t table_index = nodemgmt_fletter_table.slice_start[credential_type_id] + bucket_id;
+    uint16_t next_parent_node_addr_to_scan = nodemgmt_fletter_table.first_addresses[table_index];
+    uint16_t parent_read_buffer[4];
+    
+    /* Sanity check for this hack */
+    _Static_assert(4 == offsetof(parent_cred_node_t, nextParentAddress), "Incorrect buffer for flags & addr read");
+    _Static_assert(6 == offsetof(parent_cred_node_t, nextChildAddress), "Incorrect buffer for flags & addr read");
+    
+    /* Hack to read flags & prev / next address */
+    parent_cred_node_t* parent_node_pt = (parent_cred_node_t*)parent_read_buffer;
+    
+    /* Bucket ends where the next one starts */
+    if (stop_address == NODE_ADDR_NULL)
+    {
+        if (table_index + 1 < nodemgmt_fletter_table.slice_start[credential_type_id+1])
+        {
+            stop_address = nodemgmt_fletter_table.first_addresses[table_index+1];
+        }
+    }
+    *fchar = nodemgmt_fletter_table.first_chars[table_index];
+    
+    /* Loop in the bucket parents */
+    while ((next_parent_node_addr_to_scan != NODE_ADDR_NULL) && (next_parent_node_addr_to_scan != stop_address))
+    {
+        /* Read flags and prev/next address */
+        nodemgmt_check_address_validity_and_lock(next_parent_node_addr_to_scan);
+        nodemgmt_read_node_walk_data_from_flash(next_parent_node_addr_to_scan, sizeof(parent_read_buffer), &parent_read_buffer);
+        
+        /* Check for logins with desired category */
+        if (nodemgmt_parent_has_logins_with_category(next_parent_node_addr_to_scan, parent_node_pt->nextChildAddress, nodemgmt_current_handle.currentCategoryFlags) != FALSE)
+        {
+            return next_parent_node_addr_to_scan;
+        }
+        
+        /* Store next address to scan */
+        next_parent_node_addr_to_scan = parent_node_pt->nextParentAddress;
+    }
+    
+    return NODE_ADDR_NULL;
+}
+
+/*! \fn     nodemgmt_skip_index_invalidate(void)
+ *  \brief  Drop the skip index, it will be rebuilt from flash on next parent creation
+ */
+void nodemgmt_skip_index_invalidate(void)
+{
+    nodemgmt_skip_index.state = SKIP_INDEX_DROPPED;
+    
+    // Parent lists were changed: the merge cursor node may be gone
+    nodemgmt_merge_cursor.parent_address = NODE_ADDR_NULL;
+}
+
+/*! \fn     nodemgmt_skip_index_disable(void)
+ *  \brief  Disable the skip index until next login or external database change
+ *  \note   Used to benchmark sorted inserts from the list start
+ */
+void nodemgmt_skip_index_disable(void)
+{
+    nodemgmt_skip_index.state = SKIP_INDEX_UNAVAILABLE;
+}
+
+/*! \fn     nodemgmt_skip_index_build(void)
+ *  \brief  Build the skip index by browsing through all the current user parent lists
+ *  \note   Every NODEMGMT_SKIP_INDEX_SPACING node becomes a checkpoint, until the index is full
+ */
+static void nodemgmt_skip_index_build(void)
+{
+    uint16_t nb_cred_slices = MEMBER_ARRAY_SIZE(nodemgmtHandle_t, firstCredParentNodes);
+    uint16_t nb_slices = MEMBER_ARRAY_SIZE(nodemgmt_skip_index_t, slice_start) - 1;
+    uint16_t next_parent_addr = NODE_ADDR_NULL;
+    uint16_t parent_read_buffer[6];
+    uint32_t prev_prefix_key;
+    uint32_t prefix_key;
+    
+    /* Sanity check for this hack */
+    _Static_assert(sizeof(parent_read_buffer) == offsetof(parent_cred_node_t, service) + 2*sizeof(cust_char_t), "Incorrect buffer for flags & service prefix read");
+    
+    /* Hack to read flags, addresses & service prefix */
+    parent_cred_node_t* parent_node_pt = (parent_cred_node_t*)parent_read_buffer;
+    
+    /* Reset index */
+    nodemgmt_skip_index.nb_checkpoints = 0;
+    
+    for (uint16_t i = 0; i < nb_slices; i++)
+    {
+        nodemgmt_skip_index.slice_start[i] = nodemgmt_skip_index.nb_checkpoints;
+        nodemgmt_skip_index.head_sizes[i] = 0;
+        prev_prefix_key = 0;
+        
+        // Credential parents first, then data parents
+        if (i < nb_cred_slices)
+        {
+            next_parent_addr = nodemgmt_current_handle.firstCredParentNodes[i];
+        }
+        else
+        {
+            next_parent_addr = nodemgmt_current_handle.firstDataParentNodes[i - nb_cred_slices];
+        }
+        
+        for (uint16_t list_position = 0; next_parent_addr != NODE_ADDR_NULL; list_position++)
+        {
+            // Read beginning of parent node
+            nodemgmt_check_address_validity_and_lock(next_parent_addr);
+            dbflash_read_data_from_flash(&dbflash_descriptor, nodemgmt_page_from_address(next_parent_addr), BASE_NODE_SIZE * nodemgmt_node_from_address(next_parent_addr), sizeof(parent_read_buffer), (void*)parent_node_pt);
+            nodemgmt_check_user_perm_from_flags_and_lock(parent_node_pt->flags);
+            prefix_key = nodemgmt_service_index_prefix_key(parent_node_pt->service);
+            
+            // Checkpoints can't be trusted in a list that isn't alphabetically sorted
+            if (prefix_key < prev_prefix_key)
+            {
+                nodemgmt_skip_index.state = SKIP_INDEX_UNAVAILABLE;
+                return;
+            }
+            prev_prefix_key = prefix_key;
+            
+            // New checkpoint if there's space
+            if (((list_position % NODEMGMT_SKIP_INDEX_SPACING) == 0) && (nodemgmt_skip_index.nb_checkpoints < NODEMGMT_SKIP_INDEX_SIZE))
+            {
+                nodemgmt_skip_index.prefix_keys[nodemgmt_skip_index.nb_checkpoints] = prefix_key;
+                nodemgmt_skip_index.node_addresses[nodemgmt_skip_index.nb_checkpoints] = next_parent_addr;
+                nodemgmt_skip_index.segment_sizes[nodemgmt_skip_index.nb_checkpoints++] = 0;
+            }
+            
+            // Count node in its segment
+            if (nodemgmt_skip_index.nb_checkpoints == nodemgmt_skip_index.slice_start[i])
+            {
+                nodemgmt_skip_index.head_sizes[i]++;
+            }
+            else
+            {
+                nodemgmt_skip_index.segment_sizes[nodemgmt_skip_index.nb_checkpoints-1]++;
+            }
+            next_parent_addr = parent_node_pt->nextParentAddress;
+        }
+    }
+    
+    nodemgmt_skip_index.slice_start[nb_slices] = nodemgmt_skip_index.nb_checkpoints;
+    nodemgmt_skip_index.state = SKIP_INDEX_VALID;
+}
+
+/*! \fn     nodemgmt_skip_index_get_insert_start_addr(uint16_t slice_id, cust_char_t* service, uint16_t* checkpoint_id)
+ *  \brief  Use the skip index to find the closest parent node that comes alphabetically before a new service
+ *  \param  slice_id        Index slice ID
+ *  \param  service         Service name of the parent node to be created
+ *  \param  checkpoint_id   Where to store the checkpoint ID to pass to nodemgmt_skip_index_insert
+ *  \return The checkpoint address or NODE_ADDR_NULL if the sorted insert should start from the list start
+ *  \note   The index is lazily rebuilt if it was dropped
+ */
+static uint16_t nodemgmt_skip_index_get_insert_start_addr(uint16_t slice_id, cust_char_t* service, uint16_t* checkpoint_id)
+{
+    uint32_t prefix_key = nodemgmt_service_index_prefix_key(service);
+    uint16_t low = nodemgmt_skip_index.slice_start[slice_id];
+    uint16_t high = nodemgmt_skip_index.slice_start[slice_id+1];
+    
+    /* Default: list start */
+    *checkpoint_id = NODEMGMT_SKIP_INDEX_SIZE;
+    
+    /* Rebuild if needed */
+    if (nodemgmt_skip_index.state == SKIP_INDEX_DROPPED)
+    {
+        nodemgmt_skip_index_build();
+        low = nodemgmt_skip_index.slice_start[slice_id];
+        high = nodemgmt_skip_index.slice_start[slice_id+1];
+    }
+    if (nodemgmt_skip_index.state != SKIP_INDEX_VALID)
+    {
+        return NODE_ADDR_NULL;
+    }
+    
+    /* Binary search for the first checkpoint whose prefix isn't strictly lower: services sharing a prefix may be on either side of the new one */
+    while (low < high)
+    {
+        uint16_t mid = low + (high - low) / 2;
+        if (nodemgmt_skip_index.prefix_keys[mid] < prefix_key)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    
+    /* Start from the checkpoint before */
+    if (low == nodemgmt_skip_index.slice_start[slice_id])
+    {
+        return NODE_ADDR_NULL;
+    }
+    else
+    {
+        *checkpoint_id = low - 1;
+        return nodemgmt_skip_index.node_addresses[low - 1];
+    }
+}
+
+/*! \fn     nodemgmt_skip_index_insert(uint16_t slice_id, uint16_t checkpoint_id, uint16_t address, cust_char_t* service)
+ *  \brief  Account for a newly created parent node in the skip index
+ *  \param  slice_id        Index slice ID
+ *  \param  checkpoint_id   Checkpoint ID the insert started from, as returned by nodemgmt_skip_index_get_insert_start_addr
+ *  \param  address         Address of the new parent node
+ *  \param  service         Service name of the new parent node
+ *  \note   The new node becomes a checkpoint when its segment gets twice as long as the nominal spacing
+ */
+static void nodemgmt_skip_index_insert(uint16_t slice_id, uint16_t checkpoint_id, uint16_t address, cust_char_t* service)
+{
+    uint16_t* segment_size_pt;
+    uint16_t insert_pos;
+    
+    // Dropped index will be rebuilt from flash, unavailable index stays so
+    if (nodemgmt_skip_index.state != SKIP_INDEX_VALID)
+    {
+        return;
+    }
+    
+    // Segment the node was inserted in
+    if (checkpoint_id == NODEMGMT_SKIP_INDEX_SIZE)
+    {
+        segment_size_pt = &nodemgmt_skip_index.head_sizes[slice_id];
+        insert_pos = nodemgmt_skip_index.slice_start[slice_id];
+    }
+    else
+    {
+        segment_size_pt = &nodemgmt_skip_index.segment_sizes[checkpoint_id];
+        insert_pos = checkpoint_id + 1;
+    }
+    (*segment_size_pt)++;
+    
+    // Split long segments if there's space
+    if ((*segment_size_pt <= 2*NODEMGMT_SKIP_INDEX_SPACING) || (nodemgmt_skip_index.nb_checkpoints >= NODEMGMT_SKIP_INDEX_SIZE))
+    {
+        return;
+    }
+    
+    // Make room for the new checkpoint, keys stay sorted as the new node comes after the checkpoint it was inserted from
+    memmove(&nodemgmt_skip_index.prefix_keys[insert_pos+1], &nodemgmt_skip_index.prefix_keys[insert_pos], (nodemgmt_skip_index.nb_checkpoints - insert_pos)*sizeof(nodemgmt_skip_index.prefix_keys[0]));
+    memmove(&nodemgmt_skip_index.node_addresses[insert_pos+1], &nodemgmt_skip_index.node_addresses[insert_pos], (nodemgmt_skip_index.nb_checkpoints - insert_pos)*sizeof(nodemgmt_skip_index.node_addresses[0]));
+    memmove(&nodemgmt_skip_index.segment_sizes[insert_pos+1], &nodemgmt_skip_index.segment_sizes[insert_pos], (nodemgmt_skip_index.nb_checkpoints - insert_pos)*sizeof(nodemgmt_skip_index.segment_sizes[0]));
+    nodemgmt_skip_index.prefix_keys[insert_pos] = nodemgmt_service_index_prefix_key(service);
+    nodemgmt_skip_index.node_addresses[insert_pos] = address;
+    nodemgmt_skip_index.nb_checkpoints++;
+    
+    // Position in the segment isn't known: split it in halves
+    nodemgmt_skip_index.segment_sizes[insert_pos] = *segment_size_pt / 2;
+    *segment_size_pt -= nodemgmt_skip_index.segment_sizes[insert_pos];
+    
+    // Shift the next slices
+    for (uint16_t i = slice_id + 1; i < MEMBER_ARRAY_SIZE(nodemgmt_skip_index_t, slice_start); i++)
+    {
+        nodemgmt_skip_index.slice_start[i]++;
+    }
+}
+
+/*! \fn     nodemgmt_merge_cursor_enable(void)
+ *  \brief  Start carrying on sorted parent inserts from the last created parent
+ *  \note   Called at bulk import start, services are then expected in alphabetical order
+ */
+void nodemgmt_merge_cursor_enable(void)
+{
+    nodemgmt_merge_cursor.parent_address = NODE_ADDR_NULL;
+    nodemgmt_merge_cursor.enabled = TRUE;
+}
+
+/*! \fn     nodemgmt_merge_cursor_disable(void)
+ *  \brief  Stop using the merge cursor for sorted parent inserts
+ */
+void nodemgmt_merge_cursor_disable(void)
+{
+    nodemgmt_merge_cursor.parent_address = NODE_ADDR_NULL;
+    nodemgmt_merge_cursor.enabled = FALSE;
+}
+
+/*! \fn     nodemgmt_merge_cursor_get_insert_start_addr(uint16_t slice_id, cust_char_t* service)
+ *  \brief  Check if a sorted parent insert can start from the merge cursor
+ *  \param  slice_id        Index slice ID
+ *  \param  service         Service name of the parent node to be created
+ *  \return The cursor address or NODE_ADDR_NULL if the new service doesn't come after it
+ */
+static uint16_t nodemgmt_merge_cursor_get_insert_start_addr(uint16_t slice_id, cust_char_t* service)
+{
+    if ((nodemgmt_merge_cursor.enabled == FALSE) || (nodemgmt_merge_cursor.parent_address == NODE_ADDR_NULL) || (nodemgmt_merge_cursor.slice_id != slice_id))
+    {
+        return NODE_ADDR_NULL;
+    }
+    
+    /* Out of order services are inserted from the skip index checkpoints */
+    nodemgmt_read_parent_node(nodemgmt_merge_cursor.parent_address, &nodemgmt_current_handle.temp_parent_node, FALSE);
+    if (utils_custchar_strncmp(service, nodemgmt_current_handle.temp_parent_node.cred_parent.service, MEMBER_ARRAY_SIZE(parent_cred_node_t, service)) > 0)
+    {
+        return nodemgmt_merge_cursor.parent_address;
+    }
+    else
+    {
+        return NODE_ADDR_NULL;
+    }
+}
+
+/*! \fn     nodemgmt_get_user_language_for_user_id(uint16_t userIdNum)
+ *  \brief  Get the user language for a given user id
+ *  \return The user language id
+ */
+uint16_t nodemgmt_get_user_language_for_user_id(uint16_t userIdNum)
+{
+    uint16_t offsetUserProfile;             // The offset of the user profile
+    uint16_t pageUserProfile;               // The page of the user profile
+    uint16_t language_id;                   // Fetched languageid
+    
+    if(userIdNum >= NB_MAX_USERS)
+    {
+        /* No debug... no reason it should get stuck here as the data format doesn't allow such values */
+        main_reboot();
+    }
+    
+    /* Get page and page offset for the specified user profile */
+    nodemgmt_get_user_profile_starting_offset(userIdNum, &pageUserProfile, &offsetUserProfile);
+    
+    /* Each user profile is within a page, data starting parent node is at the end of the favorites */
+    dbflash_read_data_from_flash(&dbflash_descriptor, pageUserProfile, offsetUserProfile + (size_t)offsetof(nodemgmt_userprofile_t, main_data.language_id), sizeof(language_id), &language_id);
+    
+    /* Check for invalid language id */
+    if (language_id >= custom_fs_get_number_of_languages())
+    {
+        language_id = 0;
+    }
+    
+    /* Return language id */
+    return language_id;
+}
+
+/*! \fn     nodemgmt_allow_new_change_number_increment(void)
+ *  \brief  Allows new change number increment (called by usb / ble connect in case the user doesn't get logged out between device connections)
+ */
+void nodemgmt_allow_new_change_number_increment(void)
+{
+    nodemgmt_current_handle.datadbChanged = FALSE;
+    nodemgmt_current_handle.dbChanged = FALSE;
+}    
+    
+/*! \fn     nodemgmt_init_context(uint16_t userIdNum, uint16_t* userSecFlags, uint16_t* userLanguage, uint16_t* userLayout, uint16_t* userBLELayout)
+ *  \brief  Initializes the Node Management Handle, scans memory for the next free node
+ *  \param  userIdNum       The user id to initialize the handle for
+ *  \param  userSecFlags    Pointer to where to store user security flags
+ *  \param  userLanguage    Pointer to where to store user language
+ *  \param  userLayout      Pointer to where to store user keyboard layout
+ *  \param  userBLELayout   Pointer to where to store user BLE keyboard layout
+ */
+void nodemgmt_init_context(uint16_t userIdNum, uint16_t* userSecFlags, uint16_t* userLanguage, uint16_t* userLayout, uint16_t* userBLELayout)
+{
+    if(userIdNum >= NB_MAX_USERS)
+    {
+        /* No debug... no reason it should get stuck here as the data format doesn't allow such values */
+        main_reboot();
+    }
+    
+    /* Sanity checks */
+    _Static_assert(MEMBER_ARRAY_SIZE(nodemgmtHandle_t, firstCredParentNodes) == MEMBER_ARRAY_SIZE(nodemgmt_profile_main_data_t, cred_start_addresses), "Cred start addresses array incorrect size");
+    _Static_assert(MEMBER_ARRAY_SIZE(nodemgmtHandle_t, firstDataParentNodes) == MEMBER_ARRAY_SIZE(nodemgmt_profile_main_data_t, data_start_addresses), "Data start addresses array incorrect size");
+    _Static_assert(sizeof(generic_node_t) == 2*BASE_NODE_SIZE, "Invalid Node Sizes");
+            
+    // fill current user id, first parent node address, user profile page & offset
+    nodemgmt_get_user_category_names_starting_offset(userIdNum, &nodemgmt_current_handle.pageUserCategoryStrings, &nodemgmt_current_handle.offsetUserCategoryStrings);
     nodemgmt_get_user_profile_starting_offset(userIdNum, &nodemgmt_current_handle.pageUserProfile, &nodemgmt_current_handle.offsetUserProfile);
     nodemgmt_current_handle.currentUserId = userIdNum;
     nodemgmt_current_handle.currentCategoryFlags = 0;
@@ -2089,7 +3200,23 @@ void nodemgmt_init_context(uint16_t userIdNum, uint16_t* userSecFlags, uint16_t*
     // Scan for last parent nodes
     nodemgmt_scan_for_last_parent_nodes();
     
+    // Build service index
+    nodemgmt_service_index_build();
+    
+    // Build node usage bitmap
+    nodemgmt_node_bitmap_build();
+    
+    // Category masks are computed when parents are browsed
+    nodemgmt_category_cache_invalidate();
+    
+    // Skip index is built on first parent creation
+    nodemgmt_skip_index_invalidate();
+    
+    // No bulk import in progress
+    nodemgmt_merge_cursor_disable();
+    
     // scan for next free parent and child nodes from the start of the memory
+    nodemgmt_current_handle.nextParentFreeNode = NODE_ADDR_NULL;
     nodemgmt_scan_node_usage();
     
     // Check if the number of known languages/layouts is different from the one we currently have, and reset the language if so
@@ -2174,11 +3301,15 @@ void nodemgmt_delete_children_list(uint16_t first_children_addr, BOOL data_child
         // Delete child data block
         dbflash_write_data_pattern_to_flash(&dbflash_descriptor, nodemgmt_page_from_address(next_child_addr), BASE_NODE_SIZE * nodemgmt_node_from_address(next_child_addr), BASE_NODE_SIZE, 0xFF);
         dbflash_write_data_pattern_to_flash(&dbflash_descriptor, nodemgmt_page_from_address(nodemgmt_get_incremented_address(next_child_addr)), BASE_NODE_SIZE * nodemgmt_node_from_address(nodemgmt_get_incremented_address(next_child_addr)), BASE_NODE_SIZE, 0xFF);
+        nodemgmt_node_bitmap_set_slot(next_child_addr, FALSE);
+        nodemgmt_node_bitmap_set_slot(nodemgmt_get_incremented_address(next_child_addr), FALSE);
         
         // Set correct next address
         next_child_addr = temp_address;
     }
     
+    // We don't know the parent address
+    nodemgmt_category_cache_invalidate();
 }
 
 /*! \fn     nodemgmt_delete_current_user_from_flash(void)
@@ -2200,6 +3331,12 @@ void nodemgmt_delete_current_user_from_flash(void)
     // Delete user profile memory
     nodemgmt_format_user_profile(nodemgmt_current_handle.currentUserId, 0, 0, 0, 0);
     
+    // Parent nodes are about to go away
+    nodemgmt_service_index_invalidate();
+    nodemgmt_category_cache_invalidate();
+    nodemgmt_fletter_table_invalidate();
+    nodemgmt_skip_index_invalidate();
+    
     // Then browse through all the credentials to delete them
     for (uint16_t i = 0; i < MEMBER_ARRAY_SIZE(nodemgmtHandle_t, firstCredParentNodes) + MEMBER_ARRAY_SIZE(nodemgmtHandle_t, firstDataParentNodes); i++)
     {
@@ -2228,6 +3365,7 @@ void nodemgmt_delete_current_user_from_flash(void)
             
             // Delete parent data block
             dbflash_write_data_pattern_to_flash(&dbflash_descriptor, nodemgmt_page_from_address(next_parent_addr), BASE_NODE_SIZE * nodemgmt_node_from_address(next_parent_addr), BASE_NODE_SIZE, 0xFF);
+            nodemgmt_node_bitmap_set_slot(next_parent_addr, FALSE);
             
             // Set correct next address
             next_parent_addr = temp_address;
@@ -2631,6 +3769,7 @@ RET_TYPE nodemgmt_create_generic_node(generic_node_t* g, node_type_te node_type,
 RET_TYPE nodemgmt_create_parent_node(parent_node_t* p, service_type_te type, uint16_t* storedAddress, uint16_t typeId)
 {
     uint16_t first_parent_addr, last_parent_addr, potential_new_fparent, potential_new_lparent;
+    uint16_t search_start_addr, merge_start_addr, checkpoint_id, slice_id;
     RET_TYPE temprettype;
     
     // Set the first parent address depending on the type
@@ -2658,18 +3797,33 @@ RET_TYPE nodemgmt_create_parent_node(parent_node_t* p, service_type_te type, uin
     // This is particular to parent nodes...
     p->cred_parent.nextChildAddress = NODE_ADDR_NULL;
     
+    // Start the sorted insert from the closest checkpoint if there's one
+    slice_id = nodemgmt_service_index_slice_id((type == SERVICE_CRED_TYPE)? FALSE:TRUE, typeId);
+    search_start_addr = nodemgmt_skip_index_get_insert_start_addr(slice_id, p->cred_parent.service, &checkpoint_id);
+    
+    // During bulk imports, sorted services come right after the previously created one
+    merge_start_addr = nodemgmt_merge_cursor_get_insert_start_addr(slice_id, p->cred_parent.service);
+    if (merge_start_addr != NODE_ADDR_NULL)
+    {
+        search_start_addr = merge_start_addr;
+    }
+    else if (search_start_addr == NODE_ADDR_NULL)
+    {
+        search_start_addr = first_parent_addr;
+    }
+    
     // Call nodemgmt_create_generic_node to add a node
     if (type == SERVICE_CRED_TYPE)
     {
-        temprettype = nodemgmt_create_generic_node((generic_node_t*)p, NODE_TYPE_PARENT, first_parent_addr, &potential_new_fparent, storedAddress, &potential_new_lparent);
+        temprettype = nodemgmt_create_generic_node((generic_node_t*)p, NODE_TYPE_PARENT, search_start_addr, &potential_new_fparent, storedAddress, &potential_new_lparent);
     }
     else
     {
-        temprettype = nodemgmt_create_generic_node((generic_node_t*)p, NODE_TYPE_PARENT_DATA, first_parent_addr, &potential_new_fparent, storedAddress, &potential_new_lparent);
+        temprettype = nodemgmt_create_generic_node((generic_node_t*)p, NODE_TYPE_PARENT_DATA, search_start_addr, &potential_new_fparent, storedAddress, &potential_new_lparent);
     }
     
-    // If the return is ok & we changed the first node address
-    if ((temprettype == RETURN_OK) && (first_parent_addr != potential_new_fparent))
+    // If the return is ok & we changed the first node address (can only happen when starting from the list start)
+    if ((temprettype == RETURN_OK) && (search_start_addr != potential_new_fparent))
     {
         if (type == SERVICE_CRED_TYPE)
         {
@@ -2694,6 +3848,19 @@ RET_TYPE nodemgmt_create_parent_node(parent_node_t* p, service_type_te type, uin
         }
     }
     
+    // Update service index, skip index, first letter jump table & merge cursor
+    if (temprettype == RETURN_OK)
+    {
+        nodemgmt_service_index_insert(slice_id, p->cred_parent.prevParentAddress, p->cred_parent.nextParentAddress, *storedAddress, p->cred_parent.service);
+        nodemgmt_skip_index_insert(slice_id, checkpoint_id, *storedAddress, p->cred_parent.service);
+        if (type == SERVICE_CRED_TYPE)
+        {
+            nodemgmt_fletter_table_insert(typeId, p, *storedAddress);
+        }
+        nodemgmt_merge_cursor.slice_id = slice_id;
+        nodemgmt_merge_cursor.parent_address = *storedAddress;
+    }
+    
     return temprettype;
 }
 
@@ -2729,5 +3896,8 @@ RET_TYPE nodemgmt_create_child_node(uint16_t pAddr, child_cred_node_t* c, uint16
         nodemgmt_write_parent_node_data_block_to_flash(pAddr, &nodemgmt_current_handle.temp_parent_node);
     }
     
+    // New child category
+    nodemgmt_category_cache_invalidate_parent(pAddr);
+    
     return temprettype;
 }  
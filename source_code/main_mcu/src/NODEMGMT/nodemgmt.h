@@ -71,6 +71,12 @@ typedef enum    {NODE_TYPE_PARENT = 0, NODE_TYPE_CHILD = 1, NODE_TYPE_PARENT_DAT
 #define NODEMGMT_CAT_MASK_FINAL                     0x000F
 #define NODEMGMT_CAT_MASK                           0x000F
 #define NODEMGMT_CAT_BITSHIFT                       0
+#define NODEMGMT_SERVICE_INDEX_SIZE                 256
+#define NODEMGMT_CATEGORY_CACHE_SIZE                128
+#define NODEMGMT_FLETTER_TABLE_SIZE                 64
+#define NODEMGMT_SKIP_INDEX_SIZE                    64
+#define NODEMGMT_SKIP_INDEX_SPACING                 64
+#define NODEMGMT_NB_NODE_SLOTS                      ((PAGE_COUNT - PAGE_PER_SECTOR) * (BYTES_PER_PAGE / BASE_NODE_SIZE))
 
 /* User security settings flags */
 #define USER_SEC_FLG_LOGIN_CONF             0x01
@@ -92,6 +98,13 @@ typedef enum    {NODE_TYPE_PARENT = 0, NODE_TYPE_CHILD = 1, NODE_TYPE_PARENT_DAT
     #error "Max number of bonding information too high"
 #endif
 
+/* Service index states */
+typedef enum    {SERVICE_INDEX_DROPPED = 0, SERVICE_INDEX_VALID = 1, SERVICE_INDEX_UNAVAILABLE = 2} nodemgmt_service_index_state_te;
+/* First letter jump table states */
+typedef enum    {FLETTER_TABLE_DROPPED = 0, FLETTER_TABLE_VALID = 1, FLETTER_TABLE_UNAVAILABLE = 2, FLETTER_TABLE_BUILDING = 3} nodemgmt_fletter_table_state_te;
+/* Skip index states */
+typedef enum    {SKIP_INDEX_DROPPED = 0, SKIP_INDEX_VALID = 1, SKIP_INDEX_UNAVAILABLE = 2} nodemgmt_skip_index_state_te;
+
 /* Credential types IDs */
 typedef enum    {NODEMGMT_STANDARD_CRED_TYPE_ID = 0, NODEMGMT_WEBAUTHN_CRED_TYPE_ID = 1} nodemgmt_cred_type_te;
 /* Data types IDs */
@@ -339,6 +352,62 @@ typedef struct
     uint16_t lastDataParentNodes[7];       // The addresses of the users last data parent nodes (read from flash. eg cache)
 } nodemgmtHandle_t;
 
+// Service index: RAM copy of the parent lists ordering, one slice per credential type then per data type
+typedef struct
+{
+    nodemgmt_service_index_state_te state;  // Index state (see enum)
+    uint16_t nb_entries;                    // Number of entries in the index
+    uint16_t stride;                        // 1 when all parents are indexed, otherwise sparse index: one parent out of stride, the list first and last parents at least
+    uint16_t slice_start[MEMBER_ARRAY_SIZE(nodemgmtHandle_t, firstCredParentNodes) + MEMBER_ARRAY_SIZE(nodemgmtHandle_t, firstDataParentNodes) + 1];
+    uint16_t tail_lengths[MEMBER_ARRAY_SIZE(nodemgmtHandle_t, firstCredParentNodes) + MEMBER_ARRAY_SIZE(nodemgmtHandle_t, firstDataParentNodes)];  // Sparse index: number of parents appended after each slice last entry
+    uint32_t prefix_keys[NODEMGMT_SERVICE_INDEX_SIZE];      // Service name prefix keys, same order as in flash
+    uint16_t node_addresses[NODEMGMT_SERVICE_INDEX_SIZE];   // Corresponding parent node addresses
+} nodemgmt_service_index_t;
+
+// Node usage bitmap: one bit per node slot after the user profiles sector, set when the slot is taken
+typedef struct
+{
+    BOOL valid;                             // Set once built
+    uint32_t used_slots[(NODEMGMT_NB_NODE_SLOTS + 31) / 32];
+} nodemgmt_node_bitmap_t;
+
+// Category cache: direct mapped, for each cached parent bit N of the mask is set when one of its children has category value N
+typedef struct
+{
+    uint16_t parent_addresses[NODEMGMT_CATEGORY_CACHE_SIZE];  // Cached parent addresses, NODE_ADDR_NULL when empty
+    uint16_t category_masks[NODEMGMT_CATEGORY_CACHE_SIZE];    // Corresponding children category masks
+} nodemgmt_category_cache_t;
+
+// First letter jump table: one bucket per distinct service first letter, one slice per credential type
+typedef struct
+{
+    nodemgmt_fletter_table_state_te state;  // Table state (see enum)
+    uint16_t nb_buckets;                    // Number of buckets in the table
+    uint16_t slice_start[MEMBER_ARRAY_SIZE(nodemgmtHandle_t, firstCredParentNodes) + 1];
+    cust_char_t first_chars[NODEMGMT_FLETTER_TABLE_SIZE];       // Service first letters, same order as in flash
+    uint16_t first_addresses[NODEMGMT_FLETTER_TABLE_SIZE];      // Address of the first parent node starting with that letter
+} nodemgmt_fletter_table_t;
+
+// Skip index: sparse checkpoints in the parent lists to start sorted inserts from, same slices as the service index
+typedef struct
+{
+    nodemgmt_skip_index_state_te state;      // Index state (see enum)
+    uint16_t nb_checkpoints;                // Number of checkpoints in the index
+    uint16_t slice_start[MEMBER_ARRAY_SIZE(nodemgmt_service_index_t, slice_start)];
+    uint16_t head_sizes[MEMBER_ARRAY_SIZE(nodemgmt_service_index_t, slice_start) - 1];     // Number of nodes before the first checkpoint of each slice
+    uint32_t prefix_keys[NODEMGMT_SKIP_INDEX_SIZE];     // Checkpoint service name prefix keys
+    uint16_t node_addresses[NODEMGMT_SKIP_INDEX_SIZE];  // Checkpoint parent node addresses
+    uint16_t segment_sizes[NODEMGMT_SKIP_INDEX_SIZE];   // Number of nodes from the checkpoint until the next one
+} nodemgmt_skip_index_t;
+
+// Merge cursor: during a bulk import, sorted parent inserts carry on from the last created parent
+typedef struct
+{
+    BOOL enabled;                           // Set between bulk import begin & end
+    uint16_t slice_id;                      // Index slice of the last created parent
+    uint16_t parent_address;                // Last created parent node address, NODE_ADDR_NULL if none
+} nodemgmt_merge_cursor_t;
+
 /* Inlines */
 
 /*! \fn     nodemgmt_user_id_to_flags(uint16_t *flags, uint8_t uid)
@@ -412,6 +481,9 @@ static inline node_type_te nodeTypeFromFlags(uint16_t flags)
 }
 
 /* Prototypes */
+RET_TYPE nodemgmt_fletter_table_get_bucket_for_parent(uint16_t credential_type_id, uint16_t parent_addr, cust_char_t fchar, uint16_t* bucket_id, uint16_t* nb_buckets);
+uint16_t nodemgmt_fletter_table_get_parent_for_cur_category(uint16_t credential_type_id, uint16_t bucket_id, uint16_t stop_address, cust_char_t* fchar);
+RET_TYPE nodemgmt_service_index_get_search_start_addr(cust_char_t* name, BOOL data_parent, uint16_t type_id, uint16_t* start_address);
 RET_TYPE nodemgmt_create_generic_node(generic_node_t* g, node_type_te node_type, uint16_t firstNodeAddress, uint16_t* newFirstNodeAddress, uint16_t* storedAddress, uint16_t* newLastNodeAddress);
 void nodemgmt_get_prev_favorite_and_category_index(int16_t category_index, int16_t favorite_index, int16_t* new_cat_index, int16_t* new_fav_index, BOOL navigate_across_categories);
 void nodemgmt_get_next_favorite_and_category_index(int16_t category_index, int16_t favorite_index, int16_t* new_cat_index, int16_t* new_fav_index, BOOL navigate_across_categories);
@@ -432,6 +504,7 @@ uint16_t nodemgmt_get_next_parent_node_for_cur_category(uint16_t search_start_pa
 RET_TYPE nodemgmt_create_parent_node(parent_node_t* p, service_type_te type, uint16_t* storedAddress, uint16_t typeId);
 RET_TYPE nodemgmt_store_bluetooth_bonding_information(nodemgmt_bluetooth_bonding_information_t* bonding_information);
 uint16_t nodemgmt_check_for_logins_with_category_in_parent_node(uint16_t start_child_addr, uint16_t category_flags);
+BOOL nodemgmt_parent_has_logins_with_category(uint16_t parent_addr, uint16_t start_child_addr, uint16_t category_flags);
 void nodemgmt_read_favorite(uint16_t categoryId, uint16_t favId, uint16_t* parentAddress, uint16_t* childAddress);
 void nodemgmt_read_favorite_for_current_category(uint16_t favId, uint16_t* parentAddress, uint16_t* childAddress);
 void nodemgmt_write_child_node_block_to_flash(uint16_t address, child_node_t* child_node, BOOL write_category);
@@ -454,6 +527,7 @@ uint16_t nodemgmt_get_prev_child_node_for_cur_category(uint16_t search_start_chi
 uint16_t nodemgmt_get_next_child_node_for_cur_category(uint16_t search_start_child_addr);
 uint16_t nodemgmt_get_last_parent_addr(BOOL data_parent, uint16_t credential_type_id);
 uint16_t nodemgmt_get_starting_parent_addr_for_category(uint16_t credential_type_id);
+RET_TYPE nodemgmt_check_user_node_start(uint16_t node_addr, node_type_te* node_type);
 RET_TYPE nodemgmt_check_user_permission(uint16_t node_addr, node_type_te* node_type);
 void nodemgmt_read_cred_child_node(uint16_t address, child_cred_node_t* child_node);
 RET_TYPE nodemgmt_store_data_node(child_data_node_t* node, uint16_t* storedAddress);
@@ -489,6 +563,8 @@ void nodemgmt_set_current_category_id(uint16_t catId);
 void nodemgmt_allow_new_change_number_increment(void);
 uint16_t nodemgmt_get_user_nb_known_languages(void);
 void nodemgmt_delete_current_user_from_flash(void);
+void nodemgmt_category_cache_invalidate_parent(uint16_t parent_addr);
+RET_TYPE nodemgmt_service_index_build(void);
 uint16_t nodemgmt_get_current_category_flags(void);
 void nodemgmt_store_user_layout(uint16_t layoutId);
 void nodemgmt_trigger_db_ext_changed_actions(void);
@@ -496,6 +572,16 @@ uint16_t nodemgmt_get_user_sec_preferences(void);
 uint32_t nodemgmt_get_cred_change_number(void);
 uint32_t nodemgmt_get_data_change_number(void);
 void nodemgmt_scan_for_last_parent_nodes(void);
+void nodemgmt_service_index_invalidate(void);
+void nodemgmt_invalidate_ram_caches(void);
+void nodemgmt_category_cache_invalidate(void);
+void nodemgmt_fletter_table_invalidate(void);
+void nodemgmt_skip_index_invalidate(void);
+void nodemgmt_skip_index_disable(void);
+void nodemgmt_merge_cursor_disable(void);
+void nodemgmt_merge_cursor_enable(void);
+void nodemgmt_node_bitmap_build(void);
+void nodemgmt_service_index_disable(void);
 void nodemgmt_set_current_date(uint16_t date);
 uint16_t nodemgmt_get_current_category(void);
 uint16_t nodemgmt_get_user_ble_layout(void);
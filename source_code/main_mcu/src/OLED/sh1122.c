@@ -26,6 +26,7 @@
 #include "driver_sercom.h"
 #include "driver_timer.h"
 #include "custom_fs.h"
+#include "profiler.h"
 #include "sh1122.h"
 #include "dma.h"
 
@@ -655,6 +656,8 @@ void sh1122_flush_frame_buffer_y_window(sh1122_descriptor_t* oled_descriptor, ui
 */
 void sh1122_flush_frame_buffer(sh1122_descriptor_t* oled_descriptor)
 {
+    PROFILER_BEGIN(PROFILER_OLED_FLUSH);
+    
     /* Wait for a possible ongoing previous flush */
     sh1122_check_for_flush_and_terminate(oled_descriptor);
     
@@ -814,6 +817,8 @@ void sh1122_flush_frame_buffer(sh1122_descriptor_t* oled_descriptor)
     /* Reset transition */
     oled_descriptor->loaded_transition = OLED_TRANS_NONE;
     emu_oled_flush();
+    
+    PROFILER_END(PROFILER_OLED_FLUSH);
 }
 #endif
 
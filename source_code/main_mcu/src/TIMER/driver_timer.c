@@ -23,6 +23,7 @@
 #include <asf.h>
 #include "smartcard_lowlevel.h"
 #include "platform_defines.h"
+#include "comms_aux_mcu.h"
 #include "driver_clocks.h"
 #include "driver_timer.h"
 #include "logic_device.h"
@@ -46,6 +47,8 @@ volatile allocatedTimerEntry_t context_allocatable_timers[NUMBER_OF_ALLOCATABLE_
 volatile timerEntry_t context_timers[TOTAL_NUMBER_OF_TIMERS];
 /* Bool set when MCU systic expired */
 volatile BOOL timer_systick_expired = TRUE;
+/* MCU systick value when the aux tx flood protection was armed */
+volatile uint32_t timer_systick_aux_tx_start;
 /* System tick */
 volatile uint32_t sysTick;
 /* timestamp set at the last "set date" message */
@@ -134,6 +137,27 @@ void TCC2_Handler(void)
     #endif    
 }
 
+/*! \fn     TC4_Handler(void)
+*   \brief  Called when the aux MCU had time to deal with our last message
+*/
+void TC4_Handler(void)
+{
+    #ifndef BOOTLOADER
+    if (TC4->COUNT16.INTFLAG.reg & TC_INTFLAG_MC0)
+    {
+        /* Compare interrupt: clear flag */
+        TC4->COUNT16.INTFLAG.reg = TC_INTFLAG_MC0;
+        
+        /* Stop counter */
+        while((TC4->COUNT16.STATUS.reg & TC_STATUS_SYNCBUSY) != 0);
+        TC4->COUNT16.CTRLA.reg = TC_CTRLA_SWRST;
+        
+        /* Send next message */
+        comms_aux_mcu_start_next_tx_transfer();
+    }
+    #endif
+}
+
 /*! \fn     TC3_Handler(void)
 *   \brief  Called when inactivity is detected
 */
@@ -243,6 +267,46 @@ void timer_arm_inactivity_timer(uint16_t nb_minutes)
 #endif
 }
 
+/*! \fn     timer_start_aux_tx_gap_timer(void)
+*   \brief  Start the timer sending the next message to the aux MCU once it expires
+*   \note   Called by the DMA interrupt
+*/
+void timer_start_aux_tx_gap_timer(void)
+{
+#ifndef EMULATOR_BUILD
+    /* Disable first, in case */
+    while((TC4->COUNT16.STATUS.reg & TC_STATUS_SYNCBUSY) != 0);
+    TC4->COUNT16.CTRLA.reg = TC_CTRLA_SWRST;
+    
+    /* Set compare channel 0 value */
+    while((TC4->COUNT16.STATUS.reg & TC_STATUS_SYNCBUSY) != 0);
+    TC4->COUNT16.CC[0].reg = TC4_VAL_FOR_AUX_TX_GAP;
+    
+    /* Enable counter, 16 bits, 16 prescaler */
+    while((TC4->COUNT16.STATUS.reg & TC_STATUS_SYNCBUSY) != 0);
+    TC4->COUNT16.CTRLA.reg = TC_CTRLA_ENABLE | TC_CTRLA_MODE_COUNT16_Val | TC_CTRLA_PRESCALER_DIV16;
+    
+    /* Enable interrupt */
+    TC4->COUNT16.INTENSET.reg = TC_INTENSET_MC0;
+#else
+    /* Messages are sent right away, no need to wait */
+    comms_aux_mcu_start_next_tx_transfer();
+#endif
+}
+
+/*! \fn     timer_stop_aux_tx_gap_timer(void)
+*   \brief  Stop the timer sending the next message to the aux MCU
+*   \note   Called with IRQs disabled
+*/
+void timer_stop_aux_tx_gap_timer(void)
+{
+#ifndef EMULATOR_BUILD
+    /* Reset timer: stops it and clears its interrupt flags */
+    while((TC4->COUNT16.STATUS.reg & TC_STATUS_SYNCBUSY) != 0);
+    TC4->COUNT16.CTRLA.reg = TC_CTRLA_SWRST;
+#endif
+}
+
 /*! \fn     timer_initialize_timebase(void)
 *   \brief  Initialize the platform time base
 *   \note   Will use GCLK3 for a 1.024KHz and uses the RTC module in calendar mode
@@ -330,8 +394,18 @@ void timer_initialize_timebase(void)
     /* Prepare for potential inactivity timer */
     PM->APBCMASK.bit.TC3_ = 1;                                          // Enable APBC clock for TC3
     
+    /* Prepare for aux MCU tx gap timer, 48MHz GCLK0 */
+    clocks_map_gclk_to_peripheral_clock(GCLK_ID_48M, GCLK_CLKCTRL_ID_TC4_TC5_Val);
+    PM->APBCMASK.bit.TC4_ = 1;                                          // Enable APBC clock for TC4
+    NVIC_EnableIRQ(TC4_IRQn);                                           // Enable int
+    
     /* Store default osculp32k calibration value */
     timer_default_OSCULP32K_calib_val = SYSCTRL->OSCULP32K.bit.CALIB;
+    
+    /* Free running MCU systick: full 24bits reload, no interrupt */
+    SysTick->LOAD = 0x00FFFFFF;
+    SysTick->VAL = 0;
+    SysTick->CTRL = 0x01;
 #endif
 }
 
@@ -615,42 +689,31 @@ void timer_ms_tick(void)
     #endif
 }
 
-#ifndef EMULATOR_BUILD
-/*!	\fn		SysTick_Handler(void)
-*	\brief	Called by MCU systick at timeout
-*/
-void SysTick_Handler(void)
-{
-    /* Disable systick */
-    SysTick->CTRL = 0;
-    timer_systick_expired = TRUE;
-}
-#endif
-
 /*!	\fn		timer_wait_for_aux_tx_flood_protection(void)
 *	\brief	Wait for the MCU systick timeout
+*   \note   The systick is free running and wraps every ~350ms: after that we may wait up to 150us for nothing
 */
 void timer_wait_for_aux_tx_flood_protection(void)
 {
-    while(timer_systick_expired == FALSE);
+    #ifndef EMULATOR_BUILD
+    if (timer_systick_expired == FALSE)
+    {
+        /* Down counter: elapsed ticks are start - current */
+        while (((timer_systick_aux_tx_start - SysTick->VAL) & 0x00FFFFFF) < MCU_SYSTICK_VAL_FOR_AUX_RX_TO);
+        timer_systick_expired = TRUE;
+    }
+    #endif
 }
 
 /*!	\fn		timer_arm_mcu_systick_for_aux_tx_flood_protection(void)
-*	\brief	Arm MCU systick in countdown mode to implement a timeout
+*	\brief	Store the free running MCU systick value to implement a timeout
 *   \note   This function is called by interrupt from the DMA TX done
 */
 void timer_arm_mcu_systick_for_aux_tx_flood_protection(void)
 {
     #ifndef EMULATOR_BUILD
-    /* Reset Booleans */
+    timer_systick_aux_tx_start = SysTick->VAL;
     timer_systick_expired = FALSE;
-    
-    /* Set defined timeout value */
-    SysTick->LOAD = MCU_SYSTICK_VAL_FOR_AUX_RX_TO;
-    SysTick->VAL = 0;
-    
-    /* Use reference clock, generate interrupt and enable counter */
-    SysTick->CTRL = 0x03;
     #endif
 }
 
@@ -658,6 +721,7 @@ void timer_arm_mcu_systick_for_aux_tx_flood_protection(void)
 *	\brief	Get MCU systick
 *   \param  value   Pointer to where to store the value
 *   \return Bool indicating if the counter has overflowed
+*   \note   24bits down counter at 48MHz, free running
 */
 BOOL timer_get_mcu_systick(uint32_t* value)
 {
@@ -674,10 +738,73 @@ BOOL timer_get_mcu_systick(uint32_t* value)
     }
 #else
     /* for portability, use qt's timers */
-    return emu_get_systick(value);
+    BOOL wrapped = emu_get_systick(value);
+    
+    /* emulated ticks count up */
+    *value = 0x00FFFFFF - *value;
+    return wrapped;
 #endif
 }
 
+#ifdef EMULATOR_BUILD
+/*!	\fn		timer_get_ms_to_next_deadline(void)
+*	\brief	Get the number of ms before the next running timer expires
+*   \return Number of ms, 0 if no timer is running
+*   \note   Used by the virtual time emulator to skip idle waits
+*/
+uint32_t timer_get_ms_to_next_deadline(void)
+{
+    uint32_t next_deadline = 0;
+    uint32_t i;
+    
+    for (i = 0; i < TOTAL_NUMBER_OF_TIMERS; i++)
+    {
+        if ((context_timers[i].timer_val != 0) && ((next_deadline == 0) || (context_timers[i].timer_val < next_deadline)))
+        {
+            next_deadline = context_timers[i].timer_val;
+        }
+    }
+    
+    for (i = 0; i < NUMBER_OF_ALLOCATABLE_TIMERS; i++)
+    {
+        if ((context_allocatable_timers[i].timer_val != 0) && ((next_deadline == 0) || (context_allocatable_timers[i].timer_val < next_deadline)))
+        {
+            next_deadline = context_allocatable_timers[i].timer_val;
+        }
+    }
+    
+    return next_deadline;
+}
+
+/*!	\fn		timer_get_emulated_rtc_state(uint32_t* rtc_cnt, uint32_t* last_set_timestamp)
+*	\brief	Get the emulated RTC counters
+*   \param  rtc_cnt             Where to store the RTC counter
+*   \param  last_set_timestamp  Where to store the timestamp set at the last "set date" message
+*   \note   Used by emulator snapshots
+*/
+void timer_get_emulated_rtc_state(uint32_t* rtc_cnt, uint32_t* last_set_timestamp)
+{
+    cpu_irq_enter_critical();
+    *rtc_cnt = timer_emulator_fake_rtc_cnt;
+    *last_set_timestamp = timer_last_set_timestamp;
+    cpu_irq_leave_critical();
+}
+
+/*!	\fn		timer_set_emulated_rtc_state(uint32_t rtc_cnt, uint32_t last_set_timestamp)
+*	\brief	Set the emulated RTC counters
+*   \param  rtc_cnt             The RTC counter
+*   \param  last_set_timestamp  The timestamp set at the last "set date" message
+*   \note   Used by emulator snapshots
+*/
+void timer_set_emulated_rtc_state(uint32_t rtc_cnt, uint32_t last_set_timestamp)
+{
+    cpu_irq_enter_critical();
+    timer_emulator_fake_rtc_cnt = rtc_cnt;
+    timer_last_set_timestamp = last_set_timestamp;
+    cpu_irq_leave_critical();
+}
+#endif
+
 /*!	\fn		timer_get_systick(void)
 *	\brief	Get system timer
 *   \return The system time in ms since boot
@@ -874,7 +1001,12 @@ void timer_delay_ms(uint32_t ms)
 {
 #ifndef BOOTLOADER
     timer_start_timer(TIMER_WAITING_FUNCT, ms+1);
-    while(timer_has_timer_expired(TIMER_WAITING_FUNCT, TRUE) != TIMER_EXPIRED);
+    while(timer_has_timer_expired(TIMER_WAITING_FUNCT, TRUE) != TIMER_EXPIRED)
+    {
+        #ifdef EMULATOR_BUILD
+        emu_idle_wait();
+        #endif
+    }
 #else
     DELAYMS(ms);
 #endif
@@ -61,10 +61,10 @@ typedef enum {TIMER_EXPIRED = 0, TIMER_RUNNING = 1} timer_flag_te;
     
 /* Macros */
 #ifdef EMULATOR_BUILD
-#include <unistd.h>
-#define DELAYUS(us)                 usleep(us)
-#define DELAYMS(ms)                 usleep((ms)*1000)
-#define DELAYMS_8M(ms)              usleep((ms)*1000)
+void emu_delay_us(uint32_t us);
+#define DELAYUS(us)                 emu_delay_us(us)
+#define DELAYMS(ms)                 emu_delay_us((ms)*1000)
+#define DELAYMS_8M(ms)              emu_delay_us((ms)*1000)
 #else
 #define CYCLES_IN_DLYTICKS_FUNC     8
 #define US_TO_DLYTICKS(us)          (uint32_t)((CPU_SPEED_HF / 1000000UL) * us / CYCLES_IN_DLYTICKS_FUNC)
@@ -100,6 +100,8 @@ uint64_t driver_timer_get_rtc_timestamp_uint64t(void);
 uint32_t driver_timer_get_rtc_timestamp_uint32t(void);
 void timer_arm_inactivity_timer(uint16_t nb_minutes);
 void timer_wait_for_aux_tx_flood_protection(void);
+void timer_start_aux_tx_gap_timer(void);
+void timer_stop_aux_tx_gap_timer(void);
 uint16_t timer_get_and_start_timer(uint32_t val);
 void timer_deallocate_timer(uint16_t timer_id);
 uint32_t timer_get_timer_val(timer_id_te uid);
@@ -108,5 +110,10 @@ void timer_initialize_timebase(void);
 uint32_t timer_get_systick(void);
 void timer_delay_ms(uint32_t ms);
 void timer_ms_tick(void);
+#ifdef EMULATOR_BUILD
+uint32_t timer_get_ms_to_next_deadline(void);
+void timer_get_emulated_rtc_state(uint32_t* rtc_cnt, uint32_t* last_set_timestamp);
+void timer_set_emulated_rtc_state(uint32_t rtc_cnt, uint32_t last_set_timestamp);
+#endif
 
 #endif /* TIMER_H_ */
@@ -35,6 +35,9 @@
 #include "main.h"
 #include "rng.h"
 #include "dma.h"
+#ifdef EMULATOR_BUILD
+#include "emu_session.h"
+#endif
 
 /* Our oled & dataflash & dbflash descriptors */
 accelerometer_descriptor_t plat_acc_descriptor = {.sercom_pt = ACC_SERCOM, .cs_pin_group = ACC_nCS_GROUP, .cs_pin_mask = ACC_nCS_MASK, .int_pin_group = ACC_INT_GROUP, .int_pin_mask = ACC_INT_MASK, .evgen_sel = ACC_EV_GEN_SEL, .evgen_channel = ACC_EV_GEN_CHANNEL, .dma_channel = 3};
@@ -264,7 +267,9 @@ void main_platform_init(void)
     if (comms_aux_mcu_send_receive_ping() != RETURN_OK)
     {
         /* Try to reset our comms link */
+        comms_aux_mcu_wait_for_message_sent();
         dma_aux_mcu_disable_transfer();
+        comms_aux_mcu_reset_tx_ring();
         comms_aux_arm_rx_and_clear_no_comms();
         
         /* Try again */
@@ -313,6 +318,9 @@ void main_platform_init(void)
     }
 #endif
     
+    /* Only send the bytes that matter to the aux MCU if its firmware supports it */
+    comms_aux_mcu_negotiate_framing();
+    
     /* If debugger attached, let the aux mcu know it shouldn't use the no comms signal */
     if (debugger_present != FALSE)
     {
@@ -596,6 +604,7 @@ void main_standby_sleep(void)
             
             /* Disable aux MCU dma transfers */
             dma_aux_mcu_disable_transfer();
+            comms_aux_mcu_reset_tx_ring();
         }
     
         /* Wait for accelerometer DMA transfer end and put it to sleep */
@@ -764,6 +773,15 @@ int main(void)
         gui_dispatcher_get_back_to_current_screen();
     }
     
+    #ifdef EMULATOR_BUILD
+    /* Started from a snapshot taken with a logged in user: skip the PIN prompt */
+    if (emu_session_restore() != FALSE)
+    {
+        gui_dispatcher_set_current_screen(GUI_SCREEN_MAIN_MENU, TRUE, GUI_INTO_MENU_TRANSITION);
+        gui_dispatcher_get_back_to_current_screen();
+    }
+    #endif
+    
     /* Infinite loop */
     while(TRUE)
     {
@@ -812,6 +830,7 @@ int main(void)
             /* Clear bool */
             logic_device_activity_detected();
             logic_security_clear_management_mode();
+            logic_user_bulk_import_end();
 
             /* Set next screen */
             gui_dispatcher_set_current_screen(GUI_SCREEN_MAIN_MENU, TRUE, GUI_INTO_MENU_TRANSITION);
@@ -842,8 +861,8 @@ int main(void)
                 #endif
             }
             
-            /* TX buffer re requested problem */
-            if (comms_aux_mcu_get_and_clear_second_tx_buffer_rerequested() != FALSE)
+            /* TX slots exhausted problem */
+            if (comms_aux_mcu_get_and_clear_tx_slots_exhausted() != FALSE)
             {
                 gui_prompts_display_information_on_screen_and_wait(CONTACT_SUPPORT_007_TEXT_ID, DISP_MSG_WARNING, FALSE);
                 gui_dispatcher_get_back_to_current_screen();
@@ -268,6 +268,7 @@
      #define BOD_NOT_ENABLED
      #define DBFLASH_CHIP_8M
      #define STACK_MEASURE_ENABLED
+     #define HOT_PATH_PROFILER_ENABLED
 #elif defined(PLAT_V7_SETUP)
      #define BOD_NOT_ENABLED
      #define DBFLASH_CHIP_8M
@@ -278,6 +279,11 @@
     #undef DEVELOPER_FEATURES_ENABLED
 #endif
 
+/* The bootloader doesn't ship the profiler */
+#if defined(BOOTLOADER)
+    #undef HOT_PATH_PROFILER_ENABLED
+#endif
+
 /* Developer features */
 #ifdef DEVELOPER_FEATURES_ENABLED
     #define DEV_SKIP_INTRO_ANIM
@@ -593,6 +599,8 @@ typedef struct
 
 /* Value set inside the MCU systick timer to not send 2 messages to the AUX MCU too close to each other (as the AUX DMA interrupt may take a little while to fire) */
 #define MCU_SYSTICK_VAL_FOR_AUX_RX_TO   7200    // Around 150us
+/* Same delay for the TC4 timer chaining messages sent to the AUX MCU, 48MHz divided by 16 */
+#define TC4_VAL_FOR_AUX_TX_GAP          450     // Around 150us
 
 /* PORT defines */
 /* WHEEL ENCODER */
@@ -0,0 +1,88 @@
+/* 
+ * This file is part of the Mooltipass Project (https://github.com/mooltipass).
+ * Copyright (c) 2019 Stephan Mathieu
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/*!  \file     profiler.c
+*    \brief    Cycle profiler for the firmware hot paths
+*    Created:  17/10/2026
+*    Author:   Mathieu Stephan
+*/
+#include <string.h>
+#include "driver_timer.h"
+#include "profiler.h"
+#ifdef HOT_PATH_PROFILER_ENABLED
+/* Accumulated timings, in MCU systick cycles */
+profiler_entry_t profiler_entries[PROFILER_NB_SECTIONS];
+/* Nesting depth for each section, so recursive calls aren't counted twice */
+uint8_t profiler_section_depth[PROFILER_NB_SECTIONS];
+
+
+/*! \fn     profiler_section_begin(profiler_section_te section)
+*   \brief  Start timing a profiled section
+*   \param  section     The section
+*   \return Current MCU systick value, to be given back to profiler_section_end
+*/
+uint32_t profiler_section_begin(profiler_section_te section)
+{
+    uint32_t systick_val;
+    
+    profiler_entries[section].nb_calls++;
+    profiler_section_depth[section]++;
+    timer_get_mcu_systick(&systick_val);
+    return systick_val;
+}
+
+/*! \fn     profiler_section_end(profiler_section_te section, uint32_t start_systick)
+*   \brief  Stop timing a profiled section
+*   \param  section         The section
+*   \param  start_systick   MCU systick value returned by profiler_section_begin
+*   \note   Only calls shorter than the systick period (~350ms) are correctly timed
+*/
+void profiler_section_end(profiler_section_te section, uint32_t start_systick)
+{
+    uint32_t systick_val;
+    timer_get_mcu_systick(&systick_val);
+    
+    /* Only time the outermost call */
+    if (--profiler_section_depth[section] != 0)
+    {
+        return;
+    }
+    
+    /* 24bits down counter */
+    uint32_t nb_cycles = (start_systick - systick_val) & 0x00FFFFFF;
+    profiler_entries[section].total_cycles += nb_cycles;
+    if (nb_cycles > profiler_entries[section].max_cycles)
+    {
+        profiler_entries[section].max_cycles = nb_cycles;
+    }
+}
+
+/*! \fn     profiler_get_entries(profiler_entry_t* entries, BOOL reset_entries)
+*   \brief  Get a copy of the profiler table
+*   \param  entries         Where to store the PROFILER_NB_SECTIONS entries
+*   \param  reset_entries   Set to TRUE to reset the table once copied
+*   \note   Nesting depths are kept: sections currently running will be accounted in the new table
+*/
+void profiler_get_entries(profiler_entry_t* entries, BOOL reset_entries)
+{
+    memcpy(entries, profiler_entries, sizeof(profiler_entries));
+    
+    if (reset_entries != FALSE)
+    {
+        memset(profiler_entries, 0, sizeof(profiler_entries));
+    }
+}
+#endif
@@ -0,0 +1,57 @@
+/* 
+ * This file is part of the Mooltipass Project (https://github.com/mooltipass).
+ * Copyright (c) 2019 Stephan Mathieu
+ * 
+ * This program is free software: you can redistribute it and/or modify  
+ * it under the terms of the GNU General Public License as published by  
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but 
+ * WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU 
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License 
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+/*!  \file     profiler.h
+*    \brief    Cycle profiler for the firmware hot paths
+*    Created:  17/10/2026
+*    Author:   Mathieu Stephan
+*/
+
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include "platform_defines.h"
+#include "defines.h"
+
+/* Enums */
+typedef enum    {PROFILER_DBFLASH_READ = 0, PROFILER_CUSTOM_FS_READ, PROFILER_OLED_FLUSH, PROFILER_AES_CTR, PROFILER_AUX_MCU_ROUTINE, PROFILER_GUI_SCREEN_RENDER, PROFILER_GUI_CAROUSEL_RENDER, PROFILER_NB_SECTIONS} profiler_section_te;
+
+/* Typedefs */
+typedef struct
+{
+    uint32_t nb_calls;          // Number of calls, recursive ones included
+    uint32_t max_cycles;        // Longest outermost call
+    uint64_t total_cycles;      // Cumulated outermost calls
+} profiler_entry_t;
+
+/* Macros: the section start lives in a local variable, so a section can only be opened once per scope. PROFILER_CALL times a single statement */
+#ifdef HOT_PATH_PROFILER_ENABLED
+    #define PROFILER_BEGIN(section)         uint32_t profiler_start_##section = profiler_section_begin(section)
+    #define PROFILER_END(section)           profiler_section_end(section, profiler_start_##section)
+    #define PROFILER_CALL(section, call)    do {PROFILER_BEGIN(section); call; PROFILER_END(section);} while(0)
+#else
+    #define PROFILER_BEGIN(section)
+    #define PROFILER_END(section)
+    #define PROFILER_CALL(section, call)    call
+#endif
+
+/* Prototypes */
+void profiler_section_end(profiler_section_te section, uint32_t start_systick);
+void profiler_get_entries(profiler_entry_t* entries, BOOL reset_entries);
+uint32_t profiler_section_begin(profiler_section_te section);
+
+#endif /* PROFILER_H_ */